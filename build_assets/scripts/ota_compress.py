@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Compressed OTA image tool (zlib, fixed window) for pull-OTA.
+
+What it does:
+- compress:  writes a zlib stream of firmware.bin (or a .wtd delta patch) that
+             the device can inflate with its CFG_OTA_INFLATE_WINDOW_BYTES window.
+- verify:    inflates with the same window limit and checks the SHA-256.
+- roundtrip: compress + inflate each given build, report ratio, fail on mismatch.
+
+The device inflater lives in level_sensor/src/ota_inflate.cpp. It keeps only a
+2^window_bits byte history, so streams must be compressed with window_bits no
+larger than the firmware's window (default 13 -> 8 KB). The manifest sha256
+always refers to the decompressed image.
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import sys
+import zlib
+from pathlib import Path
+from typing import List
+
+DEFAULT_WINDOW_BITS = 13
+CHUNK = 4096
+
+
+def compress(data: bytes, window_bits: int, level: int = 9) -> bytes:
+    comp = zlib.compressobj(level, zlib.DEFLATED, window_bits, 9)
+    return comp.compress(data) + comp.flush()
+
+
+def inflate(blob: bytes, window_bits: int) -> bytes:
+    # Declared window above our limit is rejected, matching ota_inflate_begin().
+    if len(blob) < 2 or (blob[0] & 0x0F) != 8:
+        raise ValueError("not a zlib stream")
+    declared = (blob[0] >> 4) + 8
+    if declared > window_bits:
+        raise ValueError(f"stream window 2^{declared} exceeds device window 2^{window_bits}")
+    # Feed in small chunks to mirror the device's streaming path.
+    dec = zlib.decompressobj(window_bits)
+    out = bytearray()
+    for off in range(0, len(blob), CHUNK):
+        out += dec.decompress(blob[off:off + CHUNK])
+    out += dec.flush()
+    if not dec.eof:
+        raise ValueError("truncated zlib stream")
+    if dec.unused_data:
+        raise ValueError("trailing data after zlib stream")
+    return bytes(out)
+
+
+def cmd_compress(args: argparse.Namespace) -> int:
+    data = Path(args.input).read_bytes()
+    blob = compress(data, args.window_bits)
+    if inflate(blob, args.window_bits) != data:
+        print("error: round-trip mismatch", file=sys.stderr)
+        return 1
+    Path(args.out).write_bytes(blob)
+    ratio = (100.0 * len(blob) / len(data)) if data else 0.0
+    print(f"{args.out}: {len(blob)} bytes ({ratio:.1f}% of {len(data)}) window=2^{args.window_bits} "
+          f"sha256(decompressed)={hashlib.sha256(data).hexdigest()}")
+    return 0
+
+
+def cmd_verify(args: argparse.Namespace) -> int:
+    blob = Path(args.input).read_bytes()
+    if args.new:
+        expected = hashlib.sha256(Path(args.new).read_bytes()).hexdigest()
+    elif args.sha256:
+        expected = args.sha256.lower()
+    else:
+        print("error: pass --new or --sha256", file=sys.stderr)
+        return 2
+    try:
+        got = hashlib.sha256(inflate(blob, args.window_bits)).hexdigest()
+    except (ValueError, zlib.error) as exc:
+        print(f"FAIL: {exc}", file=sys.stderr)
+        return 1
+    if got != expected:
+        print(f"FAIL: sha256 mismatch expected={expected} got={got}", file=sys.stderr)
+        return 1
+    print(f"OK: sha256={got}")
+    return 0
+
+
+def cmd_roundtrip(args: argparse.Namespace) -> int:
+    fail = 0
+    for path in args.inputs:
+        data = Path(path).read_bytes()
+        blob = compress(data, args.window_bits)
+        try:
+            ok = inflate(blob, args.window_bits) == data
+        except (ValueError, zlib.error) as exc:
+            print(f"FAIL {path}: {exc}", file=sys.stderr)
+            ok = False
+        ratio = (100.0 * len(blob) / len(data)) if data else 0.0
+        print(f"{'OK  ' if ok else 'FAIL'} {path}: {len(data)} -> {len(blob)} ({ratio:.1f}%)")
+        fail |= not ok
+    return 1 if fail else 0
+
+
+def parse_args(argv: List[str]) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Produce and check zlib-compressed OTA images.")
+    parser.add_argument("--window-bits", type=int, default=DEFAULT_WINDOW_BITS,
+                        help=f"deflate window (9..15), must not exceed the firmware's (default {DEFAULT_WINDOW_BITS})")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p_compress = sub.add_parser("compress", help="compress firmware.bin or a delta patch")
+    p_compress.add_argument("input")
+    p_compress.add_argument("out")
+    p_compress.set_defaults(func=cmd_compress)
+
+    p_verify = sub.add_parser("verify", help="inflate and check against NEW / a SHA-256")
+    p_verify.add_argument("input")
+    p_verify.add_argument("--new", help="expected decompressed file")
+    p_verify.add_argument("--sha256", help="expected sha256 of the decompressed data")
+    p_verify.set_defaults(func=cmd_verify)
+
+    p_round = sub.add_parser("roundtrip", help="compress + inflate each build and compare")
+    p_round.add_argument("inputs", nargs="+")
+    p_round.set_defaults(func=cmd_roundtrip)
+
+    args = parser.parse_args(argv)
+    if not 9 <= args.window_bits <= 15:
+        parser.error("--window-bits must be within 9..15")
+    return args
+
+
+def main(argv: List[str]) -> int:
+    args = parse_args(argv)
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+"""
+Delta firmware patch tool (WTD1 format) for pull-OTA.
+
+What it does:
+- make:   builds a patch that turns OLD firmware.bin into NEW firmware.bin.
+- apply:  reconstructs NEW from OLD + patch (same semantics as the device).
+- verify: applies a patch and checks the result against NEW or a SHA-256.
+
+The device decoder lives in level_sensor/src/ota_delta.cpp. Layout (little-endian):
+  header: b"WTD1" | u32 target_size | u32 source_size | 32B sha256(source)
+  ops:    0x01 COPY src_off u32, len u32
+          0x02 ADD  src_off u32, len u32, len bytes (new = old + d mod 256)
+          0x03 DATA len u32, len bytes
+          0x00 END
+
+Matching is a greedy block-index search: exact runs become COPY, and the gaps
+between runs become ADD against the aligned old bytes when they are mostly
+similar (relocated code/data), otherwise DATA. ADD bodies are mostly zeros, so
+they shrink well if the patch is compressed for transport.
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import json
+import struct
+import sys
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+MAGIC = b"WTD1"
+OP_END = 0x00
+OP_COPY = 0x01
+OP_ADD = 0x02
+OP_DATA = 0x03
+
+BLOCK = 32
+INDEX_STEP = 4
+MIN_MATCH = 48
+ADD_MIN_SIMILARITY = 0.5
+MAX_OP_LEN = 0xFFFFFFFF
+
+
+class PatchError(Exception):
+    pass
+
+
+def sha256_hex(data: bytes) -> str:
+    return hashlib.sha256(data).hexdigest()
+
+
+def build_index(old: bytes) -> Dict[bytes, int]:
+    index: Dict[bytes, int] = {}
+    for off in range(0, len(old) - BLOCK + 1, INDEX_STEP):
+        index.setdefault(old[off:off + BLOCK], off)
+    return index
+
+
+def match_forward(old: bytes, o: int, new: bytes, n: int) -> int:
+    length = 0
+    limit = min(len(old) - o, len(new) - n)
+    step = 256
+    while length + step <= limit and old[o + length:o + length + step] == new[n + length:n + length + step]:
+        length += step
+    while length < limit and old[o + length] == new[n + length]:
+        length += 1
+    return length
+
+
+def similarity(old: bytes, o: int, new: bytes, n: int, length: int) -> float:
+    if o < 0 or length <= 0 or o + length > len(old):
+        return 0.0
+    same = sum(1 for a, b in zip(old[o:o + length], new[n:n + length]) if a == b)
+    return same / length
+
+
+def emit_gap(ops: List[Tuple], old: bytes, new: bytes, start: int, end: int, hints: List[int]) -> None:
+    """Encode new[start:end] as ADD against the best-aligned old offset, or DATA."""
+    length = end - start
+    if length <= 0:
+        return
+    best_off: Optional[int] = None
+    best_sim = 0.0
+    for off in hints:
+        sim = similarity(old, off, new, start, length)
+        if sim > best_sim:
+            best_off, best_sim = off, sim
+    if best_off is not None and best_sim >= ADD_MIN_SIMILARITY:
+        diff = bytes((b - a) & 0xFF for a, b in zip(old[best_off:best_off + length], new[start:end]))
+        ops.append((OP_ADD, best_off, diff))
+    else:
+        ops.append((OP_DATA, new[start:end]))
+
+
+def diff(old: bytes, new: bytes) -> List[Tuple]:
+    index = build_index(old)
+    ops: List[Tuple] = []
+    gap_start = 0
+    prev_src_end = 0
+    i = 0
+    while i <= len(new) - BLOCK:
+        o = index.get(new[i:i + BLOCK])
+        if o is None:
+            i += 1
+            continue
+        length = match_forward(old, o, new, i)
+        back = 0
+        while i - back > gap_start and o - back > 0 and old[o - back - 1] == new[i - back - 1]:
+            back += 1
+        if length + back < MIN_MATCH:
+            i += 1
+            continue
+        start, src = i - back, o - back
+        gap_len = start - gap_start
+        emit_gap(ops, old, new, gap_start, start, [prev_src_end, src - gap_len])
+        ops.append((OP_COPY, src, length + back))
+        i = start + length + back
+        gap_start = i
+        prev_src_end = src + length + back
+    emit_gap(ops, old, new, gap_start, len(new), [prev_src_end])
+    return ops
+
+
+def encode(old: bytes, new: bytes, ops: List[Tuple]) -> bytes:
+    out = bytearray()
+    out += MAGIC
+    out += struct.pack("<II", len(new), len(old))
+    out += hashlib.sha256(old).digest()
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[1], op[2])
+        elif op[0] == OP_ADD:
+            out += struct.pack("<BII", OP_ADD, op[1], len(op[2]))
+            out += op[2]
+        else:
+            out += struct.pack("<BI", OP_DATA, len(op[1]))
+            out += op[1]
+    out.append(OP_END)
+    return bytes(out)
+
+
+def apply_patch(old: bytes, patch: bytes) -> bytes:
+    if len(patch) < 44 or patch[:4] != MAGIC:
+        raise PatchError("bad header")
+    target_size, source_size = struct.unpack_from("<II", patch, 4)
+    if source_size > len(old):
+        raise PatchError("source shorter than patch expects")
+    if hashlib.sha256(old[:source_size]).digest() != patch[12:44]:
+        raise PatchError("source sha256 mismatch")
+    src = old[:source_size]
+    out = bytearray()
+    pos = 44
+    while True:
+        if pos >= len(patch):
+            raise PatchError("truncated (missing END)")
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op in (OP_COPY, OP_ADD):
+            off, length = struct.unpack_from("<II", patch, pos)
+            pos += 8
+            if length == 0 or off + length > source_size:
+                raise PatchError(f"source range out of bounds at {pos}")
+        elif op == OP_DATA:
+            (length,) = struct.unpack_from("<I", patch, pos)
+            pos += 4
+            if length == 0:
+                raise PatchError(f"empty op at {pos}")
+        else:
+            raise PatchError(f"bad opcode 0x{op:02x} at {pos - 1}")
+        if len(out) + length > target_size:
+            raise PatchError("target overflow")
+        if op == OP_COPY:
+            out += src[off:off + length]
+            continue
+        body = patch[pos:pos + length]
+        if len(body) != length:
+            raise PatchError("truncated op body")
+        pos += length
+        if op == OP_ADD:
+            out += bytes((a + d) & 0xFF for a, d in zip(src[off:off + length], body))
+        else:
+            out += body
+    if pos != len(patch):
+        raise PatchError("trailing data after END")
+    if len(out) != target_size:
+        raise PatchError("target size mismatch")
+    return bytes(out)
+
+
+def summarize(ops: List[Tuple]) -> str:
+    copy = sum(op[2] for op in ops if op[0] == OP_COPY)
+    add = sum(len(op[2]) for op in ops if op[0] == OP_ADD)
+    data = sum(len(op[1]) for op in ops if op[0] == OP_DATA)
+    return f"ops={len(ops)} copy={copy} add={add} data={data}"
+
+
+def cmd_make(args: argparse.Namespace) -> int:
+    old = Path(args.old).read_bytes()
+    new = Path(args.new).read_bytes()
+    ops = diff(old, new)
+    patch = encode(old, new, ops)
+    if apply_patch(old, patch) != new:
+        print("error: generated patch does not reproduce NEW", file=sys.stderr)
+        return 1
+    Path(args.out).write_bytes(patch)
+    ratio = (100.0 * len(patch) / len(new)) if new else 0.0
+    print(f"patch={args.out} size={len(patch)} ({ratio:.1f}% of {len(new)}) {summarize(ops)}", file=sys.stderr)
+    entry = {
+        "from_version": args.from_version or "",
+        "from_sha256": sha256_hex(old),
+        "url": args.url or "",
+    }
+    print(json.dumps(entry, indent=2))
+    return 0
+
+
+def cmd_apply(args: argparse.Namespace) -> int:
+    old = Path(args.old).read_bytes()
+    patch = Path(args.patch).read_bytes()
+    try:
+        new = apply_patch(old, patch)
+    except PatchError as exc:
+        print(f"error: {exc}", file=sys.stderr)
+        return 1
+    Path(args.out).write_bytes(new)
+    print(f"wrote {args.out} size={len(new)} sha256={sha256_hex(new)}", file=sys.stderr)
+    return 0
+
+
+def cmd_verify(args: argparse.Namespace) -> int:
+    old = Path(args.old).read_bytes()
+    patch = Path(args.patch).read_bytes()
+    if args.new:
+        expected = sha256_hex(Path(args.new).read_bytes())
+    elif args.sha256:
+        expected = args.sha256.lower()
+    else:
+        print("error: pass --new or --sha256", file=sys.stderr)
+        return 2
+    try:
+        got = sha256_hex(apply_patch(old, patch))
+    except PatchError as exc:
+        print(f"FAIL: {exc}", file=sys.stderr)
+        return 1
+    if got != expected:
+        print(f"FAIL: sha256 mismatch expected={expected} got={got}", file=sys.stderr)
+        return 1
+    print(f"OK: sha256={got}")
+    return 0
+
+
+def parse_args(argv: List[str]) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Generate and verify WTD1 firmware delta patches.")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p_make = sub.add_parser("make", help="create a patch from OLD to NEW; prints a manifest delta entry")
+    p_make.add_argument("old", help="firmware.bin currently on devices")
+    p_make.add_argument("new", help="firmware.bin being released")
+    p_make.add_argument("out", help="patch output path")
+    p_make.add_argument("--from-version", help="version string of OLD (manifest from_version)")
+    p_make.add_argument("--url", help="release asset URL the patch will be served from")
+    p_make.set_defaults(func=cmd_make)
+
+    p_apply = sub.add_parser("apply", help="reconstruct NEW from OLD and a patch")
+    p_apply.add_argument("old")
+    p_apply.add_argument("patch")
+    p_apply.add_argument("out")
+    p_apply.set_defaults(func=cmd_apply)
+
+    p_verify = sub.add_parser("verify", help="check that OLD + patch reproduces NEW / a SHA-256")
+    p_verify.add_argument("old")
+    p_verify.add_argument("patch")
+    p_verify.add_argument("--new", help="expected firmware.bin")
+    p_verify.add_argument("--sha256", help="expected sha256 (e.g. manifest sha256)")
+    p_verify.set_defaults(func=cmd_verify)
+
+    return parser.parse_args(argv)
+
+
+def main(argv: List[str]) -> int:
+    args = parse_args(argv)
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -50,6 +50,39 @@ for manifest in "${manifest_files[@]}"; do
     echo "::error file=${manifest}::Field 'sha256' must be a 64-character hex string" >&2
     fail=1
   fi
+
+  # Optional zlib-compressed image (sha256 still refers to the decompressed firmware.bin).
+  url_zlib="$(jq -r '.url_zlib // ""' "${manifest}")"
+  if [[ -n "${url_zlib}" && ! "${url_zlib}" =~ ^https:// ]]; then
+    echo "::error file=${manifest}::Field 'url_zlib' must start with https://" >&2
+    fail=1
+  fi
+
+  # Optional delta patches: [{from_version, from_sha256, url}, ...]
+  delta_type="$(jq -r '.delta | type' "${manifest}")"
+  if [[ "${delta_type}" != "null" && "${delta_type}" != "array" ]]; then
+    echo "::error file=${manifest}::Field 'delta' must be an array" >&2
+    fail=1
+  elif [[ "${delta_type}" == "array" ]]; then
+    delta_count="$(jq -r '.delta | length' "${manifest}")"
+    for ((i = 0; i < delta_count; i++)); do
+      from_version="$(jq -r ".delta[${i}].from_version // \"\"" "${manifest}")"
+      from_sha256="$(jq -r ".delta[${i}].from_sha256 // \"\"" "${manifest}")"
+      delta_url="$(jq -r ".delta[${i}].url // \"\"" "${manifest}")"
+      if [[ -z "${from_version}" ]]; then
+        echo "::error file=${manifest}::delta[${i}] missing from_version" >&2
+        fail=1
+      fi
+      if [[ ! "${from_sha256}" =~ ^[0-9a-fA-F]{64}$ ]]; then
+        echo "::error file=${manifest}::delta[${i}].from_sha256 must be a 64-character hex string" >&2
+        fail=1
+      fi
+      if [[ ! "${delta_url}" =~ ^https:// ]]; then
+        echo "::error file=${manifest}::delta[${i}].url must start with https://" >&2
+        fail=1
+      fi
+    done
+  fi
 done
 
 if [[ ${fail} -ne 0 ]]; then
@@ -0,0 +1,138 @@
+#pragma once
+#include <stdint.h>
+
+// Adaptive sampling controller: estimates the level trend from the smoothed
+// percent and picks SENSOR/COMPUTE window intervals for it. The trend is a
+// least-squares slope over the last CFG_ADAPT_TREND_WINDOW_MS (exponentially
+// weighted), and only the part of it that stands clear of its own standard
+// error counts, so reading noise does not look like a fill. The slow cadence
+// is only entered after the level has been quiet for CFG_ADAPT_STATIC_HOLD_MS,
+// and the cadence is never slowed before the current mode has been held for
+// CFG_ADAPT_MIN_DWELL_MS (speeding up is immediate). A token bucket bounds the
+// routine (per-sample) state publishes. The caller passes millis() in;
+// test/test_adaptive_sampler compares it against fixed-rate sampling.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_ADAPTIVE_SAMPLING
+#define CFG_ADAPTIVE_SAMPLING 1
+#endif
+
+#ifndef CFG_ADAPT_FAST_RAW_MS
+#define CFG_ADAPT_FAST_RAW_MS 500u
+#endif
+// Upper bound only: the firmware lowers it to the runtime quality windows via
+// sampler_rawCapMs so the spike and zero-hit detectors still get enough samples.
+#ifndef CFG_ADAPT_SLOW_RAW_MS
+#define CFG_ADAPT_SLOW_RAW_MS 4000u
+#endif
+#ifndef CFG_ADAPT_FAST_COMPUTE_MS
+#define CFG_ADAPT_FAST_COMPUTE_MS 1000u
+#endif
+#ifndef CFG_ADAPT_SLOW_COMPUTE_MS
+#define CFG_ADAPT_SLOW_COMPUTE_MS 15000u
+#endif
+
+#ifndef CFG_ADAPT_ACTIVE_RATE_PCT_PER_MIN
+#define CFG_ADAPT_ACTIVE_RATE_PCT_PER_MIN 0.5f
+#endif
+#ifndef CFG_ADAPT_STATIC_RATE_PCT_PER_MIN
+#define CFG_ADAPT_STATIC_RATE_PCT_PER_MIN 0.1f
+#endif
+#ifndef CFG_ADAPT_STATIC_HOLD_MS
+#define CFG_ADAPT_STATIC_HOLD_MS 120000u
+#endif
+// Time constant of the trend regression.
+#ifndef CFG_ADAPT_TREND_WINDOW_MS
+#define CFG_ADAPT_TREND_WINDOW_MS 60000u
+#endif
+#ifndef CFG_ADAPT_MIN_DWELL_MS
+#define CFG_ADAPT_MIN_DWELL_MS 60000u
+#endif
+
+#ifndef CFG_ADAPT_PUBLISH_BURST
+#define CFG_ADAPT_PUBLISH_BURST 5u
+#endif
+#ifndef CFG_ADAPT_PUBLISH_PER_MIN
+#define CFG_ADAPT_PUBLISH_PER_MIN 12u
+#endif
+
+enum class SamplerMode : uint8_t
+{
+    NORMAL = 0, // configured CFG_RAW_SAMPLE_MS / CFG_PERCENT_SAMPLE_MS
+    STATIC,
+    ACTIVE
+};
+
+struct SamplerConfig
+{
+    uint32_t normalRawMs;
+    uint32_t normalComputeMs;
+    uint32_t fastRawMs;
+    uint32_t fastComputeMs;
+    uint32_t slowRawMs;
+    uint32_t slowComputeMs;
+    float activeRatePctPerMin;
+    float staticRatePctPerMin;
+    uint32_t staticHoldMs;
+    uint32_t trendWindowMs;
+    uint32_t minDwellMs;
+    uint8_t publishBurst;
+    uint8_t publishPerMin;
+};
+
+// Weighted sums of the trend regression, with t (seconds) and p (percent)
+// taken relative to the newest sample so they stay small in float.
+struct SamplerTrend
+{
+    uint16_t samples;
+    float w;
+    float w2;
+    float t;
+    float tt;
+    float p;
+    float pp;
+    float tp;
+};
+
+struct SamplerState
+{
+    SamplerMode mode;
+    bool hasLast;
+    float lastPercent;
+    uint32_t lastMs;
+    SamplerTrend trend;
+    float slopePctPerMin;   // regression slope (signed)
+    float slopeSePctPerMin; // its standard error
+    uint32_t modeSinceMs;
+    uint32_t quietSinceMs;
+    bool quiet;
+    uint32_t rawMs;
+    uint32_t computeMs;
+    float publishTokens;
+    uint32_t publishTokenMs;
+    uint32_t modeChanges;
+};
+
+void sampler_init(SamplerState &st, const SamplerConfig &cfg, uint32_t nowMs);
+
+// Feed one smoothed percent (COMPUTE cadence). Returns true when the mode (and
+// so rawMs/computeMs) changed.
+bool sampler_update(SamplerState &st, const SamplerConfig &cfg, float percent, bool valid, uint32_t nowMs);
+
+// Routine publish budget; events (connect/quality changes) bypass it.
+bool sampler_takePublishToken(SamplerState &st, const SamplerConfig &cfg, uint32_t nowMs);
+
+// Longest raw interval that still puts `hits` samples inside `windowMs`
+// (windowMs / hits, at least 1 ms). UINT32_MAX when hits is 0.
+uint32_t sampler_rawCapMs(uint32_t windowMs, uint8_t hits);
+
+// Re-apply the current mode's intervals after cfg changed. Returns true when
+// rawMs or computeMs moved.
+bool sampler_reconfigure(SamplerState &st, const SamplerConfig &cfg);
+
+const char *sampler_modeLabel(SamplerMode mode);
@@ -0,0 +1,115 @@
+#pragma once
+#include <stdint.h>
+#include "device_state.h"
+#include "quality.h"
+
+// Statistical tier behind the fixed thresholds of quality_evaluate(). Each
+// sample is compared with a local-trend prediction (level + slope on the sample
+// clock, so fills and drains are not anomalies) and the prediction error feeds
+// three O(1) detectors:
+//   - Welford mean/variance of the error (exact during warm-up, exponentially
+//     forgetting over `window` samples after): sustained noise -> ANOMALY_NOISE.
+//   - Median of |error|, tracked by multiplicative quantile steps. Not a true
+//     MAD (no median is subtracted); the trend keeps the error centred near
+//     zero, where the two agree. Robust scale: |error| > outlierK * scale ->
+//     ANOMALY_OUTLIER.
+//   - Two-sided CUSUM of the scaled error: a persistent jump the trend does not
+//     explain -> ANOMALY_SHIFT (held for holdMs), after which the model rebases.
+// Only samples the threshold tier passed as OK are re-judged; its other verdicts
+// stand. Off by default: enable per device with set_anomaly or `anomaly on`.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_ANOMALY_ENABLED
+#define CFG_ANOMALY_ENABLED 0
+#endif
+
+#ifndef CFG_ANOMALY_WINDOW
+#define CFG_ANOMALY_WINDOW 64u // samples of memory for the error statistics
+#endif
+
+#ifndef CFG_ANOMALY_WARMUP
+#define CFG_ANOMALY_WARMUP 32u // samples before any verdict
+#endif
+
+#ifndef CFG_ANOMALY_OUTLIER_K
+#define CFG_ANOMALY_OUTLIER_K 8.0f // robust z of a single-sample outlier
+#endif
+
+#ifndef CFG_ANOMALY_NOISE_STD
+#define CFG_ANOMALY_NOISE_STD 1500.0f // raw counts; error std above this is noise
+#endif
+
+#ifndef CFG_ANOMALY_CUSUM_K
+#define CFG_ANOMALY_CUSUM_K 1.0f // allowance per sample, in robust sigmas
+#endif
+
+#ifndef CFG_ANOMALY_CUSUM_H
+#define CFG_ANOMALY_CUSUM_H 16.0f // alarm level, in robust sigmas
+#endif
+
+#ifndef CFG_ANOMALY_MIN_SIGMA
+#define CFG_ANOMALY_MIN_SIGMA 100.0f // raw counts; floor for the robust scale
+#endif
+
+#ifndef CFG_ANOMALY_HOLD_MS
+#define CFG_ANOMALY_HOLD_MS 30000u
+#endif
+
+// Persisted as an NVS side blob; bump its version in storage_nvs.cpp when the layout changes.
+struct AnomalyConfig
+{
+    bool enabled;
+    uint8_t reserved;
+    uint16_t window;
+    uint16_t warmup;
+    uint16_t reserved2;
+    float outlierK;
+    float noiseStd;
+    float cusumK;
+    float cusumH;
+    float minSigma;
+    uint32_t holdMs;
+};
+
+struct AnomalyState
+{
+    uint32_t n;         // samples seen since the last reset (saturating)
+    uint32_t lastMs;
+    float level;        // trend model
+    float slopePerMs;
+    float errMean;      // Welford / exponentially weighted
+    float errVar;
+    float errM2;        // warm-up only
+    float medAbsErr;    // median |error|; sigma = 1.4826 * this
+    float cusumPos;
+    float cusumNeg;
+    bool noisy;
+    ProbeQualityReason held; // ANOMALY_SHIFT while heldUntilMs is ahead
+    uint32_t heldUntilMs;
+};
+
+struct AnomalyResult
+{
+    QualityResult quality;
+    // Confidence in the verdict, 0..100: 50 at a detector's threshold, rising
+    // as its statistic moves away from it. 0 while warming up or disabled;
+    // threshold-tier verdicts other than OK report 100.
+    uint8_t confidence;
+};
+
+void anomaly_configDefaults(AnomalyConfig &cfg);
+bool anomaly_validateConfig(const AnomalyConfig &cfg);
+
+void anomaly_init(AnomalyState &st);
+
+// Robust scale (raw counts) the outlier and CUSUM tests currently use.
+float anomaly_sigma(const AnomalyState &st, const AnomalyConfig &cfg);
+
+// Feed one sample with the threshold tier's result for it.
+AnomalyResult anomaly_evaluate(AnomalyState &st, const AnomalyConfig &cfg, uint32_t raw, uint32_t nowMs,
+                               const QualityResult &base);
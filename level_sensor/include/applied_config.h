@@ -3,27 +3,88 @@
 #include <stdint.h>
 
 #include "device_state.h"
+#include "tank_geometry.h"
+#include "cal_curve.h"
+#include "quality_config.h"
 
 struct AppliedConfig
 {
     float tankVolumeLiters;
     float rodLengthCm;
+    TankGeometry tankGeometry;
     SenseMode senseMode;
     uint8_t simulationMode;
 
     uint32_t calDry;
     uint32_t calWet;
     bool calInverted;
+    CalCurve calCurve;
+
+    QualityConfig quality;
 };
 
-// Load config from NVS at boot; marks dirty=false after initial load.
+// Individually updatable fields. A field's generation counter is bumped each
+// time a setter changes its stored value; listeners are told which fields changed.
+enum class ConfigField : uint8_t
+{
+    TANK_VOLUME = 0,
+    ROD_LENGTH,
+    SENSE_MODE,
+    SIMULATION_MODE,
+    CAL_DRY,
+    CAL_WET,
+    CAL_INVERTED,
+    TANK_GEOMETRY,
+    CAL_CURVE,
+    QUALITY,
+    COUNT
+};
+
+constexpr uint32_t config_fieldBit(ConfigField field)
+{
+    return 1u << (uint8_t)field;
+}
+
+constexpr uint32_t CONFIG_FIELDS_TANK =
+    config_fieldBit(ConfigField::TANK_VOLUME) | config_fieldBit(ConfigField::ROD_LENGTH) |
+    config_fieldBit(ConfigField::TANK_GEOMETRY);
+constexpr uint32_t CONFIG_FIELDS_SENSE =
+    config_fieldBit(ConfigField::SENSE_MODE) | config_fieldBit(ConfigField::SIMULATION_MODE);
+constexpr uint32_t CONFIG_FIELDS_CALIBRATION =
+    config_fieldBit(ConfigField::CAL_DRY) | config_fieldBit(ConfigField::CAL_WET) | config_fieldBit(ConfigField::CAL_INVERTED) |
+    config_fieldBit(ConfigField::CAL_CURVE);
+constexpr uint32_t CONFIG_FIELDS_QUALITY = config_fieldBit(ConfigField::QUALITY);
+
+// Called synchronously from the setter with the subset of the subscribed mask that changed.
+using ConfigListener = void (*)(uint32_t changedFields);
+
+// Load config from NVS at boot. This is the only full load; afterwards the
+// cache is kept current by the setters below (write-through to storage).
 void config_begin();
 
-// Mark configuration dirty after a successful NVS write.
-void config_markDirty();
+// Subscribe to changes of the fields in fieldMask; false when the table is full.
+bool config_subscribe(uint32_t fieldMask, ConfigListener listener);
+
+// Setters persist the stored value, refresh the applied view (validated the same
+// way as at boot) and notify listeners. They return false when nothing changed.
+bool config_setTankVolume(float liters);
+bool config_setRodLength(float cm);
+// Callers validate first (tank_validateGeometry); an invalid shape is stored but applied as a vertical cylinder.
+bool config_setTankGeometry(const TankGeometry &geometry);
+bool config_setSenseMode(SenseMode mode);
+bool config_setSimulationMode(uint8_t mode);
+bool config_setCalibrationDry(int32_t dry);
+bool config_setCalibrationWet(int32_t wet);
+bool config_setCalibrationInverted(bool inverted);
+// Intermediate point at a known level; false when rejected (see cal_curveInsert).
+bool config_addCalibrationPoint(int32_t raw, float percent);
+bool config_clearCalibrationCurve();
+// Clears dry/wet/inverted and the curve.
+bool config_clearCalibration();
+// Invalid sets (quality_validateConfig) are rejected; only a change is stored.
+bool config_setQuality(const QualityConfig &quality);
 
-// If dirty, reload from NVS and clear dirty; returns true if reloaded.
-bool config_reloadIfDirty();
+uint32_t config_generation(ConfigField field);
 
-// Access the cached applied config (authoritative in RAM after last reload).
+// Access the cached applied config (authoritative in RAM).
 const AppliedConfig &config_get();
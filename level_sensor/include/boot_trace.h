@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-size boot trace: microsecond timestamps of named boot events, recorded
+// from reset until CFG_BOOT_TRACE_WINDOW_MS (or the table fills), then frozen
+// and kept in RAM until it has been published to system/boot_trace once.
+// Labels must be string literals; only the pointer is stored.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_BOOT_TRACE_EVENTS
+#define CFG_BOOT_TRACE_EVENTS 32
+#endif
+
+#ifndef CFG_BOOT_TRACE_WINDOW_MS
+#define CFG_BOOT_TRACE_WINDOW_MS 60000u
+#endif
+
+void boot_trace_mark(const char *label);
+bool boot_trace_isOpen();  // still recording
+bool boot_trace_pending(); // closed and not yet published
+void boot_trace_markPublished();
+bool boot_trace_buildJson(char *out, size_t outSize, const char *fw, uint32_t bootCount, const char *resetReason);
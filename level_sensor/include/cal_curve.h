@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+// Intermediate calibration points between dry (0 %) and wet (100 %). Touch
+// response along the rod is not linear, so each point pins the raw reading
+// seen at a known level; level_prepare() turns dry, these points and wet into
+// a piecewise-linear map.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_CAL_CURVE_MAX_POINTS
+#define CFG_CAL_CURVE_MAX_POINTS 8
+#endif
+
+struct CalCurvePoint
+{
+    int32_t raw;
+    uint16_t percentX100; // level in 0.01 %, exclusive of 0 and 100 %
+    uint16_t reserved;
+};
+
+// Persisted as one NVS blob, points sorted by percent.
+struct CalCurve
+{
+    uint8_t count;
+    uint8_t reserved[3];
+    CalCurvePoint points[CFG_CAL_CURVE_MAX_POINTS];
+};
+
+void cal_curveClear(CalCurve &curve);
+bool cal_curveValidate(const CalCurve &curve);
+
+// Insert (or replace the raw of an existing point at the same level).
+// false for a level outside (0, 100) % or when the table is full.
+bool cal_curveInsert(CalCurve &curve, int32_t raw, float percent);
@@ -3,6 +3,9 @@
 #include <stdint.h>
 
 #include "device_state.h"
+#include "tank_geometry.h"
+#include "anomaly.h"
+#include "quality_config.h"
 
 // Callback bundle that lets commands mutate state without globals.
 struct CommandsContext
@@ -11,7 +14,10 @@ struct CommandsContext
 
     void (*updateTankVolume)(float liters, bool forcePublish);
     void (*updateRodLength)(float cm, bool forcePublish);
+    void (*updateTankGeometry)(const TankGeometry &geometry, bool forcePublish);
     void (*captureCalibrationPoint)(bool isDry);
+    bool (*captureCalibrationLevel)(float percent); // intermediate point at a known level
+    void (*clearCalibrationCurve)();
     void (*clearCalibration)();
     void (*setSenseMode)(SenseMode mode, bool forcePublish, const char *sourceMsg);
     void (*setSimulationModeInternal)(uint8_t mode, bool forcePublish, const char *sourceMsg);
@@ -19,6 +25,13 @@ struct CommandsContext
     void (*setCalibrationWetValue)(int32_t value, const char *sourceMsg);
     void (*reannounce)();
     void (*wipeWifiCredentials)();
+    // Offline quality evaluation of the selected replay trace (0 = default threshold).
+    bool (*evaluateReplay)(uint32_t stuckMs, uint32_t spikeWindowMs, uint32_t calRecommendWindowMs, bool driftComp,
+                           bool anomaly);
+    void (*setDriftTau)(uint32_t tauS); // 0 disables drift compensation
+    void (*getAnomalyConfig)(AnomalyConfig &cfg);
+    void (*setAnomalyConfig)(const AnomalyConfig &cfg); // validated; persisted by the device
+    void (*updateQualityConfig)(const QualityConfig &qc, bool forcePublish); // validated
 
     void (*requestStatePublish)();
     bool (*publishAck)(const char *requestId, const char *type, const char *status, const char *msg);
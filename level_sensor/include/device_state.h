@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include "quality_config.h"
 
 // Keep schema version explicit so consumers can evolve safely
 static constexpr uint8_t STATE_SCHEMA_VERSION = 1;
@@ -28,6 +29,16 @@ enum class SenseMode : uint8_t
     SIM = 1
 };
 
+// Tank shape for the height -> volume model (tank_geometry.h).
+enum class TankShape : uint8_t
+{
+    VERTICAL_CYLINDER = 0,
+    HORIZONTAL_CYLINDER = 1,
+    RECTANGULAR = 2,
+    CONE_BOTTOM = 3,
+    STRAPPING = 4
+};
+
 enum class CalibrationState : uint8_t
 {
     NEEDS = 0,
@@ -45,6 +56,9 @@ enum class ProbeQualityReason : uint8_t
     OUT_OF_BOUNDS,
     CALIBRATION_RECOMMENDED,
     ZERO_HITS,
+    ANOMALY_OUTLIER, // statistical tier (anomaly.h)
+    ANOMALY_NOISE,
+    ANOMALY_SHIFT,
     UNKNOWN
 };
 
@@ -89,6 +103,8 @@ struct ProbeInfo
     SenseMode senseMode;
     int32_t raw; // 32-bit raw reading for consistency across probe/calibration paths
     bool rawValid;
+    float driftOffset; // subtracted from the touch reading before raw (drift_comp.h)
+    uint8_t qualityConfidence; // 0..100, statistical tier (anomaly.h)
 };
 
 struct CalibrationInfo
@@ -98,6 +114,7 @@ struct CalibrationInfo
     int32_t wet;
     bool inverted;
     int32_t minDiff;
+    uint8_t curvePoints; // intermediate points in use
 };
 
 struct LevelInfo
@@ -114,8 +131,10 @@ struct ConfigInfo
 {
     float tankVolumeLiters;
     float rodLengthCm;
+    TankShape tankShape;
     SenseMode senseMode;
     uint8_t simulationMode;
+    QualityConfig quality;
 };
 
 struct TimeInfo
@@ -139,6 +158,29 @@ enum class OtaStatus : uint8_t
     RETRYING = 7
 };
 
+// Timing/throughput of the last pull OTA attempt (success or terminal failure).
+// Plain POD so it can travel through ota_events and be persisted as an NVS side
+// blob (CRC over every byte, hence the explicit tail padding).
+struct OtaStats
+{
+    uint32_t dns_ms;        // resolve firmware host
+    uint32_t tls_ms;        // TCP connect + TLS handshake to firmware host
+    uint32_t first_byte_ms; // GET sent -> response headers (includes redirect hops)
+    uint32_t download_ms;   // body streamed + flushed to flash
+    uint32_t verify_ms;     // SHA-256 check + esp_ota_end image validation
+    uint32_t switch_ms;     // esp_ota_set_boot_partition
+    uint32_t bytes;
+    uint32_t avg_kbps;
+    uint32_t min_kbps;      // slowest 1 s window while downloading
+    uint32_t stall_ms;      // zero-read gaps >= CFG_OTA_STREAM_STALL_MS
+    uint16_t stall_count;
+    uint8_t net_retries;    // HTTP/TLS retries across the job
+    uint8_t retries;        // full download restarts
+    uint8_t tls_handshakes; // TLS handshakes incl. redirect hops and retries
+    uint8_t tls_resumed;    // of which resumed a cached session
+    uint16_t reserved;
+};
+
 struct OtaState
 {
     OtaStatus status = OtaStatus::IDLE;
@@ -155,6 +197,7 @@ struct OtaState
     char last_status[OTA_STATUS_MAX] = {0};
     char last_message[OTA_MESSAGE_MAX] = {0};
     uint32_t completed_ts = 0; // epoch seconds (0 if time not set)
+    OtaStats stats{};
 };
 
 struct LastCmdInfo
@@ -15,6 +15,7 @@ namespace domain_strings
 #endif
 
     StringView to_string(SenseMode v);
+    StringView to_string(TankShape v);
     StringView to_string(CalibrationState v);
     StringView to_string(ProbeQualityReason v);
     StringView to_string(CmdStatus v);
@@ -32,6 +33,7 @@ namespace domain_strings
 
 // Legacy wrappers (keep temporarily for existing call sites).
 inline const char *toString(SenseMode v) { return domain_strings::c_str(domain_strings::to_string(v)); }
+inline const char *toString(TankShape v) { return domain_strings::c_str(domain_strings::to_string(v)); }
 inline const char *toString(CalibrationState v) { return domain_strings::c_str(domain_strings::to_string(v)); }
 inline const char *toString(ProbeQualityReason v) { return domain_strings::c_str(domain_strings::to_string(v)); }
 inline const char *toString(CmdStatus v) { return domain_strings::c_str(domain_strings::to_string(v)); }
@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+
+// Baseline drift compensation for touch readings. touchRead() creeps with
+// temperature and humidity while the water does not move, which shows up as
+// slow percent drift and, once the reading leaves the calibrated range, as
+// CALIBRATION_RECOMMENDED. While the (corrected) reading has stayed inside a
+// small band for stableMs the level is taken as constant and any further slow
+// change is attributed to drift: the offset follows it with time constant tau.
+// When the level moves the offset is held. Callers pass nowMs, which is how
+// test_drift_comp replays a day of readings in one run.
+//
+// A real level change slower than band / tau is indistinguishable from drift
+// and is absorbed too, up to maxOffset counts.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_DRIFT_TAU_S
+#define CFG_DRIFT_TAU_S 300u // adaptation time constant; 0 disables compensation
+#endif
+
+#ifndef CFG_DRIFT_STABLE_MS
+#define CFG_DRIFT_STABLE_MS 300000u // quiet time before the level counts as stable
+#endif
+
+#ifndef CFG_DRIFT_STABLE_BAND
+#define CFG_DRIFT_STABLE_BAND 40u // raw counts
+#endif
+
+#ifndef CFG_DRIFT_MAX_OFFSET
+#define CFG_DRIFT_MAX_OFFSET 1500.0f // raw counts, either direction
+#endif
+
+#ifndef CFG_DRIFT_FAST_ALPHA
+#define CFG_DRIFT_FAST_ALPHA 0.1f // per-sample smoothing before the band check
+#endif
+
+// The offset is persisted when it moved by this much, at most every CFG_DRIFT_PERSIST_MS.
+#ifndef CFG_DRIFT_PERSIST_DELTA
+#define CFG_DRIFT_PERSIST_DELTA 10.0f
+#endif
+
+#ifndef CFG_DRIFT_PERSIST_MS
+#define CFG_DRIFT_PERSIST_MS 1800000u
+#endif
+
+struct DriftConfig
+{
+    uint32_t tauS;
+    uint32_t stableMs;
+    uint32_t stableBand;
+    float maxOffset;
+    float fastAlpha;
+};
+
+struct DriftState
+{
+    float offset;     // subtracted from raw
+    bool primed;
+    float fastRaw;    // smoothed physical raw
+    uint32_t lastMs;
+    float ref;        // corrected reading at the start of the quiet period
+    uint32_t quietSinceMs;
+    bool anchored;    // stable: offset is adapting
+};
+
+// NVS blob: the learned offset survives reboots, the rate is a setting.
+struct DriftPersist
+{
+    float offset;
+    uint32_t tauS;
+};
+
+void drift_init(DriftState &st, float offset);
+
+// Feed one physical sample; returns the corrected raw. trusted = the probe is
+// connected and the reading is not a glitch (otherwise only the correction applies).
+int32_t drift_update(DriftState &st, const DriftConfig &cfg, int32_t raw, uint32_t nowMs, bool trusted);
+
+// Correction only, for samples that must not adapt the model.
+int32_t drift_apply(const DriftState &st, int32_t raw);
@@ -0,0 +1,171 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "device_state.h"
+#include "quality.h"
+
+// Duty-cycled operation (battery/solar installs): wake, sample a burst, decide
+// whether to publish or buffer, then deep-sleep for an interval that adapts to
+// how fast the level is moving. Wakes that reach the broker stay up for a short
+// window so retained commands, OTA jobs and rollback confirmation still happen.
+// The firmware keeps DutyRtcState in RTC memory across deep sleeps; the clock is
+// passed in so test/test_duty_cycle can run days of wakes in milliseconds.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_DUTY_CYCLE
+#define CFG_DUTY_CYCLE 0 // 1 = deep-sleep between measurements instead of running appLoop()
+#endif
+
+#ifndef CFG_DUTY_MIN_INTERVAL_S
+#define CFG_DUTY_MIN_INTERVAL_S 300u
+#endif
+
+#ifndef CFG_DUTY_MAX_INTERVAL_S
+#define CFG_DUTY_MAX_INTERVAL_S 3600u
+#endif
+
+// Level change rate at (or above) which the minimum interval is used.
+#ifndef CFG_DUTY_FAST_RATE_PCT_PER_H
+#define CFG_DUTY_FAST_RATE_PCT_PER_H 10.0f
+#endif
+
+#ifndef CFG_DUTY_PUBLISH_DELTA_PCT
+#define CFG_DUTY_PUBLISH_DELTA_PCT 2.0f
+#endif
+
+#ifndef CFG_DUTY_HEARTBEAT_S
+#define CFG_DUTY_HEARTBEAT_S 21600u
+#endif
+
+#ifndef CFG_DUTY_BUFFER_SAMPLES
+#define CFG_DUTY_BUFFER_SAMPLES 24
+#endif
+
+#ifndef CFG_DUTY_BURST_SAMPLES
+#define CFG_DUTY_BURST_SAMPLES 5
+#endif
+
+#ifndef CFG_DUTY_BURST_SPACING_MS
+#define CFG_DUTY_BURST_SPACING_MS 20u
+#endif
+
+#ifndef CFG_DUTY_CONNECT_TIMEOUT_MS
+#define CFG_DUTY_CONNECT_TIMEOUT_MS 15000u
+#endif
+
+// After a publish, listen this long for retained commands on the cmd topic.
+#ifndef CFG_DUTY_LISTEN_MS
+#define CFG_DUTY_LISTEN_MS 2000u
+#endif
+
+// Awake window on heartbeat wakes, after a command arrived, and on the wake
+// following one that saw a command (the operator is likely still at it).
+#ifndef CFG_DUTY_AWAKE_WINDOW_MS
+#define CFG_DUTY_AWAKE_WINDOW_MS 60000u
+#endif
+
+// Hard cap on one awake period, OTA jobs included.
+#ifndef CFG_DUTY_MAX_AWAKE_MS
+#define CFG_DUTY_MAX_AWAKE_MS 600000u
+#endif
+
+struct DutyConfig
+{
+    uint32_t minIntervalS;
+    uint32_t maxIntervalS;
+    float fastRatePctPerHour;
+    float publishDeltaPct;
+    uint32_t heartbeatS;
+    uint32_t listenMs;
+    uint32_t awakeWindowMs;
+    uint32_t maxAwakeMs;
+};
+
+struct DutySample
+{
+    uint32_t tS;        // duty clock, seconds
+    int16_t percentX10; // -1 when the level was not valid
+    uint8_t reason;     // ProbeQualityReason
+    uint8_t reserved;
+};
+
+struct DutyRtcState
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t wakeCount;
+    uint64_t clockMs; // duty clock at wake: time since the cold boot, including sleeps
+    QualityRuntime quality;
+
+    bool hasLastPercent;
+    float lastPercent;
+    uint64_t lastPercentMs;
+
+    bool hasPublished;
+    bool lastPublishedValid;
+    uint8_t lastPublishedReason;
+    float lastPublishedPercent;
+    uint64_t lastPublishMs;
+    bool discoveryDone;
+    bool commandSeen; // a command arrived during the previous awake window
+
+    uint32_t intervalS;
+    float ratePctPerHour;
+    uint8_t bufCount;
+    DutySample buf[CFG_DUTY_BUFFER_SAMPLES];
+};
+
+struct DutyObservation
+{
+    uint64_t nowMs;
+    float percent;
+    bool valid;
+    ProbeQualityReason reason;
+};
+
+struct DutyDecision
+{
+    bool publish;
+    bool heartbeat; // first publish or heartbeat due
+    uint32_t awakeMs; // how long to stay connected after a successful publish
+    uint32_t sleepS;
+    float ratePctPerHour;
+};
+
+struct DutyAwakeWindow
+{
+    uint32_t startMs;
+    uint32_t endMs;
+};
+
+void duty_reset(DutyRtcState &st);
+bool duty_isValid(const DutyRtcState &st);
+
+// Update the rate estimate and interval, and decide whether this wake publishes.
+DutyDecision duty_plan(DutyRtcState &st, const DutyConfig &cfg, const DutyObservation &obs);
+
+// Outcome of the publish attempt (only when duty_plan asked for one). A skipped
+// or failed publish buffers the observation (oldest dropped when full). The
+// buffer is only emptied once duty/samples itself went out, so a state publish
+// that succeeds while the samples publish fails keeps the samples for the next wake.
+void duty_notePublished(DutyRtcState &st, const DutyObservation &obs);
+void duty_noteSamplesFlushed(DutyRtcState &st);
+void duty_bufferObservation(DutyRtcState &st, const DutyObservation &obs);
+
+// Awake window after a successful publish (millis() clock). duty_awakeTick
+// returns true while the device should keep servicing MQTT/OTA: a command
+// extends the window, a running OTA job holds it open, and nothing passes
+// maxAwakeMs.
+void duty_awakeBegin(DutyAwakeWindow &w, uint32_t nowMs, uint32_t awakeMs);
+bool duty_awakeTick(DutyAwakeWindow &w, const DutyConfig &cfg, uint32_t nowMs, bool commandSeen, bool otaBusy);
+
+// Advance the duty clock over the coming sleep.
+void duty_beforeSleep(DutyRtcState &st, uint64_t nowMs, uint32_t sleepS);
+
+// Buffered samples as JSON (ages relative to nowMs), for duty/samples.
+bool duty_buildSamplesJson(const DutyRtcState &st, uint64_t nowMs, char *out, size_t outSize);
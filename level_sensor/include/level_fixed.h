@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include "applied_config.h"
+#include "tank_geometry.h"
+#include "cal_curve.h"
+
+// Fixed-point level pipeline: raw -> percent (Q16.16) -> EMA -> liters and
+// centimeters (integer hundredths). Calibration is reduced once per config
+// change to an offset and a Q16 reciprocal, so a sample costs a subtract, a
+// 64-bit multiply and a shift; with intermediate calibration points a short
+// branchless search picks the segment first. Non-linear tanks map percent to liters through
+// the geometry lookup table. Validity travels as bits instead of NaN.
+
+static constexpr int32_t LEVEL_Q16_ONE = 65536;
+static constexpr int32_t LEVEL_PERCENT_Q16_MAX = 100 * LEVEL_Q16_ONE;
+static constexpr uint8_t LEVEL_MAX_KNOTS = CFG_CAL_CURVE_MAX_POINTS + 2u; // dry + points + wet
+
+enum LevelValidBits : uint8_t
+{
+    LEVEL_VALID_PERCENT = 1u << 0,
+    LEVEL_VALID_LITERS = 1u << 1,
+    LEVEL_VALID_CENTIMETERS = 1u << 2,
+};
+
+// Precomputed from AppliedConfig by level_prepare().
+struct LevelCalib
+{
+    uint8_t valid;     // LEVEL_VALID_* that the config can support
+    int32_t start;     // raw at 0 % (wet when inverted)
+    int64_t percentPerRawQ32; // (100 << 32) / (end - start), signed
+    uint32_t volumeCenti;     // tank volume, 0.01 L
+    uint32_t rodCenti;        // rod length, 0.01 cm
+    uint8_t knots;            // 0 = two-point map above; else knot tables below
+    uint8_t curvePointsUsed;  // stored curve points that fit between dry and wet
+    int32_t knotRaw[LEVEL_MAX_KNOTS];        // ascending raw
+    int32_t knotPercentQ16[LEVEL_MAX_KNOTS];
+    int64_t knotSlopeQ32[LEVEL_MAX_KNOTS];   // segment i: knot i -> i + 1, same scale as percentPerRawQ32
+    bool volumeLutActive;     // liters from volumeLut instead of volumeCenti * percent
+    uint32_t volumeLut[CFG_TANK_LUT_POINTS]; // 0.01 L at evenly spaced heights
+};
+
+struct LevelFilter
+{
+    bool primed;
+    int32_t emaQ16;
+    int32_t alphaQ16;
+};
+
+struct LevelFixed
+{
+    uint8_t valid; // LEVEL_VALID_*
+    int32_t percentQ16;
+    uint32_t litersCenti;
+    uint32_t centimetersCenti;
+};
+
+// calMinDiff: minimum |wet - dry| for a usable calibration.
+void level_prepare(LevelCalib &calib, const AppliedConfig &cfg, uint32_t calMinDiff);
+
+// Clamped percent for one raw sample; false without a usable calibration.
+bool level_percentFromRaw(const LevelCalib &calib, int32_t raw, int32_t &percentQ16);
+
+void level_filterInit(LevelFilter &filter, float alpha);
+void level_filterReset(LevelFilter &filter);
+// Feed one sample; an invalid sample resets the filter (next valid one re-primes).
+void level_filterUpdate(LevelFilter &filter, bool valid, int32_t percentQ16);
+
+// Percent/liters/centimeters from the filtered percent.
+LevelFixed level_derive(const LevelCalib &calib, const LevelFilter &filter);
+
+inline float level_q16ToFloat(int32_t q16)
+{
+    return (float)q16 / (float)LEVEL_Q16_ONE;
+}
+
+inline float level_centiToFloat(uint32_t centi)
+{
+    return (float)centi / 100.0f;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+
+// Wake-up bitmask for the main loop. Producers on any task set bits; the main
+// task blocks in loop_events_wait() until a bit is set or its timeout (the time
+// until the next scheduled release) expires. On the ESP32 this is the main
+// task's FreeRTOS notification value; host builds use a mutex and
+// std::condition_variable so the same loop can be driven from a test.
+
+enum LoopEventBits : uint32_t
+{
+    LOOP_EVENT_STATE_PUBLISH = 1u << 0, // mqtt_requestStatePublish()
+    LOOP_EVENT_OTA = 1u << 1,           // ota_events queue has work
+    LOOP_EVENT_COMMAND = 1u << 2,       // command applied; state may need publishing
+    LOOP_EVENT_MQTT_RX = 1u << 3,       // message received on a subscribed topic
+};
+
+// Bind the waiting side to the calling task. Signals before this are kept
+// (host) or dropped (ESP32, nothing to notify yet).
+void loop_events_begin();
+
+// Set bits and wake the waiter. Safe from any task (not from an ISR).
+void loop_events_signal(uint32_t bits);
+
+// Block up to timeoutMs for any bit; returns and clears the bits that were set
+// (0 on timeout). timeoutMs == 0 only collects what is already pending.
+uint32_t loop_events_wait(uint32_t timeoutMs);
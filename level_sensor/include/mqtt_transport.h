@@ -42,6 +42,12 @@ bool mqtt_publishLog(const char *topicSuffix, const char *payload, bool retained
 // MQTT connection status
 bool mqtt_isConnected();
 
+// Duty-cycled operation: skip HA discovery on connect (already retained on the
+// broker), publish state immediately, and disconnect cleanly before sleeping.
+void mqtt_setDiscoveryOnConnect(bool enabled);
+bool mqtt_publishStateNow(const DeviceState &state);
+void mqtt_disconnect();
+
 // Publish an arbitrary MQTT topic (raw topic).
 bool mqtt_publishRaw(const char *topic, const char *payload, bool retained = false);
 
@@ -0,0 +1,74 @@
+#pragma once
+#include <Preferences.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Flash wear accounting for our NVS traffic. WearPreferences is a drop-in for
+// Preferences that reports every remove/clear and every put that changes the
+// stored value (NVS keeps an identical item in place) here; we keep per-key
+// write counts, an estimate of the 32-byte NVS entries consumed, and coarse
+// lifetime totals (persisted every CFG_NVS_WEAR_PERSIST_MS) from which the
+// remaining flash life of the NVS partition is projected. Writes the WiFi
+// driver makes on its own (credentials, PHY calibration) are not visible to
+// this shim.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_NVS_WEAR_KEYS
+#define CFG_NVS_WEAR_KEYS 12 // distinct namespace/key pairs tracked; the rest fold into "*"
+#endif
+
+#ifndef CFG_NVS_WEAR_PERSIST_MS
+#define CFG_NVS_WEAR_PERSIST_MS (6UL * 60UL * 60UL * 1000UL)
+#endif
+
+#ifndef CFG_NVS_WEAR_COMPARE_BYTES
+#define CFG_NVS_WEAR_COMPARE_BYTES 256 // larger blobs are counted without comparing to the stored copy
+#endif
+
+#ifndef CFG_NVS_WEAR_ERASE_CYCLES
+#define CFG_NVS_WEAR_ERASE_CYCLES 100000UL // rated sector erase cycles of the SPI flash
+#endif
+
+struct NvsWearSummary
+{
+    uint32_t bootWrites;      // writes since this boot
+    uint32_t bootEntries;     // estimated NVS entries since this boot
+    uint32_t totalWrites;     // lifetime (persisted + this boot)
+    uint32_t totalEntries;
+    uint32_t totalBytes;
+    uint32_t totalUptimeS;    // uptime the totals were collected over
+    uint32_t partitionBytes;  // size of the NVS data partition
+    uint32_t entriesPerDay;   // lifetime average
+    uint32_t projectedYears;  // remaining at entriesPerDay; UINT32_MAX when no rate yet
+};
+
+class WearPreferences : public Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false);
+    size_t putBool(const char *key, bool value);
+    size_t putUChar(const char *key, uint8_t value);
+    size_t putInt(const char *key, int32_t value);
+    size_t putUInt(const char *key, uint32_t value);
+    size_t putFloat(const char *key, float value);
+    size_t putBytes(const char *key, const void *value, size_t len);
+    bool remove(const char *key);
+    bool clear();
+
+private:
+    bool blobUnchanged(const char *key, const void *value, size_t len);
+
+    char _ns[16] = {0};
+};
+
+void nvs_wear_begin();                 // load persisted totals; call before storage_begin()
+void nvs_wear_tick();                  // periodic persistence; call from the main loop
+void nvs_wear_note(const char *ns, const char *key, size_t bytes, uint16_t entries);
+void nvs_wear_getSummary(NvsWearSummary &out);
+bool nvs_wear_buildJson(char *out, size_t outSize); // diagnostics payload (system/nvs_wear)
+void nvs_wear_log();
@@ -0,0 +1,81 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming decoder for firmware delta patches ("WTD1"), produced by
+// build_assets/scripts/ota_delta.py. A patch rebuilds the target image from
+// the running app partition plus the patch stream, without buffering either.
+//
+// Layout (little-endian):
+//   header: "WTD1" | u32 target_size | u32 source_size | u8[32] source_sha256
+//   ops:    0x01 COPY src_off u32, len u32          out = src[off..off+len)
+//           0x02 ADD  src_off u32, len u32, len*u8  out = src[off+i] + d[i] (mod 256)
+//           0x03 DATA len u32, len*u8               out = d[0..len)
+//           0x00 END
+// source_sha256 covers the first source_size bytes of the running partition,
+// i.e. the sha256 of the previous firmware.bin.
+
+static constexpr size_t OTA_DELTA_HEADER_BYTES = 44u;
+
+struct OtaDeltaHeader
+{
+    uint32_t targetSize = 0;
+    uint32_t sourceSize = 0;
+    uint8_t sourceSha256[32] = {0};
+};
+
+enum class OtaDeltaResult : uint8_t
+{
+    OK = 0,     // output buffer full; call again with a fresh buffer
+    NEED_INPUT, // all supplied input consumed; feed more patch bytes
+    DONE,       // END op reached and target size matched
+    ERROR,      // malformed patch; see OtaDeltaDecoder::error
+};
+
+// Reads len bytes of the source image at offset into dst.
+typedef bool (*OtaDeltaSourceRead)(uint32_t offset, uint8_t *dst, size_t len, void *ctx);
+
+enum class OtaDeltaPhase : uint8_t
+{
+    OPCODE = 0,
+    ARGS,
+    BODY,
+    DONE,
+    FAILED,
+};
+
+struct OtaDeltaDecoder
+{
+    OtaDeltaPhase phase = OtaDeltaPhase::OPCODE;
+    uint8_t op = 0;
+    uint8_t args[8] = {0};
+    uint8_t argLen = 0;
+    uint32_t srcOffset = 0;
+    uint32_t remaining = 0;
+    uint32_t sourceSize = 0;
+    uint32_t targetSize = 0;
+    uint32_t produced = 0;
+    const char *error = nullptr;
+};
+
+// Parse the fixed header. Returns false on bad magic/size.
+bool ota_delta_parseHeader(const uint8_t *buf, size_t len, OtaDeltaHeader *out);
+
+void ota_delta_begin(OtaDeltaDecoder *dec, const OtaDeltaHeader &hdr);
+
+// Decode from in[0..inLen) into out[0..outCap). COPY ops consume no input, so
+// the caller keeps calling while the result is OK even with inLen == 0.
+OtaDeltaResult ota_delta_step(OtaDeltaDecoder *dec,
+                              const uint8_t *in,
+                              size_t inLen,
+                              size_t *inUsed,
+                              uint8_t *out,
+                              size_t outCap,
+                              size_t *outLen,
+                              OtaDeltaSourceRead readSource,
+                              void *ctx);
+
+inline bool ota_delta_done(const OtaDeltaDecoder &dec)
+{
+    return dec.phase == OtaDeltaPhase::DONE;
+}
@@ -21,5 +21,6 @@ bool ota_events_pushResult(const char *status, const char *message, uint32_t com
 bool ota_events_pushClearActive();
 bool ota_events_pushUpdateAvailable(bool value);
 bool ota_events_pushLastSuccessTs(uint32_t ts);
+bool ota_events_pushStats(const OtaStats &stats);
 bool ota_events_requestPublish();
 bool ota_events_drainAndApply(DeviceState *state);
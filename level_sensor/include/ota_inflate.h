@@ -0,0 +1,36 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming zlib inflater for compressed OTA images/patches, built on the ROM
+// miniz (tinfl) decoder. Output goes through a fixed power-of-two circular
+// window instead of the full 32 KB deflate dictionary, so streams must be
+// compressed with a window no larger than CFG_OTA_INFLATE_WINDOW_BYTES
+// (build_assets/scripts/ota_compress.py --window-bits). Single instance,
+// statically allocated; only the OTA task uses it.
+
+#ifndef CFG_OTA_INFLATE_WINDOW_BYTES
+#define CFG_OTA_INFLATE_WINDOW_BYTES 8192u
+#endif
+
+enum class OtaInflateResult : uint8_t
+{
+    OK = 0,     // output buffer full; call again
+    NEED_INPUT, // all supplied input consumed; feed more compressed bytes
+    DONE,       // end of zlib stream reached and Adler-32 verified
+    ERROR,      // corrupt stream
+};
+
+// True when p starts with a zlib/deflate header. windowBytes receives the
+// window the stream declares (CINFO).
+bool ota_inflate_isZlibHeader(const uint8_t *p, size_t len, uint32_t *windowBytes);
+
+// Reset the decoder. Fails if the stream's window exceeds our buffer.
+bool ota_inflate_begin(uint32_t windowBytes);
+
+OtaInflateResult ota_inflate_step(const uint8_t *in,
+                                  size_t inLen,
+                                  size_t *inUsed,
+                                  uint8_t *out,
+                                  size_t outCap,
+                                  size_t *outLen);
@@ -31,6 +31,7 @@ struct OtaTaskJob
     char version[OTA_VERSION_MAX] = {0};
     char url[OTA_URL_MAX] = {0};
     char sha256[OTA_SHA256_MAX] = {0};
+    char alt_url[OTA_URL_MAX] = {0}; // preferred source (delta patch or compressed image)
     bool force = false;
     bool reboot = true;
 };
@@ -0,0 +1,86 @@
+#pragma once
+#include <WiFiClientSecure.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+// TLS client for OTA HTTP traffic (manifest checks/pulls and firmware downloads)
+// with a small per-host session cache. The first handshake against github.com or
+// one of its redirect targets is a full one; later connections offer the cached
+// session (ID or ticket) so the server can resume and skip the certificate chain
+// verification and key exchange. HTTPClient reaches connect() virtually, so its
+// redirect hops go through the cache too.
+//
+// Only the trust setups ota_configureTlsClient() produces (PEM CA roots or the
+// insecure debug mode) take the resumable path; anything else is handed to
+// WiFiClientSecure::connect() unchanged.
+
+#ifndef CFG_OTA_TLS_SESSION_CACHE
+#define CFG_OTA_TLS_SESSION_CACHE 1
+#endif
+
+// connectResumable() rebuilds the core's start_ssl_client() on the
+// WiFiClientSecure internals of Arduino-ESP32 2.x (raw sslclient_context
+// pointer, mbedTLS 2 config). Other cores keep the cache compiled out and use
+// the stock connect().
+#ifdef __has_include
+#if __has_include(<esp_arduino_version.h>)
+#include <esp_arduino_version.h>
+#endif
+#endif
+
+#if CFG_OTA_TLS_SESSION_CACHE && defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR == 2
+#define OTA_TLS_RESUMABLE 1
+#else
+#define OTA_TLS_RESUMABLE 0
+#endif
+
+#ifndef CFG_OTA_TLS_SESSION_SLOTS
+#define CFG_OTA_TLS_SESSION_SLOTS 3
+#endif
+
+// Sessions older than this are not offered; servers drop them long before anyway.
+#ifndef CFG_OTA_TLS_SESSION_TTL_MS
+#define CFG_OTA_TLS_SESSION_TTL_MS (6UL * 60UL * 60UL * 1000UL)
+#endif
+
+struct OtaTlsHandshakeStats
+{
+    uint16_t handshakes = 0; // successful handshakes on this client
+    uint16_t resumed = 0;    // of which the server accepted the cached session
+    uint32_t totalMs = 0;    // TCP connect + handshake, summed
+    uint32_t lastMs = 0;
+    bool lastResumed = false;
+};
+
+class OtaTlsClient : public WiFiClientSecure
+{
+public:
+    using WiFiClientSecure::connect;
+    int connect(const char *host, uint16_t port, int32_t timeout) override;
+    int connect(const char *host, uint16_t port) override;
+
+    const OtaTlsHandshakeStats &handshakeStats() const { return _hs; }
+    void resetHandshakeStats() { _hs = OtaTlsHandshakeStats{}; }
+
+private:
+#if OTA_TLS_RESUMABLE
+    int connectResumable(const char *host, uint16_t port, int32_t timeout);
+#endif
+    void noteHandshake(uint32_t elapsedMs, bool resumed);
+
+    OtaTlsHandshakeStats _hs;
+    uint16_t _certsVerified = 0; // bumped by the verify callback; stays 0 on resumption
+};
+
+// Create the session cache lock; call once before any OtaTlsClient connects
+// (ota_begin() does, before otaTask starts).
+void ota_tls_begin();
+
+// Forget every cached session (e.g. after the trust store changed).
+void ota_tls_clearSessions();
@@ -2,12 +2,13 @@
 
 #include <Arduino.h>
 
-// probe_reader: produces raw probe values (physical or simulation backend)
+// probe_reader: produces raw probe values (physical, simulation or trace-replay backend)
 
 enum ReadMode
 {
     READ_PROBE = 0, // read from physical probe
     READ_SIM = 1,   // read from simulation module
+    READ_REPLAY = 2 // replay a recorded trace (trace_replay.h); transient, never persisted
 };
 
 struct ProbeConfig
@@ -24,4 +25,10 @@ void probe_begin(const ProbeConfig &cfg);
 uint32_t probe_getRaw();
 
 // set read mode based on applied truth in preferences
-void probe_updateMode(ReadMode mode);
\ No newline at end of file
+// (while a replay runs this only changes the mode restored when it stops)
+void probe_updateMode(ReadMode mode);
+
+// Switch to the selected replay trace / return to the configured backend.
+bool probe_startReplay(float speed, bool loop);
+void probe_stopReplay();
+ReadMode probe_getMode();
@@ -0,0 +1,54 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Always-on execution-time profiler. Each named slot (a loop task, the whole
+// loop pass, a FreeRTOS worker) keeps a log2-bucketed histogram of durations in
+// microseconds in fixed memory, plus count/total/max. p99 is read back from the
+// histogram as the upper bound of the bucket holding the 99th percentile.
+// Recording is safe from any task or core.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_PROFILER_SLOTS
+#define CFG_PROFILER_SLOTS 10
+#endif
+
+// Bucket i holds durations in [2^i, 2^(i+1)) us; the last bucket is open-ended.
+#ifndef CFG_PROFILER_BUCKETS
+#define CFG_PROFILER_BUCKETS 22
+#endif
+
+#ifndef CFG_PROFILER_PUBLISH_MS
+#define CFG_PROFILER_PUBLISH_MS 300000u // system/profile cadence
+#endif
+
+struct ProfilerSlotSummary
+{
+    const char *name;
+    uint32_t count;
+    uint32_t avgUs;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+// Returns the slot id for name (registering it on first use), or -1 when full.
+// Names must be string literals; only the pointer is stored.
+int profiler_register(const char *name);
+void profiler_record(int slot, uint32_t us);
+
+// Count one main-loop pass of passUs (the "loop" slot, plus loop frequency).
+void profiler_loopPass(uint32_t passUs);
+
+// Clear every histogram; nowMs starts the new measurement window.
+void profiler_reset(uint32_t nowMs);
+
+size_t profiler_slotCount();
+bool profiler_getSummary(size_t slot, ProfilerSlotSummary &out);
+
+bool profiler_buildJson(char *out, size_t outSize, uint32_t nowMs);
+void profiler_log(uint32_t nowMs);
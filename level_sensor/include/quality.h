@@ -1,26 +1,9 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 #include "device_state.h"
 #include "applied_config.h"
-
-// Configuration for quality evaluation.
-struct QualityConfig
-{
-    uint32_t disconnectedBelowRaw;
-    uint32_t rawMin;
-    uint32_t rawMax;
-    uint32_t rapidFluctuationDelta;
-    uint32_t spikeDelta;
-    uint8_t spikeCountThreshold;
-    uint32_t spikeWindowMs;
-    uint32_t stuckDelta;
-    uint32_t stuckMs;
-    uint32_t calRecommendMargin;
-    uint8_t calRecommendCount;
-    uint32_t calRecommendWindowMs;
-    uint8_t zeroHitCount;
-    uint32_t zeroWindowMs;
-};
+#include "quality_config.h"
 
 struct QualityRuntime
 {
@@ -51,3 +34,16 @@ QualityResult quality_evaluate(uint32_t raw,
                                const QualityConfig &qc,
                                QualityRuntime &rt,
                                uint32_t nowMs);
+
+// Same results as calling quality_evaluate() for raw[i] at nowMs[i] in order
+// (rt carries over both ways); it is that loop. A vectorized two-pass version
+// measured slower on the host than the per-sample state machine, so this only
+// gives callers holding a whole trace one call; test/test_quality checks it
+// against the scalar path.
+void quality_evaluateBatch(const uint32_t *raw,
+                           const uint32_t *nowMs,
+                           size_t count,
+                           const AppliedConfig &cfg,
+                           const QualityConfig &qc,
+                           QualityRuntime &rt,
+                           QualityResult *out);
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+
+// Thresholds of the fixed quality tier (quality_evaluate). The CFG_* values are
+// the defaults; the applied set lives in the config cache (AppliedConfig::quality),
+// is persisted as one NVS blob and can be changed at runtime with set_quality.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_PROBE_DISCONNECTED_BELOW_RAW
+#define CFG_PROBE_DISCONNECTED_BELOW_RAW 30000u
+#endif
+#ifndef CFG_SPIKE_DELTA
+#define CFG_SPIKE_DELTA 10000u
+#endif
+#ifndef CFG_RAPID_FLUCTUATION_DELTA
+#define CFG_RAPID_FLUCTUATION_DELTA 5000u
+#endif
+#ifndef CFG_SPIKE_COUNT_THRESHOLD
+#define CFG_SPIKE_COUNT_THRESHOLD 3u
+#endif
+#ifndef CFG_SPIKE_WINDOW_MS
+#define CFG_SPIKE_WINDOW_MS 5000u
+#endif
+#ifndef CFG_STUCK_EPS
+#define CFG_STUCK_EPS 2u
+#endif
+#ifndef CFG_STUCK_MS
+#define CFG_STUCK_MS 8000u
+#endif
+#ifndef CFG_PROBE_MIN_RAW
+#define CFG_PROBE_MIN_RAW 0u
+#endif
+#ifndef CFG_PROBE_MAX_RAW
+#define CFG_PROBE_MAX_RAW 65535u
+#endif
+#ifndef CFG_CAL_RECOMMEND_MARGIN
+#define CFG_CAL_RECOMMEND_MARGIN 2000u
+#endif
+#ifndef CFG_CAL_RECOMMEND_COUNT
+#define CFG_CAL_RECOMMEND_COUNT 3u
+#endif
+#ifndef CFG_CAL_RECOMMEND_WINDOW_MS
+#define CFG_CAL_RECOMMEND_WINDOW_MS 60000u
+#endif
+#ifndef CFG_ZERO_HIT_COUNT
+#define CFG_ZERO_HIT_COUNT 2u
+#endif
+#ifndef CFG_ZERO_WINDOW_MS
+#define CFG_ZERO_WINDOW_MS 5000u
+#endif
+
+// The side blob CRC covers every byte, so counts are grouped at the end to
+// leave no padding; changing the layout means a new side blob version.
+struct QualityConfig
+{
+    uint32_t disconnectedBelowRaw;
+    uint32_t rawMin;
+    uint32_t rawMax;
+    uint32_t rapidFluctuationDelta;
+    uint32_t spikeDelta;
+    uint32_t spikeWindowMs;
+    uint32_t stuckDelta;
+    uint32_t stuckMs;
+    uint32_t calRecommendMargin;
+    uint32_t calRecommendWindowMs;
+    uint32_t zeroWindowMs;
+    uint8_t spikeCountThreshold;
+    uint8_t calRecommendCount;
+    uint8_t zeroHitCount;
+    uint8_t reserved;
+};
+
+void quality_configDefaults(QualityConfig &qc);
+bool quality_validateConfig(const QualityConfig &qc);
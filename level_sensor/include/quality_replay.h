@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "applied_config.h"
+#include "device_state.h"
+#include "quality.h"
+#include "drift_comp.h"
+#include "anomaly.h"
+
+// Runs the selected replay trace (trace_replay.h) through quality_evaluate() on
+// a virtual clock taken from the trace timestamps, as fast as the CPU allows.
+// Hours of field data evaluate in milliseconds, so thresholds such as stuckMs,
+// spikeWindowMs or calRecommendWindowMs can be compared without waiting in
+// real time. The live quality runtime is not touched. With a DriftConfig the
+// trace is drift-compensated first (from offset 0), so the time spent in
+// CALIBRATION_RECOMMENDED can be compared with and without compensation. With an
+// AnomalyConfig the statistical tier (anomaly.h) runs too; on a trace known to
+// be healthy every anomaly event is a false positive, so anomalyEvents per hour
+// is its false-positive rate for those settings.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_QUALITY_REPLAY_LOG
+#define CFG_QUALITY_REPLAY_LOG 8 // transitions kept in the report
+#endif
+
+static constexpr size_t QUALITY_REASON_COUNT = (size_t)ProbeQualityReason::UNKNOWN + 1u;
+
+struct QualityReplayTransition
+{
+    uint32_t tMs;
+    ProbeQualityReason reason;
+    bool connected;
+};
+
+struct QualityReplayReport
+{
+    uint32_t samples;
+    uint32_t spanMs;
+    uint32_t transitions; // each forces a state publish on the device
+    uint32_t msByReason[QUALITY_REASON_COUNT];
+    uint32_t disconnectedMs;
+    uint8_t logged;
+    QualityReplayTransition log[CFG_QUALITY_REPLAY_LOG];
+    uint32_t cpuUs;
+    bool driftCompensated;
+    float driftOffset; // at the end of the trace
+    bool anomalyEvaluated;
+    uint32_t anomalyEvents; // entries into an ANOMALY_* reason
+};
+
+// False when no trace is selected or a real-time replay is running.
+// drift: nullptr evaluates the raw trace; anomaly: nullptr skips the statistical tier.
+bool quality_replayTrace(const AppliedConfig &cfg, const QualityConfig &qc, const DriftConfig *drift,
+                         const AnomalyConfig *anomaly, QualityReplayReport &out, uint32_t (*nowUs)());
+
+bool quality_replayBuildJson(const QualityReplayReport &report, const QualityConfig &qc,
+                             char *out, size_t outSize);
@@ -0,0 +1,85 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Cooperative scheduler for the main loop. Each task has a period, a relative
+// deadline and a priority; on every pass the due tasks run once each in
+// priority order, with execution time and release lateness measured. A task
+// that finishes later than release + deadline counts as an overrun. The pass
+// returns how long the loop may idle before the next release, so the caller can
+// yield instead of spinning. nowMs/nowUs are hooks so test_scheduler can drive
+// the firmware's task table from a fake clock.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_SCHED_MAX_TASKS
+#define CFG_SCHED_MAX_TASKS 16
+#endif
+
+#ifndef CFG_SCHED_MAX_IDLE_MS
+#define CFG_SCHED_MAX_IDLE_MS 100u // cap on one idle wait; loop events wake it earlier
+#endif
+
+enum class SchedPolicy : uint8_t
+{
+    ALWAYS,
+    // Not released while otaBusy(). When the job ends, a task that fell a full
+    // period behind restarts its grid from then (counted in skippedReleases)
+    // rather than running once with the whole pause as lateness.
+    SKIP_DURING_OTA
+};
+
+struct SchedTaskStats
+{
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t skippedReleases; // releases dropped because the task fell a full period behind
+    uint32_t lastExecUs;
+    uint32_t maxExecUs;
+    uint64_t totalExecUs;
+    uint32_t lastLateMs; // start time minus release time
+    uint32_t maxLateMs;
+    uint64_t totalLateMs;
+};
+
+struct SchedTask
+{
+    const char *name;
+    uint32_t periodMs;   // > 0
+    uint32_t deadlineMs; // relative to release; 0 = same as period
+    uint8_t priority;    // 0 = most urgent
+    SchedPolicy policy;
+    void (*fn)();
+
+    uint32_t nextDueMs;
+    uint32_t lastStartMs;
+    SchedTaskStats stats;
+};
+
+struct SchedHooks
+{
+    uint32_t (*nowMs)();
+    uint32_t (*nowUs)();
+    bool (*otaBusy)();                                       // optional
+    void (*onOverrun)(const SchedTask &task, uint32_t lateMs, uint32_t execUs); // optional
+    void (*onRun)(const SchedTask &task, uint32_t execUs);                   // optional, every run
+};
+
+// Returns false and schedules nothing when count exceeds CFG_SCHED_MAX_TASKS,
+// a task has periodMs 0 or a required hook is missing.
+bool sched_begin(SchedTask *tasks, size_t count, const SchedHooks &hooks);
+
+// Run every due task once (priority order). Returns ms until the next release.
+uint32_t sched_runOnce();
+
+SchedTask *sched_find(const char *name);
+// Ignored (returns false) for periodMs 0.
+bool sched_setPeriod(SchedTask &task, uint32_t periodMs);
+// Make a task due now (event-driven release); its period grid restarts from here.
+void sched_trigger(SchedTask &task);
+size_t sched_tasks(const SchedTask *&tasks);
+void sched_resetStats();
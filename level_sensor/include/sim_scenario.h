@@ -0,0 +1,97 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Scenario engine behind the simulation backend. A scenario is a short table of
+// layers applied in order to one raw value per sample: level profiles set it,
+// noise/drift/oscillation/spikes/fluctuation/range-shift add to it, stuck
+// freezes whatever the earlier layers produced and disconnect overrides it.
+// All randomness comes from a seeded xorshift PRNG, so the same scenario, seed
+// and sample times reproduce the same trace on device and on the host.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_SIM_MAX_LAYERS
+#define CFG_SIM_MAX_LAYERS 6
+#endif
+
+#ifndef CFG_SIM_DEFAULT_SEED
+#define CFG_SIM_DEFAULT_SEED 0x5EED1234u
+#endif
+
+enum class SimLayerType : uint8_t
+{
+    FILL = 0,    // sawtooth dry -> wet over periodMs, starting at the current level
+    DRAIN,       // sawtooth wet -> dry over periodMs
+    HOLD,        // dry + rangeFrac * range (rangeFrac 0 keeps the starting raw) + amplitude
+    OSCILLATE,   // sine of the given amplitude and periodMs
+    NOISE,       // gaussian, amplitude = sigma
+    DRIFT,       // amplitude per hour, linear from start
+    SPIKES,      // every ~periodMs (randomized), +/- amplitude held for durationMs
+    RAPID,       // first durationMs of each periodMs: alternate +/- amplitude per sample
+    STUCK,       // first durationMs of each periodMs: hold the value from when it froze
+    DISCONNECT,  // last durationMs of each periodMs: read below the disconnect threshold
+    RANGE_SHIFT, // every periodMs shift the baseline by +/- amplitude, ramped over durationMs
+    COUNT
+};
+
+struct SimLayer
+{
+    SimLayerType type;
+    uint32_t periodMs;
+    uint32_t durationMs;
+    float amplitude; // raw counts
+    float rangeFrac; // added to amplitude as a fraction of the calibrated range
+};
+
+struct SimScenario
+{
+    const char *name;
+    uint8_t count;
+    SimLayer layers[CFG_SIM_MAX_LAYERS];
+};
+
+struct SimRange
+{
+    int32_t dry;
+    int32_t wet;
+    int32_t disconnectedRaw;
+};
+
+struct SimLayerState
+{
+    uint32_t eventMs; // next spike / shift
+    uint32_t phaseMs; // start of the current spike / shift ramp
+    bool active;
+    int8_t dir;
+    float value;   // current offset (spike, range shift) or frozen value (stuck)
+    float target;  // range shift target offset
+};
+
+struct SimEngine
+{
+    const SimScenario *scenario;
+    uint32_t rng;
+    uint32_t startMs;
+    int32_t startRaw;
+    float startFraction; // start level as a fraction of the calibrated range
+    bool toggle;
+    SimLayerState st[CFG_SIM_MAX_LAYERS];
+};
+
+uint32_t sim_rngNext(uint32_t &state);
+
+void sim_engineStart(SimEngine &engine, const SimScenario &scenario, uint32_t seed,
+                     uint32_t nowMs, int32_t startRaw, const SimRange &range);
+int32_t sim_engineSample(SimEngine &engine, uint32_t nowMs, const SimRange &range);
+
+// Built-in scenarios, indexed by simulation mode (0..sim_builtinCount()-1).
+const SimScenario *sim_builtinScenario(uint8_t mode);
+uint8_t sim_builtinCount();
+
+bool sim_layerTypeFromString(const char *name, SimLayerType &out);
+const char *sim_layerTypeName(SimLayerType type);
@@ -1,6 +1,16 @@
 #pragma once
 #include <stdint.h>
+#include "sim_scenario.h"
 
 int32_t readSimulatedRaw();
 void sim_start(int32_t raw);
 void setSimulationMode(uint8_t mode);
+
+// Reseed the scenario PRNG and restart the scenario (0 = CFG_SIM_DEFAULT_SEED).
+void sim_setSeed(uint32_t seed);
+uint32_t sim_getSeed();
+
+// Run a custom layer table instead of the built-in scenario for the current
+// mode, until the next setSimulationMode(). Not persisted.
+bool sim_setCustomLayers(const SimLayer *layers, uint8_t count);
+const char *sim_scenarioName();
@@ -2,6 +2,11 @@
 
 #include <stdint.h>
 #include "device_state.h"
+#include "tank_geometry.h"
+#include "cal_curve.h"
+#include "drift_comp.h"
+#include "anomaly.h"
+#include "quality_config.h"
 
 enum class RebootIntent : uint8_t
 {
@@ -16,17 +21,50 @@ enum class RebootIntent : uint8_t
 bool storage_begin();
 void storage_end(); // optional cleanup on shutdown/restart
 
+/* ---------------- Write Coalescing ---------------- */
+// Setters below only update a RAM shadow; the record (and any changed side
+// blob) is written with a CRC once changes settle (storage_tick) or on storage_flush().
+void storage_tick();   // call from the main loop
+bool storage_flush();  // write pending changes now (before reboot / after boot accounting)
+
 /* ---------------- Calibration ---------------- */
+// Raw loaders return the stored values as-is; validate applies the same rules
+// the active loaders use (invalid pairs collapse to 0/0/false, NaN for tank).
+bool storage_loadCalibrationRaw(int32_t &dry, int32_t &wet, bool &inverted);
+bool storage_validateCalibration(int32_t &dry, int32_t &wet, bool &inverted);
 bool storage_loadActiveCalibration(int32_t &dry, int32_t &wet, bool &inverted);
 void storage_saveCalibrationDry(int32_t dry);
 void storage_saveCalibrationWet(int32_t wet);
 void storage_saveCalibrationInverted(bool inverted);
 void storage_clearCalibration();
+// Intermediate points, side blob like the tank geometry; invalid -> empty.
+bool storage_loadCalibrationCurve(CalCurve &curve);
+void storage_saveCalibrationCurve(const CalCurve &curve);
 
 /* ---------------- Tank Configuration ---------------- */
+bool storage_loadTankRaw(float &volumeLiters, float &tankHeightCm);
+bool storage_validateTank(float &volumeLiters, float &tankHeightCm);
 bool storage_loadTank(float &volumeLiters, float &tankHeightCm);
 void storage_saveTankVolume(float volumeLiters);
 void storage_saveTankHeight(float tankHeightCm);
+// Side blob; missing, resized or invalid -> vertical cylinder.
+bool storage_loadTankGeometry(TankGeometry &geometry);
+void storage_saveTankGeometry(const TankGeometry &geometry);
+
+/* ---------------- Drift Compensation ---------------- */
+// Side blob; missing or resized -> offset 0 at CFG_DRIFT_TAU_S.
+bool storage_loadDrift(DriftPersist &drift);
+void storage_saveDrift(const DriftPersist &drift);
+
+/* ---------------- Quality Thresholds ---------------- */
+// Side blob (QualityConfig); missing, resized or invalid -> CFG_* defaults.
+bool storage_loadQuality(QualityConfig &cfg);
+void storage_saveQuality(const QualityConfig &cfg);
+
+/* ---------------- Statistical Quality Tier ---------------- */
+// Side blob (AnomalyConfig); missing, resized or invalid -> CFG_ANOMALY_* defaults.
+bool storage_loadAnomaly(AnomalyConfig &cfg);
+void storage_saveAnomaly(const AnomalyConfig &cfg);
 
 /* ---------------- Simulation Configuration ---------------- */
 bool storage_loadSimulation(SenseMode &senseMode, uint8_t &mode);
@@ -39,6 +77,8 @@ void storage_saveOtaForce(bool force);
 void storage_saveOtaReboot(bool reboot);
 bool storage_loadOtaLastSuccess(uint32_t &ts);
 void storage_saveOtaLastSuccess(uint32_t ts);
+bool storage_loadOtaStats(OtaStats &stats);
+void storage_saveOtaStats(const OtaStats &stats);
 bool storage_loadBootCount(uint32_t &count);
 void storage_saveBootCount(uint32_t count);
 
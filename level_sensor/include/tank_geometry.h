@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "device_state.h"
+
+// Tank height -> volume model. The probe measures height (percent of the rod),
+// but volume is only proportional to it for prismatic tanks. The shape is
+// reduced at config time to a fixed table of liters at evenly spaced heights;
+// per sample the level path interpolates between two neighbouring entries.
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+// Points of a user strapping table (height, volume pairs).
+#ifndef CFG_TANK_STRAP_MAX_POINTS
+#define CFG_TANK_STRAP_MAX_POINTS 16
+#endif
+
+// Lookup table entries, 0 % .. 100 % of the rod inclusive (N - 1 segments).
+#ifndef CFG_TANK_LUT_POINTS
+#define CFG_TANK_LUT_POINTS 129
+#endif
+
+struct TankStrapPoint
+{
+    float heightCm;
+    float liters;
+};
+
+// Stored behind a version + CRC header (s_side in storage_nvs.cpp); a layout
+// change needs a new version there.
+struct TankGeometry
+{
+    TankShape shape;
+    uint8_t strapCount;
+    uint16_t reserved;
+    float coneHeightCm; // CONE_BOTTOM: height of the conical section at the bottom
+    TankStrapPoint strap[CFG_TANK_STRAP_MAX_POINTS]; // STRAPPING: ascending heights
+};
+
+void tank_geometryDefaults(TankGeometry &geom);
+
+// Shape-specific checks (cone shorter than the rod is checked at build time).
+bool tank_validateGeometry(const TankGeometry &geom);
+
+// Vertical cylinders and rectangular tanks need no table.
+bool tank_isLinear(const TankGeometry &geom);
+
+// Fill lut[0..points-1] with the volume in 0.01 L at height i / (points - 1)
+// of the rod. Modelled shapes scale volumeLiters (full tank); a strapping table uses its
+// own liters (clamped past the last point). false when the inputs cannot
+// produce a monotonic table.
+bool tank_buildVolumeLut(const TankGeometry &geom, float volumeLiters, float rodCm,
+                         uint32_t *lutCenti, size_t points);
+
+bool tank_shapeFromString(const char *name, TankShape &shape);
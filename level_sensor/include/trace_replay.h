@@ -0,0 +1,71 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Replays a recorded raw probe trace through probe_getRaw() (READ_REPLAY), so
+// quality, filtering and publishing can be checked against field data.
+//
+// A trace is a sequence of {tMs, raw} samples with non-decreasing timestamps;
+// only offsets from the first sample matter. Sources:
+//  - RAM buffer filled in chunks (MQTT "replay" command / serial upload),
+//  - an embedded trace compiled into flash when include/replay_trace_data.h
+//    exists (it must define `kReplayEmbeddedTrace[]` of ReplaySample),
+//  - host builds only: a file of little-endian {uint32 tMs, uint32 raw} pairs,
+//    memory-mapped read-only.
+//
+// Playback is time based: replay_rawAt(now) returns the sample in effect at
+// (now - start) * speed, so speed > 1 compresses the trace. A driver that owns
+// a simulated clock can instead walk the trace with replay_next().
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#ifndef CFG_REPLAY_MAX_SAMPLES
+#define CFG_REPLAY_MAX_SAMPLES 1024u // RAM buffer for uploaded traces (8 bytes each)
+#endif
+
+struct ReplaySample
+{
+    uint32_t tMs;
+    uint32_t raw;
+};
+
+struct ReplayStatus
+{
+    bool active;
+    bool finished; // reached the end without loop; last raw is held
+    bool loop;
+    float speed;
+    uint32_t count;
+    uint32_t index;
+    uint32_t durationMs;
+    const char *source; // "buffer", "embedded", "file" or "none"
+};
+
+// RAM buffer (uploaded traces). Appending validates timestamp order.
+void replay_clearBuffer();
+bool replay_append(const ReplaySample *samples, size_t count);
+bool replay_useBuffer();
+
+bool replay_hasEmbedded();
+bool replay_useEmbedded();
+
+#if !defined(ESP_PLATFORM)
+bool replay_mapFile(const char *path);
+#endif
+
+bool replay_start(uint32_t nowMs, float speed, bool loop);
+void replay_stop();
+bool replay_isActive();
+
+// Raw value in effect at nowMs; false when no replay is active.
+bool replay_rawAt(uint32_t nowMs, uint32_t &raw);
+
+// Sequential stepping with original timestamps; false at the end (no loop).
+bool replay_next(ReplaySample &out);
+void replay_rewind();
+
+void replay_getStatus(ReplayStatus &out);
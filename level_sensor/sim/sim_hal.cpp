@@ -0,0 +1,211 @@
+#include "sim_hal.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_sleep.h>
+#include <esp_system.h>
+#include <esp_wifi.h>
+#include <chrono>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+static SimHalConfig s_cfg{1.0, false, (uint32_t)ESP_RST_POWERON};
+static std::chrono::steady_clock::time_point s_hostStart;
+static uint64_t s_idleUs = 0;
+static SimProbeFn s_probe = nullptr;
+static bool s_wifiUp = true;
+static uint32_t s_rng = 0x2545F491u;
+
+void simhal_begin(const SimHalConfig &cfg)
+{
+    s_cfg = cfg;
+    s_hostStart = std::chrono::steady_clock::now();
+    s_idleUs = 0;
+}
+
+uint64_t simhal_nowUs()
+{
+    if (s_cfg.cpuScale <= 0.0)
+    {
+        return s_idleUs;
+    }
+    const auto hostUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - s_hostStart)
+                            .count();
+    return s_idleUs + (uint64_t)((double)hostUs * s_cfg.cpuScale);
+}
+
+void simhal_idleMs(uint32_t ms)
+{
+    s_idleUs += (uint64_t)ms * 1000u;
+}
+
+uint64_t simhal_idleTotalUs()
+{
+    return s_idleUs;
+}
+
+void simhal_setProbe(SimProbeFn fn)
+{
+    s_probe = fn;
+}
+
+void simhal_setWifiUp(bool up)
+{
+    s_wifiUp = up;
+}
+
+// ---- Arduino core ----
+
+uint32_t millis()
+{
+    return (uint32_t)(simhal_nowUs() / 1000u);
+}
+
+uint32_t micros()
+{
+    return (uint32_t)simhal_nowUs();
+}
+
+void delay(uint32_t ms)
+{
+    simhal_idleMs(ms);
+}
+
+void randomSeed(unsigned long seed)
+{
+    s_rng = (seed != 0u) ? (uint32_t)seed : 0x2545F491u;
+}
+
+static uint32_t nextRandom()
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+long random(long max)
+{
+    return (max > 0) ? (long)(nextRandom() % (uint32_t)max) : 0;
+}
+
+long random(long min, long max)
+{
+    return (max > min) ? min + random(max - min) : min;
+}
+
+uint32_t touchRead(uint8_t)
+{
+    const int32_t raw = s_probe ? s_probe(millis()) : 0;
+    return (raw > 0) ? (uint32_t)raw : 0u;
+}
+
+void configTime(long, int, const char *, const char *, const char *)
+{
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len)
+{
+    if (s_cfg.serialEcho)
+    {
+        fwrite(buf, 1, len, stdout);
+    }
+    return len;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    return 180000u;
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+    return 150000u;
+}
+
+void EspClass::restart()
+{
+    throw SimHalHalt{"ESP.restart()"};
+}
+
+wl_status_t WiFiClass::status()
+{
+    return (s_wifiUp && _mode != WIFI_OFF) ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+// ---- ESP-IDF ----
+
+esp_reset_reason_t esp_reset_reason()
+{
+    return (esp_reset_reason_t)s_cfg.resetReason;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t)
+{
+    return 110000u;
+}
+
+static const esp_partition_t kAppPartition = {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0,
+                                              0x10000u, 0x330000u, "app0", false};
+static const esp_partition_t kNvsPartition = {ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS,
+                                              0x9000u, 0x5000u, "nvs", false};
+
+const esp_partition_t *esp_partition_find_first(int type, int subtype, const char *)
+{
+    if (type == kNvsPartition.type && subtype == kNvsPartition.subtype)
+    {
+        return &kNvsPartition;
+    }
+    return nullptr;
+}
+
+const esp_partition_t *esp_ota_get_running_partition()
+{
+    return &kAppPartition;
+}
+
+const esp_partition_t *esp_ota_get_boot_partition()
+{
+    return &kAppPartition;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *partition, esp_ota_img_states_t *state)
+{
+    if (partition == nullptr || state == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *state = ESP_OTA_IMG_VALID;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback()
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t)
+{
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start()
+{
+    throw SimHalHalt{"esp_deep_sleep_start()"};
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t, wifi_config_t *conf)
+{
+    if (conf == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(conf, 0, sizeof(*conf));
+    memcpy(conf->sta.ssid, "sim", 3);
+    return ESP_OK;
+}
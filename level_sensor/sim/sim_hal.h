@@ -0,0 +1,67 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-ins for the hardware the firmware talks to, shared by the stubs in
+// sim/stubs and the driver in sim_main.cpp. One thread, one virtual clock:
+// idle time (loop_events_wait, delay) jumps the clock forward, and execution
+// time is the host's elapsed time multiplied by cpuScale, so task run times and
+// lateness show up in the scheduler and profiler stats. cpuScale 0 freezes the
+// clock while code runs and makes a run bit-for-bit reproducible.
+
+struct SimHalConfig
+{
+    double cpuScale;      // virtual us per host us of execution
+    bool serialEcho;      // copy Serial output to stdout
+    uint32_t resetReason; // esp_reset_reason_t reported at boot
+};
+
+// Raised by ESP.restart() / esp_deep_sleep_start(): the process cannot reboot
+// the firmware's static state, so the run ends there.
+struct SimHalHalt
+{
+    const char *why;
+};
+
+typedef int32_t (*SimProbeFn)(uint32_t nowMs);
+
+void simhal_begin(const SimHalConfig &cfg);
+uint64_t simhal_nowUs();
+void simhal_idleMs(uint32_t ms);
+uint64_t simhal_idleTotalUs();
+
+void simhal_setProbe(SimProbeFn fn);
+void simhal_setWifiUp(bool up);
+void simhal_setBrokerUp(bool up);
+
+// Queue a message on topic for delivery through PubSubClient::loop() once the
+// client is connected and subscribed to it. Messages are delivered in order.
+void simhal_inject(uint32_t atMs, const char *topic, const char *payload);
+// Earliest time a queued message becomes deliverable (UINT32_MAX when none);
+// loop_events_wait() does not sleep past it.
+uint32_t simhal_nextInjectMs();
+
+struct SimTopicStats
+{
+    uint32_t publishes;
+    uint32_t bytes;
+    uint32_t failed; // publish() while disconnected
+};
+
+struct SimNvsStats
+{
+    uint32_t puts;   // put*/remove/clear calls
+    uint32_t writes; // of which changed the stored value
+    uint32_t bytes;  // payload bytes of those writes
+};
+
+struct SimMqttStats
+{
+    uint32_t connects;
+    uint32_t connectFailures;
+    uint32_t delivered; // injected messages handed to the callback
+};
+
+void simhal_forEachTopic(void (*fn)(const char *topic, const SimTopicStats &st, void *ctx), void *ctx);
+void simhal_forEachNvsKey(void (*fn)(const char *nsKey, const SimNvsStats &st, void *ctx), void *ctx);
+SimMqttStats simhal_mqttStats();
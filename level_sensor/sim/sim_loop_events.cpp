@@ -0,0 +1,35 @@
+#include "loop_events.h"
+#include <Arduino.h>
+#include "sim_hal.h"
+
+// Virtual-clock loop_events: nothing else runs while the main task waits, so a
+// wait with no pending bits is a jump of the clock, cut short by the next
+// injected MQTT message so it is delivered on time.
+
+static uint32_t s_pending = 0;
+
+void loop_events_begin()
+{
+}
+
+void loop_events_signal(uint32_t bits)
+{
+    s_pending |= bits;
+}
+
+uint32_t loop_events_wait(uint32_t timeoutMs)
+{
+    if (s_pending == 0u && timeoutMs > 0u)
+    {
+        const uint32_t now = millis();
+        const uint32_t injectMs = simhal_nextInjectMs();
+        if (injectMs != UINT32_MAX && (int32_t)(injectMs - now) > 0 && injectMs - now < timeoutMs)
+        {
+            timeoutMs = injectMs - now;
+        }
+        simhal_idleMs(timeoutMs);
+    }
+    const uint32_t bits = s_pending;
+    s_pending = 0u;
+    return bits;
+}
@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <esp_system.h>
+#include "main.h"
+#include "device_state.h"
+#include "domain_strings.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "sim_hal.h"
+#include "sim_scenario.h"
+
+// Whole-firmware run on the host: appSetup() once, then appLoop() on the
+// virtual clock until the simulated duration is over. The probe is driven by a
+// sim_scenario trace, NVS and the broker are in memory, and the run ends with a
+// report of what a device would have done over that time: publishes per topic,
+// NVS writes per key, time spent in each quality state, scheduler lateness and
+// per-task execution time.
+//
+//   program [--days N | --hours N] [--scenario NAME] [--seed N] [--cpu-scale X]
+//           [--outage START_H,DUR_H]... [--verbose]
+
+// pio test -e sim builds this tree with a suite's own main().
+#ifndef PIO_UNIT_TESTING
+
+extern DeviceState g_state;
+
+namespace
+{
+// BASE_TOPIC in main.cpp; the firmware subscribes to <base>/cmd.
+constexpr char kCmdTopic[] = "water_tank/water_tank_esp32/cmd";
+constexpr uint32_t kCalibrateAtMs = 20000u;
+constexpr uint32_t kStallPasses = 1000000u;
+constexpr size_t kMaxOutages = 8u;
+constexpr uint8_t kReasonCount = (uint8_t)ProbeQualityReason::UNKNOWN + 1u;
+
+// Touch counts of an ESP32-S3 probe: dry and wet ends of the tank, and what a
+// pulled connector reads (below CFG_PROBE_DISCONNECTED_BELOW_RAW).
+constexpr SimRange kRange = {80000, 140000, 20000};
+
+// A day of household use: drawn down over 24 h, refilled, with probe noise and
+// slow baseline drift for the drift compensator to track.
+const SimScenario kDaily = {"daily", 3, {{SimLayerType::DRAIN, 86400000u, 0u, 0.0f, 0.0f},
+                                          {SimLayerType::NOISE, 0u, 0u, 40.0f, 0.0f},
+                                          {SimLayerType::DRIFT, 0u, 0u, 25.0f, 0.0f}}};
+
+struct Outage
+{
+    uint64_t startMs;
+    uint64_t endMs;
+};
+
+struct Options
+{
+    double hours = 24.0;
+    const SimScenario *scenario = &kDaily;
+    uint32_t seed = CFG_SIM_DEFAULT_SEED;
+    double cpuScale = 1.0;
+    bool verbose = false;
+    Outage outages[kMaxOutages];
+    size_t outageCount = 0;
+};
+
+struct QualityTally
+{
+    uint64_t ms[kReasonCount];
+    uint32_t entries[kReasonCount];
+    uint64_t percentValidMs;
+};
+
+SimEngine s_engine;
+
+int32_t probeSample(uint32_t nowMs)
+{
+    return sim_engineSample(s_engine, nowMs, kRange);
+}
+
+const SimScenario *findScenario(const char *name)
+{
+    if (strcmp(name, kDaily.name) == 0)
+    {
+        return &kDaily;
+    }
+    for (uint8_t i = 0; i < sim_builtinCount(); ++i)
+    {
+        const SimScenario *s = sim_builtinScenario(i);
+        if (s != nullptr && strcmp(s->name, name) == 0)
+        {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--days N | --hours N] [--scenario NAME] [--seed N] [--cpu-scale X]\n"
+            "          [--outage START_H,DUR_H]... [--verbose]\n"
+            "scenarios: %s",
+            prog, kDaily.name);
+    for (uint8_t i = 0; i < sim_builtinCount(); ++i)
+    {
+        fprintf(stderr, " %s", sim_builtinScenario(i)->name);
+    }
+    fprintf(stderr, "\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (strcmp(a, "--verbose") == 0)
+        {
+            opt.verbose = true;
+            continue;
+        }
+        if (v == nullptr)
+        {
+            return false;
+        }
+        ++i;
+        if (strcmp(a, "--days") == 0)
+        {
+            opt.hours = atof(v) * 24.0;
+        }
+        else if (strcmp(a, "--hours") == 0)
+        {
+            opt.hours = atof(v);
+        }
+        else if (strcmp(a, "--scenario") == 0)
+        {
+            opt.scenario = findScenario(v);
+            if (opt.scenario == nullptr)
+            {
+                return false;
+            }
+        }
+        else if (strcmp(a, "--seed") == 0)
+        {
+            opt.seed = (uint32_t)strtoul(v, nullptr, 0);
+        }
+        else if (strcmp(a, "--cpu-scale") == 0)
+        {
+            opt.cpuScale = atof(v);
+        }
+        else if (strcmp(a, "--outage") == 0)
+        {
+            double startH = 0.0;
+            double durH = 0.0;
+            if (opt.outageCount >= kMaxOutages || sscanf(v, "%lf,%lf", &startH, &durH) != 2 || durH <= 0.0)
+            {
+                return false;
+            }
+            opt.outages[opt.outageCount++] = Outage{(uint64_t)(startH * 3600000.0),
+                                                    (uint64_t)((startH + durH) * 3600000.0)};
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return opt.hours > 0.0 && opt.cpuScale >= 0.0;
+}
+
+bool brokerUpAt(const Options &opt, uint64_t nowMs)
+{
+    for (size_t i = 0; i < opt.outageCount; ++i)
+    {
+        if (nowMs >= opt.outages[i].startMs && nowMs < opt.outages[i].endMs)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void injectCalibration()
+{
+    char cmd[160];
+    snprintf(cmd, sizeof(cmd),
+             "{\"schema\":1,\"request_id\":\"sim-cal\",\"type\":\"set_calibration\","
+             "\"data\":{\"cal_dry_set\":%ld,\"cal_wet_set\":%ld}}",
+             (long)kRange.dry, (long)kRange.wet);
+    simhal_inject(kCalibrateAtMs, kCmdTopic, cmd);
+}
+
+// ---- report ----
+
+struct TopicCtx
+{
+    double hours;
+};
+
+void printTopic(const char *topic, const SimTopicStats &st, void *ctx)
+{
+    const double hours = static_cast<TopicCtx *>(ctx)->hours;
+    printf("  %-48s %9lu %9.1f %11lu %7lu\n", topic, (unsigned long)st.publishes,
+           (double)st.publishes / hours, (unsigned long)st.bytes, (unsigned long)st.failed);
+}
+
+void printNvsKey(const char *nsKey, const SimNvsStats &st, void *ctx)
+{
+    const double days = static_cast<TopicCtx *>(ctx)->hours / 24.0;
+    printf("  %-32s %9lu %9lu %9.1f %11lu\n", nsKey, (unsigned long)st.puts, (unsigned long)st.writes,
+           (double)st.writes / days, (unsigned long)st.bytes);
+}
+
+void printReport(const Options &opt, const QualityTally &q, uint64_t simMs, uint32_t passes, double hostS,
+                 const char *endReason)
+{
+    const double hours = (double)simMs / 3600000.0;
+    const uint64_t nowUs = simhal_nowUs();
+    const uint64_t busyUs = nowUs - simhal_idleTotalUs();
+    printf("\n== sim report scenario=%s seed=0x%08lX simulated_h=%.2f host_s=%.2f cpu_scale=%.2f end=%s\n",
+           opt.scenario->name, (unsigned long)opt.seed, hours, hostS, opt.cpuScale, endReason);
+    printf("loop passes=%lu per_s=%.2f busy_pct=%.3f\n", (unsigned long)passes,
+           (double)passes / ((double)simMs / 1000.0), 100.0 * (double)busyUs / (double)nowUs);
+
+    TopicCtx ctx{hours};
+    const SimMqttStats mqtt = simhal_mqttStats();
+    printf("\n-- mqtt connects=%lu connect_failures=%lu commands_delivered=%lu\n", (unsigned long)mqtt.connects,
+           (unsigned long)mqtt.connectFailures, (unsigned long)mqtt.delivered);
+    printf("  %-48s %9s %9s %11s %7s\n", "topic", "publishes", "per_hour", "bytes", "failed");
+    simhal_forEachTopic(printTopic, &ctx);
+
+    printf("\n-- nvs (writes = puts that changed the stored value)\n");
+    printf("  %-32s %9s %9s %9s %11s\n", "namespace/key", "puts", "writes", "per_day", "bytes");
+    simhal_forEachNvsKey(printNvsKey, &ctx);
+
+    printf("\n-- quality percent_valid_pct=%.2f\n", 100.0 * (double)q.percentValidMs / (double)simMs);
+    printf("  %-24s %9s %9s\n", "reason", "time_pct", "entries");
+    for (uint8_t r = 0; r < kReasonCount; ++r)
+    {
+        if (q.ms[r] == 0u && q.entries[r] == 0u)
+        {
+            continue;
+        }
+        printf("  %-24s %9.3f %9lu\n", toString((ProbeQualityReason)r), 100.0 * (double)q.ms[r] / (double)simMs,
+               (unsigned long)q.entries[r]);
+    }
+
+    const SchedTask *tasks = nullptr;
+    const size_t taskCount = sched_tasks(tasks);
+    printf("\n-- scheduler\n");
+    printf("  %-12s %9s %9s %9s %9s %9s %11s %11s\n", "task", "period_ms", "runs", "late_avg", "late_max",
+           "overruns", "exec_avg_us", "exec_max_us");
+    for (size_t i = 0; i < taskCount; ++i)
+    {
+        const SchedTaskStats &st = tasks[i].stats;
+        printf("  %-12s %9lu %9lu %9.2f %9lu %9lu %11.1f %11lu\n", tasks[i].name, (unsigned long)tasks[i].periodMs,
+               (unsigned long)st.runs, st.runs ? (double)st.totalLateMs / st.runs : 0.0,
+               (unsigned long)st.maxLateMs, (unsigned long)st.overruns,
+               st.runs ? (double)st.totalExecUs / st.runs : 0.0, (unsigned long)st.maxExecUs);
+    }
+
+    printf("\n-- profiler (since the last profiler reset)\n");
+    printf("  %-12s %9s %9s %9s %9s\n", "slot", "count", "avg_us", "p99_us", "max_us");
+    for (size_t i = 0; i < profiler_slotCount(); ++i)
+    {
+        ProfilerSlotSummary s{};
+        if (profiler_getSummary(i, s))
+        {
+            printf("  %-12s %9lu %9lu %9lu %9lu\n", s.name, (unsigned long)s.count, (unsigned long)s.avgUs,
+                   (unsigned long)s.p99Us, (unsigned long)s.maxUs);
+        }
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    simhal_begin(SimHalConfig{opt.cpuScale, opt.verbose, (uint32_t)ESP_RST_POWERON});
+    sim_engineStart(s_engine, *opt.scenario, opt.seed, 0u, kRange.dry, kRange);
+    simhal_setProbe(probeSample);
+    injectCalibration();
+
+    const uint64_t endMs = (uint64_t)(opt.hours * 3600000.0);
+    const auto hostStart = std::chrono::steady_clock::now();
+    QualityTally q{};
+    uint32_t passes = 0;
+    uint32_t stalled = 0;
+    const char *endReason = "duration";
+    uint64_t lastMs = 0;
+    uint8_t lastReason = kReasonCount;
+    try
+    {
+        appSetup();
+        for (;;)
+        {
+            const uint64_t beforeUs = simhal_nowUs();
+            const uint64_t nowMs = beforeUs / 1000u;
+            if (nowMs >= endMs)
+            {
+                break;
+            }
+            simhal_setBrokerUp(brokerUpAt(opt, nowMs));
+
+            // Attribute the time since the previous pass to the state it was in.
+            const uint8_t reason = (uint8_t)g_state.probe.quality;
+            if (lastReason < kReasonCount)
+            {
+                q.ms[lastReason] += nowMs - lastMs;
+            }
+            if (reason != lastReason && reason < kReasonCount)
+            {
+                q.entries[reason]++;
+            }
+            if (g_state.level.percentValid)
+            {
+                q.percentValidMs += nowMs - lastMs;
+            }
+            lastReason = reason;
+            lastMs = nowMs;
+
+            appLoop();
+            passes++;
+            stalled = (simhal_nowUs() == beforeUs) ? stalled + 1u : 0u;
+            if (stalled >= kStallPasses)
+            {
+                endReason = "stalled";
+                break;
+            }
+        }
+    }
+    catch (const SimHalHalt &halt)
+    {
+        endReason = halt.why;
+    }
+
+    const uint64_t simMs = simhal_nowUs() / 1000u;
+    if (lastReason < kReasonCount && simMs > lastMs)
+    {
+        q.ms[lastReason] += simMs - lastMs;
+    }
+    const double hostS =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - hostStart).count();
+    printReport(opt, q, simMs > 0u ? simMs : 1u, passes, hostS, endReason);
+    return (strcmp(endReason, "duration") == 0) ? 0 : 1;
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,143 @@
+#include <PubSubClient.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "sim_hal.h"
+
+// One broker, one client. Taking the broker down drops the session the same
+// way a lost TCP connection would: connected() turns false and the firmware
+// has to reconnect and resubscribe.
+
+namespace
+{
+struct Pending
+{
+    uint32_t atMs;
+    std::string topic;
+    std::string payload;
+};
+
+bool s_brokerUp = true;
+uint32_t s_brokerEpoch = 1;
+std::set<std::string> s_subscriptions;
+std::deque<Pending> s_pending;
+std::map<std::string, SimTopicStats> s_topics;
+SimMqttStats s_mqtt{};
+} // namespace
+
+void simhal_setBrokerUp(bool up)
+{
+    if (s_brokerUp && !up)
+    {
+        s_brokerEpoch++;
+        s_subscriptions.clear();
+    }
+    s_brokerUp = up;
+}
+
+void simhal_inject(uint32_t atMs, const char *topic, const char *payload)
+{
+    s_pending.push_back(Pending{atMs, topic ? topic : "", payload ? payload : ""});
+}
+
+uint32_t simhal_nextInjectMs()
+{
+    return s_pending.empty() ? UINT32_MAX : s_pending.front().atMs;
+}
+
+void simhal_forEachTopic(void (*fn)(const char *topic, const SimTopicStats &st, void *ctx), void *ctx)
+{
+    for (const auto &it : s_topics)
+    {
+        fn(it.first.c_str(), it.second, ctx);
+    }
+}
+
+SimMqttStats simhal_mqttStats()
+{
+    return s_mqtt;
+}
+
+bool PubSubClient::connect(const char *, const char *, const char *, const char *willTopic, uint8_t,
+                           bool, const char *)
+{
+    if (!s_brokerUp || !WiFi.isConnected())
+    {
+        s_mqtt.connectFailures++;
+        _connected = false;
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+    (void)willTopic;
+    s_mqtt.connects++;
+    _connected = true;
+    _session = s_brokerEpoch;
+    _state = MQTT_CONNECTED;
+    return true;
+}
+
+void PubSubClient::disconnect()
+{
+    _connected = false;
+    _state = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected()
+{
+    if (_connected && (!s_brokerUp || _session != s_brokerEpoch || !WiFi.isConnected()))
+    {
+        _connected = false;
+        _state = MQTT_CONNECTION_LOST;
+    }
+    return _connected;
+}
+
+bool PubSubClient::subscribe(const char *topic)
+{
+    if (!connected() || topic == nullptr)
+    {
+        return false;
+    }
+    s_subscriptions.insert(topic);
+    return true;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool)
+{
+    SimTopicStats &st = s_topics[topic ? topic : ""];
+    const size_t len = payload ? strlen(payload) : 0u;
+    if (!connected() || len + (topic ? strlen(topic) : 0u) + 8u > _bufferSize)
+    {
+        st.failed++;
+        return false;
+    }
+    st.publishes++;
+    st.bytes += (uint32_t)len;
+    return true;
+}
+
+bool PubSubClient::loop()
+{
+    if (!connected())
+    {
+        return false;
+    }
+    const uint32_t now = millis();
+    while (!s_pending.empty() && (int32_t)(now - s_pending.front().atMs) >= 0 &&
+           s_subscriptions.count(s_pending.front().topic) != 0u)
+    {
+        Pending msg = s_pending.front();
+        s_pending.pop_front();
+        s_mqtt.delivered++;
+        if (_callback != nullptr)
+        {
+            std::vector<char> topic(msg.topic.begin(), msg.topic.end());
+            topic.push_back('\0');
+            std::vector<uint8_t> payload(msg.payload.begin(), msg.payload.end());
+            _callback(topic.data(), payload.data(), (unsigned int)payload.size());
+        }
+    }
+    return true;
+}
@@ -0,0 +1,145 @@
+#include <Preferences.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "sim_hal.h"
+
+// Preferences over an in-memory map. Namespaces and keys follow the NVS name
+// limit (15 chars) so a key that would be rejected on the device fails here too.
+
+namespace
+{
+constexpr size_t kNvsKeyMax = 15u;
+
+typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+std::map<std::string, Namespace> &store()
+{
+    static std::map<std::string, Namespace> s;
+    return s;
+}
+
+std::map<std::string, SimNvsStats> &stats()
+{
+    static std::map<std::string, SimNvsStats> s;
+    return s;
+}
+
+SimNvsStats &statsFor(const char *ns, const char *key)
+{
+    return stats()[std::string(ns) + "/" + key];
+}
+} // namespace
+
+bool Preferences::begin(const char *name, bool readOnly)
+{
+    if (name == nullptr || strlen(name) > kNvsKeyMax)
+    {
+        return false;
+    }
+    strncpy(_ns, name, sizeof(_ns));
+    _ns[sizeof(_ns) - 1] = '\0';
+    _open = true;
+    _readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end()
+{
+    _open = false;
+}
+
+bool Preferences::clear()
+{
+    if (!_open || _readOnly)
+    {
+        return false;
+    }
+    Namespace &ns = store()[_ns];
+    SimNvsStats &st = statsFor(_ns, "*");
+    st.puts++;
+    if (!ns.empty())
+    {
+        st.writes++;
+        ns.clear();
+    }
+    return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+    if (!_open || _readOnly || key == nullptr)
+    {
+        return false;
+    }
+    Namespace &ns = store()[_ns];
+    SimNvsStats &st = statsFor(_ns, key);
+    st.puts++;
+    if (ns.erase(key) == 0u)
+    {
+        return false;
+    }
+    st.writes++;
+    return true;
+}
+
+bool Preferences::isKey(const char *key)
+{
+    if (!_open || key == nullptr)
+    {
+        return false;
+    }
+    const Namespace &ns = store()[_ns];
+    return ns.find(key) != ns.end();
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    if (!_open || key == nullptr)
+    {
+        return 0u;
+    }
+    const Namespace &ns = store()[_ns];
+    const auto it = ns.find(key);
+    return (it == ns.end()) ? 0u : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+    const size_t len = getBytesLength(key);
+    if (len == 0u || buf == nullptr || maxLen < len)
+    {
+        return 0u;
+    }
+    memcpy(buf, store()[_ns][key].data(), len);
+    return len;
+}
+
+bool Preferences::put(const char *key, const void *value, size_t len)
+{
+    if (!_open || _readOnly || key == nullptr || strlen(key) > kNvsKeyMax || (value == nullptr && len > 0u))
+    {
+        return false;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    std::vector<uint8_t> next(bytes, bytes + len);
+    std::vector<uint8_t> &slot = store()[_ns][key];
+    SimNvsStats &st = statsFor(_ns, key);
+    st.puts++;
+    if (slot != next || len == 0u)
+    {
+        st.writes++;
+        st.bytes += (uint32_t)len;
+        slot.swap(next);
+    }
+    return true;
+}
+
+void simhal_forEachNvsKey(void (*fn)(const char *nsKey, const SimNvsStats &st, void *ctx), void *ctx)
+{
+    for (const auto &it : stats())
+    {
+        fn(it.first.c_str(), it.second, ctx);
+    }
+}
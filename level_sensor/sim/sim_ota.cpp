@@ -0,0 +1,64 @@
+#include "ota_events.h"
+#include "ota_service.h"
+#include <stdio.h>
+
+// No network to pull firmware from: the OTA service is idle and every request
+// fails the way an unreachable server would, so the command and state paths
+// around it still run.
+
+static bool sim_otaUnavailable(char *errBuf, size_t errBufLen)
+{
+    if (errBuf != nullptr && errBufLen > 0u)
+    {
+        snprintf(errBuf, errBufLen, "simulation");
+    }
+    return false;
+}
+
+void ota_begin(DeviceState *, const char *, const char *)
+{
+}
+
+void ota_handle()
+{
+}
+
+bool ota_pullStart(DeviceState *, const char *, const char *, const char *, const char *, bool, bool,
+                   char *errBuf, size_t errBufLen)
+{
+    return sim_otaUnavailable(errBuf, errBufLen);
+}
+
+bool ota_pullStartFromManifest(DeviceState *, const char *, bool, bool, char *errBuf, size_t errBufLen)
+{
+    return sim_otaUnavailable(errBuf, errBufLen);
+}
+
+bool ota_checkManifest(DeviceState *, char *errBuf, size_t errBufLen)
+{
+    return sim_otaUnavailable(errBuf, errBufLen);
+}
+
+void ota_confirmRunningApp()
+{
+}
+
+bool ota_cancel(const char *)
+{
+    return false;
+}
+
+bool ota_isBusy()
+{
+    return false;
+}
+
+bool ota_events_begin()
+{
+    return true;
+}
+
+bool ota_events_drainAndApply(DeviceState *)
+{
+    return false;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "esp_system.h"
+
+// Host stand-in for the slice of the Arduino-ESP32 core the firmware uses.
+// Time is virtual (sim_hal.h): millis()/micros() only move when the firmware
+// waits or delays, so a simulated week runs in seconds.
+
+typedef uint8_t byte;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+uint32_t touchRead(uint8_t pin);
+void configTime(long gmtOffsetS, int dstOffsetS, const char *server1, const char *server2 = nullptr,
+                const char *server3 = nullptr);
+
+class String
+{
+public:
+    String(const char *s = "") : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+    explicit String(unsigned v) : _s(std::to_string(v)) {}
+    explicit String(long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned length() const { return (unsigned)_s.size(); }
+    bool operator==(const char *s) const { return _s == (s ? s : ""); }
+    String &operator+=(const char *s)
+    {
+        _s += s ? s : "";
+        return *this;
+    }
+    String &operator+=(const String &s)
+    {
+        _s += s._s;
+        return *this;
+    }
+    friend String operator+(const String &a, const char *b) { return String(a._s + (b ? b : "")); }
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+
+private:
+    std::string _s;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1u); }
+    virtual size_t write(const uint8_t *buf, size_t len) = 0;
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t println(const char *s = "") { return print(s) + print("\r\n"); }
+    size_t println(const String &s) { return println(s.c_str()); }
+    size_t println(int v) { return print(v) + println(); }
+    size_t println(unsigned v) { return print(v) + println(); }
+    size_t println(long v) { return print(v) + println(); }
+    size_t println(unsigned long v) { return print(v) + println(); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buf[512];
+        va_list ap;
+        va_start(ap, fmt);
+        const int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        return (n > 0) ? write((const uint8_t *)buf, strnlen(buf, sizeof(buf))) : 0u;
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    virtual void flush() {}
+    size_t readBytesUntil(char, char *, size_t) { return 0u; }
+    void setTimeout(unsigned long) {}
+};
+
+// Console output goes to stdout when echo is on (sim_hal_setSerialEcho).
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(const uint8_t *buf, size_t len) override;
+    using Print::write;
+    operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+class IPAddress
+{
+public:
+    IPAddress() : _b{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _b{a, b, c, d} {}
+    uint8_t operator[](int i) const { return _b[i & 3]; }
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+        return String(buf);
+    }
+    operator uint32_t() const { return (uint32_t)_b[0] | ((uint32_t)_b[1] << 8) | ((uint32_t)_b[2] << 16) | ((uint32_t)_b[3] << 24); }
+
+private:
+    uint8_t _b[4];
+};
+
+class EspClass
+{
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    void restart();
+};
+extern EspClass ESP;
@@ -0,0 +1,49 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// In-memory NVS. Values survive simulated reboots within one run; every put is
+// counted, and puts that change the stored bytes are counted separately as
+// flash writes (NVS skips rewriting an identical value).
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false);
+    void end();
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putBool(const char *key, bool value) { return put(key, &value, sizeof(value)) ? 1u : 0u; }
+    size_t putUChar(const char *key, uint8_t value) { return put(key, &value, sizeof(value)) ? 1u : 0u; }
+    size_t putUShort(const char *key, uint16_t value) { return put(key, &value, sizeof(value)) ? 2u : 0u; }
+    size_t putInt(const char *key, int32_t value) { return put(key, &value, sizeof(value)) ? 4u : 0u; }
+    size_t putUInt(const char *key, uint32_t value) { return put(key, &value, sizeof(value)) ? 4u : 0u; }
+    size_t putFloat(const char *key, float value) { return put(key, &value, sizeof(value)) ? 4u : 0u; }
+    size_t putULong64(const char *key, uint64_t value) { return put(key, &value, sizeof(value)) ? 8u : 0u; }
+    size_t putBytes(const char *key, const void *value, size_t len) { return put(key, value, len) ? len : 0u; }
+
+    bool getBool(const char *key, bool def = false) { return getT(key, def); }
+    uint8_t getUChar(const char *key, uint8_t def = 0) { return getT(key, def); }
+    uint16_t getUShort(const char *key, uint16_t def = 0) { return getT(key, def); }
+    int32_t getInt(const char *key, int32_t def = 0) { return getT(key, def); }
+    uint32_t getUInt(const char *key, uint32_t def = 0) { return getT(key, def); }
+    float getFloat(const char *key, float def = 0.0f) { return getT(key, def); }
+    uint64_t getULong64(const char *key, uint64_t def = 0) { return getT(key, def); }
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+    bool put(const char *key, const void *value, size_t len);
+    template <class T>
+    T getT(const char *key, T def)
+    {
+        T v;
+        return (getBytesLength(key) == sizeof(T) && getBytes(key, &v, sizeof(T)) == sizeof(T)) ? v : def;
+    }
+
+    char _ns[16] = {0};
+    bool _open = false;
+    bool _readOnly = false;
+};
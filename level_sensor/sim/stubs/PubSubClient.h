@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include "WiFi.h"
+
+// Broker stand-in: publishes are tallied per topic by the harness, and
+// commands it injects arrive through the callback from loop().
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+class PubSubClient
+{
+public:
+    typedef void (*Callback)(char *topic, uint8_t *payload, unsigned int length);
+
+    explicit PubSubClient(Client &) {}
+    PubSubClient &setServer(const char *, uint16_t) { return *this; }
+    PubSubClient &setKeepAlive(uint16_t) { return *this; }
+    PubSubClient &setSocketTimeout(uint16_t) { return *this; }
+    bool setBufferSize(uint16_t size)
+    {
+        _bufferSize = size;
+        return true;
+    }
+    PubSubClient &setCallback(Callback cb)
+    {
+        _callback = cb;
+        return *this;
+    }
+
+    bool connect(const char *id, const char *user, const char *pass, const char *willTopic,
+                 uint8_t willQos, bool willRetain, const char *willMessage);
+    void disconnect();
+    bool connected();
+    int state() { return _state; }
+    bool loop();
+    bool publish(const char *topic, const char *payload, bool retained = false);
+    bool subscribe(const char *topic);
+
+private:
+    Callback _callback = nullptr;
+    uint16_t _bufferSize = 256;
+    int _state = MQTT_DISCONNECTED;
+    bool _connected = false;
+    uint32_t _session = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+// Station that is always associated unless the harness takes the link down.
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_MODE_NULL = 0,
+    WIFI_OFF = 0,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+} wifi_mode_t;
+
+class Client : public Stream
+{
+public:
+    size_t write(const uint8_t *, size_t len) override { return len; }
+    using Print::write;
+};
+
+class WiFiClient : public Client
+{
+};
+
+class WiFiClass
+{
+public:
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    int8_t RSSI() { return isConnected() ? -58 : 0; }
+    IPAddress localIP() { return isConnected() ? IPAddress(192, 168, 1, 50) : IPAddress(); }
+    bool mode(wifi_mode_t m)
+    {
+        _mode = m;
+        return true;
+    }
+    wifi_mode_t getMode() { return _mode; }
+    void begin() {}
+    void begin(const char *, const char *) {}
+    bool disconnect(bool = false, bool = false) { return true; }
+    String SSID() { return String("sim"); }
+    bool setSleep(bool) { return true; }
+    void persistent(bool) {}
+
+private:
+    wifi_mode_t _mode = WIFI_OFF;
+};
+extern WiFiClass WiFi;
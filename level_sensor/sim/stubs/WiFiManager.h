@@ -0,0 +1,31 @@
+#pragma once
+#include "WiFi.h"
+
+// The portal never opens in the simulation: credentials are always present.
+
+class WiFiManager
+{
+public:
+    void setConfigPortalTimeout(unsigned long) {}
+    void setConnectTimeout(unsigned long) {}
+    void setConfigPortalBlocking(bool) {}
+    void setBreakAfterConfig(bool) {}
+    void setCaptivePortalEnable(bool) {}
+    void setWiFiAutoReconnect(bool) {}
+    void setCleanConnect(bool) {}
+    void setConnectRetries(int) {}
+    void setHostname(const char *) {}
+    void setTitle(const char *) {}
+    void setShowInfoUpdate(bool) {}
+    void setDebugOutput(bool) {}
+    void setEnableConfigPortal(bool) {}
+    void setMinimumSignalQuality(int) {}
+    bool startConfigPortal(const char *) { return false; }
+    bool startConfigPortal(const char *, const char *) { return false; }
+    bool autoConnect(const char *) { return true; }
+    bool autoConnect(const char *, const char *) { return true; }
+    bool process() { return false; }
+    bool getConfigPortalActive() { return false; }
+    void stopConfigPortal() {}
+    void resetSettings() {}
+};
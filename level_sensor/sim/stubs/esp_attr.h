@@ -0,0 +1,5 @@
+#pragma once
+
+// RTC memory is ordinary memory here; it survives a simulated deep sleep
+// because the process does.
+#define RTC_DATA_ATTR
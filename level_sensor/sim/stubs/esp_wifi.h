@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    WIFI_IF_STA,
+    WIFI_IF_AP
+} wifi_interface_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t ssid[32];
+        uint8_t password[64];
+    } sta;
+} wifi_config_t;
+
+esp_err_t esp_wifi_get_config(wifi_interface_t iface, wifi_config_t *conf);
@@ -0,0 +1,251 @@
+#include "adaptive_sampler.h"
+#include <math.h>
+
+// A slope only counts beyond this many standard errors, and not before the
+// regression has a few points.
+static constexpr float kDeadbandSe = 3.0f;
+static constexpr uint16_t kMinTrendSamples = 5u;
+
+static void sampler_applyMode(SamplerState &st, const SamplerConfig &cfg, SamplerMode mode, uint32_t nowMs)
+{
+    if (mode != st.mode)
+    {
+        st.modeSinceMs = nowMs;
+    }
+    st.mode = mode;
+    switch (mode)
+    {
+    case SamplerMode::ACTIVE:
+        st.rawMs = cfg.fastRawMs;
+        st.computeMs = cfg.fastComputeMs;
+        break;
+    case SamplerMode::STATIC:
+        st.rawMs = cfg.slowRawMs;
+        st.computeMs = cfg.slowComputeMs;
+        break;
+    case SamplerMode::NORMAL:
+    default:
+        st.rawMs = cfg.normalRawMs;
+        st.computeMs = cfg.normalComputeMs;
+        break;
+    }
+}
+
+// Cadence order: STATIC samples slowest, ACTIVE fastest.
+static uint8_t sampler_rank(SamplerMode mode)
+{
+    switch (mode)
+    {
+    case SamplerMode::STATIC:
+        return 0u;
+    case SamplerMode::ACTIVE:
+        return 2u;
+    case SamplerMode::NORMAL:
+    default:
+        return 1u;
+    }
+}
+
+void sampler_init(SamplerState &st, const SamplerConfig &cfg, uint32_t nowMs)
+{
+    st = SamplerState{};
+    st.publishTokens = (float)cfg.publishBurst;
+    st.publishTokenMs = nowMs;
+    st.modeSinceMs = nowMs;
+    sampler_applyMode(st, cfg, SamplerMode::NORMAL, nowMs);
+}
+
+// Move the origin to the new sample (dtS later, dp higher), age the old points
+// by the window, then add the new one at (0, 0).
+static void sampler_trendAdd(SamplerTrend &tr, float dtS, float dp, float windowS)
+{
+    tr.tt += dtS * dtS * tr.w - 2.0f * dtS * tr.t;
+    tr.pp += dp * dp * tr.w - 2.0f * dp * tr.p;
+    tr.tp += dtS * dp * tr.w - dtS * tr.p - dp * tr.t;
+    tr.t -= dtS * tr.w;
+    tr.p -= dp * tr.w;
+
+    const float decay = expf(-dtS / windowS);
+    tr.w = tr.w * decay + 1.0f;
+    tr.w2 = tr.w2 * decay * decay + 1.0f;
+    tr.t *= decay;
+    tr.tt *= decay;
+    tr.p *= decay;
+    tr.pp *= decay;
+    tr.tp *= decay;
+    if (tr.samples < UINT16_MAX)
+    {
+        tr.samples++;
+    }
+}
+
+// Weighted least-squares slope in percent per minute and its standard error.
+// false until the fit is determined.
+static bool sampler_trendSlope(const SamplerTrend &tr, float &slope, float &se)
+{
+    if (tr.samples < kMinTrendSamples)
+    {
+        return false;
+    }
+    const float sxx = tr.tt - tr.t * tr.t / tr.w;
+    if (!(sxx > 1e-6f))
+    {
+        return false;
+    }
+    const float sxy = tr.tp - tr.t * tr.p / tr.w;
+    const float syy = tr.pp - tr.p * tr.p / tr.w;
+    const float b = sxy / sxx;
+    const float sse = fmaxf(syy - b * sxy, 0.0f);
+    // Effective sample count of the decayed weights, for the residual variance
+    // and the slope variance of a weighted fit.
+    const float nEff = tr.w * tr.w / tr.w2;
+    if (nEff <= 2.5f)
+    {
+        return false;
+    }
+    const float sigma2 = (sse / tr.w) * nEff / (nEff - 2.0f);
+    slope = b * 60.0f;
+    se = sqrtf(sigma2 * (tr.w2 / tr.w) / sxx) * 60.0f;
+    return true;
+}
+
+bool sampler_update(SamplerState &st, const SamplerConfig &cfg, float percent, bool valid, uint32_t nowMs)
+{
+    const SamplerMode prev = st.mode;
+
+    if (!valid || isnan(percent))
+    {
+        // No trend without a level; fall back to the configured cadence.
+        st.hasLast = false;
+        st.quiet = false;
+        st.slopePctPerMin = 0.0f;
+        st.slopeSePctPerMin = 0.0f;
+        sampler_applyMode(st, cfg, SamplerMode::NORMAL, nowMs);
+        return st.mode != prev;
+    }
+
+    if (!st.hasLast)
+    {
+        st.hasLast = true;
+        st.lastPercent = percent;
+        st.lastMs = nowMs;
+        st.trend = SamplerTrend{};
+        st.trend.w = 1.0f;
+        st.trend.w2 = 1.0f;
+        st.trend.samples = 1u;
+        return false;
+    }
+
+    const uint32_t dtMs = nowMs - st.lastMs;
+    if (dtMs == 0u)
+    {
+        return false;
+    }
+    const float windowS = (float)(cfg.trendWindowMs > 0u ? cfg.trendWindowMs : 1u) / 1000.0f;
+    sampler_trendAdd(st.trend, (float)dtMs / 1000.0f, percent - st.lastPercent, windowS);
+    st.lastPercent = percent;
+    st.lastMs = nowMs;
+
+    float slope = 0.0f;
+    float se = 0.0f;
+    if (!sampler_trendSlope(st.trend, slope, se))
+    {
+        return false;
+    }
+    st.slopePctPerMin = slope;
+    st.slopeSePctPerMin = se;
+
+    // Rate the trend supports beyond its noise.
+    const float rate = fmaxf(fabsf(slope) - kDeadbandSe * se, 0.0f);
+    SamplerMode next = st.mode;
+    if (rate >= cfg.activeRatePctPerMin)
+    {
+        st.quiet = false;
+        next = SamplerMode::ACTIVE;
+    }
+    else if (rate < cfg.staticRatePctPerMin)
+    {
+        if (!st.quiet)
+        {
+            st.quiet = true;
+            st.quietSinceMs = nowMs;
+        }
+        if ((uint32_t)(nowMs - st.quietSinceMs) >= cfg.staticHoldMs)
+        {
+            next = SamplerMode::STATIC;
+        }
+        else if (st.mode == SamplerMode::ACTIVE)
+        {
+            next = SamplerMode::NORMAL;
+        }
+    }
+    else
+    {
+        // Between thresholds: hysteresis keeps ACTIVE, but leave STATIC.
+        st.quiet = false;
+        if (st.mode == SamplerMode::STATIC)
+        {
+            next = SamplerMode::NORMAL;
+        }
+    }
+
+    // Speeding up is never held back; the deadband already keeps noise out.
+    // Slowing down waits until the current mode has been held for the dwell.
+    const bool slower = sampler_rank(next) < sampler_rank(st.mode);
+    if (next != st.mode && (!slower || (uint32_t)(nowMs - st.modeSinceMs) >= cfg.minDwellMs))
+    {
+        sampler_applyMode(st, cfg, next, nowMs);
+        st.modeChanges++;
+        return true;
+    }
+    return false;
+}
+
+bool sampler_takePublishToken(SamplerState &st, const SamplerConfig &cfg, uint32_t nowMs)
+{
+    const uint32_t elapsed = nowMs - st.publishTokenMs;
+    st.publishTokenMs = nowMs;
+    st.publishTokens += (float)elapsed * (float)cfg.publishPerMin / 60000.0f;
+    if (st.publishTokens > (float)cfg.publishBurst)
+    {
+        st.publishTokens = (float)cfg.publishBurst;
+    }
+    if (st.publishTokens < 1.0f)
+    {
+        return false;
+    }
+    st.publishTokens -= 1.0f;
+    return true;
+}
+
+uint32_t sampler_rawCapMs(uint32_t windowMs, uint8_t hits)
+{
+    if (hits == 0u)
+    {
+        return UINT32_MAX;
+    }
+    const uint32_t cap = windowMs / hits;
+    return (cap > 0u) ? cap : 1u;
+}
+
+bool sampler_reconfigure(SamplerState &st, const SamplerConfig &cfg)
+{
+    const uint32_t rawMs = st.rawMs;
+    const uint32_t computeMs = st.computeMs;
+    sampler_applyMode(st, cfg, st.mode, st.modeSinceMs);
+    return st.rawMs != rawMs || st.computeMs != computeMs;
+}
+
+const char *sampler_modeLabel(SamplerMode mode)
+{
+    switch (mode)
+    {
+    case SamplerMode::STATIC:
+        return "static";
+    case SamplerMode::ACTIVE:
+        return "active";
+    case SamplerMode::NORMAL:
+        return "normal";
+    }
+    return "normal";
+}
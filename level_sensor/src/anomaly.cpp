@@ -0,0 +1,199 @@
+#include "anomaly.h"
+#include <math.h>
+
+// Trend gains (error-correction form of Holt's linear method): the level takes
+// half of each error, the slope 0.3 of that spread over the sample spacing.
+// Chosen on simulated fills/drains of up to 50 counts/s with 0.5..4 s spacing.
+static constexpr float kTrendAlpha = 0.5f;
+static constexpr float kTrendBeta = 0.3f;
+static constexpr float kMedAbsErrToSigma = 1.4826f; // gaussian sigma per median |error| of a zero-mean error
+static constexpr float kNoiseClearRatio = 0.8f;
+
+void anomaly_configDefaults(AnomalyConfig &cfg)
+{
+    cfg = AnomalyConfig{};
+    cfg.enabled = CFG_ANOMALY_ENABLED != 0;
+    cfg.window = (uint16_t)CFG_ANOMALY_WINDOW;
+    cfg.warmup = (uint16_t)CFG_ANOMALY_WARMUP;
+    cfg.outlierK = CFG_ANOMALY_OUTLIER_K;
+    cfg.noiseStd = CFG_ANOMALY_NOISE_STD;
+    cfg.cusumK = CFG_ANOMALY_CUSUM_K;
+    cfg.cusumH = CFG_ANOMALY_CUSUM_H;
+    cfg.minSigma = CFG_ANOMALY_MIN_SIGMA;
+    cfg.holdMs = CFG_ANOMALY_HOLD_MS;
+}
+
+bool anomaly_validateConfig(const AnomalyConfig &cfg)
+{
+    if (cfg.window < 4u || cfg.window > 4096u || cfg.warmup < 4u || cfg.warmup > 4096u)
+    {
+        return false;
+    }
+    if (!isfinite(cfg.outlierK) || !(cfg.outlierK > 1.0f) ||
+        !isfinite(cfg.noiseStd) || !(cfg.noiseStd > 0.0f) ||
+        !isfinite(cfg.cusumK) || !(cfg.cusumK >= 0.0f) ||
+        !isfinite(cfg.cusumH) || !(cfg.cusumH > 0.0f) ||
+        !isfinite(cfg.minSigma) || !(cfg.minSigma > 0.0f))
+    {
+        return false;
+    }
+    return cfg.holdMs <= 86400000u;
+}
+
+void anomaly_init(AnomalyState &st)
+{
+    st = AnomalyState{};
+    st.held = ProbeQualityReason::OK;
+}
+
+float anomaly_sigma(const AnomalyState &st, const AnomalyConfig &cfg)
+{
+    return fmaxf(kMedAbsErrToSigma * st.medAbsErr, cfg.minSigma);
+}
+
+static uint8_t confidenceAbove(float ratio)
+{
+    const float c = 50.0f * ratio;
+    return (uint8_t)(c >= 100.0f ? 100.0f : c);
+}
+
+static uint8_t confidenceBelow(float ratio)
+{
+    const float c = 100.0f - 50.0f * ratio;
+    return (uint8_t)(c <= 0.0f ? 0.0f : c);
+}
+
+AnomalyResult anomaly_evaluate(AnomalyState &st, const AnomalyConfig &cfg, uint32_t raw, uint32_t nowMs,
+                               const QualityResult &base)
+{
+    AnomalyResult res{base, 100u};
+    if (!base.connected)
+    {
+        anomaly_init(st);
+        return res;
+    }
+    // Implausible samples would poison the statistics; the threshold verdict stands.
+    if (base.reason != ProbeQualityReason::OK && base.reason != ProbeQualityReason::CALIBRATION_RECOMMENDED)
+    {
+        return res;
+    }
+    if (!cfg.enabled)
+    {
+        res.confidence = 0u;
+        return res;
+    }
+
+    const float x = (float)raw;
+    if (st.n == 0u)
+    {
+        anomaly_init(st);
+        st.n = 1u;
+        st.level = x;
+        st.lastMs = nowMs;
+        res.confidence = 0u;
+        return res;
+    }
+
+    const uint32_t dtMs = nowMs - st.lastMs;
+    st.lastMs = nowMs;
+    const float dt = (float)dtMs;
+    const float e = x - (st.level + st.slopePerMs * dt);
+    if (st.n < UINT32_MAX)
+    {
+        st.n++;
+    }
+
+    const uint32_t errors = st.n - 1u;
+    if (errors <= cfg.warmup)
+    {
+        // Exact Welford over the warm-up errors, then seed the robust scale from it.
+        const float d = e - st.errMean;
+        st.errMean += d / (float)errors;
+        st.errM2 += d * (e - st.errMean);
+        st.errVar = st.errM2 / (float)errors;
+        st.medAbsErr = sqrtf(st.errVar) / kMedAbsErrToSigma;
+        st.level += st.slopePerMs * dt + kTrendAlpha * e;
+        if (dtMs > 0u)
+        {
+            st.slopePerMs += kTrendBeta * kTrendAlpha * e / dt;
+        }
+        res.confidence = 0u;
+        return res;
+    }
+
+    const float z = e / anomaly_sigma(st, cfg);
+    const bool outlier = fabsf(z) > cfg.outlierK;
+    const float zc = fminf(fmaxf(z, -cfg.outlierK), cfg.outlierK);
+    st.cusumPos = fmaxf(0.0f, st.cusumPos + zc - cfg.cusumK);
+    st.cusumNeg = fmaxf(0.0f, st.cusumNeg - zc - cfg.cusumK);
+    const float shiftRatio = fmaxf(st.cusumPos, st.cusumNeg) / cfg.cusumH;
+    const bool shift = shiftRatio > 1.0f;
+
+    if (shift)
+    {
+        // Rebase on the new reading; the slope and scale carry over.
+        st.level = x;
+        st.cusumPos = 0.0f;
+        st.cusumNeg = 0.0f;
+        st.held = ProbeQualityReason::ANOMALY_SHIFT;
+        st.heldUntilMs = nowMs + cfg.holdMs;
+    }
+    else if (!outlier)
+    {
+        st.level += st.slopePerMs * dt + kTrendAlpha * e;
+        if (dtMs > 0u)
+        {
+            st.slopePerMs += kTrendBeta * kTrendAlpha * e / dt;
+        }
+        const float a = 1.0f / (float)cfg.window;
+        const float d = e - st.errMean;
+        st.errMean += a * d;
+        st.errVar = (1.0f - a) * (st.errVar + a * d * d);
+        const float step = 2.0f * a;
+        st.medAbsErr *= (fabsf(e) > st.medAbsErr) ? (1.0f + step) : (1.0f - step);
+        st.medAbsErr = fmaxf(st.medAbsErr, 1.0f); // a zero scale could never grow back
+    }
+    else
+    {
+        // Outliers do not move the model; the CUSUM catches them if they persist.
+        st.level += st.slopePerMs * dt;
+    }
+
+    const float noiseRatio = sqrtf(st.errVar) / cfg.noiseStd;
+    st.noisy = noiseRatio > (st.noisy ? kNoiseClearRatio : 1.0f);
+    if (st.held == ProbeQualityReason::ANOMALY_SHIFT && !shift && (int32_t)(st.heldUntilMs - nowMs) <= 0)
+    {
+        st.held = ProbeQualityReason::OK;
+    }
+
+    const float outlierRatio = fabsf(z) / cfg.outlierK;
+    if (base.reason != ProbeQualityReason::OK)
+    {
+        return res;
+    }
+    if (shift)
+    {
+        res.quality.reason = ProbeQualityReason::ANOMALY_SHIFT;
+        res.confidence = confidenceAbove(shiftRatio);
+    }
+    else if (st.held == ProbeQualityReason::ANOMALY_SHIFT)
+    {
+        res.quality.reason = ProbeQualityReason::ANOMALY_SHIFT;
+        res.confidence = 50u;
+    }
+    else if (outlier)
+    {
+        res.quality.reason = ProbeQualityReason::ANOMALY_OUTLIER;
+        res.confidence = confidenceAbove(outlierRatio);
+    }
+    else if (st.noisy)
+    {
+        res.quality.reason = ProbeQualityReason::ANOMALY_NOISE;
+        res.confidence = confidenceAbove(noiseRatio);
+    }
+    else
+    {
+        res.confidence = confidenceBelow(fmaxf(fmaxf(outlierRatio, shiftRatio), noiseRatio));
+    }
+    return res;
+}
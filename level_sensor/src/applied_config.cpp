@@ -1,26 +1,126 @@
 #include "applied_config.h"
 
 #include <Arduino.h>
+#include <string.h>
 
 #include "device_state.h"
 #include "storage_nvs.h"
+#include "config.h"
+
+#ifndef CFG_CONFIG_MAX_LISTENERS
+#define CFG_CONFIG_MAX_LISTENERS 6
+#endif
+
+// Values as last written; the applied view is derived from these so a half-set
+// calibration pair or out-of-range tank stays inactive exactly as after a reboot.
+struct StoredConfig
+{
+    float tankVolumeLiters;
+    float rodLengthCm;
+    int32_t calDry;
+    int32_t calWet;
+    bool calInverted;
+};
+
+struct ConfigSubscriber
+{
+    uint32_t mask;
+    ConfigListener listener;
+};
 
 static AppliedConfig g_config = {
     NAN, // tankVolumeLiters
     NAN, // rodLengthCm
+    {},  // tankGeometry (vertical cylinder)
     SenseMode::TOUCH,
     0,
     0,
     0,
-    false};
+    false,
+    {},  // calCurve
+    {}}; // quality (defaults applied by config_begin)
+
+static StoredConfig s_stored = {NAN, NAN, 0, 0, false};
+static uint32_t s_generation[(size_t)ConfigField::COUNT] = {0};
+static ConfigSubscriber s_subscribers[CFG_CONFIG_MAX_LISTENERS] = {};
+static size_t s_subscriberCount = 0;
+
+static bool sameFloat(float a, float b)
+{
+    return (a == b) || (isnan(a) && isnan(b));
+}
 
-static bool s_dirty = false;
+static void deriveTank()
+{
+    float vol = s_stored.tankVolumeLiters;
+    float rod = s_stored.rodLengthCm;
+    storage_validateTank(vol, rod);
+    g_config.tankVolumeLiters = vol;
+    g_config.rodLengthCm = rod;
+}
+
+static void applyGeometry(const TankGeometry &stored)
+{
+    if (tank_validateGeometry(stored))
+    {
+        g_config.tankGeometry = stored;
+    }
+    else
+    {
+        tank_geometryDefaults(g_config.tankGeometry);
+    }
+}
+
+static void applyQuality(const QualityConfig &stored)
+{
+    if (quality_validateConfig(stored))
+    {
+        g_config.quality = stored;
+    }
+    else
+    {
+        quality_configDefaults(g_config.quality);
+    }
+}
+
+static void deriveCalibration()
+{
+    int32_t dry = s_stored.calDry;
+    int32_t wet = s_stored.calWet;
+    bool inverted = s_stored.calInverted;
+    storage_validateCalibration(dry, wet, inverted);
+    g_config.calDry = dry;
+    g_config.calWet = wet;
+    g_config.calInverted = inverted;
+}
+
+static void notifyChanged(uint32_t changed)
+{
+    for (size_t i = 0; i < (size_t)ConfigField::COUNT; ++i)
+    {
+        if (changed & config_fieldBit((ConfigField)i))
+        {
+            s_generation[i]++;
+        }
+    }
+    for (size_t i = 0; i < s_subscriberCount; ++i)
+    {
+        const uint32_t relevant = changed & s_subscribers[i].mask;
+        if (relevant != 0u)
+        {
+            s_subscribers[i].listener(relevant);
+        }
+    }
+}
 
 static void loadFromNvs()
 {
-    float vol = NAN;
-    float rod = NAN;
-    storage_loadTank(vol, rod);
+    storage_loadTankRaw(s_stored.tankVolumeLiters, s_stored.rodLengthCm);
+    deriveTank();
+
+    TankGeometry geometry;
+    storage_loadTankGeometry(geometry);
+    applyGeometry(geometry);
 
     SenseMode senseMode = SenseMode::TOUCH;
     uint8_t simMode = 0;
@@ -30,44 +130,212 @@ static void loadFromNvs()
     {
         senseMode = SenseMode::TOUCH;
     }
-
-    int32_t dry = 0;
-    int32_t wet = 0;
-    bool inverted = false;
-    storage_loadActiveCalibration(dry, wet, inverted);
-
-    g_config.tankVolumeLiters = vol;
-    g_config.rodLengthCm = rod;
     g_config.senseMode = senseMode;
     g_config.simulationMode = simMode;
-    g_config.calDry = dry;
-    g_config.calWet = wet;
-    g_config.calInverted = inverted;
+
+    storage_loadCalibrationRaw(s_stored.calDry, s_stored.calWet, s_stored.calInverted);
+    deriveCalibration();
+    storage_loadCalibrationCurve(g_config.calCurve);
+
+    QualityConfig quality;
+    storage_loadQuality(quality);
+    applyQuality(quality);
 }
 
 void config_begin()
 {
     loadFromNvs();
-    s_dirty = false;
 }
 
-void config_markDirty()
+bool config_subscribe(uint32_t fieldMask, ConfigListener listener)
 {
-    s_dirty = true;
+    if (!listener || s_subscriberCount >= CFG_CONFIG_MAX_LISTENERS)
+    {
+        return false;
+    }
+    s_subscribers[s_subscriberCount++] = {fieldMask, listener};
+    return true;
 }
 
-bool config_reloadIfDirty()
+bool config_setTankVolume(float liters)
 {
-    if (!s_dirty)
+    storage_saveTankVolume(liters);
+    if (sameFloat(s_stored.tankVolumeLiters, liters))
     {
         return false;
     }
+    s_stored.tankVolumeLiters = liters;
+    deriveTank();
+    notifyChanged(config_fieldBit(ConfigField::TANK_VOLUME));
+    return true;
+}
 
-    loadFromNvs();
-    s_dirty = false;
+bool config_setRodLength(float cm)
+{
+    storage_saveTankHeight(cm);
+    if (sameFloat(s_stored.rodLengthCm, cm))
+    {
+        return false;
+    }
+    s_stored.rodLengthCm = cm;
+    deriveTank();
+    notifyChanged(config_fieldBit(ConfigField::ROD_LENGTH));
+    return true;
+}
+
+bool config_setTankGeometry(const TankGeometry &geometry)
+{
+    storage_saveTankGeometry(geometry);
+    TankGeometry previous = g_config.tankGeometry;
+    applyGeometry(geometry);
+    if (memcmp(&previous, &g_config.tankGeometry, sizeof(TankGeometry)) == 0)
+    {
+        return false;
+    }
+    notifyChanged(config_fieldBit(ConfigField::TANK_GEOMETRY));
+    return true;
+}
+
+bool config_setSenseMode(SenseMode mode)
+{
+    const SenseMode applied = (mode == SenseMode::SIM) ? SenseMode::SIM : SenseMode::TOUCH;
+    storage_saveSenseMode(mode);
+    if (g_config.senseMode == applied)
+    {
+        return false;
+    }
+    g_config.senseMode = applied;
+    notifyChanged(config_fieldBit(ConfigField::SENSE_MODE));
+    return true;
+}
+
+bool config_setSimulationMode(uint8_t mode)
+{
+    storage_saveSimulationMode(mode);
+    if (g_config.simulationMode == mode)
+    {
+        return false;
+    }
+    g_config.simulationMode = mode;
+    notifyChanged(config_fieldBit(ConfigField::SIMULATION_MODE));
+    return true;
+}
+
+bool config_setCalibrationDry(int32_t dry)
+{
+    storage_saveCalibrationDry(dry);
+    if (s_stored.calDry == dry)
+    {
+        return false;
+    }
+    s_stored.calDry = dry;
+    deriveCalibration();
+    notifyChanged(config_fieldBit(ConfigField::CAL_DRY));
+    return true;
+}
+
+bool config_setCalibrationWet(int32_t wet)
+{
+    storage_saveCalibrationWet(wet);
+    if (s_stored.calWet == wet)
+    {
+        return false;
+    }
+    s_stored.calWet = wet;
+    deriveCalibration();
+    notifyChanged(config_fieldBit(ConfigField::CAL_WET));
+    return true;
+}
+
+bool config_setCalibrationInverted(bool inverted)
+{
+    storage_saveCalibrationInverted(inverted);
+    if (s_stored.calInverted == inverted)
+    {
+        return false;
+    }
+    s_stored.calInverted = inverted;
+    deriveCalibration();
+    notifyChanged(config_fieldBit(ConfigField::CAL_INVERTED));
+    return true;
+}
+
+bool config_addCalibrationPoint(int32_t raw, float percent)
+{
+    CalCurve next = g_config.calCurve;
+    if (!cal_curveInsert(next, raw, percent))
+    {
+        return false;
+    }
+    if (memcmp(&next, &g_config.calCurve, sizeof(CalCurve)) == 0)
+    {
+        return false;
+    }
+    storage_saveCalibrationCurve(next);
+    g_config.calCurve = next;
+    notifyChanged(config_fieldBit(ConfigField::CAL_CURVE));
+    return true;
+}
+
+bool config_clearCalibrationCurve()
+{
+    if (g_config.calCurve.count == 0u)
+    {
+        return false;
+    }
+    cal_curveClear(g_config.calCurve);
+    storage_saveCalibrationCurve(g_config.calCurve);
+    notifyChanged(config_fieldBit(ConfigField::CAL_CURVE));
     return true;
 }
 
+bool config_clearCalibration()
+{
+    uint32_t changed = 0;
+    if (g_config.calCurve.count != 0u)
+    {
+        cal_curveClear(g_config.calCurve);
+        storage_saveCalibrationCurve(g_config.calCurve);
+        changed |= config_fieldBit(ConfigField::CAL_CURVE);
+    }
+    if (s_stored.calDry != 0)
+        changed |= config_fieldBit(ConfigField::CAL_DRY);
+    if (s_stored.calWet != 0)
+        changed |= config_fieldBit(ConfigField::CAL_WET);
+    if (s_stored.calInverted)
+        changed |= config_fieldBit(ConfigField::CAL_INVERTED);
+
+    storage_clearCalibration();
+    s_stored.calDry = 0;
+    s_stored.calWet = 0;
+    s_stored.calInverted = false;
+    if (changed == 0u)
+    {
+        return false;
+    }
+    deriveCalibration();
+    notifyChanged(changed);
+    return true;
+}
+
+bool config_setQuality(const QualityConfig &quality)
+{
+    if (!quality_validateConfig(quality) || memcmp(&quality, &g_config.quality, sizeof(QualityConfig)) == 0)
+    {
+        return false;
+    }
+    storage_saveQuality(quality);
+    g_config.quality = quality;
+    notifyChanged(config_fieldBit(ConfigField::QUALITY));
+    return true;
+}
+
+uint32_t config_generation(ConfigField field)
+{
+    const size_t idx = (size_t)field;
+    return (idx < (size_t)ConfigField::COUNT) ? s_generation[idx] : 0u;
+}
+
 const AppliedConfig &config_get()
 {
     return g_config;
@@ -0,0 +1,134 @@
+#include "boot_trace.h"
+#include <ArduinoJson.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#else
+#include <chrono>
+#endif
+
+namespace
+{
+struct BootTraceEvent
+{
+    const char *label;
+    uint32_t us;
+};
+} // namespace
+
+static BootTraceEvent s_events[CFG_BOOT_TRACE_EVENTS];
+static size_t s_count = 0;
+static uint16_t s_dropped = 0;
+static bool s_closed = false;
+static bool s_published = false;
+
+#if defined(ESP_PLATFORM)
+static portMUX_TYPE s_traceMux = portMUX_INITIALIZER_UNLOCKED;
+#define BOOT_TRACE_LOCK() portENTER_CRITICAL(&s_traceMux)
+#define BOOT_TRACE_UNLOCK() portEXIT_CRITICAL(&s_traceMux)
+
+static uint64_t bt_nowUs()
+{
+    return (uint64_t)esp_timer_get_time();
+}
+#else
+#define BOOT_TRACE_LOCK()
+#define BOOT_TRACE_UNLOCK()
+
+// Host builds: steady clock relative to the first call stands in for esp_timer.
+static uint64_t bt_nowUs()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+#endif
+
+static void bt_closeIfExpiredLocked(uint64_t nowUs)
+{
+    if (!s_closed && nowUs >= (uint64_t)CFG_BOOT_TRACE_WINDOW_MS * 1000u)
+    {
+        s_closed = true;
+    }
+}
+
+void boot_trace_mark(const char *label)
+{
+    const uint64_t now = bt_nowUs();
+    BOOT_TRACE_LOCK();
+    bt_closeIfExpiredLocked(now);
+    if (!s_closed)
+    {
+        if (s_count < CFG_BOOT_TRACE_EVENTS)
+        {
+            s_events[s_count++] = {label ? label : "?", (uint32_t)now};
+        }
+        else if (s_dropped < UINT16_MAX)
+        {
+            s_dropped++;
+        }
+    }
+    BOOT_TRACE_UNLOCK();
+}
+
+bool boot_trace_isOpen()
+{
+    const uint64_t now = bt_nowUs();
+    BOOT_TRACE_LOCK();
+    bt_closeIfExpiredLocked(now);
+    const bool open = !s_closed;
+    BOOT_TRACE_UNLOCK();
+    return open;
+}
+
+bool boot_trace_pending()
+{
+    return !s_published && !boot_trace_isOpen();
+}
+
+void boot_trace_markPublished()
+{
+    s_published = true;
+}
+
+bool boot_trace_buildJson(char *out, size_t outSize, const char *fw, uint32_t bootCount, const char *resetReason)
+{
+    if (!out || outSize == 0u)
+    {
+        return false;
+    }
+
+    BootTraceEvent events[CFG_BOOT_TRACE_EVENTS];
+    BOOT_TRACE_LOCK();
+    const size_t count = s_count;
+    const uint16_t dropped = s_dropped;
+    for (size_t i = 0; i < count; ++i)
+    {
+        events[i] = s_events[i];
+    }
+    BOOT_TRACE_UNLOCK();
+
+    StaticJsonDocument<JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(CFG_BOOT_TRACE_EVENTS) +
+                       CFG_BOOT_TRACE_EVENTS * JSON_OBJECT_SIZE(2)>
+        doc;
+    doc["fw"] = fw ? fw : "";
+    doc["boot_count"] = bootCount;
+    doc["reset_reason"] = resetReason ? resetReason : "";
+    doc["window_ms"] = (uint32_t)CFG_BOOT_TRACE_WINDOW_MS;
+    doc["dropped"] = dropped;
+    JsonArray arr = doc.createNestedArray("events");
+    for (size_t i = 0; i < count; ++i)
+    {
+        JsonObject ev = arr.createNestedObject();
+        ev["ev"] = events[i].label; // literal: stored by pointer
+        ev["t_us"] = events[i].us;
+    }
+    if (doc.overflowed())
+    {
+        return false;
+    }
+    const size_t n = serializeJson(doc, out, outSize);
+    return n > 0u && n < outSize;
+}
@@ -0,0 +1,64 @@
+#include "cal_curve.h"
+#include <math.h>
+#include <string.h>
+
+static constexpr uint16_t kPercentX100Max = 10000u;
+
+void cal_curveClear(CalCurve &curve)
+{
+    memset(&curve, 0, sizeof(curve));
+}
+
+bool cal_curveValidate(const CalCurve &curve)
+{
+    if (curve.count > CFG_CAL_CURVE_MAX_POINTS)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < curve.count; ++i)
+    {
+        const CalCurvePoint &p = curve.points[i];
+        if (p.raw <= 0 || p.percentX100 == 0u || p.percentX100 >= kPercentX100Max)
+        {
+            return false;
+        }
+        if (i > 0u && p.percentX100 <= curve.points[i - 1].percentX100)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool cal_curveInsert(CalCurve &curve, int32_t raw, float percent)
+{
+    if (!(percent > 0.0f) || !(percent < 100.0f) || raw <= 0)
+    {
+        return false;
+    }
+    const long scaled = lroundf(percent * 100.0f);
+    if (scaled <= 0 || scaled >= (long)kPercentX100Max)
+    {
+        return false;
+    }
+    const uint16_t pctX100 = (uint16_t)scaled;
+
+    uint8_t pos = 0;
+    while (pos < curve.count && curve.points[pos].percentX100 < pctX100)
+    {
+        ++pos;
+    }
+    if (pos < curve.count && curve.points[pos].percentX100 == pctX100)
+    {
+        curve.points[pos].raw = raw;
+        return true;
+    }
+    if (curve.count >= CFG_CAL_CURVE_MAX_POINTS)
+    {
+        return false;
+    }
+    memmove(&curve.points[pos + 1], &curve.points[pos], sizeof(CalCurvePoint) * (curve.count - pos));
+    curve.points[pos] = CalCurvePoint{raw, pctX100, 0u};
+    curve.count++;
+    return true;
+}
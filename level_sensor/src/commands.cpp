@@ -1,15 +1,21 @@
 #include "commands.h"
+#include "applied_config.h"
 #include <ArduinoJson.h>
 #include <stdarg.h>
 #include <string.h>
 #include <strings.h>
 #include <WiFi.h>
 #include "logger.h"
+#include "loop_events.h"
 
 #include "device_state.h"
 #include "domain_strings.h"
 #include "ota_service.h"
+#include "probe_reader.h"
+#include "simulation.h"
+#include "profiler.h"
 #include "storage_nvs.h"
+#include "trace_replay.h"
 
 #ifndef CMD_SCHEMA_VERSION
 #define CMD_SCHEMA_VERSION 1
@@ -110,11 +116,72 @@ static void finish(const char *reqId, const char *type, CmdStatus st, const char
     }
 }
 
+// Geometry keys merge into the applied geometry:
+// tank_shape: "horizontal_cylinder" | ...; cone_height_cm: 40; strapping: [[0,0],[50,180],[120,900]]
+// A strapping table alone implies tank_shape "strapping".
+static bool parseTankGeometry(JsonObject data, TankGeometry &geom)
+{
+    geom = config_get().tankGeometry;
+    if (data.containsKey("tank_shape") && !tank_shapeFromString(data["tank_shape"] | "", geom.shape))
+    {
+        return false;
+    }
+    if (data.containsKey("cone_height_cm"))
+    {
+        geom.coneHeightCm = data["cone_height_cm"].as<float>();
+    }
+    if (data.containsKey("strapping"))
+    {
+        JsonArray points = data["strapping"].as<JsonArray>();
+        if (points.isNull() || points.size() > CFG_TANK_STRAP_MAX_POINTS)
+        {
+            return false;
+        }
+        memset(geom.strap, 0, sizeof(geom.strap));
+        geom.strapCount = 0;
+        for (JsonArray point : points)
+        {
+            if (point.size() != 2)
+            {
+                return false;
+            }
+            geom.strap[geom.strapCount].heightCm = point[0].as<float>();
+            geom.strap[geom.strapCount].liters = point[1].as<float>();
+            geom.strapCount++;
+        }
+        if (geom.strapCount != points.size())
+        {
+            return false;
+        }
+        if (!data.containsKey("tank_shape"))
+        {
+            geom.shape = TankShape::STRAPPING;
+        }
+    }
+    return tank_validateGeometry(geom);
+}
+
 static void handleSetConfig(JsonObject data, const char *requestId)
 {
     bool appliedAny = false;
     char changes[96] = "";
 
+    const bool hasGeometry = data.containsKey("tank_shape") || data.containsKey("cone_height_cm") ||
+                             data.containsKey("strapping");
+    if (hasGeometry && s_ctx.updateTankGeometry)
+    {
+        TankGeometry geom;
+        if (!parseTankGeometry(data, geom))
+        {
+            finish(requestId, "set_config", CmdStatus::REJECTED, "invalid_geometry");
+            LOG_WARN(LogDomain::COMMAND, "Command rejected: reason=invalid_geometry type=set_config");
+            return;
+        }
+        s_ctx.updateTankGeometry(geom, true);
+        appliedAny = true;
+        appendChange(changes, sizeof(changes), "tank_shape=%s", toString(geom.shape));
+    }
+
     if (data.containsKey("tank_volume_l") && s_ctx.updateTankVolume)
     {
         float v = data["tank_volume_l"].as<float>();
@@ -122,6 +189,13 @@ static void handleSetConfig(JsonObject data, const char *requestId)
         appliedAny = true;
         appendChange(changes, sizeof(changes), "tank_volume_l=%.2f", v);
     }
+    if (data.containsKey("drift_tau_s") && s_ctx.setDriftTau)
+    {
+        const uint32_t tau = data["drift_tau_s"].as<uint32_t>();
+        s_ctx.setDriftTau(tau);
+        appliedAny = true;
+        appendChange(changes, sizeof(changes), "drift_tau_s=%lu", (unsigned long)tau);
+    }
     if (data.containsKey("rod_length_cm") && s_ctx.updateRodLength)
     {
         float v = data["rod_length_cm"].as<float>();
@@ -169,6 +243,29 @@ static void handleCalibrate(JsonObject data, const char *requestId)
         return;
     }
 
+    if (strcmp(point, "level") == 0)
+    {
+        // {"point":"level","percent":37.5}: intermediate curve point at a known level.
+        if (!s_ctx.captureCalibrationLevel || !data["percent"].is<float>())
+        {
+            finish(requestId, "calibrate", CmdStatus::REJECTED, "invalid_percent");
+            return;
+        }
+        const float percent = data["percent"].as<float>();
+        const bool ok = s_ctx.captureCalibrationLevel(percent);
+        finish(requestId, "calibrate", ok ? CmdStatus::APPLIED : CmdStatus::REJECTED, ok ? "level" : "invalid_percent");
+        LOG_INFO(LogDomain::COMMAND, "%s cmd type=calibrate request_id=%s changes=point=level percent=%.2f",
+                 ok ? "Applied" : "Rejected", requestId ? requestId : "", (double)percent);
+        return;
+    }
+    if (strcmp(point, "clear_curve") == 0 && s_ctx.clearCalibrationCurve)
+    {
+        s_ctx.clearCalibrationCurve();
+        finish(requestId, "calibrate", CmdStatus::APPLIED, "clear_curve");
+        LOG_INFO(LogDomain::COMMAND, "Applied cmd type=calibrate request_id=%s changes=point=clear_curve", requestId ? requestId : "");
+        return;
+    }
+
     finish(requestId, "calibrate", CmdStatus::REJECTED, "invalid_point");
     LOG_WARN(LogDomain::COMMAND, "Command rejected: reason=invalid_point type=calibrate");
 }
@@ -439,6 +536,31 @@ static SenseMode parseSenseMode(JsonVariant value)
     return SenseMode::TOUCH;
 }
 
+// layers: [{"type":"fill","period_ms":120000},{"type":"noise","amplitude":20},...]
+static bool applySimulationLayers(JsonArray layers)
+{
+    if (layers.isNull() || layers.size() == 0 || layers.size() > CFG_SIM_MAX_LAYERS)
+    {
+        return false;
+    }
+    SimLayer table[CFG_SIM_MAX_LAYERS];
+    uint8_t n = 0;
+    for (JsonObject l : layers)
+    {
+        SimLayer &layer = table[n];
+        if (!sim_layerTypeFromString(l["type"] | "", layer.type))
+        {
+            return false;
+        }
+        layer.periodMs = l["period_ms"] | 0u;
+        layer.durationMs = l["duration_ms"] | 0u;
+        layer.amplitude = l["amplitude"] | 0.0f;
+        layer.rangeFrac = l["range_frac"] | 0.0f;
+        ++n;
+    }
+    return n == layers.size() && sim_setCustomLayers(table, n);
+}
+
 static void handleSetSimulation(JsonObject data, const char *requestId)
 {
     bool okAny = false;
@@ -472,13 +594,31 @@ static void handleSetSimulation(JsonObject data, const char *requestId)
         int m = data["mode"].as<int>();
         if (m < 0)
             m = 0;
-        if (m > 5)
-            m = 5;
+        if (m >= (int)sim_builtinCount())
+            m = (int)sim_builtinCount() - 1;
         s_ctx.setSimulationModeInternal((uint8_t)m, true, "cmd");
         okAny = true;
         appliedMode = true;
         appendChange(changes, sizeof(changes), "mode=%d", m);
     }
+    // Transient scenario controls (not persisted): seed and a custom layer table.
+    if (data.containsKey("seed"))
+    {
+        sim_setSeed(data["seed"].as<uint32_t>());
+        okAny = true;
+        appendChange(changes, sizeof(changes), "seed=%lu", (unsigned long)sim_getSeed());
+    }
+    if (data.containsKey("layers"))
+    {
+        if (!applySimulationLayers(data["layers"].as<JsonArray>()))
+        {
+            finish(requestId, "set_simulation", CmdStatus::REJECTED, "invalid_layers");
+            LOG_WARN(LogDomain::COMMAND, "Command rejected: reason=invalid_layers type=set_simulation");
+            return;
+        }
+        okAny = true;
+        appendChange(changes, sizeof(changes), "layers=%s", sim_scenarioName());
+    }
 
     if (!handlerSense && hasSense)
     {
@@ -529,6 +669,270 @@ static void handleReannounce(const char *requestId)
     }
 }
 
+// data: {"action":"load","samples":[[t_ms,raw],...],"append":bool}
+//       {"action":"start","source":"buffer"|"embedded","speed":1.0,"loop":bool}
+//       {"action":"evaluate","source":...,"stuck_ms":..,"spike_window_ms":..,"cal_recommend_window_ms":..}
+//       {"action":"stop"}
+static void handleReplay(JsonObject data, const char *requestId)
+{
+    const char *action = data["action"] | "";
+    char msg[64];
+
+    if (strcmp(action, "load") == 0)
+    {
+        JsonArray samples = data["samples"].as<JsonArray>();
+        if (samples.isNull() || samples.size() == 0)
+        {
+            finish(requestId, "replay", CmdStatus::REJECTED, "missing_samples");
+            return;
+        }
+        if (!(data["append"] | false))
+        {
+            replay_clearBuffer();
+        }
+        ReplaySample chunk[16];
+        size_t n = 0;
+        for (JsonVariant v : samples)
+        {
+            JsonArray pair = v.as<JsonArray>();
+            if (pair.isNull() || pair.size() != 2 || !pair[0].is<uint32_t>() || !pair[1].is<uint32_t>())
+            {
+                finish(requestId, "replay", CmdStatus::REJECTED, "invalid_sample");
+                return;
+            }
+            chunk[n++] = ReplaySample{pair[0].as<uint32_t>(), pair[1].as<uint32_t>()};
+            if (n == sizeof(chunk) / sizeof(chunk[0]))
+            {
+                if (!replay_append(chunk, n))
+                {
+                    finish(requestId, "replay", CmdStatus::REJECTED, "buffer_full_or_unordered");
+                    return;
+                }
+                n = 0;
+            }
+        }
+        if (n > 0u && !replay_append(chunk, n))
+        {
+            finish(requestId, "replay", CmdStatus::REJECTED, "buffer_full_or_unordered");
+            return;
+        }
+        snprintf(msg, sizeof(msg), "loaded=%u", (unsigned)samples.size());
+        finish(requestId, "replay", CmdStatus::APPLIED, msg);
+        return;
+    }
+
+    if (strcmp(action, "start") == 0)
+    {
+        const char *source = data["source"] | "buffer";
+        const float speed = data["speed"] | 1.0f;
+        const bool loop = data["loop"] | false;
+        const bool selected = (strcmp(source, "embedded") == 0) ? replay_useEmbedded() : replay_useBuffer();
+        if (!selected)
+        {
+            finish(requestId, "replay", CmdStatus::REJECTED, "no_trace");
+            return;
+        }
+        if (!probe_startReplay(speed, loop))
+        {
+            finish(requestId, "replay", CmdStatus::REJECTED, "invalid_speed");
+            return;
+        }
+        ReplayStatus st{};
+        replay_getStatus(st);
+        snprintf(msg, sizeof(msg), "source=%s samples=%lu speed=%.2f", st.source, (unsigned long)st.count, (double)speed);
+        finish(requestId, "replay", CmdStatus::APPLIED, msg);
+        LOG_INFO(LogDomain::COMMAND, "Applied cmd type=replay request_id=%s %s loop=%s",
+                 requestId ? requestId : "", msg, loop ? "true" : "false");
+        if (s_ctx.requestStatePublish)
+        {
+            s_ctx.requestStatePublish();
+        }
+        return;
+    }
+
+    if (strcmp(action, "evaluate") == 0)
+    {
+        // Without a source the current selection (last started trace) is used.
+        const char *source = data["source"] | "";
+        bool selected = true;
+        if (strcmp(source, "embedded") == 0)
+        {
+            selected = replay_useEmbedded();
+        }
+        else if (strcmp(source, "buffer") == 0)
+        {
+            selected = replay_useBuffer();
+        }
+        if (!selected)
+        {
+            finish(requestId, "replay", CmdStatus::REJECTED, "no_trace");
+            return;
+        }
+        if (!s_ctx.evaluateReplay)
+        {
+            finish(requestId, "replay", CmdStatus::ERROR, "missing_callback");
+            return;
+        }
+        const bool ok = s_ctx.evaluateReplay(data["stuck_ms"] | 0u, data["spike_window_ms"] | 0u,
+                                             data["cal_recommend_window_ms"] | 0u, data["drift"] | false,
+                                             data["anomaly"] | false);
+        finish(requestId, "replay", ok ? CmdStatus::APPLIED : CmdStatus::REJECTED,
+               ok ? "evaluated" : "no_trace_or_running");
+        return;
+    }
+
+    if (strcmp(action, "stop") == 0)
+    {
+        probe_stopReplay();
+        finish(requestId, "replay", CmdStatus::APPLIED, "stopped");
+        LOG_INFO(LogDomain::COMMAND, "Applied cmd type=replay request_id=%s action=stop", requestId ? requestId : "");
+        if (s_ctx.requestStatePublish)
+        {
+            s_ctx.requestStatePublish();
+        }
+        return;
+    }
+
+    finish(requestId, "replay", CmdStatus::REJECTED, "invalid_action");
+}
+
+// Keys merge into the active statistical-tier settings (anomaly.h):
+// {"enabled":true,"window":64,"warmup":32,"outlier_k":8,"noise_std":1500,
+//  "cusum_k":1,"cusum_h":16,"min_sigma":100,"hold_ms":30000}
+static void handleSetAnomaly(JsonObject data, const char *requestId)
+{
+    if (!s_ctx.getAnomalyConfig || !s_ctx.setAnomalyConfig)
+    {
+        finish(requestId, "set_anomaly", CmdStatus::ERROR, "missing_callback");
+        return;
+    }
+    AnomalyConfig cfg;
+    s_ctx.getAnomalyConfig(cfg);
+    if (data.containsKey("enabled"))
+    {
+        cfg.enabled = data["enabled"].as<bool>();
+    }
+    if (data.containsKey("window"))
+    {
+        cfg.window = data["window"].as<uint16_t>();
+    }
+    if (data.containsKey("warmup"))
+    {
+        cfg.warmup = data["warmup"].as<uint16_t>();
+    }
+    if (data.containsKey("outlier_k"))
+    {
+        cfg.outlierK = data["outlier_k"].as<float>();
+    }
+    if (data.containsKey("noise_std"))
+    {
+        cfg.noiseStd = data["noise_std"].as<float>();
+    }
+    if (data.containsKey("cusum_k"))
+    {
+        cfg.cusumK = data["cusum_k"].as<float>();
+    }
+    if (data.containsKey("cusum_h"))
+    {
+        cfg.cusumH = data["cusum_h"].as<float>();
+    }
+    if (data.containsKey("min_sigma"))
+    {
+        cfg.minSigma = data["min_sigma"].as<float>();
+    }
+    if (data.containsKey("hold_ms"))
+    {
+        cfg.holdMs = data["hold_ms"].as<uint32_t>();
+    }
+    if (!anomaly_validateConfig(cfg))
+    {
+        finish(requestId, "set_anomaly", CmdStatus::REJECTED, "invalid_fields");
+        LOG_WARN(LogDomain::COMMAND, "Command rejected: reason=invalid_fields type=set_anomaly");
+        return;
+    }
+    s_ctx.setAnomalyConfig(cfg);
+    finish(requestId, "set_anomaly", CmdStatus::APPLIED, "applied");
+    LOG_INFO(LogDomain::COMMAND, "Applied cmd type=set_anomaly request_id=%s enabled=%s window=%u outlier_k=%.1f noise_std=%.0f cusum_h=%.1f",
+             requestId ? requestId : "", cfg.enabled ? "true" : "false", (unsigned)cfg.window,
+             (double)cfg.outlierK, (double)cfg.noiseStd, (double)cfg.cusumH);
+}
+
+// Absent keys keep the current value; present ones must be integers within [0, max].
+static bool mergeQualityField(JsonObject data, const char *key, uint32_t max, uint32_t &field)
+{
+    JsonVariant v = data[key];
+    if (v.isNull())
+    {
+        return true;
+    }
+    if (!v.is<uint32_t>() || v.as<uint32_t>() > max)
+    {
+        return false;
+    }
+    field = v.as<uint32_t>();
+    return true;
+}
+
+static bool mergeQualityCount(JsonObject data, const char *key, uint8_t &field)
+{
+    uint32_t value = field;
+    if (!mergeQualityField(data, key, UINT8_MAX, value))
+    {
+        return false;
+    }
+    field = (uint8_t)value;
+    return true;
+}
+
+// Keys merge into the applied thresholds (quality_config.h); "reset":true starts
+// from the CFG_* defaults. Values must be non-negative integers; counts fit a byte.
+// {"spike_delta":10000,"rapid_delta":5000,"stuck_delta":2,"stuck_ms":8000,...}
+static void handleSetQuality(JsonObject data, const char *requestId)
+{
+    if (!s_ctx.updateQualityConfig)
+    {
+        finish(requestId, "set_quality", CmdStatus::ERROR, "missing_callback");
+        return;
+    }
+    QualityConfig qc = config_get().quality;
+    if (data["reset"] | false)
+    {
+        quality_configDefaults(qc);
+    }
+    const bool valid = mergeQualityField(data, "disconnected_below_raw", UINT32_MAX, qc.disconnectedBelowRaw) &&
+                       mergeQualityField(data, "raw_min", UINT32_MAX, qc.rawMin) &&
+                       mergeQualityField(data, "raw_max", UINT32_MAX, qc.rawMax) &&
+                       mergeQualityField(data, "rapid_delta", UINT32_MAX, qc.rapidFluctuationDelta) &&
+                       mergeQualityField(data, "spike_delta", UINT32_MAX, qc.spikeDelta) &&
+                       mergeQualityCount(data, "spike_count", qc.spikeCountThreshold) &&
+                       mergeQualityField(data, "spike_window_ms", UINT32_MAX, qc.spikeWindowMs) &&
+                       mergeQualityField(data, "stuck_delta", UINT32_MAX, qc.stuckDelta) &&
+                       mergeQualityField(data, "stuck_ms", UINT32_MAX, qc.stuckMs) &&
+                       mergeQualityField(data, "cal_recommend_margin", UINT32_MAX, qc.calRecommendMargin) &&
+                       mergeQualityCount(data, "cal_recommend_count", qc.calRecommendCount) &&
+                       mergeQualityField(data, "cal_recommend_window_ms", UINT32_MAX, qc.calRecommendWindowMs) &&
+                       mergeQualityCount(data, "zero_hit_count", qc.zeroHitCount) &&
+                       mergeQualityField(data, "zero_window_ms", UINT32_MAX, qc.zeroWindowMs);
+    if (!valid || !quality_validateConfig(qc))
+    {
+        finish(requestId, "set_quality", CmdStatus::REJECTED, "invalid_fields");
+        LOG_WARN(LogDomain::COMMAND, "Command rejected: reason=invalid_fields type=set_quality");
+        return;
+    }
+    s_ctx.updateQualityConfig(qc, true);
+    finish(requestId, "set_quality", CmdStatus::APPLIED, "applied");
+    LOG_INFO(LogDomain::COMMAND, "Applied cmd type=set_quality request_id=%s spike_delta=%lu rapid_delta=%lu stuck_delta=%lu stuck_ms=%lu cal_margin=%lu",
+             requestId ? requestId : "", (unsigned long)qc.spikeDelta, (unsigned long)qc.rapidFluctuationDelta,
+             (unsigned long)qc.stuckDelta, (unsigned long)qc.stuckMs, (unsigned long)qc.calRecommendMargin);
+}
+
+static void handleResetProfiler(const char *requestId)
+{
+    profiler_reset(millis());
+    finish(requestId, "reset_profiler", CmdStatus::APPLIED, "reset");
+    LOG_INFO(LogDomain::COMMAND, "Applied cmd type=reset_profiler request_id=%s", requestId ? requestId : "");
+}
+
 void commands_begin(const CommandsContext &ctx)
 {
     s_ctx = ctx;
@@ -603,6 +1007,7 @@ void commands_handle(const uint8_t *payload, size_t len)
 
     // Mark command as received
     setLastCmd(requestId, type, CmdStatus::RECEIVED, "received");
+    loop_events_signal(LOOP_EVENT_COMMAND);
 
     // Extract optional data object
     const bool hasDataObj = doc["data"].is<JsonObject>();
@@ -685,6 +1090,37 @@ void commands_handle(const uint8_t *payload, size_t len)
     {
         handleSafeMode(data, hasDataObj, requestId);
     }
+    else if (strcmp(type, "replay") == 0)
+    {
+        if (!hasDataObj)
+        {
+            finish(requestId, type, CmdStatus::REJECTED, "missing_data");
+            return;
+        }
+        handleReplay(data, requestId);
+    }
+    else if (strcmp(type, "set_anomaly") == 0)
+    {
+        if (!hasDataObj)
+        {
+            finish(requestId, type, CmdStatus::REJECTED, "missing_data");
+            return;
+        }
+        handleSetAnomaly(data, requestId);
+    }
+    else if (strcmp(type, "set_quality") == 0)
+    {
+        if (!hasDataObj)
+        {
+            finish(requestId, type, CmdStatus::REJECTED, "missing_data");
+            return;
+        }
+        handleSetQuality(data, requestId);
+    }
+    else if (strcmp(type, "reset_profiler") == 0)
+    {
+        handleResetProfiler(requestId);
+    }
     else
     {
         // Unknown or unsupported command
@@ -37,6 +37,28 @@ namespace domain_strings
 #endif
     }
 
+    StringView to_string(TankShape v)
+    {
+        switch (v)
+        {
+        case TankShape::VERTICAL_CYLINDER:
+            return "vertical_cylinder";
+        case TankShape::HORIZONTAL_CYLINDER:
+            return "horizontal_cylinder";
+        case TankShape::RECTANGULAR:
+            return "rectangular";
+        case TankShape::CONE_BOTTOM:
+            return "cone_bottom";
+        case TankShape::STRAPPING:
+            return "strapping";
+        }
+#if DOMAIN_STRINGS_STRICT
+        __builtin_unreachable();
+#else
+        return kUnknown;
+#endif
+    }
+
     StringView to_string(CalibrationState v)
     {
         switch (v)
@@ -75,6 +97,12 @@ namespace domain_strings
             return "calibration_recommended";
         case ProbeQualityReason::ZERO_HITS:
             return "zero_hits";
+        case ProbeQualityReason::ANOMALY_OUTLIER:
+            return "anomaly_outlier";
+        case ProbeQualityReason::ANOMALY_NOISE:
+            return "anomaly_noise";
+        case ProbeQualityReason::ANOMALY_SHIFT:
+            return "anomaly_level_shift";
         case ProbeQualityReason::UNKNOWN:
             return kUnknown;
         }
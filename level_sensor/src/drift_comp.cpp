@@ -0,0 +1,80 @@
+#include "drift_comp.h"
+#include <math.h>
+
+void drift_init(DriftState &st, float offset)
+{
+    st = DriftState{};
+    st.offset = isfinite(offset) ? offset : 0.0f;
+}
+
+int32_t drift_apply(const DriftState &st, int32_t raw)
+{
+    const int32_t corrected = raw - (int32_t)lroundf(st.offset);
+    return corrected > 0 ? corrected : 0;
+}
+
+static void drift_restartQuiet(DriftState &st, float corrected, uint32_t nowMs)
+{
+    st.anchored = false;
+    st.ref = corrected;
+    st.quietSinceMs = nowMs;
+}
+
+int32_t drift_update(DriftState &st, const DriftConfig &cfg, int32_t raw, uint32_t nowMs, bool trusted)
+{
+    if (cfg.tauS == 0u || !trusted)
+    {
+        st.primed = false;
+        return drift_apply(st, raw);
+    }
+    if (!st.primed)
+    {
+        st.primed = true;
+        st.fastRaw = (float)raw;
+        st.lastMs = nowMs;
+        drift_restartQuiet(st, st.fastRaw - st.offset, nowMs);
+        return drift_apply(st, raw);
+    }
+
+    const uint32_t dtMs = nowMs - st.lastMs;
+    st.lastMs = nowMs;
+    st.fastRaw += cfg.fastAlpha * ((float)raw - st.fastRaw);
+    const float corrected = st.fastRaw - st.offset;
+    const float band = (float)cfg.stableBand;
+
+    if (!st.anchored)
+    {
+        if (fabsf(corrected - st.ref) > band)
+        {
+            drift_restartQuiet(st, corrected, nowMs);
+        }
+        else if (nowMs - st.quietSinceMs >= cfg.stableMs)
+        {
+            st.anchored = true;
+        }
+        return drift_apply(st, raw);
+    }
+
+    const float err = corrected - st.ref;
+    if (fabsf(err) > band)
+    {
+        // Faster than the model follows: the level moved. Hold the offset.
+        drift_restartQuiet(st, corrected, nowMs);
+        return drift_apply(st, raw);
+    }
+    float gain = (float)dtMs / ((float)cfg.tauS * 1000.0f);
+    if (gain > 1.0f)
+    {
+        gain = 1.0f;
+    }
+    st.offset += err * gain;
+    if (st.offset > cfg.maxOffset)
+    {
+        st.offset = cfg.maxOffset;
+    }
+    else if (st.offset < -cfg.maxOffset)
+    {
+        st.offset = -cfg.maxOffset;
+    }
+    return drift_apply(st, raw);
+}
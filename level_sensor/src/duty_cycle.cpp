@@ -0,0 +1,159 @@
+#include "duty_cycle.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static constexpr uint32_t kDutyMagic = 0x44555459u; // "DUTY"
+static constexpr uint16_t kDutyVersion = 2;
+
+void duty_reset(DutyRtcState &st)
+{
+    memset(&st, 0, sizeof(st));
+    st.magic = kDutyMagic;
+    st.version = kDutyVersion;
+    quality_init(st.quality);
+}
+
+bool duty_isValid(const DutyRtcState &st)
+{
+    return st.magic == kDutyMagic && st.version == kDutyVersion && st.bufCount <= CFG_DUTY_BUFFER_SAMPLES;
+}
+
+static uint32_t duty_targetInterval(const DutyConfig &cfg, float rate)
+{
+    if (!(cfg.fastRatePctPerHour > 0.0f) || rate >= cfg.fastRatePctPerHour)
+    {
+        return cfg.minIntervalS;
+    }
+    const float span = (float)(cfg.maxIntervalS - cfg.minIntervalS);
+    const float shrink = span * (rate / cfg.fastRatePctPerHour);
+    return cfg.maxIntervalS - (uint32_t)shrink;
+}
+
+DutyDecision duty_plan(DutyRtcState &st, const DutyConfig &cfg, const DutyObservation &obs)
+{
+    st.wakeCount++;
+
+    if (obs.valid)
+    {
+        if (st.hasLastPercent && obs.nowMs > st.lastPercentMs)
+        {
+            const float hours = (float)(obs.nowMs - st.lastPercentMs) / 3600000.0f;
+            st.ratePctPerHour = fabsf(obs.percent - st.lastPercent) / hours;
+        }
+        st.hasLastPercent = true;
+        st.lastPercent = obs.percent;
+        st.lastPercentMs = obs.nowMs;
+
+        // Shorten at once when the level starts moving; lengthen at most 2x per
+        // wake so a single quiet sample does not jump straight to the maximum.
+        const uint32_t target = duty_targetInterval(cfg, st.ratePctPerHour);
+        if (st.intervalS == 0u || target <= st.intervalS)
+        {
+            st.intervalS = target;
+        }
+        else
+        {
+            const uint32_t grown = st.intervalS * 2u;
+            st.intervalS = (grown < target) ? grown : target;
+        }
+    }
+    else if (st.intervalS == 0u)
+    {
+        // No level yet: keep the interval we had (minimum on the first wake)
+        // rather than waking fast forever on a disconnected probe.
+        st.intervalS = cfg.minIntervalS;
+    }
+
+    const bool heartbeat = !st.hasPublished || ((obs.nowMs - st.lastPublishMs) >= (uint64_t)cfg.heartbeatS * 1000u);
+    bool publish = heartbeat || st.commandSeen;
+    publish = publish || (obs.valid != st.lastPublishedValid);
+    publish = publish || ((uint8_t)obs.reason != st.lastPublishedReason);
+    publish = publish || (obs.valid && fabsf(obs.percent - st.lastPublishedPercent) >= cfg.publishDeltaPct);
+    publish = publish || (st.bufCount >= CFG_DUTY_BUFFER_SAMPLES);
+
+    const uint32_t awakeMs = (heartbeat || st.commandSeen) ? cfg.awakeWindowMs : cfg.listenMs;
+    return DutyDecision{publish, heartbeat, publish ? awakeMs : 0u, st.intervalS, st.ratePctPerHour};
+}
+
+void duty_notePublished(DutyRtcState &st, const DutyObservation &obs)
+{
+    st.hasPublished = true;
+    st.lastPublishedValid = obs.valid;
+    st.lastPublishedReason = (uint8_t)obs.reason;
+    st.lastPublishedPercent = obs.valid ? obs.percent : 0.0f;
+    st.lastPublishMs = obs.nowMs;
+}
+
+void duty_noteSamplesFlushed(DutyRtcState &st)
+{
+    st.bufCount = 0;
+}
+
+void duty_bufferObservation(DutyRtcState &st, const DutyObservation &obs)
+{
+    if (st.bufCount >= CFG_DUTY_BUFFER_SAMPLES)
+    {
+        memmove(&st.buf[0], &st.buf[1], sizeof(st.buf[0]) * (CFG_DUTY_BUFFER_SAMPLES - 1));
+        st.bufCount = CFG_DUTY_BUFFER_SAMPLES - 1;
+    }
+    DutySample &s = st.buf[st.bufCount++];
+    s.tS = (uint32_t)(obs.nowMs / 1000u);
+    s.percentX10 = obs.valid ? (int16_t)lroundf(obs.percent * 10.0f) : (int16_t)-1;
+    s.reason = (uint8_t)obs.reason;
+    s.reserved = 0;
+}
+
+void duty_awakeBegin(DutyAwakeWindow &w, uint32_t nowMs, uint32_t awakeMs)
+{
+    w.startMs = nowMs;
+    w.endMs = nowMs + awakeMs;
+}
+
+bool duty_awakeTick(DutyAwakeWindow &w, const DutyConfig &cfg, uint32_t nowMs, bool commandSeen, bool otaBusy)
+{
+    if ((uint32_t)(nowMs - w.startMs) >= cfg.maxAwakeMs)
+    {
+        return false;
+    }
+    if (commandSeen && (int32_t)((nowMs + cfg.awakeWindowMs) - w.endMs) > 0)
+    {
+        w.endMs = nowMs + cfg.awakeWindowMs;
+    }
+    return otaBusy || (int32_t)(w.endMs - nowMs) > 0;
+}
+
+void duty_beforeSleep(DutyRtcState &st, uint64_t nowMs, uint32_t sleepS)
+{
+    st.clockMs = nowMs + (uint64_t)sleepS * 1000u;
+}
+
+bool duty_buildSamplesJson(const DutyRtcState &st, uint64_t nowMs, char *out, size_t outSize)
+{
+    if (!out || outSize == 0u)
+    {
+        return false;
+    }
+    const uint32_t nowS = (uint32_t)(nowMs / 1000u);
+    int n = snprintf(out, outSize, "{\"wake\":%u,\"interval_s\":%lu,\"rate_pct_h\":%.2f,\"samples\":[",
+                     (unsigned)st.wakeCount, (unsigned long)st.intervalS, (double)st.ratePctPerHour);
+    for (uint8_t i = 0; i < st.bufCount; ++i)
+    {
+        if (n < 0 || (size_t)n >= outSize)
+        {
+            return false;
+        }
+        const DutySample &s = st.buf[i];
+        n += snprintf(out + n, outSize - (size_t)n, "%s[%lu,%.1f,%u]",
+                      i ? "," : "",
+                      (unsigned long)(nowS - s.tS),
+                      s.percentX10 < 0 ? -1.0 : (double)s.percentX10 / 10.0,
+                      (unsigned)s.reason);
+    }
+    if (n < 0 || (size_t)n >= outSize)
+    {
+        return false;
+    }
+    n += snprintf(out + n, outSize - (size_t)n, "]}");
+    return n > 0 && (size_t)n < outSize;
+}
@@ -6,6 +6,7 @@
 
 #include "logger.h"
 #include "telemetry_registry.h"
+#include "boot_trace.h"
 
 #ifdef __has_include
 #if __has_include("config.h")
@@ -593,6 +594,7 @@ HaDiscoveryResult ha_discovery_publishAll()
         return HaDiscoveryResult::ALREADY_PUBLISHED;
     }
 
+    boot_trace_mark("ha_discovery_begin");
     bool anyOk = false;
 
     anyOk |= publishDeviceInfo();
@@ -641,6 +643,7 @@ HaDiscoveryResult ha_discovery_publishAll()
         }
     }
 
+    boot_trace_mark(anyOk ? "ha_discovery_done" : "ha_discovery_failed");
     if (anyOk)
     {
         s_published = true;
@@ -0,0 +1,223 @@
+#include "level_fixed.h"
+#include <math.h>
+
+static constexpr int64_t kMaxRawDelta = (int64_t)1 << 24;
+
+static uint32_t level_toCenti(float value)
+{
+    if (!(value > 0.0f))
+    {
+        return 0u; // also NaN
+    }
+    const float centi = value * 100.0f + 0.5f;
+    return (centi >= 4294967295.0f) ? UINT32_MAX : (uint32_t)centi;
+}
+
+// Knots dry(0 %) .. points .. wet(100 %) in raw order. A point whose raw is not
+// strictly between its lower neighbour and wet would fold the curve; skip it.
+static void level_prepareCurve(LevelCalib &calib, const CalCurve &curve, int32_t start, int32_t end)
+{
+    if (curve.count == 0u || !cal_curveValidate(curve))
+    {
+        return;
+    }
+    const bool ascending = end > start;
+    int32_t raw[LEVEL_MAX_KNOTS];
+    int32_t pct[LEVEL_MAX_KNOTS];
+    uint8_t n = 0;
+    raw[n] = start;
+    pct[n++] = 0;
+    for (uint8_t i = 0; i < curve.count; ++i)
+    {
+        const int32_t r = curve.points[i].raw;
+        const bool inside = ascending ? (r > raw[n - 1] && r < end) : (r < raw[n - 1] && r > end);
+        if (!inside)
+        {
+            continue;
+        }
+        raw[n] = r;
+        pct[n++] = (int32_t)(((int64_t)curve.points[i].percentX100 * LEVEL_Q16_ONE + 50) / 100);
+    }
+    raw[n] = end;
+    pct[n++] = LEVEL_PERCENT_Q16_MAX;
+    calib.curvePointsUsed = (uint8_t)(n - 2u);
+    if (calib.curvePointsUsed == 0u)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        const uint8_t src = ascending ? i : (uint8_t)(n - 1u - i);
+        calib.knotRaw[i] = raw[src];
+        calib.knotPercentQ16[i] = pct[src];
+    }
+    for (uint8_t i = 0; i + 1u < n; ++i)
+    {
+        const int64_t dPct = (int64_t)(calib.knotPercentQ16[i + 1] - calib.knotPercentQ16[i]) << 16;
+        calib.knotSlopeQ32[i] = dPct / (int64_t)(calib.knotRaw[i + 1] - calib.knotRaw[i]);
+    }
+    calib.knots = n;
+}
+
+void level_prepare(LevelCalib &calib, const AppliedConfig &cfg, uint32_t calMinDiff)
+{
+    calib = LevelCalib{};
+    const int32_t diff = (cfg.calDry > cfg.calWet) ? (int32_t)(cfg.calDry - cfg.calWet) : (int32_t)(cfg.calWet - cfg.calDry);
+    if ((int32_t)cfg.calDry <= 0 || (int32_t)cfg.calWet <= 0 || (uint32_t)diff < calMinDiff || diff == 0)
+    {
+        return;
+    }
+
+    const int32_t start = cfg.calInverted ? (int32_t)cfg.calWet : (int32_t)cfg.calDry;
+    const int32_t end = cfg.calInverted ? (int32_t)cfg.calDry : (int32_t)cfg.calWet;
+    calib.start = start;
+    calib.percentPerRawQ32 = ((int64_t)100 << 32) / (int64_t)(end - start);
+    calib.valid = LEVEL_VALID_PERCENT;
+    level_prepareCurve(calib, cfg.calCurve, start, end);
+
+    if (!tank_isLinear(cfg.tankGeometry))
+    {
+        // No liters rather than proportional liters when the table cannot be built.
+        calib.volumeLutActive = tank_buildVolumeLut(cfg.tankGeometry, cfg.tankVolumeLiters, cfg.rodLengthCm,
+                                                    calib.volumeLut, CFG_TANK_LUT_POINTS);
+        if (calib.volumeLutActive)
+        {
+            calib.valid |= LEVEL_VALID_LITERS;
+        }
+    }
+    else if (!isnan(cfg.tankVolumeLiters))
+    {
+        calib.volumeCenti = level_toCenti(cfg.tankVolumeLiters);
+        calib.valid |= LEVEL_VALID_LITERS;
+    }
+    if (!isnan(cfg.rodLengthCm))
+    {
+        calib.rodCenti = level_toCenti(cfg.rodLengthCm);
+        calib.valid |= LEVEL_VALID_CENTIMETERS;
+    }
+}
+
+bool level_percentFromRaw(const LevelCalib &calib, int32_t raw, int32_t &percentQ16)
+{
+    if (!(calib.valid & LEVEL_VALID_PERCENT))
+    {
+        return false;
+    }
+    int32_t origin = calib.start;
+    int64_t slopeQ32 = calib.percentPerRawQ32;
+    int64_t q16 = 0;
+    if (calib.knots != 0u)
+    {
+        // Last knot at or below raw (first one when below the table), without
+        // data-dependent branches; the final segment extends past the top knot.
+        const int32_t *base = calib.knotRaw;
+        uint8_t n = (uint8_t)(calib.knots - 1u);
+        while (n > 1u)
+        {
+            const uint8_t half = (uint8_t)(n / 2u);
+            base = (base[half] <= raw) ? base + half : base;
+            n = (uint8_t)(n - half);
+        }
+        const uint8_t seg = (uint8_t)(base - calib.knotRaw);
+        origin = calib.knotRaw[seg];
+        slopeQ32 = calib.knotSlopeQ32[seg];
+        q16 = calib.knotPercentQ16[seg];
+    }
+    // (raw - origin) * (100 << 32) / span, back to Q16. Far out-of-range deltas
+    // clamp to 0/100 % anyway; bounding them keeps the product within 64 bits.
+    int64_t delta = (int64_t)raw - (int64_t)origin;
+    if (delta > kMaxRawDelta)
+    {
+        delta = kMaxRawDelta;
+    }
+    else if (delta < -kMaxRawDelta)
+    {
+        delta = -kMaxRawDelta;
+    }
+    q16 += (delta * slopeQ32) >> 16;
+    if (q16 < 0)
+    {
+        q16 = 0;
+    }
+    else if (q16 > LEVEL_PERCENT_Q16_MAX)
+    {
+        q16 = LEVEL_PERCENT_Q16_MAX;
+    }
+    percentQ16 = (int32_t)q16;
+    return true;
+}
+
+void level_filterInit(LevelFilter &filter, float alpha)
+{
+    filter.primed = false;
+    filter.emaQ16 = 0;
+    filter.alphaQ16 = (int32_t)lroundf(alpha * (float)LEVEL_Q16_ONE);
+}
+
+void level_filterReset(LevelFilter &filter)
+{
+    filter.primed = false;
+    filter.emaQ16 = 0;
+}
+
+void level_filterUpdate(LevelFilter &filter, bool valid, int32_t percentQ16)
+{
+    if (!valid)
+    {
+        level_filterReset(filter);
+        return;
+    }
+    if (!filter.primed)
+    {
+        filter.emaQ16 = percentQ16;
+        filter.primed = true;
+        return;
+    }
+    // ema += alpha * (x - ema), rounded to nearest
+    const int64_t step = (int64_t)filter.alphaQ16 * (int64_t)(percentQ16 - filter.emaQ16);
+    filter.emaQ16 += (int32_t)((step + (LEVEL_Q16_ONE / 2)) >> 16);
+}
+
+// Interpolate the geometry table at percentQ16: one divide by a constant and one multiply.
+static uint32_t level_lutLiters(const LevelCalib &calib, uint64_t percentQ16)
+{
+    static constexpr uint64_t kSegments = CFG_TANK_LUT_POINTS - 1u;
+    const uint64_t pos = percentQ16 * kSegments;
+    const uint64_t idx = pos / (uint64_t)LEVEL_PERCENT_Q16_MAX;
+    if (idx >= kSegments)
+    {
+        return calib.volumeLut[kSegments];
+    }
+    const uint64_t rem = pos - idx * (uint64_t)LEVEL_PERCENT_Q16_MAX;
+    const uint32_t lo = calib.volumeLut[idx];
+    const uint32_t hi = calib.volumeLut[idx + 1u];
+    return lo + (uint32_t)(((uint64_t)(hi - lo) * rem + (uint64_t)LEVEL_PERCENT_Q16_MAX / 2u) / (uint64_t)LEVEL_PERCENT_Q16_MAX);
+}
+
+LevelFixed level_derive(const LevelCalib &calib, const LevelFilter &filter)
+{
+    LevelFixed out{};
+    if (!filter.primed || !(calib.valid & LEVEL_VALID_PERCENT))
+    {
+        return out;
+    }
+    out.percentQ16 = filter.emaQ16;
+    out.valid = calib.valid;
+    // value * percentQ16 / (100 << 16); volume < 2^32 and percent <= 100 << 16 fit in 64 bits.
+    const uint64_t pct = (uint64_t)(uint32_t)filter.emaQ16;
+    const uint64_t denom = (uint64_t)LEVEL_PERCENT_Q16_MAX;
+    if (calib.volumeLutActive)
+    {
+        out.litersCenti = level_lutLiters(calib, pct);
+    }
+    else if (calib.valid & LEVEL_VALID_LITERS)
+    {
+        out.litersCenti = (uint32_t)(((uint64_t)calib.volumeCenti * pct + denom / 2u) / denom);
+    }
+    if (calib.valid & LEVEL_VALID_CENTIMETERS)
+    {
+        out.centimetersCenti = (uint32_t)(((uint64_t)calib.rodCenti * pct + denom / 2u) / denom);
+    }
+    return out;
+}
@@ -0,0 +1,72 @@
+#include "loop_events.h"
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static TaskHandle_t s_waiter = nullptr;
+
+void loop_events_begin()
+{
+    s_waiter = xTaskGetCurrentTaskHandle();
+}
+
+void loop_events_signal(uint32_t bits)
+{
+    TaskHandle_t waiter = s_waiter;
+    if (waiter == nullptr || bits == 0u)
+    {
+        return;
+    }
+    xTaskNotify(waiter, bits, eSetBits);
+}
+
+uint32_t loop_events_wait(uint32_t timeoutMs)
+{
+    uint32_t bits = 0;
+    if (s_waiter == nullptr)
+    {
+        return 0u;
+    }
+    xTaskNotifyWait(0u, UINT32_MAX, &bits, pdMS_TO_TICKS(timeoutMs));
+    return bits;
+}
+
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+static std::mutex s_mutex;
+static std::condition_variable s_cv;
+static uint32_t s_pending = 0;
+
+void loop_events_begin()
+{
+}
+
+void loop_events_signal(uint32_t bits)
+{
+    if (bits == 0u)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_pending |= bits;
+    }
+    s_cv.notify_one();
+}
+
+uint32_t loop_events_wait(uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(s_mutex);
+    if (s_pending == 0u && timeoutMs > 0u)
+    {
+        s_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [] { return s_pending != 0u; });
+    }
+    const uint32_t bits = s_pending;
+    s_pending = 0u;
+    return bits;
+}
+#endif
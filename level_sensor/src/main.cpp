@@ -8,6 +8,8 @@
 #include <esp_system.h>
 #include <esp_heap_caps.h>
 #include <esp_partition.h>
+#include <esp_sleep.h>
+#include <esp_attr.h>
 #include "main.h"
 #include "probe_reader.h"
 #include "wifi_provisioning.h"
@@ -16,11 +18,24 @@
 #include "ota_service.h"
 #include "mqtt_transport.h"
 #include "storage_nvs.h"
+#include "nvs_wear.h"
+#include "boot_trace.h"
+#include "duty_cycle.h"
+#include "adaptive_sampler.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "loop_events.h"
 #include "simulation.h"
+#include "trace_replay.h"
+#include "quality_replay.h"
 #include "commands.h"
 #include "applied_config.h"
 #include "logger.h"
 #include "quality.h"
+#include "level_fixed.h"
+#include "drift_comp.h"
+#include "anomaly.h"
+#include "domain_strings.h"
 #include "time_format.h"
 #include "version.h"
 
@@ -33,51 +48,9 @@ DeviceState g_state;
 #endif
 #endif
 
-#ifndef CFG_PROBE_DISCONNECTED_BELOW_RAW
-#define CFG_PROBE_DISCONNECTED_BELOW_RAW 30000u
-#endif
 #ifndef CFG_CAL_MIN_DIFF
 #define CFG_CAL_MIN_DIFF 20u
 #endif
-#ifndef CFG_SPIKE_DELTA
-#define CFG_SPIKE_DELTA 10000u
-#endif
-#ifndef CFG_RAPID_FLUCTUATION_DELTA
-#define CFG_RAPID_FLUCTUATION_DELTA 5000u
-#endif
-#ifndef CFG_SPIKE_COUNT_THRESHOLD
-#define CFG_SPIKE_COUNT_THRESHOLD 3u
-#endif
-#ifndef CFG_SPIKE_WINDOW_MS
-#define CFG_SPIKE_WINDOW_MS 5000u
-#endif
-#ifndef CFG_STUCK_EPS
-#define CFG_STUCK_EPS 2u
-#endif
-#ifndef CFG_STUCK_MS
-#define CFG_STUCK_MS 8000u
-#endif
-#ifndef CFG_PROBE_MIN_RAW
-#define CFG_PROBE_MIN_RAW 0u
-#endif
-#ifndef CFG_PROBE_MAX_RAW
-#define CFG_PROBE_MAX_RAW 65535u
-#endif
-#ifndef CFG_CAL_RECOMMEND_MARGIN
-#define CFG_CAL_RECOMMEND_MARGIN 2000u
-#endif
-#ifndef CFG_CAL_RECOMMEND_COUNT
-#define CFG_CAL_RECOMMEND_COUNT 3u
-#endif
-#ifndef CFG_CAL_RECOMMEND_WINDOW_MS
-#define CFG_CAL_RECOMMEND_WINDOW_MS 60000u
-#endif
-#ifndef CFG_ZERO_HIT_COUNT
-#define CFG_ZERO_HIT_COUNT 2u
-#endif
-#ifndef CFG_ZERO_WINDOW_MS
-#define CFG_ZERO_WINDOW_MS 5000u
-#endif
 #ifndef CFG_RAW_SAMPLE_MS
 #define CFG_RAW_SAMPLE_MS 1000u
 #endif
@@ -96,6 +69,12 @@ DeviceState g_state;
 #ifndef CFG_SERIAL_CMD_BUF
 #define CFG_SERIAL_CMD_BUF 256u
 #endif
+#ifndef CFG_BOOT_SERIAL_SETTLE_MS
+#define CFG_BOOT_SERIAL_SETTLE_MS 0u // raise (e.g. 1500) to catch early logs on a freshly attached USB console
+#endif
+#ifndef CFG_LOOP_POLL_MS
+#define CFG_LOOP_POLL_MS 50u // FAST/MQTT/BOOT polling period (serial, WiFi, MQTT socket); events run them sooner
+#endif
 #ifndef CFG_DEV_MODE
 #define CFG_DEV_MODE 0
 #endif
@@ -164,8 +143,21 @@ static const uint8_t TOUCH_SAMPLE_DELAY_MS = 5;
 static const uint32_t RAW_SAMPLE_MS = CFG_RAW_SAMPLE_MS;
 static const uint32_t PERCENT_SAMPLE_MS = CFG_PERCENT_SAMPLE_MS;
 static const float PERCENT_EMA_ALPHA = CFG_PERCENT_EMA_ALPHA;
-static constexpr uint8_t SIM_MODE_MAX = 5;
-static constexpr float LEVEL_CHANGE_EPS = 0.01f;
+static const SamplerConfig SAMPLER_CFG = {
+    .normalRawMs = RAW_SAMPLE_MS,
+    .normalComputeMs = PERCENT_SAMPLE_MS,
+    .fastRawMs = CFG_ADAPT_FAST_RAW_MS,
+    .fastComputeMs = CFG_ADAPT_FAST_COMPUTE_MS,
+    .slowRawMs = CFG_ADAPT_SLOW_RAW_MS,
+    .slowComputeMs = CFG_ADAPT_SLOW_COMPUTE_MS,
+    .activeRatePctPerMin = CFG_ADAPT_ACTIVE_RATE_PCT_PER_MIN,
+    .staticRatePctPerMin = CFG_ADAPT_STATIC_RATE_PCT_PER_MIN,
+    .staticHoldMs = CFG_ADAPT_STATIC_HOLD_MS,
+    .trendWindowMs = CFG_ADAPT_TREND_WINDOW_MS,
+    .minDwellMs = CFG_ADAPT_MIN_DWELL_MS,
+    .publishBurst = (uint8_t)CFG_ADAPT_PUBLISH_BURST,
+    .publishPerMin = (uint8_t)CFG_ADAPT_PUBLISH_PER_MIN};
+static constexpr uint8_t SIM_MODE_MAX = 6;
 static constexpr size_t SERIAL_CMD_BUF = CFG_SERIAL_CMD_BUF;
 static constexpr char SERIAL_CMD_DELIMS[] = " \t";
 
@@ -174,6 +166,9 @@ static_assert(CFG_PERCENT_EMA_ALPHA >= 0.0f && CFG_PERCENT_EMA_ALPHA <= 1.0f, "C
 
 static const uint32_t OTA_MANIFEST_CHECK_MS = 21600000u; // 6h
 static const uint32_t OTA_MANIFEST_RETRY_MS = 60000u;    // 60s on failure
+static const uint32_t NVS_WEAR_PUBLISH_MS = 3600000u;     // 1h
+static const uint32_t NVS_WEAR_RETRY_MS = 60000u;
+static const uint32_t PROFILE_RETRY_MS = 60000u;
 static uint32_t s_lastManifestCheckMs = 0;
 static uint32_t s_lastManifestAttemptMs = 0;
 
@@ -184,28 +179,51 @@ static const uint32_t WIFI_TIMEOUT_MS = 20000;
 static bool calibrationInProgress = false;
 
 static int32_t lastRawValue = 0;
-static float percentEma = NAN;
+static LevelCalib s_levelCalib{};
+static LevelFilter s_levelFilter{};
 static bool probeConnected = false;
 static ProbeQualityReason probeQualityReason = ProbeQualityReason::UNKNOWN;
 static QualityRuntime probeQualityRt{};
+static DriftState s_drift{};
+static DriftConfig s_driftCfg = {CFG_DRIFT_TAU_S, CFG_DRIFT_STABLE_MS, CFG_DRIFT_STABLE_BAND,
+                                 CFG_DRIFT_MAX_OFFSET, CFG_DRIFT_FAST_ALPHA};
+static float s_driftSavedOffset = 0.0f;
+static uint32_t s_driftSavedMs = 0;
+// Dry/wet generations the offset was last reset against.
+static uint32_t s_driftDryGen = 0;
+static uint32_t s_driftWetGen = 0;
+static AnomalyState s_anomaly{};
+static AnomalyConfig s_anomalyCfg{};
 
 static int32_t calDry = 0;
 static int32_t calWet = 0;
 static bool calInverted = false;
 
-static float lastLiters = NAN; // Derived caches for change detection
-static float lastCentimeters = NAN;
+static LevelFixed s_lastLevel{}; // last derived level, for change detection
 static char s_emptyStr[1] = {0};
 static bool s_goodBootMarked = false;
+static SamplerState s_sampler{};
+static SamplerConfig s_samplerCfg = SAMPLER_CFG;
+// Base of the clock quality_evaluate() sees; non-zero after a duty-cycle wake so
+// its windows keep running across deep sleep.
+static uint64_t s_qualityClockBaseMs = 0;
+#if CFG_DUTY_CYCLE
+RTC_DATA_ATTR static DutyRtcState s_dutyRtc;
+#endif
 static bool s_bootRollbackDiagPending = false;
 static char s_bootRollbackDiag[192] = {0};
 static bool s_bootRebootDiagPending = false;
 static char s_bootRebootDiag[192] = {0};
+static uint32_t s_lastNvsWearPublishMs = 0;
+static uint32_t s_commandsSeen = 0;
+static bool s_nvsWearLastOk = false;
+static uint32_t s_lastProfilePublishMs = 0;
+static bool s_profileLastOk = false;
 
 enum class BootClassification : uint8_t;
 
 static void applyConfigFromCache(bool logValues);
-static bool reloadConfigIfDirty(bool logValues);
+static void subscribeConfigListeners();
 static void handleSerialCommands();
 static void updatePercentFromRaw();
 static void refreshStateSnapshot();
@@ -214,6 +232,8 @@ static void windowSensor();
 static void windowCompute();
 static void windowStateMeta();
 static void windowMqtt();
+static void adaptSampling();
+static void logSchedulerStats();
 static void maybeConfirmOtaRollback();
 static void logBootCrashDiagnostics(esp_reset_reason_t reasonCode, const char *reasonLabel);
 static void logBootRebootEvent(const char *resetReason, esp_reset_reason_t reasonCode, uint8_t rebootIntent, BootClassification cls);
@@ -221,33 +241,48 @@ static void logBootOtaIntentResult(uint8_t rebootIntent);
 static void setCalibrationDryValue(int32_t value, const char *sourceMsg = nullptr);
 static void setCalibrationWetValue(int32_t value, const char *sourceMsg = nullptr);
 
-enum class WindowPolicy : uint8_t
-{
-  ALWAYS,
-  SKIP_DURING_OTA
-};
+// ----------------- Staged boot -----------------
+// appSetup() only runs the critical path (storage, config, probe, first level).
+// Networking, OTA and diagnostics are started one step per loop pass by
+// windowBoot(). Every stage is also recorded in the boot trace, which is
+// published to system/boot_trace once its window has closed and MQTT is up.
 
-struct LoopWindow
+enum class BootStage : uint8_t
 {
-  const char *name;
-  uint32_t intervalMs;
-  uint32_t lastMs;
-  WindowPolicy policy;
-  void (*fn)();
+  STORAGE = 0,
+  CONFIG,
+  PROBE,
+  FIRST_LEVEL,
+  SETUP_DONE,
+  WIFI_INIT,
+  MQTT_INIT,
+  OTA_INIT,
+  DIAGNOSTICS,
+  WIFI_UP,
+  MQTT_UP,
+  COUNT
 };
 
-static void runWindow(LoopWindow &w, uint32_t now)
+static const char *const kBootStageNames[(size_t)BootStage::COUNT] = {
+    "storage", "config", "probe", "first_level", "setup_done",
+    "wifi_init", "mqtt_init", "ota_init", "diagnostics", "wifi_up", "mqtt_up"};
+
+static uint32_t s_bootStageMask = 0;
+
+static void bootMark(BootStage stage)
 {
-  if (w.policy == WindowPolicy::SKIP_DURING_OTA && ota_isBusy())
+  const uint32_t bit = 1u << (uint8_t)stage;
+  if (s_bootStageMask & bit)
   {
     return;
   }
+  s_bootStageMask |= bit;
+  boot_trace_mark(kBootStageNames[(size_t)stage]);
+}
 
-  if (w.intervalMs == 0 || (uint32_t)(now - w.lastMs) >= w.intervalMs)
-  {
-    w.fn();
-    w.lastMs = now;
-  }
+static bool bootReached(BootStage stage)
+{
+  return (s_bootStageMask & (1u << (uint8_t)stage)) != 0u;
 }
 
 // ----------------- Helpers -----------------
@@ -570,6 +605,8 @@ static void printHelpMenu()
   LOG_INFO(LogDomain::SYSTEM, "  dry   -> capture current averaged raw as dry, save to NVS");
   LOG_INFO(LogDomain::SYSTEM, "  wet   -> capture current averaged raw as wet, save to NVS");
   LOG_INFO(LogDomain::SYSTEM, "  show  -> print current NVS contents / internal state");
+  LOG_INFO(LogDomain::SYSTEM, "  cal <percent> -> capture current raw as a curve point at a known level (0-100 exclusive)");
+  LOG_INFO(LogDomain::SYSTEM, "  curve [clear] -> print (or clear) the intermediate calibration points");
   LOG_INFO(LogDomain::SYSTEM, "  clear -> clear stored calibration");
   LOG_INFO(LogDomain::SYSTEM, "  invert-> toggle inverted flag and save");
   LOG_INFO(LogDomain::SYSTEM, "  wifi  -> start WiFi captive portal (setup mode)");
@@ -579,10 +616,18 @@ static void printHelpMenu()
   LOG_INFO(LogDomain::SYSTEM, "  safe_mode enter -> force safe mode on (testing)");
   LOG_INFO(LogDomain::SYSTEM, "  dev on/off/status -> toggle runtime dev mode (high-frequency logs)");
   LOG_INFO(LogDomain::SYSTEM, "  log hf on/off -> enable/disable high-frequency logs");
-  LOG_INFO(LogDomain::SYSTEM, "  sim <0-5> -> set simulation mode and enable sim backend");
+  LOG_INFO(LogDomain::SYSTEM, "  sim <0-6> [seed] -> set simulation scenario (optionally reseeded) and enable sim backend");
   LOG_INFO(LogDomain::SYSTEM, "  mode touch -> use touchRead()");
   LOG_INFO(LogDomain::SYSTEM, "  mode sim   -> use simulation backend");
+  LOG_INFO(LogDomain::SYSTEM, "  replay start|embedded [speed] [loop] -> replay uploaded/embedded raw trace");
+  LOG_INFO(LogDomain::SYSTEM, "  replay stop|status -> stop replay (back to configured backend) / show progress");
+  LOG_INFO(LogDomain::SYSTEM, "  replay eval [stuck_ms] [spike_window_ms] [cal_window_ms] [drift] [anomaly] -> evaluate quality over the trace offline");
+  LOG_INFO(LogDomain::SYSTEM, "  drift [reset | tau <s>] -> show drift compensation, zero the offset, or set the rate (0 = off)");
+  LOG_INFO(LogDomain::SYSTEM, "  quality [reset] -> show the quality thresholds or restore the build defaults (set_quality over MQTT)");
+  LOG_INFO(LogDomain::SYSTEM, "  anomaly [on | off | reset] -> show, toggle or restart the statistical quality tier");
   LOG_INFO(LogDomain::SYSTEM, "  ota <url> <sha256> <version> -> start force pull-OTA from serial");
+  LOG_INFO(LogDomain::SYSTEM, "  sched [reset] -> print (or reset) loop task timing stats");
+  LOG_INFO(LogDomain::SYSTEM, "  prof [reset] -> print (or reset) execution-time profile");
   LOG_INFO(LogDomain::SYSTEM, "  help  -> show this menu");
 }
 
@@ -735,21 +780,6 @@ static float clampNonNegative(float value)
   return value < 0.0f ? 0.0f : value;
 }
 
-static float computePercent(int32_t raw)
-{
-  if (!hasCalibrationValues() || calDry == calWet || !probeConnected)
-  {
-    return NAN;
-  }
-
-  const AppliedConfig &cfg = config_get();
-  const float inputStart = cfg.calInverted ? (float)cfg.calWet : (float)cfg.calDry;
-  const float inputEnd = cfg.calInverted ? (float)cfg.calDry : (float)cfg.calWet;
-  const float percent = ((float)raw - inputStart) * 100.0f / (inputEnd - inputStart);
-
-  return constrain(percent, 0.0f, 100.0f);
-}
-
 static int32_t getRaw()
 {
   return (int32_t)probe_getRaw();
@@ -771,49 +801,31 @@ static void refreshCalibrationState()
   g_state.calibration.state = nextState;
 }
 
-static void refreshValidityFlags(float currentPercent)
-{
-  g_state.level.percentValid = probeConnected && g_state.calibration.state == CalibrationState::CALIBRATED && !isnan(currentPercent);
-  const AppliedConfig &cfg = config_get();
-  g_state.level.litersValid = g_state.level.percentValid && !isnan(cfg.tankVolumeLiters);
-  g_state.level.centimetersValid = g_state.level.percentValid && !isnan(cfg.rodLengthCm);
-}
-
-static void refreshLevelFromPercent(float percent)
+// Publish the derived level into g_state (floats at the edge; NaN when invalid).
+static void refreshLevelState()
 {
-  g_state.level.percent = percent;
-  refreshValidityFlags(percent);
-
-  if (g_state.level.percentValid)
-  {
-    const AppliedConfig &cfg = config_get();
-    const float liters = clampNonNegative(cfg.tankVolumeLiters * percent / 100.0f);
-    const float centimeters = clampNonNegative(cfg.rodLengthCm * percent / 100.0f);
-
-    g_state.level.liters = liters;
-    g_state.level.litersValid = true;
-    g_state.level.centimeters = centimeters;
-    g_state.level.centimetersValid = true;
-
-    const bool litersChanged = isnan(lastLiters) || fabs(lastLiters - liters) > LEVEL_CHANGE_EPS;
-    const bool cmChanged = isnan(lastCentimeters) || fabs(lastCentimeters - centimeters) > LEVEL_CHANGE_EPS;
-    if (litersChanged || cmChanged)
-    {
-      mqtt_requestStatePublish();
-    }
-
-    lastLiters = liters;
-    lastCentimeters = centimeters;
-  }
-  else
+  const LevelFixed level = level_derive(s_levelCalib, s_levelFilter);
+  const bool percentValid = probeConnected && g_state.calibration.state == CalibrationState::CALIBRATED &&
+                            (level.valid & LEVEL_VALID_PERCENT);
+  const uint8_t valid = percentValid ? level.valid : 0u;
+
+  g_state.level.percentValid = percentValid;
+  g_state.level.percent = percentValid ? level_q16ToFloat(level.percentQ16) : NAN;
+  g_state.level.litersValid = (valid & LEVEL_VALID_LITERS) != 0u;
+  g_state.level.liters = g_state.level.litersValid ? level_centiToFloat(level.litersCenti) : NAN;
+  g_state.level.centimetersValid = (valid & LEVEL_VALID_CENTIMETERS) != 0u;
+  g_state.level.centimeters = g_state.level.centimetersValid ? level_centiToFloat(level.centimetersCenti) : NAN;
+
+  // Publish on any 0.01 L / 0.01 cm step, or when the level becomes valid.
+  const bool changed = valid != s_lastLevel.valid ||
+                       level.litersCenti != s_lastLevel.litersCenti ||
+                       level.centimetersCenti != s_lastLevel.centimetersCenti;
+  if (percentValid && changed)
   {
-    g_state.level.liters = NAN;
-    g_state.level.litersValid = false;
-    g_state.level.centimeters = NAN;
-    g_state.level.centimetersValid = false;
-    lastLiters = NAN;
-    lastCentimeters = NAN;
+    mqtt_requestStatePublish();
   }
+  s_lastLevel = level;
+  s_lastLevel.valid = valid;
 }
 
 static void refreshProbeState(int32_t raw, bool forcePublish)
@@ -822,26 +834,14 @@ static void refreshProbeState(int32_t raw, bool forcePublish)
   const ProbeQualityReason prevReason = probeQualityReason;
 
   const AppliedConfig &cfg = config_get();
-  QualityConfig qc{
-      .disconnectedBelowRaw = CFG_PROBE_DISCONNECTED_BELOW_RAW,
-      .rawMin = CFG_PROBE_MIN_RAW,
-      .rawMax = CFG_PROBE_MAX_RAW,
-      .rapidFluctuationDelta = CFG_RAPID_FLUCTUATION_DELTA,
-      .spikeDelta = CFG_SPIKE_DELTA,
-      .spikeCountThreshold = (uint8_t)CFG_SPIKE_COUNT_THRESHOLD,
-      .spikeWindowMs = CFG_SPIKE_WINDOW_MS,
-      .stuckDelta = CFG_STUCK_EPS,
-      .stuckMs = CFG_STUCK_MS,
-      .calRecommendMargin = CFG_CAL_RECOMMEND_MARGIN,
-      .calRecommendCount = (uint8_t)CFG_CAL_RECOMMEND_COUNT,
-      .calRecommendWindowMs = CFG_CAL_RECOMMEND_WINDOW_MS,
-      .zeroHitCount = (uint8_t)CFG_ZERO_HIT_COUNT,
-      .zeroWindowMs = CFG_ZERO_WINDOW_MS};
-
-  const QualityResult qr = quality_evaluate((uint32_t)raw, cfg, qc, probeQualityRt, millis());
-
-  probeConnected = qr.connected;
-  probeQualityReason = qr.reason;
+
+  const uint32_t nowMs = (uint32_t)(s_qualityClockBaseMs + millis());
+  const QualityResult qr = quality_evaluate((uint32_t)raw, cfg, cfg.quality, probeQualityRt, nowMs);
+  const AnomalyResult ar = anomaly_evaluate(s_anomaly, s_anomalyCfg, (uint32_t)raw, nowMs, qr);
+
+  probeConnected = ar.quality.connected;
+  probeQualityReason = ar.quality.reason;
+  g_state.probe.qualityConfidence = ar.confidence;
 
   g_state.probe.connected = probeConnected;
   g_state.probe.quality = probeQualityReason;
@@ -857,6 +857,129 @@ static void refreshProbeState(int32_t raw, bool forcePublish)
   }
 }
 
+// Drift compensation sits between the probe and everything downstream (quality,
+// level). It learns only from samples the previous quality pass accepted.
+static int32_t compensateDrift(int32_t raw)
+{
+  const bool trusted = probeConnected && (probeQualityReason == ProbeQualityReason::OK ||
+                                          probeQualityReason == ProbeQualityReason::CALIBRATION_RECOMMENDED);
+  const int32_t corrected = drift_update(s_drift, s_driftCfg, raw, millis(), trusted);
+  g_state.probe.driftOffset = s_drift.offset;
+  return corrected;
+}
+
+static void saveDriftState()
+{
+  storage_saveDrift(DriftPersist{s_drift.offset, s_driftCfg.tauS});
+  s_driftSavedOffset = s_drift.offset;
+  s_driftSavedMs = millis();
+}
+
+static void maybePersistDrift()
+{
+  if (fabsf(s_drift.offset - s_driftSavedOffset) >= CFG_DRIFT_PERSIST_DELTA &&
+      (uint32_t)(millis() - s_driftSavedMs) >= CFG_DRIFT_PERSIST_MS)
+  {
+    saveDriftState();
+  }
+}
+
+static void loadDriftState()
+{
+  DriftPersist stored{};
+  storage_loadDrift(stored);
+  s_driftCfg.tauS = stored.tauS;
+  drift_init(s_drift, stored.offset);
+  s_driftSavedOffset = stored.offset;
+  s_driftSavedMs = millis();
+  s_driftDryGen = config_generation(ConfigField::CAL_DRY);
+  s_driftWetGen = config_generation(ConfigField::CAL_WET);
+  g_state.probe.driftOffset = s_drift.offset;
+}
+
+// A new calibration was taken against today's baseline; start from zero.
+// Persisted through the coalesced storage path like any other offset change.
+static void resetDrift(const char *sourceMsg)
+{
+  drift_init(s_drift, 0.0f);
+  saveDriftState();
+  g_state.probe.driftOffset = 0.0f;
+  LOG_INFO(LogDomain::PROBE, "Drift offset reset (%s)", sourceMsg ? sourceMsg : "");
+}
+
+static void setDriftTau(uint32_t tauS)
+{
+  s_driftCfg.tauS = tauS;
+  saveDriftState();
+  mqtt_requestStatePublish();
+  LOG_INFO(LogDomain::PROBE, "Drift compensation tau_s=%lu%s", (unsigned long)tauS, tauS == 0u ? " (off)" : "");
+}
+
+static void loadAnomalyConfig()
+{
+  const bool stored = storage_loadAnomaly(s_anomalyCfg);
+  anomaly_init(s_anomaly);
+  LOG_INFO(LogDomain::PROBE, "Anomaly tier %s (%s) window=%u outlier_k=%.1f noise_std=%.0f cusum_k=%.2f cusum_h=%.1f min_sigma=%.0f",
+           s_anomalyCfg.enabled ? "on" : "off", stored ? "stored" : "defaults", (unsigned)s_anomalyCfg.window,
+           (double)s_anomalyCfg.outlierK, (double)s_anomalyCfg.noiseStd, (double)s_anomalyCfg.cusumK,
+           (double)s_anomalyCfg.cusumH, (double)s_anomalyCfg.minSigma);
+}
+
+static void getAnomalyConfig(AnomalyConfig &cfg)
+{
+  cfg = s_anomalyCfg;
+}
+
+// Statistics restart from warm-up so a new window or scale applies cleanly.
+static void setAnomalyConfig(const AnomalyConfig &cfg)
+{
+  s_anomalyCfg = cfg;
+  storage_saveAnomaly(s_anomalyCfg);
+  anomaly_init(s_anomaly);
+  mqtt_requestStatePublish();
+}
+
+// Evaluate the selected replay trace offline (see quality_replay.h); 0 keeps the
+// built-in threshold. The report is logged and published to system/quality_replay.
+static bool evaluateReplay(uint32_t stuckMs, uint32_t spikeWindowMs, uint32_t calRecommendWindowMs, bool driftComp,
+                           bool anomaly)
+{
+  QualityConfig qc = config_get().quality;
+  if (stuckMs > 0u)
+  {
+    qc.stuckMs = stuckMs;
+  }
+  if (spikeWindowMs > 0u)
+  {
+    qc.spikeWindowMs = spikeWindowMs;
+  }
+  if (calRecommendWindowMs > 0u)
+  {
+    qc.calRecommendWindowMs = calRecommendWindowMs;
+  }
+
+  static QualityReplayReport report;
+  if (!quality_replayTrace(config_get(), qc, driftComp ? &s_driftCfg : nullptr, anomaly ? &s_anomalyCfg : nullptr,
+                           report, []() -> uint32_t { return micros(); }))
+  {
+    LOG_WARN(LogDomain::PROBE, "Replay evaluation skipped (no trace selected or replay running)");
+    return false;
+  }
+  LOG_INFO(LogDomain::PROBE,
+           "Replay evaluation samples=%lu span_s=%lu cpu_us=%lu transitions=%lu disconnected_s=%lu stuck_ms=%lu spike_window_ms=%lu cal_window_ms=%lu cal_recommended_s=%lu drift=%s anomaly=%s anomaly_events=%lu",
+           (unsigned long)report.samples, (unsigned long)(report.spanMs / 1000u), (unsigned long)report.cpuUs,
+           (unsigned long)report.transitions, (unsigned long)(report.disconnectedMs / 1000u),
+           (unsigned long)qc.stuckMs, (unsigned long)qc.spikeWindowMs, (unsigned long)qc.calRecommendWindowMs,
+           (unsigned long)(report.msByReason[(size_t)ProbeQualityReason::CALIBRATION_RECOMMENDED] / 1000u),
+           driftComp ? "on" : "off", anomaly ? "on" : "off", (unsigned long)report.anomalyEvents);
+  static char payload[1280];
+  if (mqtt_isConnected() && quality_replayBuildJson(report, qc, payload, sizeof(payload)))
+  {
+    mqtt_publishLog("system/quality_replay", payload, false);
+  }
+  return true;
+}
+
 static void refreshDeviceMeta()
 {
   g_state.schema = STATE_SCHEMA_VERSION;
@@ -889,8 +1012,10 @@ static void refreshDeviceMeta()
   const AppliedConfig &cfg = config_get();
   g_state.config.tankVolumeLiters = cfg.tankVolumeLiters;
   g_state.config.rodLengthCm = cfg.rodLengthCm;
+  g_state.config.tankShape = cfg.tankGeometry.shape;
   g_state.config.senseMode = cfg.senseMode;
   g_state.config.simulationMode = cfg.simulationMode;
+  g_state.config.quality = cfg.quality;
 }
 
 static void updateTankVolume(float value, bool /*forcePublish*/ = false)
@@ -898,9 +1023,7 @@ static void updateTankVolume(float value, bool /*forcePublish*/ = false)
   if (isnan(value))
     return;
 
-  const float next = clampNonNegative(value);
-  storage_saveTankVolume(next);
-  config_markDirty();
+  config_setTankVolume(clampNonNegative(value));
 }
 
 static void updateRodLength(float value, bool /*forcePublish*/ = false)
@@ -908,21 +1031,27 @@ static void updateRodLength(float value, bool /*forcePublish*/ = false)
   if (isnan(value))
     return;
 
-  const float next = clampNonNegative(value);
-  storage_saveTankHeight(next);
-  config_markDirty();
+  config_setRodLength(clampNonNegative(value));
+}
+
+static void updateTankGeometry(const TankGeometry &geometry, bool /*forcePublish*/ = false)
+{
+  config_setTankGeometry(geometry);
+}
+
+static void updateQualityConfig(const QualityConfig &qc, bool /*forcePublish*/ = false)
+{
+  config_setQuality(qc);
 }
 
 static void clearCalibration()
 {
-  storage_clearCalibration();
-  config_markDirty();
-  reloadConfigIfDirty(false);
+  calibrationInProgress = false;
+  level_filterReset(s_levelFilter);
+  config_clearCalibration();
   calDry = 0;
   calWet = 0;
   calInverted = false;
-  calibrationInProgress = false;
-  percentEma = NAN;
   g_state.calibration.dry = 0;
   g_state.calibration.wet = 0;
   g_state.calibration.inverted = false;
@@ -935,6 +1064,7 @@ static void wipeWifiCredentials()
 {
   LOG_WARN(LogDomain::WIFI, "Wipe WiFi credentials requested via command");
   storage_saveRebootIntent((uint8_t)RebootIntent::WIFI_WIPE);
+  storage_flush();
   wifi_wipeCredentialsAndReboot();
 }
 
@@ -952,70 +1082,99 @@ static void finishCalibrationCapture()
   mqtt_requestStatePublish();
 }
 
-static void captureCalibrationPoint(bool isDry)
+static int32_t captureCalibrationSample()
 {
   beginCalibrationCapture();
   const int32_t sample = getRaw();
   lastRawValue = sample;
   refreshProbeState(sample, true);
+  level_filterReset(s_levelFilter);
+  return sample;
+}
 
+static void captureCalibrationPoint(bool isDry)
+{
+  const int32_t sample = captureCalibrationSample();
   if (isDry)
   {
-    calDry = sample;
-    g_state.calibration.dry = calDry;
-    storage_saveCalibrationDry(calDry);
-    config_markDirty();
-    reloadConfigIfDirty(false);
-    LOG_INFO(LogDomain::CAL, "Captured dry=%ld", (long)calDry);
+    config_setCalibrationDry(sample);
+    LOG_INFO(LogDomain::CAL, "Captured dry=%ld", (long)sample);
   }
   else
   {
-    calWet = sample;
-    g_state.calibration.wet = calWet;
-    storage_saveCalibrationWet(calWet);
-    config_markDirty();
-    reloadConfigIfDirty(false);
-    LOG_INFO(LogDomain::CAL, "Captured wet=%ld", (long)calWet);
+    config_setCalibrationWet(sample);
+    LOG_INFO(LogDomain::CAL, "Captured wet=%ld", (long)sample);
   }
 
-  percentEma = NAN;
   refreshCalibrationState();
   finishCalibrationCapture();
 }
 
+// Intermediate point: the tank is known to be at `percent` right now.
+static bool captureCalibrationLevel(float percent)
+{
+  const int32_t sample = captureCalibrationSample();
+  const bool ok = config_addCalibrationPoint(sample, percent);
+  if (ok)
+  {
+    LOG_INFO(LogDomain::CAL, "Captured curve point raw=%ld at %.2f%% (points=%u used=%u)",
+             (long)sample, (double)percent, (unsigned)config_get().calCurve.count,
+             (unsigned)s_levelCalib.curvePointsUsed);
+  }
+  else
+  {
+    LOG_WARN(LogDomain::CAL, "Curve point rejected raw=%ld percent=%.2f (range or table full)",
+             (long)sample, (double)percent);
+  }
+  finishCalibrationCapture();
+  return ok;
+}
+
+static void clearCalibrationCurve()
+{
+  level_filterReset(s_levelFilter);
+  config_clearCalibrationCurve();
+  mqtt_requestStatePublish();
+  LOG_INFO(LogDomain::CAL, "Calibration curve cleared");
+}
+
+static void logCalibrationCurve()
+{
+  const CalCurve &curve = config_get().calCurve;
+  LOG_INFO(LogDomain::CAL, "[CAL] Curve points=%u used=%u", (unsigned)curve.count, (unsigned)s_levelCalib.curvePointsUsed);
+  for (uint8_t i = 0; i < curve.count; ++i)
+  {
+    LOG_INFO(LogDomain::CAL, "[CAL]   %.2f%% raw=%ld", (double)curve.points[i].percentX100 / 100.0,
+             (long)curve.points[i].raw);
+  }
+}
+
 static void handleInvertCalibration()
 {
-  calInverted = !calInverted;
-  storage_saveCalibrationInverted(calInverted);
-  g_state.calibration.inverted = calInverted;
-  config_markDirty();
-  reloadConfigIfDirty(false);
-  percentEma = NAN;
+  level_filterReset(s_levelFilter);
+  const bool inverted = !calInverted;
+  config_setCalibrationInverted(inverted);
   refreshCalibrationState();
   mqtt_requestStatePublish();
-  LOG_INFO(LogDomain::CAL, "Calibration inverted=%s", calInverted ? "true" : "false");
+  LOG_INFO(LogDomain::CAL, "Calibration inverted=%s", inverted ? "true" : "false");
 }
 
 static void setSenseMode(SenseMode mode, bool /*forcePublish*/ = false, const char * /*sourceMsg*/ = nullptr)
 {
-  storage_saveSenseMode(mode);
-  g_state.config.senseMode = mode;
+  config_setSenseMode(mode);
   probe_updateMode(mode == SenseMode::SIM ? READ_SIM : READ_PROBE);
   if (mode == SenseMode::SIM)
   {
     sim_start(g_state.probe.raw);
   }
-  config_markDirty();
   mqtt_requestStatePublish();
 }
 
 static void setSimulationModeInternal(uint8_t mode, bool /*forcePublish*/ = false, const char * /*sourceMsg*/ = nullptr)
 {
   uint8_t clamped = clampSimulationMode(mode);
-  storage_saveSimulationMode(clamped);
-  g_state.config.simulationMode = clamped;
+  config_setSimulationMode(clamped);
   setSimulationMode(clamped);
-  config_markDirty();
   mqtt_requestStatePublish();
 }
 
@@ -1024,19 +1183,13 @@ static void setCalibrationValueInternal(int32_t value, bool isDry, const char *s
   const int32_t clamped = clampNonNegativeInt32(value);
   if (isDry)
   {
-    calDry = clamped;
-    g_state.calibration.dry = calDry;
-    storage_saveCalibrationDry(calDry);
+    config_setCalibrationDry(clamped);
   }
   else
   {
-    calWet = clamped;
-    g_state.calibration.wet = calWet;
-    storage_saveCalibrationWet(calWet);
+    config_setCalibrationWet(clamped);
   }
 
-  config_markDirty();
-  reloadConfigIfDirty(false);
   refreshCalibrationState();
   mqtt_requestStatePublish();
   LOG_INFO(LogDomain::CAL, "Calibration %s set to %ld (%s)", isDry ? "dry" : "wet", (long)clamped, sourceMsg ? sourceMsg : "");
@@ -1052,7 +1205,7 @@ static void setCalibrationWetValue(int32_t value, const char *sourceMsg)
   setCalibrationValueInternal(value, false, sourceMsg);
 }
 
-static void applyConfigFromCache(bool logValues)
+static void applyCalibrationFromConfig()
 {
   const AppliedConfig &cfg = config_get();
 
@@ -1064,11 +1217,22 @@ static void applyConfigFromCache(bool logValues)
   g_state.calibration.wet = calWet;
   g_state.calibration.inverted = calInverted;
   g_state.calibration.minDiff = CFG_CAL_MIN_DIFF;
+  level_prepare(s_levelCalib, cfg, CFG_CAL_MIN_DIFF);
+  g_state.calibration.curvePoints = s_levelCalib.curvePointsUsed;
+}
+
+static void applyConfigFromCache(bool logValues)
+{
+  const AppliedConfig &cfg = config_get();
+
+  applyCalibrationFromConfig();
 
   g_state.config.tankVolumeLiters = cfg.tankVolumeLiters;
   g_state.config.rodLengthCm = cfg.rodLengthCm;
+  g_state.config.tankShape = cfg.tankGeometry.shape;
   g_state.config.senseMode = cfg.senseMode;
   g_state.config.simulationMode = cfg.simulationMode;
+  g_state.config.quality = cfg.quality;
 
   setSimulationMode(cfg.simulationMode);
   probe_updateMode(cfg.senseMode == SenseMode::SIM ? READ_SIM : READ_PROBE);
@@ -1086,45 +1250,163 @@ static void applyConfigFromCache(bool logValues)
   }
 }
 
-static bool reloadConfigIfDirty(bool logValues)
+// Config listeners: each dependent only reacts to the fields it reads.
+static void onCalibrationConfigChanged(uint32_t /*changedFields*/)
 {
-  if (config_reloadIfDirty())
+  // Only a recaptured dry or wet point embeds today's baseline. Inverting,
+  // clearing or editing the curve leaves the learned offset valid.
+  const uint32_t dryGen = config_generation(ConfigField::CAL_DRY);
+  const uint32_t wetGen = config_generation(ConfigField::CAL_WET);
+  int32_t dry = 0;
+  int32_t wet = 0;
+  bool inverted = false;
+  storage_loadCalibrationRaw(dry, wet, inverted);
+  if ((dryGen != s_driftDryGen && dry != 0) || (wetGen != s_driftWetGen && wet != 0))
+  {
+    resetDrift("calibration");
+  }
+  s_driftDryGen = dryGen;
+  s_driftWetGen = wetGen;
+  applyCalibrationFromConfig();
+  refreshCalibrationState();
+}
+
+static void onTankConfigChanged(uint32_t changedFields)
+{
+  const AppliedConfig &cfg = config_get();
+  g_state.config.tankVolumeLiters = cfg.tankVolumeLiters;
+  g_state.config.rodLengthCm = cfg.rodLengthCm;
+  g_state.config.tankShape = cfg.tankGeometry.shape;
+  LOG_INFO(LogDomain::CONFIG, "Tank config updated fields=0x%02lX volume_l=%.2f rod_cm=%.2f shape=%s",
+           (unsigned long)changedFields, (double)cfg.tankVolumeLiters, (double)cfg.rodLengthCm,
+           toString(cfg.tankGeometry.shape));
+  level_prepare(s_levelCalib, cfg, CFG_CAL_MIN_DIFF);
+  if (!tank_isLinear(cfg.tankGeometry) && !s_levelCalib.volumeLutActive)
   {
-    applyConfigFromCache(logValues);
-    return true;
+    LOG_WARN(LogDomain::CONFIG, "Tank geometry %s unusable with volume/rod; liters unavailable",
+             toString(cfg.tankGeometry.shape));
   }
-  return false;
+  refreshLevelState();
+  mqtt_requestStatePublish();
 }
 
-static void windowFast()
+static void onSenseConfigChanged(uint32_t /*changedFields*/)
+{
+  const AppliedConfig &cfg = config_get();
+  g_state.config.senseMode = cfg.senseMode;
+  g_state.config.simulationMode = cfg.simulationMode;
+  mqtt_requestStatePublish();
+}
+
+static void logQualityConfig(const char *what)
 {
-  ota_events_drainAndApply(&g_state);
-  ota_handle();
-  wifi_ensureConnected(WIFI_TIMEOUT_MS);
+  const QualityConfig &qc = config_get().quality;
+  LOG_INFO(LogDomain::CONFIG,
+           "Quality thresholds %s disconnected_below=%lu raw=[%lu..%lu] spike_delta=%lu x%u/%lums rapid_delta=%lu stuck_delta=%lu/%lums cal_margin=%lu x%u/%lums zero=x%u/%lums",
+           what, (unsigned long)qc.disconnectedBelowRaw, (unsigned long)qc.rawMin, (unsigned long)qc.rawMax,
+           (unsigned long)qc.spikeDelta, (unsigned)qc.spikeCountThreshold, (unsigned long)qc.spikeWindowMs,
+           (unsigned long)qc.rapidFluctuationDelta, (unsigned long)qc.stuckDelta, (unsigned long)qc.stuckMs,
+           (unsigned long)qc.calRecommendMargin, (unsigned)qc.calRecommendCount, (unsigned long)qc.calRecommendWindowMs,
+           (unsigned)qc.zeroHitCount, (unsigned long)qc.zeroWindowMs);
+}
 
-  if (reloadConfigIfDirty(true))
+// Windows and counters restart so a sample is never judged by a mix of old and new thresholds.
+// The slow raw cadence must still land spikeCountThreshold samples inside the
+// spike window and zeroHitCount samples inside the zero window.
+static void refreshSamplerConfig(const QualityConfig &qc)
+{
+  s_samplerCfg = SAMPLER_CFG;
+  uint32_t cap = sampler_rawCapMs(qc.spikeWindowMs, qc.spikeCountThreshold);
+  const uint32_t zeroCap = sampler_rawCapMs(qc.zeroWindowMs, qc.zeroHitCount);
+  if (zeroCap < cap)
   {
-    LOG_INFO(LogDomain::CONFIG, "Config reloaded from NVS");
-    refreshLevelFromPercent(percentEma);
-    mqtt_requestStatePublish();
+    cap = zeroCap;
+  }
+  if (s_samplerCfg.slowRawMs > cap)
+  {
+    s_samplerCfg.slowRawMs = cap;
+  }
+}
+
+#if CFG_ADAPTIVE_SAMPLING
+static void applySamplerCadence()
+{
+  static SchedTask *sensorTask = sched_find("SENSOR");
+  static SchedTask *computeTask = sched_find("COMPUTE");
+  if (sensorTask)
+  {
+    sched_setPeriod(*sensorTask, s_sampler.rawMs);
+  }
+  if (computeTask)
+  {
+    sched_setPeriod(*computeTask, s_sampler.computeMs);
+  }
+  LOG_DEBUG(LogDomain::PROBE, "Sampling mode=%s slope_pct_min=%.3f se=%.3f raw_ms=%lu compute_ms=%lu",
+            sampler_modeLabel(s_sampler.mode), (double)s_sampler.slopePctPerMin,
+            (double)s_sampler.slopeSePctPerMin, (unsigned long)s_sampler.rawMs,
+            (unsigned long)s_sampler.computeMs);
+}
+#endif
+
+static void onQualityConfigChanged(uint32_t /*changedFields*/)
+{
+  g_state.config.quality = config_get().quality;
+  quality_init(probeQualityRt);
+#if CFG_ADAPTIVE_SAMPLING
+  refreshSamplerConfig(g_state.config.quality);
+  if (sampler_reconfigure(s_sampler, s_samplerCfg))
+  {
+    applySamplerCadence();
   }
+#endif
+  logQualityConfig("updated");
+  mqtt_requestStatePublish();
+}
 
+static void subscribeConfigListeners()
+{
+  config_subscribe(CONFIG_FIELDS_CALIBRATION, onCalibrationConfigChanged);
+  config_subscribe(CONFIG_FIELDS_TANK, onTankConfigChanged);
+  config_subscribe(CONFIG_FIELDS_SENSE, onSenseConfigChanged);
+  config_subscribe(CONFIG_FIELDS_QUALITY, onQualityConfigChanged);
+}
+
+static void windowFast()
+{
+  if (bootReached(BootStage::OTA_INIT))
+  {
+    ota_events_drainAndApply(&g_state);
+    ota_handle();
+  }
+  if (bootReached(BootStage::WIFI_INIT))
+  {
+    wifi_ensureConnected(WIFI_TIMEOUT_MS);
+  }
   handleSerialCommands();
 }
 
 static void windowSensor()
 {
-  lastRawValue = getRaw();
+  lastRawValue = compensateDrift(getRaw());
   refreshProbeState(lastRawValue, false);
+  maybePersistDrift();
   logger_logEvery("raw_sample", 1000, LogLevel::DEBUG, LogDomain::PROBE,
                   "raw=%ld connected=%s quality=%d", (long)lastRawValue,
                   probeConnected ? "true" : "false", (int)probeQualityReason);
+#if CFG_ADAPTIVE_SAMPLING
+  // Routine per-sample publishes are budgeted; probe/quality changes request their own.
+  if (!sampler_takePublishToken(s_sampler, s_samplerCfg, millis()))
+  {
+    return;
+  }
+#endif
   mqtt_requestStatePublish();
 }
 
 static void windowCompute()
 {
   updatePercentFromRaw();
+  adaptSampling();
 }
 
 static void maybeCheckManifest()
@@ -1158,11 +1440,18 @@ static void maybeCheckManifest()
 static void windowStateMeta()
 {
   refreshStateSnapshot();
-  maybeCheckManifest();
+  if (bootReached(BootStage::OTA_INIT))
+  {
+    maybeCheckManifest();
+  }
 }
 
 static void windowMqtt()
 {
+  if (!bootReached(BootStage::MQTT_INIT))
+  {
+    return;
+  }
   mqtt_tick(g_state);
   if (s_bootRollbackDiagPending && mqtt_isConnected())
   {
@@ -1178,6 +1467,25 @@ static void windowMqtt()
       s_bootRebootDiagPending = false;
     }
   }
+  const uint32_t now = millis();
+  const uint32_t nvsWearDueMs = s_nvsWearLastOk ? NVS_WEAR_PUBLISH_MS : NVS_WEAR_RETRY_MS;
+  if (mqtt_isConnected() &&
+      (s_lastNvsWearPublishMs == 0 || (uint32_t)(now - s_lastNvsWearPublishMs) >= nvsWearDueMs))
+  {
+    static char payload[1024];
+    s_lastNvsWearPublishMs = now;
+    s_nvsWearLastOk = nvs_wear_buildJson(payload, sizeof(payload)) &&
+                      mqtt_publishLog("system/nvs_wear", payload, false);
+  }
+  const uint32_t profileDueMs = s_profileLastOk ? (uint32_t)CFG_PROFILER_PUBLISH_MS : PROFILE_RETRY_MS;
+  if (mqtt_isConnected() &&
+      (s_lastProfilePublishMs == 0 || (uint32_t)(now - s_lastProfilePublishMs) >= profileDueMs))
+  {
+    static char payload[1536];
+    s_lastProfilePublishMs = now;
+    s_profileLastOk = profiler_buildJson(payload, sizeof(payload), now) &&
+                      mqtt_publishLog("system/profile", payload, false);
+  }
 }
 
 static void handleSerialCommands()
@@ -1232,6 +1540,66 @@ static void handleSerialCommands()
     return;
   }
 
+  if (strcmp(cmd, "replay") == 0)
+  {
+    const char *sub = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (sub && strcmp(sub, "stop") == 0)
+    {
+      probe_stopReplay();
+      LOG_INFO(LogDomain::SYSTEM, "Replay stopped (serial)");
+      mqtt_requestStatePublish();
+      return;
+    }
+    if (sub && (strcmp(sub, "start") == 0 || strcmp(sub, "embedded") == 0))
+    {
+      const char *speedStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+      const char *loopStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+      const float speed = speedStr ? (float)atof(speedStr) : 1.0f;
+      const bool loop = loopStr && strcmp(loopStr, "loop") == 0;
+      const bool selected = (strcmp(sub, "embedded") == 0) ? replay_useEmbedded() : replay_useBuffer();
+      if (!selected || !probe_startReplay(speed, loop))
+      {
+        LOG_WARN(LogDomain::SYSTEM, "Replay start failed (no trace loaded or invalid speed)");
+        return;
+      }
+      LOG_INFO(LogDomain::SYSTEM, "Replay started source=%s speed=%.2f loop=%s (serial)",
+               sub, (double)speed, loop ? "true" : "false");
+      mqtt_requestStatePublish();
+      return;
+    }
+    if (sub && strcmp(sub, "eval") == 0)
+    {
+      const char *stuckStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+      const char *spikeStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+      const char *calStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+      bool driftComp = false;
+      bool anomaly = false;
+      for (const char *flag = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save); flag;
+           flag = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save))
+      {
+        driftComp = driftComp || strcmp(flag, "drift") == 0;
+        anomaly = anomaly || strcmp(flag, "anomaly") == 0;
+      }
+      evaluateReplay(stuckStr ? (uint32_t)strtoul(stuckStr, nullptr, 10) : 0u,
+                     spikeStr ? (uint32_t)strtoul(spikeStr, nullptr, 10) : 0u,
+                     calStr ? (uint32_t)strtoul(calStr, nullptr, 10) : 0u,
+                     driftComp, anomaly);
+      return;
+    }
+    if (sub && strcmp(sub, "status") == 0)
+    {
+      ReplayStatus st{};
+      replay_getStatus(st);
+      LOG_INFO(LogDomain::SYSTEM, "Replay active=%s finished=%s source=%s sample=%lu/%lu duration_ms=%lu speed=%.2f loop=%s",
+               st.active ? "true" : "false", st.finished ? "true" : "false", st.source,
+               (unsigned long)st.index, (unsigned long)st.count, (unsigned long)st.durationMs,
+               (double)st.speed, st.loop ? "true" : "false");
+      return;
+    }
+    printHelpMenu();
+    return;
+  }
+
   if (strcmp(cmd, "sim") == 0)
   {
     const char *modeStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
@@ -1244,7 +1612,13 @@ static void handleSerialCommands()
     const uint8_t clamped = clampSimulationMode(modeVal);
     setSenseMode(SenseMode::SIM, true, "serial");
     setSimulationModeInternal(clamped, true, "serial");
-    LOG_INFO(LogDomain::SYSTEM, "Simulation mode set to %u (serial)", (unsigned)clamped);
+    const char *seedStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (seedStr)
+    {
+      sim_setSeed((uint32_t)strtoul(seedStr, nullptr, 0));
+    }
+    LOG_INFO(LogDomain::SYSTEM, "Simulation mode set to %u scenario=%s seed=0x%08lx (serial)",
+             (unsigned)clamped, sim_scenarioName(), (unsigned long)sim_getSeed());
     return;
   }
 
@@ -1258,25 +1632,107 @@ static void handleSerialCommands()
     captureCalibrationPoint(false);
     return;
   }
-  if (strcmp(cmd, "show") == 0)
+  if (strcmp(cmd, "drift") == 0)
   {
-    LOG_INFO(LogDomain::CAL, "[CAL] Dry=%ld Wet=%ld Inverted=%s", (long)calDry, (long)calWet, calInverted ? "true" : "false");
-    LOG_INFO(LogDomain::CAL, "[CAL] Valid=%s", hasCalibrationValues() ? "yes" : "no");
-    storage_dump();
+    const char *sub = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (sub && strcmp(sub, "reset") == 0)
+    {
+      resetDrift("serial");
+      return;
+    }
+    if (sub && strcmp(sub, "tau") == 0)
+    {
+      const char *tauStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+      setDriftTau(tauStr ? (uint32_t)strtoul(tauStr, nullptr, 10) : CFG_DRIFT_TAU_S);
+      return;
+    }
+    LOG_INFO(LogDomain::PROBE, "Drift offset=%.1f tau_s=%lu anchored=%s band=%lu stable_ms=%lu",
+             (double)s_drift.offset, (unsigned long)s_driftCfg.tauS, s_drift.anchored ? "yes" : "no",
+             (unsigned long)s_driftCfg.stableBand, (unsigned long)s_driftCfg.stableMs);
     return;
   }
-  if (strcmp(cmd, "clear") == 0)
+  if (strcmp(cmd, "quality") == 0)
   {
-    clearCalibration();
+    const char *sub = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (sub && strcmp(sub, "reset") == 0)
+    {
+      QualityConfig qc;
+      quality_configDefaults(qc);
+      if (!config_setQuality(qc))
+      {
+        LOG_INFO(LogDomain::CONFIG, "Quality thresholds already at defaults");
+      }
+      return;
+    }
+    logQualityConfig("active");
     return;
   }
-  if (strcmp(cmd, "invert") == 0)
+  if (strcmp(cmd, "anomaly") == 0)
   {
-    handleInvertCalibration();
+    const char *sub = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (sub && (strcmp(sub, "on") == 0 || strcmp(sub, "off") == 0))
+    {
+      AnomalyConfig cfg = s_anomalyCfg;
+      cfg.enabled = strcmp(sub, "on") == 0;
+      setAnomalyConfig(cfg);
+      LOG_INFO(LogDomain::PROBE, "Anomaly tier %s (serial)", sub);
+      return;
+    }
+    if (sub && strcmp(sub, "reset") == 0)
+    {
+      anomaly_init(s_anomaly);
+      LOG_INFO(LogDomain::PROBE, "Anomaly statistics restarted (serial)");
+      return;
+    }
+    const float sigma = anomaly_sigma(s_anomaly, s_anomalyCfg);
+    LOG_INFO(LogDomain::PROBE, "Anomaly enabled=%s samples=%lu med_abs_err=%.1f sigma=%.1f noise_std=%.1f cusum=+%.1f/-%.1f confidence=%u",
+             s_anomalyCfg.enabled ? "true" : "false", (unsigned long)s_anomaly.n, (double)s_anomaly.medAbsErr, (double)sigma,
+             (double)sqrtf(s_anomaly.errVar), (double)s_anomaly.cusumPos, (double)s_anomaly.cusumNeg,
+             (unsigned)g_state.probe.qualityConfidence);
     return;
   }
-
-  if (strcmp(cmd, "log") == 0 || strcmp(cmd, "loghf") == 0)
+  if (strcmp(cmd, "cal") == 0)
+  {
+    const char *pctStr = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (!pctStr)
+    {
+      LOG_WARN(LogDomain::CAL, "Usage: cal <percent>");
+      return;
+    }
+    captureCalibrationLevel(strtof(pctStr, nullptr));
+    return;
+  }
+  if (strcmp(cmd, "curve") == 0)
+  {
+    const char *sub = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (sub && strcmp(sub, "clear") == 0)
+    {
+      clearCalibrationCurve();
+      return;
+    }
+    logCalibrationCurve();
+    return;
+  }
+  if (strcmp(cmd, "show") == 0)
+  {
+    LOG_INFO(LogDomain::CAL, "[CAL] Dry=%ld Wet=%ld Inverted=%s", (long)calDry, (long)calWet, calInverted ? "true" : "false");
+    LOG_INFO(LogDomain::CAL, "[CAL] Valid=%s", hasCalibrationValues() ? "yes" : "no");
+    logCalibrationCurve();
+    storage_dump();
+    return;
+  }
+  if (strcmp(cmd, "clear") == 0)
+  {
+    clearCalibration();
+    return;
+  }
+  if (strcmp(cmd, "invert") == 0)
+  {
+    handleInvertCalibration();
+    return;
+  }
+
+  if (strcmp(cmd, "log") == 0 || strcmp(cmd, "loghf") == 0)
   {
     const bool isLogHf = strcmp(cmd, "loghf") == 0;
     const char *arg1 = isLogHf ? "hf" : strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
@@ -1446,6 +1902,30 @@ static void handleSerialCommands()
     }
     return;
   }
+  if (strcmp(cmd, "prof") == 0)
+  {
+    const char *sub = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (sub && strcmp(sub, "reset") == 0)
+    {
+      profiler_reset(millis());
+      LOG_INFO(LogDomain::SYSTEM, "Profiler reset");
+      return;
+    }
+    profiler_log(millis());
+    return;
+  }
+  if (strcmp(cmd, "sched") == 0)
+  {
+    const char *sub = strtok_r(nullptr, SERIAL_CMD_DELIMS, &save);
+    if (sub && strcmp(sub, "reset") == 0)
+    {
+      sched_resetStats();
+      LOG_INFO(LogDomain::SYSTEM, "Scheduler stats reset");
+      return;
+    }
+    logSchedulerStats();
+    return;
+  }
   if (strcmp(cmd, "help") == 0)
   {
     printHelpMenu();
@@ -1457,48 +1937,414 @@ static void handleSerialCommands()
 
 static void updatePercentFromRaw()
 {
-  const float rawPercent = computePercent(lastRawValue);
+  int32_t percentQ16 = 0;
+  const bool valid = probeConnected && level_percentFromRaw(s_levelCalib, lastRawValue, percentQ16);
+  level_filterUpdate(s_levelFilter, valid, percentQ16);
+  refreshLevelState();
+}
+
+static void refreshStateSnapshot()
+{
+  refreshDeviceMeta();
+  g_state.calibration.dry = calDry;
+  g_state.calibration.wet = calWet;
+  g_state.calibration.inverted = calInverted;
+  g_state.calibration.minDiff = CFG_CAL_MIN_DIFF;
+}
+
+static void bootStartWifi()
+{
+  wifi_begin();
+}
+
+// Counts deliveries so duty-cycle mode can tell whether anyone is talking to it.
+static void onMqttCommand(const uint8_t *payload, size_t len)
+{
+  s_commandsSeen++;
+  commands_handle(payload, len);
+}
+
+static void bootStartMqtt()
+{
+  MqttConfig mqttCfg{
+      .host = MQTT_HOST_VALUE,
+      .port = MQTT_PORT_VALUE,
+      .clientId = MQTT_CLIENT_ID,
+      .user = MQTT_USER,
+      .pass = MQTT_PASS,
+      .baseTopic = BASE_TOPIC,
+      .deviceId = DEVICE_ID,
+      .deviceName = DEVICE_NAME,
+      .deviceModel = DEVICE_NAME,
+      .deviceSw = DEVICE_FW,
+      .deviceHw = DEVICE_HW};
+  mqtt_begin(mqttCfg, onMqttCommand);
+}
+
+static void bootStartOta()
+{
+  if (!ota_events_begin())
+  {
+    LOG_ERROR(LogDomain::OTA, "Failed to initialize ota events queue");
+  }
+  ota_begin(&g_state, DEVICE_ID, OTA_PASS);
+}
+
+static void bootLogDiagnostics()
+{
+  logBootCrashDiagnostics(esp_reset_reason(), g_state.reset_reason);
+
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  const esp_partition_t *boot = esp_ota_get_boot_partition();
+
+  LOG_INFO(LogDomain::OTA, "Running partition=%s addr=0x%08lx",
+           running ? running->label : "<null>",
+           running ? (unsigned long)running->address : 0);
+
+  LOG_INFO(LogDomain::OTA, "Boot partition=%s addr=0x%08lx",
+           boot ? boot->label : "<null>",
+           boot ? (unsigned long)boot->address : 0);
+
+  maybeConfirmOtaRollback();
+}
+
+struct DeferredBootStep
+{
+  BootStage stage;
+  void (*fn)();
+};
+
+// WiFi first: association is the long pole, so start it as early as possible.
+static const DeferredBootStep kDeferredBootSteps[] = {
+    {BootStage::WIFI_INIT, bootStartWifi},
+    {BootStage::MQTT_INIT, bootStartMqtt},
+    {BootStage::OTA_INIT, bootStartOta},
+    {BootStage::DIAGNOSTICS, bootLogDiagnostics}};
+static size_t s_deferredBootStep = 0;
 
-  if (!isnan(rawPercent))
+static void windowBoot()
+{
+  constexpr size_t kSteps = sizeof(kDeferredBootSteps) / sizeof(kDeferredBootSteps[0]);
+  if (s_deferredBootStep < kSteps)
+  {
+    const DeferredBootStep &step = kDeferredBootSteps[s_deferredBootStep++];
+    step.fn();
+    bootMark(step.stage);
+    return;
+  }
+
+  if (WiFi.isConnected())
+  {
+    bootMark(BootStage::WIFI_UP);
+  }
+  if (!mqtt_isConnected())
+  {
+    return;
+  }
+  bootMark(BootStage::MQTT_UP);
+
+  if (!boot_trace_pending())
+  {
+    return;
+  }
+  static char payload[1536];
+  if (!boot_trace_buildJson(payload, sizeof(payload), DEVICE_FW, g_state.boot_count, g_state.reset_reason))
   {
-    if (isnan(percentEma))
+    LOG_WARN(LogDomain::SYSTEM, "Boot trace does not fit payload buffer; dropped");
+    boot_trace_markPublished();
+    return;
+  }
+  if (mqtt_publishLog("system/boot_trace", payload, false))
+  {
+    boot_trace_markPublished();
+  }
+}
+
+// Loop tasks, scheduled by period/deadline/priority (0 = most urgent). FAST
+// carries OTA, WiFi and serial so it always runs first in a pass. Between
+// releases the loop blocks on loop_events; an event makes its consumer due now.
+static SchedTask g_tasks[] = {
+    {"FAST", CFG_LOOP_POLL_MS, CFG_LOOP_POLL_MS, 0, SchedPolicy::ALWAYS, windowFast, 0u, 0u, {}},
+    {"SENSOR", RAW_SAMPLE_MS, RAW_SAMPLE_MS, 1, SchedPolicy::SKIP_DURING_OTA, windowSensor, 0u, 0u, {}},
+    {"COMPUTE", PERCENT_SAMPLE_MS, PERCENT_SAMPLE_MS, 2, SchedPolicy::SKIP_DURING_OTA, windowCompute, 0u, 0u, {}},
+    {"MQTT", CFG_LOOP_POLL_MS, 250u, 3, SchedPolicy::SKIP_DURING_OTA, windowMqtt, 0u, 0u, {}},
+    {"STATE_META", 1000u, 1000u, 4, SchedPolicy::SKIP_DURING_OTA, windowStateMeta, 0u, 0u, {}},
+    {"BOOT", CFG_LOOP_POLL_MS, 0u, 5, SchedPolicy::ALWAYS, windowBoot, 0u, 0u, {}}};
+static_assert(sizeof(g_tasks) / sizeof(g_tasks[0]) <= CFG_SCHED_MAX_TASKS, "raise CFG_SCHED_MAX_TASKS");
+
+static uint32_t schedNowMs()
+{
+  return millis();
+}
+
+static uint32_t schedNowUs()
+{
+  return micros();
+}
+
+static bool schedOtaBusy()
+{
+  return ota_isBusy();
+}
+
+static int s_taskProfileSlots[sizeof(g_tasks) / sizeof(g_tasks[0])];
+
+static void onSchedRun(const SchedTask &task, uint32_t execUs)
+{
+  profiler_record(s_taskProfileSlots[&task - g_tasks], execUs);
+}
+
+static void onSchedOverrun(const SchedTask &task, uint32_t lateMs, uint32_t execUs)
+{
+  char key[24];
+  snprintf(key, sizeof(key), "sched_overrun_%s", task.name);
+  LOG_WARN_EVERY(key, 10000u, LogDomain::SYSTEM,
+                 "Task overrun task=%s late_ms=%lu exec_us=%lu deadline_ms=%lu overruns=%lu",
+                 task.name, (unsigned long)lateMs, (unsigned long)execUs,
+                 (unsigned long)(task.deadlineMs ? task.deadlineMs : task.periodMs),
+                 (unsigned long)task.stats.overruns);
+}
+
+// Release the task that consumes each loop event.
+static void dispatchLoopEvents(uint32_t events)
+{
+  static SchedTask *fastTask = sched_find("FAST");
+  static SchedTask *mqttTask = sched_find("MQTT");
+  if ((events & LOOP_EVENT_OTA) && fastTask)
+  {
+    sched_trigger(*fastTask);
+  }
+  if ((events & (LOOP_EVENT_STATE_PUBLISH | LOOP_EVENT_COMMAND | LOOP_EVENT_MQTT_RX)) && mqttTask)
+  {
+    sched_trigger(*mqttTask);
+  }
+}
+
+static void logSchedulerStats()
+{
+  const SchedTask *tasks = nullptr;
+  const size_t count = sched_tasks(tasks);
+  for (size_t i = 0; i < count; ++i)
+  {
+    const SchedTask &t = tasks[i];
+    const SchedTaskStats &st = t.stats;
+    LOG_INFO(LogDomain::SYSTEM,
+             "[SCHED] %-10s prio=%u period_ms=%lu runs=%lu exec_us avg=%lu max=%lu late_ms avg=%lu max=%lu overruns=%lu skipped=%lu",
+             t.name, (unsigned)t.priority, (unsigned long)t.periodMs, (unsigned long)st.runs,
+             (unsigned long)(st.runs ? st.totalExecUs / st.runs : 0u), (unsigned long)st.maxExecUs,
+             (unsigned long)(st.runs ? st.totalLateMs / st.runs : 0u), (unsigned long)st.maxLateMs,
+             (unsigned long)st.overruns, (unsigned long)st.skippedReleases);
+  }
+}
+
+// Retune the SENSOR/COMPUTE cadence from the level trend (see adaptive_sampler.h).
+static void adaptSampling()
+{
+#if CFG_ADAPTIVE_SAMPLING
+  if (!sampler_update(s_sampler, s_samplerCfg, g_state.level.percent, g_state.level.percentValid, millis()))
+  {
+    return;
+  }
+  applySamplerCadence();
+#endif
+}
+
+static void confirmGoodBoot()
+{
+  if (s_goodBootMarked || g_state.safe_mode || g_state.bad_boot_streak == 0u)
+  {
+    return;
+  }
+  g_state.bad_boot_streak = 0u;
+  storage_saveBadBootStreak(0u);
+  g_state.last_good_boot_ts = g_state.ts;
+  storage_saveGoodBootTs(g_state.last_good_boot_ts);
+  g_state.last_stable_boot = g_state.boot_count;
+  g_state.crash_window_boots = 0u;
+  g_state.crash_window_bad = 0u;
+  g_state.crash_loop = false;
+  strncpy(g_state.crash_loop_reason, "stable_runtime", sizeof(g_state.crash_loop_reason));
+  g_state.crash_loop_reason[sizeof(g_state.crash_loop_reason) - 1] = '\0';
+  LOG_INFO(LogDomain::SYSTEM, "Good boot confirmed: bad_boot_streak reset, last_good_boot_ts=%lu",
+           (unsigned long)g_state.last_good_boot_ts);
+  s_goodBootMarked = true;
+  mqtt_requestStatePublish();
+}
+
+// ---------------- Duty-cycled mode ----------------
+#if CFG_DUTY_CYCLE
+static const DutyConfig kDutyConfig = {
+    .minIntervalS = CFG_DUTY_MIN_INTERVAL_S,
+    .maxIntervalS = CFG_DUTY_MAX_INTERVAL_S,
+    .fastRatePctPerHour = CFG_DUTY_FAST_RATE_PCT_PER_H,
+    .publishDeltaPct = CFG_DUTY_PUBLISH_DELTA_PCT,
+    .heartbeatS = CFG_DUTY_HEARTBEAT_S,
+    .listenMs = CFG_DUTY_LISTEN_MS,
+    .awakeWindowMs = CFG_DUTY_AWAKE_WINDOW_MS,
+    .maxAwakeMs = CFG_DUTY_MAX_AWAKE_MS};
+
+// Restore carried state after a timer wake; anything else starts a fresh cycle.
+static bool dutyResume(esp_reset_reason_t reason)
+{
+  if (reason == ESP_RST_DEEPSLEEP && duty_isValid(s_dutyRtc))
+  {
+    probeQualityRt = s_dutyRtc.quality;
+    s_qualityClockBaseMs = s_dutyRtc.clockMs;
+    return true;
+  }
+  duty_reset(s_dutyRtc);
+  return false;
+}
+
+static bool dutyPublish()
+{
+  mqtt_setDiscoveryOnConnect(!s_dutyRtc.discoveryDone);
+  bootStartWifi();
+  bootMark(BootStage::WIFI_INIT);
+  bootStartMqtt();
+  bootMark(BootStage::MQTT_INIT);
+  s_deferredBootStep = 2; // windowBoot() continues with OTA/diagnostics if we stay awake
+
+  const uint32_t start = millis();
+  while ((uint32_t)(millis() - start) < CFG_DUTY_CONNECT_TIMEOUT_MS)
+  {
+    wifi_ensureConnected(CFG_DUTY_CONNECT_TIMEOUT_MS);
+    mqtt_tick(g_state);
+    if (mqtt_isConnected())
+    {
+      break;
+    }
+    delay(10);
+  }
+  if (!mqtt_isConnected())
+  {
+    LOG_WARN(LogDomain::MQTT, "Duty cycle: no MQTT within %lums; buffering sample",
+             (unsigned long)CFG_DUTY_CONNECT_TIMEOUT_MS);
+    return false;
+  }
+
+  refreshStateSnapshot();
+  if (!mqtt_publishStateNow(g_state))
+  {
+    return false;
+  }
+  s_dutyRtc.discoveryDone = true;
+  if (s_dutyRtc.bufCount > 0u)
+  {
+    // The state went out either way; the samples stay buffered until they do too.
+    static char payload[1024];
+    if (duty_buildSamplesJson(s_dutyRtc, s_qualityClockBaseMs + millis(), payload, sizeof(payload)) &&
+        mqtt_publishLog("duty/samples", payload, false))
     {
-      percentEma = rawPercent;
+      duty_noteSamplesFlushed(s_dutyRtc);
     }
     else
     {
-      percentEma = (PERCENT_EMA_ALPHA * rawPercent) + ((1.0f - PERCENT_EMA_ALPHA) * percentEma);
+      LOG_WARN(LogDomain::MQTT, "Duty cycle: duty/samples publish failed; keeping %u samples",
+               (unsigned)s_dutyRtc.bufCount);
     }
   }
-  else
+  return true;
+}
+
+// Keep servicing commands, OTA and the deferred boot steps through the normal
+// loop for the window duty_plan() granted. A command extends it and a running
+// OTA job holds it open, up to CFG_DUTY_MAX_AWAKE_MS.
+static void dutyStayAwake(uint32_t awakeMs)
+{
+  const uint32_t commandsAtStart = s_commandsSeen;
+  uint32_t commandsSeen = s_commandsSeen;
+  DutyAwakeWindow window{};
+  duty_awakeBegin(window, millis(), awakeMs);
+  for (;;)
+  {
+    const bool commandSeen = (s_commandsSeen != commandsSeen);
+    commandsSeen = s_commandsSeen;
+    const bool otaBusy = bootReached(BootStage::OTA_INIT) && ota_isBusy();
+    if (!duty_awakeTick(window, kDutyConfig, millis(), commandSeen, otaBusy))
+    {
+      break;
+    }
+    appLoop();
+  }
+  s_dutyRtc.commandSeen = (s_commandsSeen != commandsAtStart);
+  if (bootReached(BootStage::OTA_INIT) && ota_isBusy())
   {
-    percentEma = NAN;
+    (void)ota_cancel("duty_awake_limit");
   }
-
-  refreshLevelFromPercent(percentEma);
 }
 
-static void refreshStateSnapshot()
+// Runs once per wake in place of appLoop(); ends in deep sleep.
+static void dutyCycleRun()
 {
-  refreshDeviceMeta();
-  g_state.calibration.dry = calDry;
-  g_state.calibration.wet = calWet;
-  g_state.calibration.inverted = calInverted;
-  g_state.calibration.minDiff = CFG_CAL_MIN_DIFF;
-}
+  uint32_t burst[CFG_DUTY_BURST_SAMPLES];
+  burst[0] = (uint32_t)lastRawValue; // first-level sample taken by appSetup()
+  for (size_t i = 1; i < CFG_DUTY_BURST_SAMPLES; ++i)
+  {
+    delay(CFG_DUTY_BURST_SPACING_MS);
+    burst[i] = (uint32_t)drift_apply(s_drift, getRaw()); // too sparse to learn from; apply the stored offset
+    refreshProbeState((int32_t)burst[i], false);
+  }
+  // Level from the burst median; quality already saw every sample.
+  for (size_t i = 1; i < CFG_DUTY_BURST_SAMPLES; ++i)
+  {
+    const uint32_t v = burst[i];
+    size_t j = i;
+    while (j > 0 && burst[j - 1] > v)
+    {
+      burst[j] = burst[j - 1];
+      --j;
+    }
+    burst[j] = v;
+  }
+  lastRawValue = (int32_t)burst[CFG_DUTY_BURST_SAMPLES / 2];
+  level_filterReset(s_levelFilter);
+  updatePercentFromRaw();
+
+  const DutyObservation obs{s_qualityClockBaseMs + millis(), g_state.level.percent,
+                            g_state.level.percentValid, probeQualityReason};
+  const DutyDecision d = duty_plan(s_dutyRtc, kDutyConfig, obs);
+  if (d.publish && dutyPublish())
+  {
+    duty_notePublished(s_dutyRtc, obs);
+    confirmGoodBoot();
+    dutyStayAwake(d.awakeMs);
+  }
+  else
+  {
+    duty_bufferObservation(s_dutyRtc, obs);
+  }
+
+  // A new image must be confirmed even on wakes that never reach the broker,
+  // or the bootloader rolls it back on the next reset.
+  if (!bootReached(BootStage::DIAGNOSTICS))
+  {
+    maybeConfirmOtaRollback();
+  }
+  s_dutyRtc.quality = probeQualityRt;
+  storage_flush();
+  LOG_INFO(LogDomain::SYSTEM, "Duty cycle wake=%u publish=%s heartbeat=%s buffered=%u rate_pct_h=%.2f sleep_s=%lu awake_ms=%lu",
+           (unsigned)s_dutyRtc.wakeCount, d.publish ? "true" : "false", d.heartbeat ? "true" : "false",
+           (unsigned)s_dutyRtc.bufCount, (double)d.ratePctPerHour, (unsigned long)d.sleepS,
+           (unsigned long)millis());
 
-static LoopWindow g_windows[] = {
-    {"FAST", 0u, 0u, WindowPolicy::ALWAYS, windowFast},
-    {"SENSOR", RAW_SAMPLE_MS, 0u, WindowPolicy::SKIP_DURING_OTA, windowSensor},
-    {"COMPUTE", PERCENT_SAMPLE_MS, 0u, WindowPolicy::SKIP_DURING_OTA, windowCompute},
-    {"STATE_META", 1000u, 0u, WindowPolicy::SKIP_DURING_OTA, windowStateMeta},
-    {"MQTT", 0u, 0u, WindowPolicy::SKIP_DURING_OTA, windowMqtt}};
+  mqtt_disconnect();
+  WiFi.disconnect(true, false);
+  WiFi.mode(WIFI_OFF);
+  Serial.flush();
+  duty_beforeSleep(s_dutyRtc, s_qualityClockBaseMs + millis(), d.sleepS);
+  esp_sleep_enable_timer_wakeup((uint64_t)d.sleepS * 1000000ULL);
+  esp_deep_sleep_start();
+}
+#endif
 
 // ---------------- Arduino lifecycle ----------------
 
-// Contract: call once after boot. Initializes subsystems, state, and MQTT/OTA handlers.
+// Contract: call once after boot. Runs the critical path up to the first level
+// reading; WiFi/MQTT/OTA bring-up continues from appLoop() via windowBoot().
 void appSetup()
 {
+  boot_trace_mark("setup_start");
   Serial.begin(115200);
   Serial.println("STARTING UP...");
   Serial.flush();
@@ -1508,26 +2354,21 @@ void appSetup()
   strncpy(g_state.reset_reason, bootReason, sizeof(g_state.reset_reason));
   g_state.reset_reason[sizeof(g_state.reset_reason) - 1] = '\0';
 
-  delay(1500);
+  if (CFG_BOOT_SERIAL_SETTLE_MS > 0u)
+  {
+    delay(CFG_BOOT_SERIAL_SETTLE_MS);
+  }
   logger_begin(BASE_TOPIC, true, true);
   logger_setHighFreqEnabled(log_hf_enabled());
   quality_init(probeQualityRt);
-  logBootCrashDiagnostics(resetReasonCode, bootReason);
+#if CFG_DUTY_CYCLE
+  const bool dutyWake = dutyResume(resetReasonCode);
+#else
+  const bool dutyWake = false;
+#endif
+  boot_trace_mark("logger");
   LOG_INFO(LogDomain::SYSTEM, "BOOT water_level_sensor starting...");
 
-  const esp_partition_t *running = esp_ota_get_running_partition();
-  const esp_partition_t *boot = esp_ota_get_boot_partition();
-
-  LOG_INFO(LogDomain::OTA, "Running partition=%s addr=0x%08lx",
-           running ? running->label : "<null>",
-           running ? (unsigned long)running->address : 0);
-
-  LOG_INFO(LogDomain::OTA, "Boot partition=%s addr=0x%08lx",
-           boot ? boot->label : "<null>",
-           boot ? (unsigned long)boot->address : 0);
-
-  maybeConfirmOtaRollback();
-
   LOG_INFO(LogDomain::SYSTEM, "FW=%s HW=%s", DEVICE_FW, DEVICE_HW);
   LOG_INFO(LogDomain::SYSTEM, "Reset reason=%s (code=%d)", g_state.reset_reason, (int)resetReasonCode);
   if (strcmp(g_state.reset_reason, "brownout") == 0)
@@ -1536,12 +2377,17 @@ void appSetup()
   }
   LOG_INFO(LogDomain::SYSTEM, "TOUCH_PIN=%d", TOUCH_PIN);
 
+  nvs_wear_begin();
   storage_begin();
   {
     uint32_t persistedBootCount = 0u;
     storage_loadBootCount(persistedBootCount);
-    g_state.boot_count = persistedBootCount + 1u;
-    storage_saveBootCount(g_state.boot_count);
+    // A duty-cycle timer wake continues the same boot; counting it would cost a flash write per wake.
+    g_state.boot_count = dutyWake ? persistedBootCount : persistedBootCount + 1u;
+    if (!dutyWake)
+    {
+      storage_saveBootCount(g_state.boot_count);
+    }
 
     uint8_t rebootIntent = (uint8_t)RebootIntent::NONE;
     storage_loadRebootIntent(rebootIntent);
@@ -1632,18 +2478,18 @@ void appSetup()
              (unsigned long)g_state.crash_window_bad,
              g_state.crash_loop_reason);
   }
-  wifi_begin();
+  // Boot count / streak / safe-mode must be durable before anything that could crash.
+  storage_flush();
+  bootMark(BootStage::STORAGE);
+
   config_begin();
+  subscribeConfigListeners();
+  bootMark(BootStage::CONFIG);
 
   probe_begin({(uint8_t)TOUCH_PIN, TOUCH_SAMPLES, TOUCH_SAMPLE_DELAY_MS});
+  level_filterInit(s_levelFilter, PERCENT_EMA_ALPHA);
   applyConfigFromCache(true);
-  refreshStateSnapshot();
-
-  if (!ota_events_begin())
-  {
-    LOG_ERROR(LogDomain::OTA, "Failed to initialize ota events queue");
-  }
-  ota_begin(&g_state, DEVICE_ID, OTA_PASS);
+  bootMark(BootStage::PROBE);
 
   g_state.lastCmd.requestId = s_emptyStr;
   g_state.lastCmd.type = s_emptyStr;
@@ -1679,6 +2525,7 @@ void appSetup()
     {
       (void)time_format::formatIsoUtc(otaLastOk, g_state.ota_last_success_ts, sizeof(g_state.ota_last_success_ts));
     }
+    (void)storage_loadOtaStats(g_state.ota.stats);
   }
 
   g_state.level.percent = NAN;
@@ -1688,11 +2535,30 @@ void appSetup()
   g_state.level.litersValid = false;
   g_state.level.centimetersValid = false;
 
+  loadDriftState();
+  loadAnomalyConfig();
+
+  // First level reading straight away instead of waiting for the SENSOR/COMPUTE windows.
+  lastRawValue = drift_apply(s_drift, getRaw());
+  refreshProbeState(lastRawValue, true);
+  updatePercentFromRaw();
+  refreshStateSnapshot();
+  refreshSamplerConfig(config_get().quality);
+  sampler_init(s_sampler, s_samplerCfg, millis());
+  bootMark(BootStage::FIRST_LEVEL);
+  LOG_INFO(LogDomain::SYSTEM, "First level at %lums raw=%ld percent_valid=%s",
+           (unsigned long)millis(),
+           (long)lastRawValue,
+           g_state.level.percentValid ? "true" : "false");
+
   CommandsContext cmdCtx{
       .state = &g_state,
       .updateTankVolume = updateTankVolume,
       .updateRodLength = updateRodLength,
+      .updateTankGeometry = updateTankGeometry,
       .captureCalibrationPoint = captureCalibrationPoint,
+      .captureCalibrationLevel = captureCalibrationLevel,
+      .clearCalibrationCurve = clearCalibrationCurve,
       .clearCalibration = clearCalibration,
       .setSenseMode = setSenseMode,
       .setSimulationModeInternal = setSimulationModeInternal,
@@ -1700,55 +2566,53 @@ void appSetup()
       .setCalibrationWetValue = setCalibrationWetValue,
       .reannounce = mqtt_reannounceDiscovery,
       .wipeWifiCredentials = wipeWifiCredentials,
+      .evaluateReplay = evaluateReplay,
+      .setDriftTau = setDriftTau,
+      .getAnomalyConfig = getAnomalyConfig,
+      .setAnomalyConfig = setAnomalyConfig,
+      .updateQualityConfig = updateQualityConfig,
       .requestStatePublish = mqtt_requestStatePublish,
       .publishAck = mqtt_publishAck};
   commands_begin(cmdCtx);
-
-  MqttConfig mqttCfg{
-      .host = MQTT_HOST_VALUE,
-      .port = MQTT_PORT_VALUE,
-      .clientId = MQTT_CLIENT_ID,
-      .user = MQTT_USER,
-      .pass = MQTT_PASS,
-      .baseTopic = BASE_TOPIC,
-      .deviceId = DEVICE_ID,
-      .deviceName = DEVICE_NAME,
-      .deviceModel = DEVICE_NAME,
-      .deviceSw = DEVICE_FW,
-      .deviceHw = DEVICE_HW};
-  mqtt_begin(mqttCfg, commands_handle);
+  for (size_t i = 0; i < sizeof(g_tasks) / sizeof(g_tasks[0]); ++i)
+  {
+    s_taskProfileSlots[i] = profiler_register(g_tasks[i].name);
+  }
+  profiler_reset(millis());
+  loop_events_begin();
+  if (!sched_begin(g_tasks, sizeof(g_tasks) / sizeof(g_tasks[0]),
+                   SchedHooks{schedNowMs, schedNowUs, schedOtaBusy, onSchedOverrun, onSchedRun}))
+  {
+    LOG_ERROR(LogDomain::SYSTEM, "Scheduler rejected the task table (zero period?); loop tasks will not run");
+  }
+  bootMark(BootStage::SETUP_DONE);
+#if CFG_DUTY_CYCLE
+  dutyCycleRun();
+#endif
 }
 
-// Contract: called frequently from the Arduino loop; must remain non-blocking.
+// Contract: called repeatedly from the Arduino loop. Tasks must not block; the
+// pass itself ends blocked in loop_events_wait() until the next release or event.
 void appLoop()
 {
+  const uint32_t passStartUs = micros();
   const uint32_t now = millis();
   g_state.uptime_seconds = now / 1000u;
-  for (LoopWindow &w : g_windows)
-  {
-    runWindow(w, now);
-  }
+  const uint32_t idleMs = sched_runOnce();
 
-  if (!s_goodBootMarked &&
-      !g_state.safe_mode &&
-      g_state.bad_boot_streak > 0u &&
-      now >= (uint32_t)CFG_CRASH_GOOD_BOOT_AFTER_MS)
+  if (now >= (uint32_t)CFG_CRASH_GOOD_BOOT_AFTER_MS)
   {
-    g_state.bad_boot_streak = 0u;
-    storage_saveBadBootStreak(0u);
-    g_state.last_good_boot_ts = g_state.ts;
-    storage_saveGoodBootTs(g_state.last_good_boot_ts);
-    g_state.last_stable_boot = g_state.boot_count;
-    g_state.crash_window_boots = 0u;
-    g_state.crash_window_bad = 0u;
-    g_state.crash_loop = false;
-    strncpy(g_state.crash_loop_reason, "stable_runtime", sizeof(g_state.crash_loop_reason));
-    g_state.crash_loop_reason[sizeof(g_state.crash_loop_reason) - 1] = '\0';
-    LOG_INFO(LogDomain::SYSTEM, "Good boot confirmed: bad_boot_streak reset, last_good_boot_ts=%lu",
-             (unsigned long)g_state.last_good_boot_ts);
-    s_goodBootMarked = true;
-    mqtt_requestStatePublish();
+    confirmGoodBoot();
   }
+
+  storage_tick();
+  nvs_wear_tick();
+  profiler_loopPass(micros() - passStartUs);
+
+  // Block until the next release or until a producer signals work; a pass
+  // with work already due only collects pending events.
+  const uint32_t waitMs = (idleMs < CFG_SCHED_MAX_IDLE_MS) ? idleMs : CFG_SCHED_MAX_IDLE_MS;
+  dispatchLoopEvents(loop_events_wait(waitMs));
 }
 
 // -----------------------------------------------------------------------------
@@ -13,6 +13,8 @@
 #include "commands.h"
 #include "logger.h"
 #include "domain_strings.h"
+#include "boot_trace.h"
+#include "loop_events.h"
 
 #ifdef __has_include
 #if __has_include("config.h")
@@ -33,6 +35,7 @@ static PubSubClient mqtt(wifiClient);
 static MqttConfig s_cfg{};
 static CommandHandlerFn s_cmdHandler = nullptr;
 static bool s_haDiscoveryBegun = false;
+static bool s_discoveryOnConnect = true;
 
 bool mqtt_publishRaw(const char *topic, const char *payload, bool retained)
 {
@@ -44,6 +47,15 @@ static bool s_initialized = false;
 static bool s_statePublishRequested = true;
 static portMUX_TYPE s_statePublishMux = portMUX_INITIALIZER_UNLOCKED;
 
+// Sets the flag without waking the loop; used when a request stays pending
+// until the next regular MQTT pass (retry / publish interval).
+static void mqtt_markStatePublishPending()
+{
+    portENTER_CRITICAL(&s_statePublishMux);
+    s_statePublishRequested = true;
+    portEXIT_CRITICAL(&s_statePublishMux);
+}
+
 struct Topics
 {
     char state[96];
@@ -342,6 +354,7 @@ static void mqttCallback(char *topic, byte *payload, unsigned int length)
     // Our logger may publish over MQTT; doing that inside the callback can cause
     // confusing re-entrancy / buffer reuse issues. We already copied the payload.
     s_cmdHandler(cmdBuf, length);
+    loop_events_signal(LOOP_EVENT_MQTT_RX);
 
     // From here on, we only log using the copied buffer.
 
@@ -534,6 +547,7 @@ static bool mqtt_ensureConnected()
                                     s_cfg.host, s_cfg.port, s_cfg.clientId, authMode);
                 }
             }
+            boot_trace_mark("mqtt_connect_begin");
             const bool ok = mqtt.connect(
                 s_cfg.clientId,
                 s_cfg.user,
@@ -541,6 +555,7 @@ static bool mqtt_ensureConnected()
                 s_topics.avail, 0, true, AVAIL_OFFLINE);
 
             s_lastAttemptMs = now;
+            boot_trace_mark(ok ? "mqtt_connected" : "mqtt_connect_failed");
 
             if (ok)
             {
@@ -603,8 +618,11 @@ static bool mqtt_ensureConnected()
                         LOG_DEBUG(LogDomain::MQTT, "MQTT online published topic=%s retained=true", s_topics.avail);
                     }
                 }
-                HaDiscoveryResult discResult = ha_discovery_publishAll();
-                mqtt_handleDiscoveryResult(discResult, false);
+                if (s_discoveryOnConnect)
+                {
+                    HaDiscoveryResult discResult = ha_discovery_publishAll();
+                    mqtt_handleDiscoveryResult(discResult, false);
+                }
 
                 if (mqtt_devLogsEnabled())
                 {
@@ -690,7 +708,7 @@ static bool publishState(const DeviceState &state)
     if (!mqtt.connected())
         return false;
 
-    static char buf[2048]; // sized to fit expanded state payload
+    static char buf[3072]; // sized to fit expanded state payload (incl. ota.stats, config.quality)
     StateJsonDiag diag{};
     const StateJsonError jsonErr = buildStateJson(state, buf, sizeof(buf), &diag);
     if (jsonErr != StateJsonError::OK)
@@ -732,6 +750,10 @@ static bool publishState(const DeviceState &state)
                     "Publish state topic=%s retained=%s bytes=%u", s_topics.state, retained ? "true" : "false", (unsigned)payloadLen);
     if (ok)
     {
+        if (s_lastStatePublishMs == 0)
+        {
+            boot_trace_mark("mqtt_first_state");
+        }
         publishOtaShadowTopics(state);
         s_lastStatePublishMs = millis();
     }
@@ -798,7 +820,7 @@ void mqtt_begin(const MqttConfig &cfg, CommandHandlerFn cmdHandler)
     mqtt.setServer(cfg.host, cfg.port);
     mqtt.setKeepAlive(30);
     mqtt.setSocketTimeout(5);
-    mqtt.setBufferSize(2048);
+    mqtt.setBufferSize(3072);
     mqtt.setCallback(mqttCallback);
     s_initialized = true;
 
@@ -852,21 +874,20 @@ void mqtt_tick(const DeviceState &state)
         if (!publishState(state) && requested)
         {
             // Retry on next loop if this explicit request failed.
-            mqtt_requestStatePublish();
+            mqtt_markStatePublishPending();
         }
     }
     else if (requested)
     {
         // Keep explicit requests pending until publish interval permits sending.
-        mqtt_requestStatePublish();
+        mqtt_markStatePublishPending();
     }
 }
 
 void mqtt_requestStatePublish()
 {
-    portENTER_CRITICAL(&s_statePublishMux);
-    s_statePublishRequested = true;
-    portEXIT_CRITICAL(&s_statePublishMux);
+    mqtt_markStatePublishPending();
+    loop_events_signal(LOOP_EVENT_STATE_PUBLISH);
 }
 
 bool mqtt_takeStatePublishRequested()
@@ -912,3 +933,24 @@ bool mqtt_isConnected()
 {
     return mqtt.connected();
 }
+
+void mqtt_setDiscoveryOnConnect(bool enabled)
+{
+    s_discoveryOnConnect = enabled;
+}
+
+bool mqtt_publishStateNow(const DeviceState &state)
+{
+    return publishState(state);
+}
+
+void mqtt_disconnect()
+{
+    if (mqtt.connected())
+    {
+        // Clean DISCONNECT: the broker drops the session without firing the
+        // offline will, so the retained "online" stays for a sleeping device.
+        mqtt.disconnect();
+    }
+    s_lastConnected = false;
+}
@@ -0,0 +1,345 @@
+#include "nvs_wear.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_partition.h>
+#include <string.h>
+#include "logger.h"
+
+namespace
+{
+constexpr const char kNamespace[] = "nvs_wear";
+constexpr const char kKeyTotals[] = "totals";
+constexpr uint16_t kTotalsVersion = 1;
+
+// NVS layout: 4 KB pages of 126 x 32-byte entries, one page kept free for GC.
+constexpr uint32_t kNvsPageBytes = 4096u;
+constexpr uint32_t kNvsEntriesPerPage = 126u;
+constexpr uint32_t kNvsEntryBytes = 32u;
+constexpr uint32_t kNvsDefaultPartitionBytes = 0x5000u;
+
+struct NvsWearTotals
+{
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t writes;
+    uint32_t entries;
+    uint32_t bytes;
+    uint32_t uptimeS;
+};
+
+struct NvsWearKey
+{
+    char ns[16];
+    char key[16];
+    uint32_t writes;
+    uint32_t bytes;
+};
+} // namespace
+
+static NvsWearTotals s_base{};
+static NvsWearKey s_keys[CFG_NVS_WEAR_KEYS + 1]; // last slot is the "*" overflow bucket
+static uint32_t s_bootWrites = 0;
+static uint32_t s_bootEntries = 0;
+static uint32_t s_bootBytes = 0;
+static uint32_t s_lastPersistMs = 0;
+static uint32_t s_partitionBytes = 0;
+static portMUX_TYPE s_wearMux = portMUX_INITIALIZER_UNLOCKED;
+static WearPreferences s_prefs;
+static bool s_begun = false;
+
+static uint16_t wear_entriesFor(size_t len, bool variable)
+{
+    if (!variable)
+    {
+        return 1u;
+    }
+    // Blob: index entry + data header + payload entries.
+    return (uint16_t)(2u + (len + kNvsEntryBytes - 1u) / kNvsEntryBytes);
+}
+
+// NVS compares a put with the stored item and leaves an identical one in place,
+// so only puts that change the value are counted. `unchanged` is sampled by
+// the caller before the put goes through.
+static size_t wear_note(const char *ns, const char *key, size_t written, bool variable, bool unchanged)
+{
+    if (written > 0u && !unchanged)
+    {
+        nvs_wear_note(ns, key, written, wear_entriesFor(written, variable));
+    }
+    return written;
+}
+
+bool WearPreferences::begin(const char *name, bool readOnly)
+{
+    strncpy(_ns, name ? name : "", sizeof(_ns));
+    _ns[sizeof(_ns) - 1] = '\0';
+    return Preferences::begin(name, readOnly);
+}
+
+size_t WearPreferences::putBool(const char *key, bool value)
+{
+    const bool unchanged = isKey(key) && getBool(key, !value) == value;
+    return wear_note(_ns, key, Preferences::putBool(key, value), false, unchanged);
+}
+
+size_t WearPreferences::putUChar(const char *key, uint8_t value)
+{
+    const bool unchanged = isKey(key) && getUChar(key, (uint8_t)~value) == value;
+    return wear_note(_ns, key, Preferences::putUChar(key, value), false, unchanged);
+}
+
+size_t WearPreferences::putInt(const char *key, int32_t value)
+{
+    const bool unchanged = isKey(key) && getInt(key, ~value) == value;
+    return wear_note(_ns, key, Preferences::putInt(key, value), false, unchanged);
+}
+
+size_t WearPreferences::putUInt(const char *key, uint32_t value)
+{
+    const bool unchanged = isKey(key) && getUInt(key, ~value) == value;
+    return wear_note(_ns, key, Preferences::putUInt(key, value), false, unchanged);
+}
+
+size_t WearPreferences::putFloat(const char *key, float value)
+{
+    // Preferences stores a float as a 4-byte blob.
+    const bool unchanged = blobUnchanged(key, &value, sizeof(value));
+    return wear_note(_ns, key, Preferences::putFloat(key, value), true, unchanged);
+}
+
+size_t WearPreferences::putBytes(const char *key, const void *value, size_t len)
+{
+    const bool unchanged = blobUnchanged(key, value, len);
+    return wear_note(_ns, key, Preferences::putBytes(key, value, len), true, unchanged);
+}
+
+bool WearPreferences::blobUnchanged(const char *key, const void *value, size_t len)
+{
+    uint8_t stored[CFG_NVS_WEAR_COMPARE_BYTES];
+    if (value == nullptr || len == 0u || len > sizeof(stored) || !isKey(key))
+    {
+        return false;
+    }
+    return getBytesLength(key) == len && getBytes(key, stored, len) == len && memcmp(stored, value, len) == 0;
+}
+
+bool WearPreferences::remove(const char *key)
+{
+    const bool ok = Preferences::remove(key);
+    if (ok)
+    {
+        // Erasing only flips entry state bits; no new entries are consumed.
+        nvs_wear_note(_ns, key, 0u, 0u);
+    }
+    return ok;
+}
+
+bool WearPreferences::clear()
+{
+    const bool ok = Preferences::clear();
+    if (ok)
+    {
+        nvs_wear_note(_ns, "*clear", 0u, 0u);
+    }
+    return ok;
+}
+
+void nvs_wear_note(const char *ns, const char *key, size_t bytes, uint16_t entries)
+{
+    const char *nsStr = ns ? ns : "";
+    const char *keyStr = key ? key : "";
+    portENTER_CRITICAL(&s_wearMux);
+    s_bootWrites++;
+    s_bootEntries += entries;
+    s_bootBytes += (uint32_t)bytes;
+
+    NvsWearKey *slot = &s_keys[CFG_NVS_WEAR_KEYS];
+    for (size_t i = 0; i < CFG_NVS_WEAR_KEYS; ++i)
+    {
+        NvsWearKey &k = s_keys[i];
+        if (k.key[0] == '\0')
+        {
+            strncpy(k.ns, nsStr, sizeof(k.ns) - 1u);
+            strncpy(k.key, keyStr, sizeof(k.key) - 1u);
+            slot = &k;
+            break;
+        }
+        if (strcmp(k.key, keyStr) == 0 && strcmp(k.ns, nsStr) == 0)
+        {
+            slot = &k;
+            break;
+        }
+    }
+    slot->writes++;
+    slot->bytes += (uint32_t)bytes;
+    portEXIT_CRITICAL(&s_wearMux);
+}
+
+void nvs_wear_begin()
+{
+    if (s_begun)
+    {
+        return;
+    }
+    strncpy(s_keys[CFG_NVS_WEAR_KEYS].key, "*", sizeof(s_keys[CFG_NVS_WEAR_KEYS].key));
+
+    const esp_partition_t *part =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS, nullptr);
+    s_partitionBytes = part ? part->size : kNvsDefaultPartitionBytes;
+
+    if (!s_prefs.begin(kNamespace, false))
+    {
+        LOG_WARN(LogDomain::CONFIG, "NVS wear: begin failed namespace=%s", kNamespace);
+        return;
+    }
+    s_begun = true;
+
+    NvsWearTotals stored{};
+    if (s_prefs.getBytesLength(kKeyTotals) == sizeof(stored) &&
+        s_prefs.getBytes(kKeyTotals, &stored, sizeof(stored)) == sizeof(stored) &&
+        stored.version == kTotalsVersion)
+    {
+        s_base = stored;
+    }
+    s_lastPersistMs = millis();
+}
+
+void nvs_wear_getSummary(NvsWearSummary &out)
+{
+    out = NvsWearSummary{};
+    portENTER_CRITICAL(&s_wearMux);
+    out.bootWrites = s_bootWrites;
+    out.bootEntries = s_bootEntries;
+    out.totalWrites = s_base.writes + s_bootWrites;
+    out.totalEntries = s_base.entries + s_bootEntries;
+    out.totalBytes = s_base.bytes + s_bootBytes;
+    portEXIT_CRITICAL(&s_wearMux);
+    out.totalUptimeS = s_base.uptimeS + millis() / 1000u;
+    out.partitionBytes = s_partitionBytes;
+
+    // Average over at least an hour so a fresh boot's burst does not dominate.
+    const uint32_t spanS = (out.totalUptimeS > 3600u) ? out.totalUptimeS : 3600u;
+    out.entriesPerDay = (uint32_t)(((uint64_t)out.totalEntries * 86400u) / spanS);
+
+    const uint32_t pages = s_partitionBytes / kNvsPageBytes;
+    const uint64_t budget =
+        (uint64_t)((pages > 1u) ? (pages - 1u) : 1u) * kNvsEntriesPerPage * (uint64_t)CFG_NVS_WEAR_ERASE_CYCLES;
+    const uint64_t remaining = (budget > out.totalEntries) ? (budget - out.totalEntries) : 0u;
+    if (out.entriesPerDay == 0u)
+    {
+        out.projectedYears = UINT32_MAX;
+    }
+    else
+    {
+        const uint64_t years = remaining / ((uint64_t)out.entriesPerDay * 365u);
+        out.projectedYears = (years > UINT32_MAX) ? UINT32_MAX : (uint32_t)years;
+    }
+}
+
+void nvs_wear_tick()
+{
+    if (!s_begun)
+    {
+        return;
+    }
+    const uint32_t now = millis();
+    if ((uint32_t)(now - s_lastPersistMs) < (uint32_t)CFG_NVS_WEAR_PERSIST_MS)
+    {
+        return;
+    }
+    s_lastPersistMs = now;
+
+    NvsWearSummary sum{};
+    nvs_wear_getSummary(sum);
+    NvsWearTotals totals{};
+    totals.version = kTotalsVersion;
+    totals.writes = sum.totalWrites + 1u; // count this persist itself
+    totals.entries = sum.totalEntries + wear_entriesFor(sizeof(totals), true);
+    totals.bytes = sum.totalBytes + (uint32_t)sizeof(totals);
+    totals.uptimeS = sum.totalUptimeS;
+    // Bypass the shim: the persist is already folded into the totals above.
+    if (static_cast<Preferences &>(s_prefs).putBytes(kKeyTotals, &totals, sizeof(totals)) == sizeof(totals))
+    {
+        portENTER_CRITICAL(&s_wearMux);
+        s_base.writes = totals.writes - s_bootWrites;
+        s_base.entries = totals.entries - s_bootEntries;
+        s_base.bytes = totals.bytes - s_bootBytes;
+        portEXIT_CRITICAL(&s_wearMux);
+    }
+}
+
+bool nvs_wear_buildJson(char *out, size_t outSize)
+{
+    if (!out || outSize == 0u)
+    {
+        return false;
+    }
+    NvsWearSummary sum{};
+    nvs_wear_getSummary(sum);
+
+    StaticJsonDocument<1536> doc;
+    doc["boot_writes"] = sum.bootWrites;
+    doc["boot_entries"] = sum.bootEntries;
+    doc["total_writes"] = sum.totalWrites;
+    doc["total_entries"] = sum.totalEntries;
+    doc["total_bytes"] = sum.totalBytes;
+    doc["uptime_s"] = sum.totalUptimeS;
+    doc["partition_bytes"] = sum.partitionBytes;
+    doc["entries_per_day"] = sum.entriesPerDay;
+    if (sum.projectedYears != UINT32_MAX)
+    {
+        doc["projected_years"] = sum.projectedYears;
+    }
+    JsonArray keys = doc.createNestedArray("keys");
+    NvsWearKey snapshot[CFG_NVS_WEAR_KEYS + 1];
+    portENTER_CRITICAL(&s_wearMux);
+    memcpy(snapshot, s_keys, sizeof(snapshot));
+    portEXIT_CRITICAL(&s_wearMux);
+    for (const NvsWearKey &k : snapshot)
+    {
+        if (k.key[0] == '\0' || k.writes == 0u)
+        {
+            continue;
+        }
+        JsonObject o = keys.createNestedObject();
+        o["ns"] = k.ns;
+        o["key"] = k.key;
+        o["writes"] = k.writes;
+        o["bytes"] = k.bytes;
+    }
+    if (doc.overflowed())
+    {
+        return false;
+    }
+    const size_t n = serializeJson(doc, out, outSize);
+    return n > 0u && n < outSize;
+}
+
+void nvs_wear_log()
+{
+    NvsWearSummary sum{};
+    nvs_wear_getSummary(sum);
+    LOG_INFO(LogDomain::CONFIG,
+             "NVS wear boot_writes=%lu boot_entries=%lu total_writes=%lu total_entries=%lu "
+             "uptime_s=%lu entries_per_day=%lu projected_years=%s%lu",
+             (unsigned long)sum.bootWrites,
+             (unsigned long)sum.bootEntries,
+             (unsigned long)sum.totalWrites,
+             (unsigned long)sum.totalEntries,
+             (unsigned long)sum.totalUptimeS,
+             (unsigned long)sum.entriesPerDay,
+             (sum.projectedYears == UINT32_MAX) ? ">" : "",
+             (unsigned long)((sum.projectedYears == UINT32_MAX) ? 999u : sum.projectedYears));
+    portENTER_CRITICAL(&s_wearMux);
+    NvsWearKey snapshot[CFG_NVS_WEAR_KEYS + 1];
+    memcpy(snapshot, s_keys, sizeof(snapshot));
+    portEXIT_CRITICAL(&s_wearMux);
+    for (const NvsWearKey &k : snapshot)
+    {
+        if (k.key[0] != '\0' && k.writes > 0u)
+        {
+            LOG_INFO(LogDomain::CONFIG, "NVS wear key %s/%s writes=%lu bytes=%lu",
+                     k.ns, k.key, (unsigned long)k.writes, (unsigned long)k.bytes);
+        }
+    }
+}
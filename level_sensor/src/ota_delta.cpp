@@ -0,0 +1,240 @@
+#include "ota_delta.h"
+#include <string.h>
+
+static constexpr uint8_t DELTA_OP_END = 0x00;
+static constexpr uint8_t DELTA_OP_COPY = 0x01;
+static constexpr uint8_t DELTA_OP_ADD = 0x02;
+static constexpr uint8_t DELTA_OP_DATA = 0x03;
+
+static inline uint32_t delta_readU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] |
+           ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static inline uint8_t delta_argBytes(uint8_t op)
+{
+    switch (op)
+    {
+    case DELTA_OP_COPY:
+    case DELTA_OP_ADD:
+        return 8u;
+    case DELTA_OP_DATA:
+        return 4u;
+    default:
+        return 0u;
+    }
+}
+
+static OtaDeltaResult delta_fail(OtaDeltaDecoder *dec, const char *error)
+{
+    dec->phase = OtaDeltaPhase::FAILED;
+    dec->error = error;
+    return OtaDeltaResult::ERROR;
+}
+
+// Validate op arguments against source/target bounds before any byte is produced.
+static bool delta_startOp(OtaDeltaDecoder *dec)
+{
+    uint32_t len = 0;
+    if (dec->op == DELTA_OP_DATA)
+    {
+        len = delta_readU32(dec->args);
+        dec->srcOffset = 0;
+    }
+    else
+    {
+        dec->srcOffset = delta_readU32(dec->args);
+        len = delta_readU32(dec->args + 4);
+        if (dec->srcOffset > dec->sourceSize || len > dec->sourceSize - dec->srcOffset)
+        {
+            dec->error = "delta_source_range";
+            return false;
+        }
+    }
+    if (len == 0u)
+    {
+        dec->error = "delta_empty_op";
+        return false;
+    }
+    if (len > dec->targetSize - dec->produced)
+    {
+        dec->error = "delta_target_overflow";
+        return false;
+    }
+    dec->remaining = len;
+    return true;
+}
+
+bool ota_delta_parseHeader(const uint8_t *buf, size_t len, OtaDeltaHeader *out)
+{
+    if (!buf || !out || len < OTA_DELTA_HEADER_BYTES)
+    {
+        return false;
+    }
+    if (memcmp(buf, "WTD1", 4) != 0)
+    {
+        return false;
+    }
+    out->targetSize = delta_readU32(buf + 4);
+    out->sourceSize = delta_readU32(buf + 8);
+    memcpy(out->sourceSha256, buf + 12, sizeof(out->sourceSha256));
+    return out->targetSize > 0u && out->sourceSize > 0u;
+}
+
+void ota_delta_begin(OtaDeltaDecoder *dec, const OtaDeltaHeader &hdr)
+{
+    if (!dec)
+    {
+        return;
+    }
+    *dec = OtaDeltaDecoder{};
+    dec->sourceSize = hdr.sourceSize;
+    dec->targetSize = hdr.targetSize;
+}
+
+OtaDeltaResult ota_delta_step(OtaDeltaDecoder *dec,
+                              const uint8_t *in,
+                              size_t inLen,
+                              size_t *inUsed,
+                              uint8_t *out,
+                              size_t outCap,
+                              size_t *outLen,
+                              OtaDeltaSourceRead readSource,
+                              void *ctx)
+{
+    size_t inPos = 0;
+    size_t outPos = 0;
+    OtaDeltaResult result = OtaDeltaResult::OK;
+
+    if (!dec || !inUsed || !outLen || !readSource || (inLen > 0u && !in) || (outCap > 0u && !out))
+    {
+        return OtaDeltaResult::ERROR;
+    }
+
+    for (;;)
+    {
+        if (dec->phase == OtaDeltaPhase::DONE)
+        {
+            result = OtaDeltaResult::DONE;
+            break;
+        }
+        if (dec->phase == OtaDeltaPhase::FAILED)
+        {
+            result = OtaDeltaResult::ERROR;
+            break;
+        }
+
+        if (dec->phase == OtaDeltaPhase::OPCODE)
+        {
+            if (inPos >= inLen)
+            {
+                result = OtaDeltaResult::NEED_INPUT;
+                break;
+            }
+            dec->op = in[inPos++];
+            dec->argLen = 0;
+            if (dec->op == DELTA_OP_END)
+            {
+                if (dec->produced != dec->targetSize)
+                {
+                    result = delta_fail(dec, "delta_size_mismatch");
+                    break;
+                }
+                dec->phase = OtaDeltaPhase::DONE;
+                continue;
+            }
+            if (delta_argBytes(dec->op) == 0u)
+            {
+                result = delta_fail(dec, "delta_bad_opcode");
+                break;
+            }
+            dec->phase = OtaDeltaPhase::ARGS;
+            continue;
+        }
+
+        if (dec->phase == OtaDeltaPhase::ARGS)
+        {
+            const uint8_t need = delta_argBytes(dec->op);
+            while (dec->argLen < need && inPos < inLen)
+            {
+                dec->args[dec->argLen++] = in[inPos++];
+            }
+            if (dec->argLen < need)
+            {
+                result = OtaDeltaResult::NEED_INPUT;
+                break;
+            }
+            if (!delta_startOp(dec))
+            {
+                result = delta_fail(dec, dec->error);
+                break;
+            }
+            dec->phase = OtaDeltaPhase::BODY;
+            continue;
+        }
+
+        // BODY: emit min(remaining, output room[, input available]) bytes.
+        if (outPos >= outCap)
+        {
+            result = OtaDeltaResult::OK;
+            break;
+        }
+        size_t chunk = outCap - outPos;
+        if (chunk > dec->remaining)
+        {
+            chunk = dec->remaining;
+        }
+        if (dec->op != DELTA_OP_COPY)
+        {
+            const size_t inAvail = inLen - inPos;
+            if (inAvail == 0u)
+            {
+                result = OtaDeltaResult::NEED_INPUT;
+                break;
+            }
+            if (chunk > inAvail)
+            {
+                chunk = inAvail;
+            }
+        }
+
+        uint8_t *dst = out + outPos;
+        if (dec->op == DELTA_OP_DATA)
+        {
+            memcpy(dst, in + inPos, chunk);
+            inPos += chunk;
+        }
+        else
+        {
+            if (!readSource(dec->srcOffset, dst, chunk, ctx))
+            {
+                result = delta_fail(dec, "delta_source_read");
+                break;
+            }
+            if (dec->op == DELTA_OP_ADD)
+            {
+                for (size_t i = 0; i < chunk; ++i)
+                {
+                    dst[i] = (uint8_t)(dst[i] + in[inPos + i]);
+                }
+                inPos += chunk;
+            }
+            dec->srcOffset += (uint32_t)chunk;
+        }
+
+        outPos += chunk;
+        dec->produced += (uint32_t)chunk;
+        dec->remaining -= (uint32_t)chunk;
+        if (dec->remaining == 0u)
+        {
+            dec->phase = OtaDeltaPhase::OPCODE;
+        }
+    }
+
+    *inUsed = inPos;
+    *outLen = outPos;
+    return result;
+}
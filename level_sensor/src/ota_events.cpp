@@ -6,6 +6,7 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 
+#include "loop_events.h"
 #include "mqtt_transport.h"
 #include "time_format.h"
 
@@ -20,6 +21,7 @@ enum class OtaEventType : uint8_t
     CLEAR_ACTIVE,
     SET_UPDATE_AVAILABLE,
     SET_LAST_SUCCESS_TS,
+    SET_STATS,
     REQUEST_PUBLISH
 };
 
@@ -69,6 +71,7 @@ struct OtaEvent
         {
             uint32_t ts;
         } lastSuccess;
+        OtaStats stats;
     } data;
 };
 
@@ -85,13 +88,16 @@ static bool pushEventDropOldest(const OtaEvent &ev)
     }
     if (xQueueSend(s_queue, &ev, 0) == pdTRUE)
     {
+        loop_events_signal(LOOP_EVENT_OTA);
         return true;
     }
 
     // Drop oldest event to preserve forward progress under bursty OTA updates.
     OtaEvent dropped{};
     (void)xQueueReceive(s_queue, &dropped, 0);
-    return xQueueSend(s_queue, &ev, 0) == pdTRUE;
+    const bool queued = xQueueSend(s_queue, &ev, 0) == pdTRUE;
+    loop_events_signal(LOOP_EVENT_OTA);
+    return queued;
 }
 
 bool ota_events_begin()
@@ -147,6 +153,7 @@ bool ota_events_pushProgress(uint8_t progress)
         s_progressCoalescedPending = false;
         s_progressCoalescedValue = 0;
         portEXIT_CRITICAL(&s_eventsMux);
+        loop_events_signal(LOOP_EVENT_OTA);
         return true;
     }
 
@@ -155,6 +162,7 @@ bool ota_events_pushProgress(uint8_t progress)
     s_progressCoalescedValue = progress;
     s_progressCoalescedPending = true;
     portEXIT_CRITICAL(&s_eventsMux);
+    loop_events_signal(LOOP_EVENT_OTA);
     return true;
 }
 
@@ -245,6 +253,14 @@ bool ota_events_pushLastSuccessTs(uint32_t ts)
     return pushEventDropOldest(ev);
 }
 
+bool ota_events_pushStats(const OtaStats &stats)
+{
+    OtaEvent ev{};
+    ev.type = OtaEventType::SET_STATS;
+    ev.data.stats = stats;
+    return pushEventDropOldest(ev);
+}
+
 bool ota_events_requestPublish()
 {
     OtaEvent ev{};
@@ -272,6 +288,8 @@ struct PendingApply
     bool updateAvailable = false;
     bool hasLastSuccessTs = false;
     uint32_t lastSuccessTs = 0;
+    bool hasStats = false;
+    OtaStats stats{};
     bool requestPublish = false;
 };
 
@@ -317,6 +335,10 @@ static void collectPending(PendingApply &pending, const OtaEvent &ev)
         pending.hasLastSuccessTs = true;
         pending.lastSuccessTs = ev.data.lastSuccess.ts;
         break;
+    case OtaEventType::SET_STATS:
+        pending.hasStats = true;
+        pending.stats = ev.data.stats;
+        break;
     case OtaEventType::REQUEST_PUBLISH:
         pending.requestPublish = true;
         break;
@@ -458,6 +480,10 @@ bool ota_events_drainAndApply(DeviceState *state)
     {
         (void)time_format::formatIsoUtc(pending.lastSuccessTs, state->ota_last_success_ts, sizeof(state->ota_last_success_ts));
     }
+    if (pending.hasStats)
+    {
+        state->ota.stats = pending.stats;
+    }
     if (pending.requestPublish)
     {
         mqtt_requestStatePublish();
@@ -0,0 +1,150 @@
+#include "ota_inflate.h"
+#include <string.h>
+
+#ifdef __has_include
+#if __has_include("config.h")
+#include "config.h"
+#endif
+#endif
+
+#if __has_include("esp32/rom/miniz.h")
+#include "esp32/rom/miniz.h"
+#else
+#include "rom/miniz.h"
+#endif
+
+static_assert((CFG_OTA_INFLATE_WINDOW_BYTES & (CFG_OTA_INFLATE_WINDOW_BYTES - 1u)) == 0u,
+              "CFG_OTA_INFLATE_WINDOW_BYTES must be a power of two");
+static_assert(CFG_OTA_INFLATE_WINDOW_BYTES >= 256u && CFG_OTA_INFLATE_WINDOW_BYTES <= 32768u,
+              "CFG_OTA_INFLATE_WINDOW_BYTES must be within the deflate window range");
+
+static tinfl_decompressor s_decomp;
+alignas(4) static uint8_t s_window[CFG_OTA_INFLATE_WINDOW_BYTES];
+static size_t s_writePos = 0;   // next tinfl output offset in s_window
+static size_t s_pendingPos = 0; // produced bytes not yet handed to the caller
+static size_t s_pendingLen = 0;
+static bool s_done = false;
+
+bool ota_inflate_isZlibHeader(const uint8_t *p, size_t len, uint32_t *windowBytes)
+{
+    if (!p || len < 2u)
+    {
+        return false;
+    }
+    const uint8_t cmf = p[0];
+    const uint8_t flg = p[1];
+    if ((cmf & 0x0Fu) != 8u || (cmf >> 4) > 7u)
+    {
+        return false;
+    }
+    if ((((uint32_t)cmf << 8) | flg) % 31u != 0u || (flg & 0x20u) != 0u)
+    {
+        return false; // bad check bits or preset dictionary
+    }
+    if (windowBytes)
+    {
+        *windowBytes = 1u << ((cmf >> 4) + 8u);
+    }
+    return true;
+}
+
+bool ota_inflate_begin(uint32_t windowBytes)
+{
+    if (windowBytes == 0u || windowBytes > (uint32_t)CFG_OTA_INFLATE_WINDOW_BYTES)
+    {
+        return false;
+    }
+    tinfl_init(&s_decomp);
+    s_writePos = 0;
+    s_pendingPos = 0;
+    s_pendingLen = 0;
+    s_done = false;
+    return true;
+}
+
+OtaInflateResult ota_inflate_step(const uint8_t *in,
+                                  size_t inLen,
+                                  size_t *inUsed,
+                                  uint8_t *out,
+                                  size_t outCap,
+                                  size_t *outLen)
+{
+    size_t inPos = 0;
+    size_t outPos = 0;
+    OtaInflateResult result = OtaInflateResult::OK;
+
+    if (!inUsed || !outLen || (inLen > 0u && !in) || (outCap > 0u && !out))
+    {
+        return OtaInflateResult::ERROR;
+    }
+
+    for (;;)
+    {
+        // tinfl writes contiguously up to the window end, so pending never wraps.
+        if (s_pendingLen > 0u)
+        {
+            size_t n = outCap - outPos;
+            if (n > s_pendingLen)
+            {
+                n = s_pendingLen;
+            }
+            memcpy(out + outPos, s_window + s_pendingPos, n);
+            outPos += n;
+            s_pendingPos += n;
+            s_pendingLen -= n;
+            if (s_pendingLen > 0u)
+            {
+                result = OtaInflateResult::OK;
+                break;
+            }
+        }
+        if (s_done)
+        {
+            result = OtaInflateResult::DONE;
+            break;
+        }
+        if (outPos >= outCap)
+        {
+            result = OtaInflateResult::OK;
+            break;
+        }
+
+        size_t inBytes = inLen - inPos;
+        size_t outBytes = sizeof(s_window) - s_writePos;
+        const tinfl_status status = tinfl_decompress(&s_decomp,
+                                                     in + inPos,
+                                                     &inBytes,
+                                                     s_window,
+                                                     s_window + s_writePos,
+                                                     &outBytes,
+                                                     TINFL_FLAG_PARSE_ZLIB_HEADER |
+                                                         TINFL_FLAG_COMPUTE_ADLER32 |
+                                                         TINFL_FLAG_HAS_MORE_INPUT);
+        inPos += inBytes;
+        s_pendingPos = s_writePos;
+        s_pendingLen = outBytes;
+        s_writePos = (s_writePos + outBytes) & (sizeof(s_window) - 1u);
+
+        if (status < TINFL_STATUS_DONE)
+        {
+            s_pendingLen = 0;
+            result = OtaInflateResult::ERROR;
+            break;
+        }
+        if (status == TINFL_STATUS_DONE)
+        {
+            s_done = true;
+            continue;
+        }
+        if (inBytes == 0u && outBytes == 0u)
+        {
+            // No progress: either starved, or tinfl refused input it was given.
+            result = (inPos >= inLen) ? OtaInflateResult::NEED_INPUT : OtaInflateResult::ERROR;
+            break;
+        }
+    }
+
+    *inUsed = inPos;
+    *outLen = outPos;
+    return result;
+}
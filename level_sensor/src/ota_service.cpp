@@ -1,6 +1,9 @@
 #include "ota_service.h"
 #include "ota_events.h"
 #include "ota_task.h"
+#include "ota_delta.h"
+#include "ota_inflate.h"
+#include "ota_tls.h"
 #include <WiFiClientSecure.h>
 #include "ota_ca_cert.h"
 #include "mbedtls/sha256.h"
@@ -21,12 +24,14 @@
 #include <stdarg.h>
 #include "domain_strings.h"
 #include "mqtt_transport.h"
+#include "profiler.h"
 #include "storage_nvs.h"
 #include "time_format.h"
 #include "wifi_provisioning.h"
 #include "semver.h"
 #include "version.h"
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <esp_heap_caps.h>
 
 #ifdef __has_include
@@ -56,6 +61,9 @@
 #ifndef CFG_OTA_HTTP_READ_TIMEOUT_MS
 #define CFG_OTA_HTTP_READ_TIMEOUT_MS 10000u
 #endif
+#ifndef CFG_OTA_PIPE_STUCK_MS
+#define CFG_OTA_PIPE_STUCK_MS 20000u
+#endif
 #ifndef CFG_OTA_HTTP_MAX_RETRIES
 #define CFG_OTA_HTTP_MAX_RETRIES 3u
 #endif
@@ -94,6 +102,35 @@
 #define CFG_OTA_ANSI_COLORS 1
 #endif
 #endif
+// Download pipeline: the OTA task fills one buffer from the TLS stream while the
+// writer task hashes + flashes the previous one. Buffers are sector-sized so each
+// esp_ota_write covers whole flash pages.
+#ifndef CFG_OTA_STREAM_BUF_BYTES
+#define CFG_OTA_STREAM_BUF_BYTES 4096u
+#endif
+#ifndef CFG_OTA_STREAM_BUF_COUNT
+#define CFG_OTA_STREAM_BUF_COUNT 2u
+#endif
+#ifndef CFG_OTA_WRITER_TASK_STACK_BYTES
+#define CFG_OTA_WRITER_TASK_STACK_BYTES 6144u
+#endif
+// Zero-read gaps shorter than this are normal tick spacing, not stalls.
+#ifndef CFG_OTA_STREAM_STALL_MS
+#define CFG_OTA_STREAM_STALL_MS 250u
+#endif
+
+// Patch bytes staged between the stream and the delta decoder per read.
+#ifndef CFG_OTA_DELTA_IN_BYTES
+#define CFG_OTA_DELTA_IN_BYTES 1024u
+#endif
+
+// Compressed bytes staged between the socket and the inflater per read.
+#ifndef CFG_OTA_STREAM_IN_BYTES
+#define CFG_OTA_STREAM_IN_BYTES 1024u
+#endif
+
+// Manifests carry an optional delta[] list, so leave room beyond version/url/sha256.
+static constexpr size_t OTA_MANIFEST_DOC_BYTES = 1536u;
 
 static constexpr uint8_t MAX_OTA_RETRIES = 3u;
 static constexpr uint32_t BASE_RETRY_DELAY_MS = 5000u;
@@ -104,6 +141,13 @@ static bool s_started = false;
 static DeviceState *s_serviceState = nullptr;
 static bool s_bootDiagPublished = false;
 
+enum class OtaStreamMode : uint8_t
+{
+    UNKNOWN = 0,
+    RAW,
+    INFLATE,
+};
+
 struct PullOtaJob
 {
     bool active = false;
@@ -115,13 +159,14 @@ struct PullOtaJob
     char version[16] = {0};
     char url[256] = {0};
     char sha256[65] = {0};
+    char altUrl[256] = {0};
 
     uint32_t lastProgressMs = 0;
     uint32_t lastReportMs = 0;
     uint32_t lastDiagMs = 0;
     uint32_t lastWriteLogMs = 0;
     uint32_t bytesTotal = 0;
-    uint32_t bytesWritten = 0;
+    uint32_t bytesWritten = 0; // bytes received from the stream (patch bytes in delta mode)
     uint32_t bytesAtLastWriteLog = 0;
     uint32_t progressLastBytesPrinted = 0;
     int16_t progressLastPctPrinted = -1;
@@ -140,9 +185,43 @@ struct PullOtaJob
     uint8_t retryCount = 0;
     uint32_t nextRetryAtMs = 0;
 
+    // Stream pipeline state + per-attempt throughput stats (owned by OTA task).
+    int8_t pipeFillIdx = -1;
+    uint32_t pipeFillLen = 0;
+    uint32_t downloadStartMs = 0;
+    uint32_t downloadEndMs = 0;
+    uint32_t netStallMs = 0;
+    uint16_t netStallCount = 0;
+    uint32_t flashStallMs = 0;
+    uint32_t rateWindowStartMs = 0;
+    uint32_t rateWindowBytes = 0;
+    uint32_t minKbps = UINT32_MAX;
+    uint32_t verifyStartMs = 0;
+
+    // Phase timings/retry totals for the whole job, published under ota.stats.
+    OtaStats stats{};
+
+    // Alternate source (delta patch / compressed image) with fallback to url.
+    bool altActive = false;
+
+    // Stream decoding: raw passthrough or zlib inflate, picked from the first bytes.
+    OtaStreamMode streamMode = OtaStreamMode::UNKNOWN;
+    uint32_t stageLen = 0;
+    uint32_t stagePos = 0;
+    bool inflateDone = false;
+    uint32_t decodedBytes = 0;
+    const char *streamErr = nullptr;
+
+    // Delta mode: the decoded stream is a patch against the running partition.
+    bool deltaActive = false;
+    OtaDeltaDecoder delta{};
+    const esp_partition_t *deltaSource = nullptr;
+    uint32_t deltaInLen = 0;
+    uint32_t deltaInPos = 0;
+
     // Streaming object
     HTTPClient http;
-    WiFiClientSecure client;
+    OtaTlsClient client;
 
     mbedtls_sha256_context shaCtx;
     bool shaInit = false;
@@ -155,6 +234,23 @@ struct PullOtaJob
 
 static PullOtaJob g_job;
 
+struct OtaPipeChunk
+{
+    uint8_t idx = 0;
+    uint32_t len = 0;
+};
+
+alignas(4) static uint8_t s_pipeBuf[CFG_OTA_STREAM_BUF_COUNT][CFG_OTA_STREAM_BUF_BYTES];
+static QueueHandle_t s_pipeFreeQ = nullptr;
+static QueueHandle_t s_pipeFullQ = nullptr;
+static TaskHandle_t s_pipeWriterTask = nullptr;
+static volatile bool s_pipeDiscard = false;
+static volatile esp_err_t s_pipeErr = ESP_OK;
+static volatile uint32_t s_pipeBytesFlashed = 0;
+static volatile uint32_t s_pipeFlashUs = 0;
+static uint8_t s_deltaIn[CFG_OTA_DELTA_IN_BYTES];
+static uint8_t s_streamIn[CFG_OTA_STREAM_IN_BYTES];
+
 static const char *s_lastTlsTrustMode = "none";
 static int s_lastTlsErrCode = 0;
 static char s_lastTlsErrMsg[128] = {0};
@@ -259,6 +355,28 @@ static bool ota_extractUrlHost(const char *url, char *out, size_t outLen)
     return i > 0;
 }
 
+static uint16_t ota_urlPort(const char *url)
+{
+    const bool https = url && strncmp(url, "https://", 8) == 0;
+    const uint16_t defaultPort = https ? 443u : 80u;
+    const char *host = url ? strstr(url, "://") : nullptr;
+    if (!host)
+    {
+        return defaultPort;
+    }
+    host += 3;
+    while (*host != '\0' && *host != '/' && *host != ':' && *host != '?' && *host != '#')
+    {
+        ++host;
+    }
+    if (*host != ':')
+    {
+        return defaultPort;
+    }
+    const long port = strtol(host + 1, nullptr, 10);
+    return (port > 0 && port <= 65535) ? (uint16_t)port : defaultPort;
+}
+
 static bool ota_manifestUrlHostTrusted(const char *url)
 {
     char host[128] = {0};
@@ -1361,6 +1479,18 @@ static inline void ota_prepareTlsClient(WiFiClientSecure &client, const char *ph
 #endif
 }
 
+// Handshakes a request needed (first host + redirect hops) and how many resumed.
+static inline void ota_logTlsHandshakes(const char *phase, const OtaTlsClient &client)
+{
+    const OtaTlsHandshakeStats &hs = client.handshakeStats();
+    ota_trace("tls_handshakes", "phase=%s count=%u resumed=%u total_ms=%lu last_ms=%lu",
+              phase ? phase : "",
+              (unsigned int)hs.handshakes,
+              (unsigned int)hs.resumed,
+              (unsigned long)hs.totalMs,
+              (unsigned long)hs.lastMs);
+}
+
 bool ota_isBusy()
 {
     return g_job.active || ota_taskHasPendingWork();
@@ -1373,6 +1503,7 @@ void ota_begin(DeviceState *state, const char *hostName, const char *password)
     s_password = password;
     s_started = false;
     s_bootDiagPublished = false;
+    ota_tls_begin();
     if (!ota_taskBegin(state))
     {
         LOG_ERROR(LogDomain::OTA, "Failed to start otaTask worker");
@@ -1643,6 +1774,10 @@ static bool ota_scheduleRetry(DeviceState *state, const char *reason)
     }
 
     g_job.netRetryCount++;
+    if (g_job.stats.net_retries < UINT8_MAX)
+    {
+        g_job.stats.net_retries++;
+    }
     uint32_t backoffMs = (uint32_t)CFG_OTA_HTTP_RETRY_BASE_MS * (uint32_t)g_job.netRetryCount;
     if (backoffMs > (uint32_t)CFG_OTA_HTTP_RETRY_MAX_BACKOFF_MS)
     {
@@ -1678,8 +1813,632 @@ static void ota_markFailed(DeviceState *state, const char *reason)
     ota_requestPublish();
 }
 
+// Writer side of the download pipeline: hashes and flashes filled buffers in
+// order, then hands them back. Flash erase stalls block here instead of in the
+// TLS read loop. After the first error, buffers are returned unwritten.
+static void ota_pipeWriterTask(void * /*arg*/)
+{
+    const int profSlot = profiler_register("otaWriter"); // one sample per chunk
+    for (;;)
+    {
+        OtaPipeChunk chunk{};
+        if (xQueueReceive(s_pipeFullQ, &chunk, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        if (!s_pipeDiscard && s_pipeErr == ESP_OK)
+        {
+            const uint32_t startUs = micros();
+            const uint8_t *data = s_pipeBuf[chunk.idx];
+            if (g_job.shaInit)
+            {
+                mbedtls_sha256_update(&g_job.shaCtx, data, chunk.len);
+            }
+            const esp_err_t err = esp_ota_write(g_job.otaHandle, data, chunk.len);
+            if (err != ESP_OK)
+            {
+                s_pipeErr = err;
+            }
+            else
+            {
+                s_pipeBytesFlashed += chunk.len;
+            }
+            const uint32_t elapsedUs = micros() - startUs;
+            s_pipeFlashUs += elapsedUs;
+            profiler_record(profSlot, elapsedUs);
+        }
+        (void)xQueueSend(s_pipeFreeQ, &chunk.idx, portMAX_DELAY);
+    }
+}
+
+static bool ota_pipeBegin()
+{
+    if (s_pipeWriterTask == nullptr)
+    {
+        s_pipeFreeQ = xQueueCreate((UBaseType_t)CFG_OTA_STREAM_BUF_COUNT, sizeof(uint8_t));
+        s_pipeFullQ = xQueueCreate((UBaseType_t)CFG_OTA_STREAM_BUF_COUNT, sizeof(OtaPipeChunk));
+        if (s_pipeFreeQ == nullptr || s_pipeFullQ == nullptr)
+        {
+            LOG_ERROR(LogDomain::OTA, "OTA pipeline queue create failed bufs=%u",
+                      (unsigned)CFG_OTA_STREAM_BUF_COUNT);
+            if (s_pipeFreeQ)
+            {
+                vQueueDelete(s_pipeFreeQ);
+                s_pipeFreeQ = nullptr;
+            }
+            if (s_pipeFullQ)
+            {
+                vQueueDelete(s_pipeFullQ);
+                s_pipeFullQ = nullptr;
+            }
+            return false;
+        }
+        for (uint8_t i = 0; i < (uint8_t)CFG_OTA_STREAM_BUF_COUNT; ++i)
+        {
+            (void)xQueueSend(s_pipeFreeQ, &i, 0);
+        }
+
+        // Same priority/core as otaTask so the reader yields to it whenever it waits.
+        BaseType_t created = pdFAIL;
+#if (CFG_OTA_TASK_CORE < 0)
+        created = xTaskCreate(ota_pipeWriterTask, "otaWriter",
+                              (uint32_t)CFG_OTA_WRITER_TASK_STACK_BYTES, nullptr,
+                              (UBaseType_t)CFG_OTA_TASK_PRIORITY, &s_pipeWriterTask);
+#else
+        created = xTaskCreatePinnedToCore(ota_pipeWriterTask, "otaWriter",
+                                          (uint32_t)CFG_OTA_WRITER_TASK_STACK_BYTES, nullptr,
+                                          (UBaseType_t)CFG_OTA_TASK_PRIORITY, &s_pipeWriterTask,
+                                          (BaseType_t)CFG_OTA_TASK_CORE);
+#endif
+        if (created != pdPASS)
+        {
+            LOG_ERROR(LogDomain::OTA, "otaWriter create failed stack_bytes=%u",
+                      (unsigned)CFG_OTA_WRITER_TASK_STACK_BYTES);
+            s_pipeWriterTask = nullptr;
+            vQueueDelete(s_pipeFreeQ);
+            vQueueDelete(s_pipeFullQ);
+            s_pipeFreeQ = nullptr;
+            s_pipeFullQ = nullptr;
+            return false;
+        }
+#if CFG_OTA_DEV_LOGS
+        LOG_INFO(LogDomain::OTA, "otaWriter started bufs=%u buf_bytes=%u stack_bytes=%u",
+                 (unsigned)CFG_OTA_STREAM_BUF_COUNT,
+                 (unsigned)CFG_OTA_STREAM_BUF_BYTES,
+                 (unsigned)CFG_OTA_WRITER_TASK_STACK_BYTES);
+#endif
+    }
+
+    s_pipeDiscard = false;
+    s_pipeErr = ESP_OK;
+    s_pipeBytesFlashed = 0;
+    s_pipeFlashUs = 0;
+    g_job.pipeFillIdx = -1;
+    g_job.pipeFillLen = 0;
+    return true;
+}
+
+static bool ota_pipeIdle()
+{
+    if (s_pipeFreeQ == nullptr)
+    {
+        return true;
+    }
+    const UBaseType_t held = (g_job.pipeFillIdx >= 0) ? 1u : 0u;
+    return (uxQueueMessagesWaiting(s_pipeFreeQ) + held) >= (UBaseType_t)CFG_OTA_STREAM_BUF_COUNT;
+}
+
+static bool ota_pipeDrain(uint32_t timeoutMs)
+{
+    const uint32_t startMs = millis();
+    while (!ota_pipeIdle())
+    {
+        if ((uint32_t)(millis() - startMs) >= timeoutMs)
+        {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return true;
+}
+
+// Queue the partially/fully filled buffer for the writer (or give back an empty one).
+static void ota_pipeSubmitFill()
+{
+    if (g_job.pipeFillIdx < 0 || s_pipeFullQ == nullptr)
+    {
+        return;
+    }
+    const uint8_t idx = (uint8_t)g_job.pipeFillIdx;
+    if (g_job.pipeFillLen > 0)
+    {
+        OtaPipeChunk chunk{};
+        chunk.idx = idx;
+        chunk.len = g_job.pipeFillLen;
+        (void)xQueueSend(s_pipeFullQ, &chunk, portMAX_DELAY);
+    }
+    else
+    {
+        (void)xQueueSend(s_pipeFreeQ, &idx, portMAX_DELAY);
+    }
+    g_job.pipeFillIdx = -1;
+    g_job.pipeFillLen = 0;
+}
+
+// A writer that never went idle is most likely stuck inside esp_ota_write with
+// the SPI flash lock held. Deleting it could leave that lock taken, and the
+// esp_ota_abort / NVS stats write that follow a failed job would then block
+// forever. Fail the job in RAM only, touch no flash, and restart.
+static void ota_pipeWedgedRestart(DeviceState *state)
+{
+    LOG_ERROR(LogDomain::OTA, "otaWriter stuck after %lums in a flash write, restarting without saving",
+              (unsigned long)(CFG_OTA_HTTP_READ_TIMEOUT_MS + CFG_OTA_PIPE_STUCK_MS));
+    if (state)
+    {
+        ota_setStatus(state, OtaStatus::ERROR);
+        ota_setResult(state, "error", "flash_writer_stuck");
+        ota_setFlat(state, "failed", state->ota.progress, "flash_writer_stuck", state->ota.version, true);
+    }
+    delay(250);
+    Serial.flush();
+    ESP.restart();
+}
+
+// Drop any queued data and wait for the writer to go idle before the OTA handle
+// or SHA context is torn down. Discard stays set until the writer is idle; a
+// writer still busy after the grace period restarts the device (see above), so
+// on return the writer no longer touches g_job.
+static void ota_pipeReset(DeviceState *state)
+{
+    if (s_pipeFreeQ == nullptr)
+    {
+        g_job.pipeFillIdx = -1;
+        g_job.pipeFillLen = 0;
+        return;
+    }
+    s_pipeDiscard = true;
+    g_job.pipeFillLen = 0;
+    ota_pipeSubmitFill();
+    if (ota_pipeDrain((uint32_t)CFG_OTA_HTTP_READ_TIMEOUT_MS))
+    {
+        s_pipeDiscard = false;
+        return;
+    }
+    ota_logWarnMaybeDeferred("OTA pipeline drain timeout free=%u/%u",
+                             (unsigned)uxQueueMessagesWaiting(s_pipeFreeQ),
+                             (unsigned)CFG_OTA_STREAM_BUF_COUNT);
+    if (ota_pipeDrain((uint32_t)CFG_OTA_PIPE_STUCK_MS))
+    {
+        s_pipeDiscard = false;
+        return;
+    }
+    ota_pipeWedgedRestart(state);
+}
+
+static void ota_noteStreamData()
+{
+    if (g_job.zeroReadStreak > 0 && g_job.noDataSinceMs != 0)
+    {
+        const uint32_t gapMs = millis() - g_job.noDataSinceMs;
+        if (gapMs >= (uint32_t)CFG_OTA_STREAM_STALL_MS)
+        {
+            g_job.netStallMs += gapMs;
+            if (g_job.netStallCount < UINT16_MAX)
+            {
+                g_job.netStallCount++;
+            }
+        }
+    }
+    g_job.zeroReadStreak = 0;
+    g_job.noDataSinceMs = 0;
+}
+
+static void ota_logStreamStats(const char *phase)
+{
+    const uint32_t endMs = (g_job.downloadEndMs != 0u) ? g_job.downloadEndMs : millis();
+    const uint32_t elapsedMs = (g_job.downloadStartMs != 0u) ? (endMs - g_job.downloadStartMs) : 0u;
+    const uint32_t kbps = (elapsedMs > 0u)
+                              ? (uint32_t)(((uint64_t)g_job.bytesWritten * 1000u) / ((uint64_t)elapsedMs * 1024u))
+                              : 0u;
+    char sizeBuf[24] = {0};
+    ota_formatSizeCompact(g_job.bytesWritten, sizeBuf, sizeof(sizeBuf));
+    ota_progressEnsureLineBreak();
+    LOG_INFO(LogDomain::OTA,
+             "Download %s: %s in %lu.%01lus (%lu kB/s) net_stalls=%u/%lums flash_wait=%lums flash_busy=%lums",
+             phase ? phase : "stats",
+             sizeBuf,
+             (unsigned long)(elapsedMs / 1000u),
+             (unsigned long)((elapsedMs % 1000u) / 100u),
+             (unsigned long)kbps,
+             (unsigned int)g_job.netStallCount,
+             (unsigned long)g_job.netStallMs,
+             (unsigned long)g_job.flashStallMs,
+             (unsigned long)(s_pipeFlashUs / 1000u));
+}
+
+static void ota_sampleThroughput(uint32_t nowMs)
+{
+    if (g_job.rateWindowStartMs == 0u)
+    {
+        g_job.rateWindowStartMs = nowMs;
+        g_job.rateWindowBytes = g_job.bytesWritten;
+        return;
+    }
+    const uint32_t elapsedMs = nowMs - g_job.rateWindowStartMs;
+    if (elapsedMs < 1000u)
+    {
+        return;
+    }
+    const uint32_t windowBytes = g_job.bytesWritten - g_job.rateWindowBytes;
+    const uint32_t kbps = (uint32_t)(((uint64_t)windowBytes * 1000u) / ((uint64_t)elapsedMs * 1024u));
+    if (kbps < g_job.minKbps)
+    {
+        g_job.minKbps = kbps;
+    }
+    g_job.rateWindowStartMs = nowMs;
+    g_job.rateWindowBytes = g_job.bytesWritten;
+}
+
+// Fold this attempt's handshakes (pre-connect + redirect hops) into the job stats.
+static void ota_noteTlsHandshakes()
+{
+    const OtaTlsHandshakeStats &hs = g_job.client.handshakeStats();
+    const uint32_t total = (uint32_t)g_job.stats.tls_handshakes + hs.handshakes;
+    const uint32_t resumed = (uint32_t)g_job.stats.tls_resumed + hs.resumed;
+    g_job.stats.tls_handshakes = (total > 0xFFu) ? 0xFFu : (uint8_t)total;
+    g_job.stats.tls_resumed = (resumed > 0xFFu) ? 0xFFu : (uint8_t)resumed;
+    ota_logTlsHandshakes("firmware_download", g_job.client);
+    g_job.client.resetHandshakeStats();
+}
+
+// Fold the current attempt's stream counters into g_job.stats, then mirror to
+// state (via ota_events from the OTA task) and NVS so it survives the reboot.
+static void ota_publishStats(DeviceState *state)
+{
+    OtaStats &st = g_job.stats;
+    const uint32_t endMs = (g_job.downloadEndMs != 0u) ? g_job.downloadEndMs : millis();
+    st.download_ms = (g_job.downloadStartMs != 0u) ? (endMs - g_job.downloadStartMs) : 0u;
+    st.bytes = g_job.bytesWritten;
+    st.avg_kbps = (st.download_ms > 0u)
+                      ? (uint32_t)(((uint64_t)st.bytes * 1000u) / ((uint64_t)st.download_ms * 1024u))
+                      : 0u;
+    st.min_kbps = (g_job.minKbps != UINT32_MAX) ? g_job.minKbps : st.avg_kbps;
+    st.stall_ms = g_job.netStallMs;
+    st.stall_count = g_job.netStallCount;
+    st.retries = g_job.retryCount;
+
+#if CFG_OTA_DEV_LOGS
+    LOG_INFO(LogDomain::OTA,
+             "OTA stats dns=%lums tls=%lums first_byte=%lums download=%lums verify=%lums switch=%lums "
+             "bytes=%lu avg=%lukB/s min=%lukB/s stalls=%u/%lums net_retries=%u retries=%u "
+             "tls_handshakes=%u resumed=%u",
+             (unsigned long)st.dns_ms,
+             (unsigned long)st.tls_ms,
+             (unsigned long)st.first_byte_ms,
+             (unsigned long)st.download_ms,
+             (unsigned long)st.verify_ms,
+             (unsigned long)st.switch_ms,
+             (unsigned long)st.bytes,
+             (unsigned long)st.avg_kbps,
+             (unsigned long)st.min_kbps,
+             (unsigned int)st.stall_count,
+             (unsigned long)st.stall_ms,
+             (unsigned int)st.net_retries,
+             (unsigned int)st.retries,
+             (unsigned int)st.tls_handshakes,
+             (unsigned int)st.tls_resumed);
+#endif
+
+    if (ota_isInOtaTaskContext())
+    {
+        ota_events_pushStats(st);
+    }
+    else if (state)
+    {
+        state->ota.stats = st;
+    }
+    storage_saveOtaStats(st);
+}
+
+static void ota_streamReset()
+{
+    g_job.streamMode = OtaStreamMode::UNKNOWN;
+    g_job.stageLen = 0;
+    g_job.stagePos = 0;
+    g_job.inflateDone = false;
+    g_job.decodedBytes = 0;
+    g_job.streamErr = nullptr;
+}
+
+// Socket read capped at Content-Length. Counts network bytes and zero reads.
+static int ota_streamReadRaw(WiFiClient *stream, uint8_t *dst, size_t len)
+{
+    if (g_job.bytesWritten >= g_job.bytesTotal)
+    {
+        return 0;
+    }
+    if (len > (size_t)(g_job.bytesTotal - g_job.bytesWritten))
+    {
+        len = (size_t)(g_job.bytesTotal - g_job.bytesWritten);
+    }
+    const int avail = stream->available();
+    int n = 0;
+    if (avail > 0)
+    {
+        n = stream->read(dst, ((size_t)avail < len) ? (size_t)avail : len);
+    }
+    if (n <= 0)
+    {
+        if (g_job.zeroReadStreak == 0)
+            g_job.noDataSinceMs = millis();
+        if (g_job.zeroReadStreak < UINT8_MAX)
+            g_job.zeroReadStreak++;
+        return 0;
+    }
+    ota_noteStreamData();
+    g_job.bytesWritten += (uint32_t)n;
+    g_job.lastProgressMs = millis();
+    return n;
+}
+
+// Decoded bytes from the download: passthrough, or inflated when the body
+// starts with a zlib header. Returns 0 when nothing is available yet and -1 on
+// a decode error (reason in g_job.streamErr).
+static int ota_streamRead(WiFiClient *stream, uint8_t *dst, size_t len)
+{
+    if (g_job.streamMode == OtaStreamMode::UNKNOWN)
+    {
+        while (g_job.stageLen < 2u)
+        {
+            const int n = ota_streamReadRaw(stream, s_streamIn + g_job.stageLen, 2u - g_job.stageLen);
+            if (n <= 0)
+            {
+                return 0;
+            }
+            g_job.stageLen += (uint32_t)n;
+        }
+        uint32_t windowBytes = 0;
+        if (ota_inflate_isZlibHeader(s_streamIn, g_job.stageLen, &windowBytes))
+        {
+            if (!ota_inflate_begin(windowBytes))
+            {
+                g_job.streamErr = "inflate_window_too_large";
+                return -1;
+            }
+            g_job.streamMode = OtaStreamMode::INFLATE;
+        }
+        else
+        {
+            g_job.streamMode = OtaStreamMode::RAW;
+        }
+        ota_trace("stream_mode", "mode=%s window=%lu",
+                  g_job.streamMode == OtaStreamMode::INFLATE ? "zlib" : "raw",
+                  (unsigned long)windowBytes);
+    }
+
+    size_t produced = 0;
+    if (g_job.streamMode == OtaStreamMode::RAW)
+    {
+        if (g_job.stagePos < g_job.stageLen)
+        {
+            produced = g_job.stageLen - g_job.stagePos;
+            if (produced > len)
+                produced = len;
+            memcpy(dst, s_streamIn + g_job.stagePos, produced);
+            g_job.stagePos += (uint32_t)produced;
+        }
+        else
+        {
+            produced = (size_t)ota_streamReadRaw(stream, dst, len);
+        }
+    }
+    else
+    {
+        while (produced < len && !g_job.inflateDone)
+        {
+            if (g_job.stagePos >= g_job.stageLen)
+            {
+                if (g_job.bytesWritten >= g_job.bytesTotal)
+                {
+                    g_job.streamErr = "inflate_truncated";
+                    return -1;
+                }
+                const int n = ota_streamReadRaw(stream, s_streamIn, sizeof(s_streamIn));
+                if (n <= 0)
+                {
+                    break;
+                }
+                g_job.stageLen = (uint32_t)n;
+                g_job.stagePos = 0;
+            }
+            size_t inUsed = 0;
+            size_t outLen = 0;
+            const OtaInflateResult res = ota_inflate_step(s_streamIn + g_job.stagePos,
+                                                          g_job.stageLen - g_job.stagePos,
+                                                          &inUsed,
+                                                          dst + produced,
+                                                          len - produced,
+                                                          &outLen);
+            g_job.stagePos += (uint32_t)inUsed;
+            produced += outLen;
+            if (res == OtaInflateResult::ERROR)
+            {
+                g_job.streamErr = "inflate_failed";
+                return -1;
+            }
+            if (res == OtaInflateResult::DONE)
+            {
+                g_job.inflateDone = true;
+            }
+        }
+    }
+    g_job.decodedBytes += (uint32_t)produced;
+    return (int)produced;
+}
+
+static bool ota_streamEnded()
+{
+    if (g_job.streamMode == OtaStreamMode::INFLATE)
+    {
+        return g_job.inflateDone;
+    }
+    if (g_job.streamMode == OtaStreamMode::RAW)
+    {
+        return g_job.bytesWritten >= g_job.bytesTotal && g_job.stagePos >= g_job.stageLen;
+    }
+    return false;
+}
+
+static bool ota_deltaReadSource(uint32_t offset, uint8_t *dst, size_t len, void *ctx)
+{
+    const esp_partition_t *src = static_cast<const esp_partition_t *>(ctx);
+    return src != nullptr && esp_partition_read(src, offset, dst, len) == ESP_OK;
+}
+
+// Hash the first sourceSize bytes of the running partition and compare with the
+// patch header. Catches patches built against a different base before flashing.
+static bool ota_deltaSourceMatches(const OtaDeltaHeader &hdr)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (running == nullptr || hdr.sourceSize > running->size)
+    {
+        return false;
+    }
+
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    bool ok = true;
+    for (uint32_t off = 0; off < hdr.sourceSize;)
+    {
+        uint32_t n = hdr.sourceSize - off;
+        if (n > (uint32_t)sizeof(s_deltaIn))
+        {
+            n = (uint32_t)sizeof(s_deltaIn);
+        }
+        if (esp_partition_read(running, off, s_deltaIn, n) != ESP_OK)
+        {
+            ok = false;
+            break;
+        }
+        mbedtls_sha256_update(&ctx, s_deltaIn, n);
+        off += n;
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    if (!ok || memcmp(digest, hdr.sourceSha256, sizeof(digest)) != 0)
+    {
+        return false;
+    }
+    g_job.deltaSource = running;
+    return true;
+}
+
+// A bad delta/compressed download is not worth a retry slot: drop to the raw
+// image url and let the retry window in ota_tick tear down and restart
+// immediately. Without an alternate source this is a normal abort.
+static void ota_altFallback(DeviceState *state, const char *reason)
+{
+    if (!g_job.altActive)
+    {
+        ota_abort(state, reason);
+        return;
+    }
+    ota_progressEnsureLineBreak();
+    ota_trace("alt_fallback", "reason=%s", reason ? reason : "");
+    ota_logWarnMaybeDeferred("OTA %s unusable reason=%s; falling back to full image",
+                             g_job.deltaActive ? "delta" : "compressed image",
+                             reason ? reason : "");
+    g_job.altActive = false;
+    g_job.deltaActive = false;
+    g_job.altUrl[0] = '\0';
+    g_job.nextRetryAtMs = millis() + 1u;
+    if (state)
+    {
+        ota_recordError(state, reason);
+        ota_requestPublish();
+    }
+}
+
+// Step B in delta mode: stage decoded patch bytes and let the decoder
+// fill pipeline buffers. COPY ops produce output without reading the network,
+// so the budget counts output bytes. Returns a failure reason or nullptr.
+static const char *ota_deltaPump(WiFiClient *stream, size_t budget)
+{
+    size_t produced = 0;
+    while (produced < budget && !ota_delta_done(g_job.delta))
+    {
+        if (g_job.pipeFillIdx < 0)
+        {
+            uint8_t idx = 0;
+            const uint32_t waitStartMs = millis();
+            const bool gotBuf = xQueueReceive(s_pipeFreeQ, &idx, pdMS_TO_TICKS(20)) == pdTRUE;
+            g_job.flashStallMs += millis() - waitStartMs;
+            if (!gotBuf)
+            {
+                break;
+            }
+            g_job.pipeFillIdx = (int8_t)idx;
+            g_job.pipeFillLen = 0;
+        }
+
+        size_t inUsed = 0;
+        size_t outLen = 0;
+        const OtaDeltaResult res = ota_delta_step(&g_job.delta,
+                                                  s_deltaIn + g_job.deltaInPos,
+                                                  g_job.deltaInLen - g_job.deltaInPos,
+                                                  &inUsed,
+                                                  s_pipeBuf[g_job.pipeFillIdx] + g_job.pipeFillLen,
+                                                  (size_t)CFG_OTA_STREAM_BUF_BYTES - (size_t)g_job.pipeFillLen,
+                                                  &outLen,
+                                                  ota_deltaReadSource,
+                                                  (void *)g_job.deltaSource);
+        g_job.deltaInPos += (uint32_t)inUsed;
+        g_job.pipeFillLen += (uint32_t)outLen;
+        produced += outLen;
+        if (outLen > 0u)
+        {
+            g_job.lastProgressMs = millis();
+        }
+
+        if (res == OtaDeltaResult::ERROR)
+        {
+            return g_job.delta.error ? g_job.delta.error : "delta_corrupt";
+        }
+        if (g_job.pipeFillLen >= (uint32_t)CFG_OTA_STREAM_BUF_BYTES || res == OtaDeltaResult::DONE)
+        {
+            ota_pipeSubmitFill();
+        }
+        if (res != OtaDeltaResult::NEED_INPUT)
+        {
+            continue;
+        }
+
+        if (ota_streamEnded())
+        {
+            return "delta_truncated";
+        }
+        const int n = ota_streamRead(stream, s_deltaIn, sizeof(s_deltaIn));
+        if (n < 0)
+        {
+            return g_job.streamErr;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        g_job.deltaInLen = (uint32_t)n;
+        g_job.deltaInPos = 0;
+        ota_progressPrint(g_job.bytesWritten, g_job.bytesTotal, false, false);
+    }
+    return nullptr;
+}
+
 static void ota_releaseJobResources()
 {
+    // Returns only once the writer is idle; it no longer touches g_job.
+    ota_pipeReset(s_serviceState);
     if (g_job.updateBegun)
     {
         (void)esp_ota_abort(g_job.otaHandle);
@@ -1720,12 +2479,30 @@ static void ota_resetRuntimeJob()
     g_job.retryAtMs = 0;
     g_job.retryCount = 0;
     g_job.nextRetryAtMs = 0;
+    g_job.downloadStartMs = 0;
+    g_job.downloadEndMs = 0;
+    g_job.netStallMs = 0;
+    g_job.netStallCount = 0;
+    g_job.flashStallMs = 0;
+    g_job.rateWindowStartMs = 0;
+    g_job.rateWindowBytes = 0;
+    g_job.minKbps = UINT32_MAX;
+    g_job.verifyStartMs = 0;
+    g_job.stats = OtaStats{};
+    g_job.altActive = false;
+    ota_streamReset();
+    g_job.deltaActive = false;
+    g_job.delta = OtaDeltaDecoder{};
+    g_job.deltaSource = nullptr;
+    g_job.deltaInLen = 0;
+    g_job.deltaInPos = 0;
     g_job.otaHandle = 0;
     g_job.targetPartition = nullptr;
     g_job.request_id[0] = '\0';
     g_job.version[0] = '\0';
     g_job.url[0] = '\0';
     g_job.sha256[0] = '\0';
+    g_job.altUrl[0] = '\0';
 }
 
 static void ota_primeRuntimeJob(const OtaTaskJob &job)
@@ -1745,17 +2522,21 @@ static void ota_primeRuntimeJob(const OtaTaskJob &job)
     g_job.url[sizeof(g_job.url) - 1] = '\0';
     strncpy(g_job.sha256, job.sha256, sizeof(g_job.sha256));
     g_job.sha256[sizeof(g_job.sha256) - 1] = '\0';
+    strncpy(g_job.altUrl, job.alt_url, sizeof(g_job.altUrl));
+    g_job.altUrl[sizeof(g_job.altUrl) - 1] = '\0';
+    g_job.altActive = g_job.altUrl[0] != '\0';
 }
 
-bool ota_pullStart(DeviceState *state,
-                   const char *request_id,
-                   const char *version,
-                   const char *url,
-                   const char *sha256,
-                   bool force,
-                   bool reboot,
-                   char *errBuf,
-                   size_t errBufLen)
+static bool ota_pullStartJob(DeviceState *state,
+                             const char *request_id,
+                             const char *version,
+                             const char *url,
+                             const char *sha256,
+                             const char *altUrl,
+                             bool force,
+                             bool reboot,
+                             char *errBuf,
+                             size_t errBufLen)
 {
     ota_nextBlockAttempt();
 
@@ -1900,6 +2681,8 @@ bool ota_pullStart(DeviceState *state,
     taskJob.url[sizeof(taskJob.url) - 1] = '\0';
     strncpy(taskJob.sha256, sha256 ? sha256 : "", sizeof(taskJob.sha256));
     taskJob.sha256[sizeof(taskJob.sha256) - 1] = '\0';
+    strncpy(taskJob.alt_url, altUrl ? altUrl : "", sizeof(taskJob.alt_url));
+    taskJob.alt_url[sizeof(taskJob.alt_url) - 1] = '\0';
     taskJob.force = force;
     taskJob.reboot = reboot;
 #if CFG_OTA_DEV_LOGS
@@ -1907,11 +2690,12 @@ bool ota_pullStart(DeviceState *state,
     strncpy(shaPrefix, taskJob.sha256, 12);
     shaPrefix[sizeof(shaPrefix) - 1] = '\0';
     LOG_INFO(LogDomain::OTA,
-             "Pull OTA enqueue request request_id=%s version=%s url_len=%u sha_prefix=%s force=%s reboot=%s",
+             "Pull OTA enqueue request request_id=%s version=%s url_len=%u sha_prefix=%s alt=%s force=%s reboot=%s",
              taskJob.request_id[0] ? taskJob.request_id : "<none>",
              taskJob.version[0] ? taskJob.version : "<none>",
              (unsigned)strlen(taskJob.url),
              taskJob.sha256[0] ? shaPrefix : "<none>",
+             taskJob.alt_url[0] ? "true" : "false",
              taskJob.force ? "true" : "false",
              taskJob.reboot ? "true" : "false");
 #endif
@@ -1973,6 +2757,53 @@ bool ota_pullStart(DeviceState *state,
     return true;
 }
 
+bool ota_pullStart(DeviceState *state,
+                   const char *request_id,
+                   const char *version,
+                   const char *url,
+                   const char *sha256,
+                   bool force,
+                   bool reboot,
+                   char *errBuf,
+                   size_t errBufLen)
+{
+    return ota_pullStartJob(state, request_id, version, url, sha256, nullptr, force, reboot, errBuf, errBufLen);
+}
+
+// Pick the manifest delta entry built against the running firmware, if any.
+// Entries: {"from_version": "...", "from_sha256": "...", "url": "https://..."}.
+// from_sha256 is informational here; the OTA task re-checks the patch header
+// against the running partition and falls back to the full image on mismatch.
+static const char *ota_manifestSelectDelta(JsonArrayConst deltas, const char *currentFw)
+{
+    if (deltas.isNull() || !currentFw || currentFw[0] == '\0')
+    {
+        return nullptr;
+    }
+    for (JsonObjectConst entry : deltas)
+    {
+        const char *fromVersion = entry["from_version"] | "";
+        const char *fromSha = entry["from_sha256"] | "";
+        const char *deltaUrl = entry["url"] | "";
+        if (strcmp(fromVersion, currentFw) != 0)
+        {
+            continue;
+        }
+        if (deltaUrl[0] == '\0' || strlen(deltaUrl) >= OTA_URL_MAX || !isHex64(fromSha))
+        {
+            LOG_WARN(LogDomain::OTA, "Manifest delta entry ignored from_version=%s reason=malformed", fromVersion);
+            return nullptr;
+        }
+        if (!ota_manifestUrlHostTrusted(deltaUrl))
+        {
+            LOG_WARN(LogDomain::OTA, "Manifest delta entry ignored from_version=%s reason=untrusted_host", fromVersion);
+            return nullptr;
+        }
+        return deltaUrl;
+    }
+    return nullptr;
+}
+
 bool ota_pullStartFromManifest(DeviceState *state,
                                const char *request_id,
                                bool force,
@@ -2044,7 +2875,7 @@ bool ota_pullStartFromManifest(DeviceState *state,
         return false;
     }
 
-    WiFiClientSecure client;
+    OtaTlsClient client;
     ota_prepareTlsClient(client, "manifest_pull", manifestUrl);
 
     HTTPClient http;
@@ -2069,6 +2900,7 @@ bool ota_pullStartFromManifest(DeviceState *state,
     http.useHTTP10(false);
 
     const int code = http.GET();
+    ota_logTlsHandshakes("manifest_pull", client);
     const bool requestOk = (code > 0);
     if (!requestOk)
     {
@@ -2105,7 +2937,7 @@ bool ota_pullStartFromManifest(DeviceState *state,
         }
     }
 
-    StaticJsonDocument<768> doc;
+    StaticJsonDocument<OTA_MANIFEST_DOC_BYTES> doc;
     const DeserializationError derr = deserializeJson(doc, http.getStream());
     http.end();
     if (derr)
@@ -2150,7 +2982,26 @@ bool ota_pullStartFromManifest(DeviceState *state,
         return false;
     }
 
-    const bool ok = ota_pullStart(state, request_id, version, url, sha256, force, reboot, errBuf, errBufLen);
+    // Preferred source: delta for this version, else the compressed image, else url.
+    const char *altUrl = ota_manifestSelectDelta(doc["delta"].as<JsonArrayConst>(), state->device.fw);
+    if (altUrl)
+    {
+        LOG_INFO(LogDomain::OTA, "Manifest offers delta from %s", state->device.fw);
+    }
+    else
+    {
+        const char *zlibUrl = doc["url_zlib"] | "";
+        if (zlibUrl[0] != '\0' && strlen(zlibUrl) < OTA_URL_MAX && ota_manifestUrlHostTrusted(zlibUrl))
+        {
+            altUrl = zlibUrl;
+        }
+        else if (zlibUrl[0] != '\0')
+        {
+            LOG_WARN(LogDomain::OTA, "Manifest url_zlib ignored reason=untrusted_or_too_long");
+        }
+    }
+
+    const bool ok = ota_pullStartJob(state, request_id, version, url, sha256, altUrl, force, reboot, errBuf, errBufLen);
     if (!ok && errBuf && errBuf[0] && strcmp(errBuf, "busy") != 0)
     {
         ota_markFailed(state, errBuf);
@@ -2222,7 +3073,7 @@ bool ota_checkManifest(DeviceState *state, char *errBuf, size_t errBufLen)
         return false;
     }
 
-    WiFiClientSecure client;
+    OtaTlsClient client;
     ota_prepareTlsClient(client, "manifest_check", manifestUrl);
 
     HTTPClient http;
@@ -2249,6 +3100,7 @@ bool ota_checkManifest(DeviceState *state, char *errBuf, size_t errBufLen)
     http.useHTTP10(false);
 
     const int code = http.GET();
+    ota_logTlsHandshakes("manifest_check", client);
     const bool requestOk = (code > 0);
     if (!requestOk)
     {
@@ -2275,7 +3127,7 @@ bool ota_checkManifest(DeviceState *state, char *errBuf, size_t errBufLen)
         return false;
     }
 
-    StaticJsonDocument<768> doc;
+    StaticJsonDocument<OTA_MANIFEST_DOC_BYTES> doc;
     const DeserializationError derr = deserializeJson(doc, http.getStream());
     http.end();
     if (derr)
@@ -2405,8 +3257,15 @@ static void ota_abort(DeviceState *state, const char *reason)
              g_job.httpBegun ? "true" : "false",
              (unsigned long)ESP.getFreeHeap());
     ota_logPartitionSnapshot("abort");
+    if (g_job.updateBegun)
+    {
+        ota_logStreamStats("aborted");
+    }
 #endif
 
+    // Quiesce the writer before anything below releases the OTA handle or SHA
+    // context (a stuck writer restarts the device instead of returning).
+    ota_pipeReset(state);
     if (g_job.retryCount < MAX_OTA_RETRIES)
     {
         const uint8_t nextRetryCount = (uint8_t)(g_job.retryCount + 1u);
@@ -2467,6 +3326,7 @@ static void ota_abort(DeviceState *state, const char *reason)
     }
 
     ota_progressFail(reason);
+    ota_publishStats(state);
 
     if (g_job.updateBegun)
     {
@@ -2556,6 +3416,7 @@ static void ota_finishSuccess(DeviceState *state)
             }
             storage_saveOtaLastSuccess(epochNow);
         }
+        ota_publishStats(state);
         ota_requestPublish();
     }
 
@@ -2588,6 +3449,7 @@ static void ota_finishSuccess(DeviceState *state)
             ota_setStatus(state, OtaStatus::REBOOTING);
         }
         storage_saveRebootIntent((uint8_t)RebootIntent::OTA);
+        storage_flush();
 #if CFG_OTA_DEV_LOGS
         LOG_INFO(LogDomain::OTA, "Saved reboot intent=ota");
         LOG_INFO(LogDomain::OTA, "ota_success_rebooting");
@@ -2659,6 +3521,8 @@ void ota_processPullJobInTask(DeviceState *state, const OtaTaskJob &job)
         logger_setOtaQuietMode(true);
     }
 
+    // One sample per ota_tick() slice; the 20 ms yields between slices are not counted.
+    const int profSlot = profiler_register("otaTask");
     while (g_job.active)
     {
 #if CFG_OTA_DEV_LOGS
@@ -2680,7 +3544,9 @@ void ota_processPullJobInTask(DeviceState *state, const OtaTaskJob &job)
             continue;
         }
 
+        const uint32_t sliceStartUs = micros();
         ota_tick(state);
+        profiler_record(profSlot, micros() - sliceStartUs);
         if (g_job.active)
         {
             vTaskDelay(pdMS_TO_TICKS(20));
@@ -2726,6 +3592,7 @@ static void ota_tick(DeviceState *state)
         ota_trace("retry_window_reached", "now=%lu target=%lu",
                   (unsigned long)nowMs, (unsigned long)g_job.nextRetryAtMs);
         g_job.nextRetryAtMs = 0;
+        ota_pipeReset(state);
         if (g_job.updateBegun)
         {
             (void)esp_ota_abort(g_job.otaHandle);
@@ -2796,7 +3663,10 @@ static void ota_tick(DeviceState *state)
     // Step A: begin HTTP if not begun
     if (!g_job.httpBegun)
     {
-        ota_trace("http_begin_prepare", "url=%s", g_job.url[0] ? g_job.url : "<none>");
+        const char *srcUrl = g_job.altActive ? g_job.altUrl : g_job.url;
+        ota_trace("http_begin_prepare", "url=%s alt=%s",
+                  srcUrl[0] ? srcUrl : "<none>",
+                  g_job.altActive ? "true" : "false");
         ota_logRuntimeHealth("http_begin_prepare");
         const uint32_t connectTimeoutMs = (uint32_t)CFG_OTA_HTTP_CONNECT_TIMEOUT_MS;
         const uint32_t readTimeoutMs = (uint32_t)CFG_OTA_HTTP_READ_TIMEOUT_MS;
@@ -2804,8 +3674,8 @@ static void ota_tick(DeviceState *state)
 
         g_job.http.end();
         g_job.client.stop();
-        g_job.client = WiFiClientSecure();
-        ota_prepareTlsClient(g_job.client, "firmware_download", g_job.url);
+        g_job.client = OtaTlsClient();
+        ota_prepareTlsClient(g_job.client, "firmware_download", srcUrl);
 
 #ifdef HTTPC_FORCE_FOLLOW_REDIRECTS
         g_job.http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
@@ -2819,13 +3689,13 @@ static void ota_tick(DeviceState *state)
         g_job.http.setTimeout(readTimeoutMsClamped);
 
         const uint32_t hsStartMs = millis();
-        const bool beginOk = g_job.http.begin(g_job.client, g_job.url);
+        const bool beginOk = g_job.http.begin(g_job.client, srcUrl);
         const uint32_t hsElapsedMs = millis() - hsStartMs;
         if (!beginOk)
         {
             ota_trace("http_begin_fail", "elapsed_ms=%lu", (unsigned long)hsElapsedMs);
             ota_captureTlsError(g_job.client);
-            ota_logTlsStatus("firmware_download", g_job.url, false, 0);
+            ota_logTlsStatus("firmware_download", srcUrl, false, 0);
             const char *reason = ota_classifyBeginFailure(hsElapsedMs);
             ota_scheduleRetry(state, reason);
             return;
@@ -2835,7 +3705,7 @@ static void ota_tick(DeviceState *state)
 #if CFG_OTA_DEV_LOGS
         LOG_INFO(LogDomain::OTA,
                  "HTTP begin ok url=%s announced_len_pre_get=%d",
-                 g_job.url,
+                 srcUrl,
                  g_job.http.getSize());
 #endif
         g_job.httpBegun = true;
@@ -2846,23 +3716,58 @@ static void ota_tick(DeviceState *state)
         g_job.http.addHeader("Accept", "application/octet-stream");
         g_job.http.useHTTP10(false);
 
-        ota_trace("http_get_start", "url=%s", g_job.url);
+        // Resolve + handshake explicitly so DNS and TLS time can be reported
+        // separately; HTTPClient reuses the already-connected client for GET.
+        char host[128] = {0};
+        if (ota_extractUrlHost(srcUrl, host, sizeof(host)))
+        {
+            IPAddress hostIp;
+            const uint32_t dnsStartMs = millis();
+            const bool dnsOk = WiFi.hostByName(host, hostIp) == 1;
+            g_job.stats.dns_ms = millis() - dnsStartMs;
+            if (!dnsOk)
+            {
+                ota_trace("dns_fail", "host=%s elapsed_ms=%lu", host, (unsigned long)g_job.stats.dns_ms);
+                ota_scheduleRetry(state, "dns_fail");
+                return;
+            }
+
+            const uint32_t tlsStartMs = millis();
+            const bool tlsOk = g_job.client.connect(host, ota_urlPort(srcUrl), (int32_t)connectTimeoutMs) == 1;
+            g_job.stats.tls_ms = millis() - tlsStartMs;
+            if (!tlsOk)
+            {
+                ota_trace("tls_connect_fail", "host=%s elapsed_ms=%lu", host, (unsigned long)g_job.stats.tls_ms);
+                ota_captureTlsError(g_job.client);
+                ota_logTlsStatus("firmware_download", srcUrl, false, 0);
+                ota_scheduleRetry(state, ota_classifyBeginFailure(g_job.stats.tls_ms));
+                return;
+            }
+            ota_trace("tls_connect_ok", "host=%s dns_ms=%lu tls_ms=%lu",
+                      host,
+                      (unsigned long)g_job.stats.dns_ms,
+                      (unsigned long)g_job.stats.tls_ms);
+        }
+
+        ota_trace("http_get_start", "url=%s", srcUrl);
         const uint32_t getStartMs = millis();
         const int code = g_job.http.GET();
         const uint32_t getElapsedMs = millis() - getStartMs;
+        g_job.stats.first_byte_ms = getElapsedMs;
+        ota_noteTlsHandshakes();
         const int responseLen = g_job.http.getSize();
         String location = g_job.http.header("Location");
         ota_trace("http_get_done", "code=%d len=%d location=%s requested_url=%s",
                   code,
                   responseLen,
                   location.length() > 0 ? location.c_str() : "<none>",
-                  g_job.url);
+                  srcUrl);
         const bool requestOk = (code > 0);
         if (!requestOk)
         {
             ota_trace("http_get_fail", "code=%d elapsed_ms=%lu", code, (unsigned long)getElapsedMs);
             ota_captureTlsError(g_job.client);
-            ota_logTlsStatus("firmware_download", g_job.url, false, code);
+            ota_logTlsStatus("firmware_download", srcUrl, false, code);
             const char *reason = ota_classifyRequestFailure(code);
             if (getElapsedMs >= readTimeoutMs)
             {
@@ -2871,7 +3776,7 @@ static void ota_tick(DeviceState *state)
             ota_scheduleRetry(state, reason);
             return;
         }
-        ota_logTlsStatus("firmware_download", g_job.url, true, code);
+        ota_logTlsStatus("firmware_download", srcUrl, true, code);
         if (code != HTTP_CODE_OK)
         {
             ota_trace("http_status_fail", "code=%d", code);
@@ -2934,7 +3839,9 @@ static void ota_tick(DeviceState *state)
             return;
         }
         g_job.bytesTotal = (uint32_t)len;
-        if (len < OTA_MIN_BYTES)
+        // Patches and compressed images can legitimately be tiny.
+        const int minLen = g_job.altActive ? 16 : OTA_MIN_BYTES;
+        if (len < minLen)
         {
             ota_abort(state, "content_too_small");
             return;
@@ -2965,25 +3872,34 @@ static void ota_tick(DeviceState *state)
             return;
         }
 
-        uint8_t headerProbe[32] = {0};
+        // Probe decoded bytes (after inflate, if the body is zlib). Images only
+        // need the magic; a patch from the alternate url needs its whole header.
+        ota_streamReset();
+        uint8_t headerProbe[OTA_DELTA_HEADER_BYTES] = {0};
         size_t headerProbeLen = 0;
+        size_t headerProbeNeed = 4u;
         const uint32_t probeStartMs = millis();
-        while (headerProbeLen == 0)
+        while (headerProbeLen < headerProbeNeed)
         {
-            const int avail = stream->available();
-            if (avail > 0)
+            const int n = ota_streamRead(stream, headerProbe + headerProbeLen, headerProbeNeed - headerProbeLen);
+            if (n < 0)
             {
-                size_t toRead = (size_t)avail;
-                if (toRead > sizeof(headerProbe))
-                {
-                    toRead = sizeof(headerProbe);
-                }
-                const int n = stream->read(headerProbe, toRead);
-                if (n > 0)
+                ota_trace("header_probe_fail", "stream_err=%s", g_job.streamErr ? g_job.streamErr : "");
+                ota_altFallback(state, g_job.streamErr);
+                return;
+            }
+            if (n > 0)
+            {
+                headerProbeLen += (size_t)n;
+                if (g_job.altActive && headerProbeLen >= 4u && memcmp(headerProbe, "WTD1", 4) == 0)
                 {
-                    headerProbeLen = (size_t)n;
-                    break;
+                    headerProbeNeed = sizeof(headerProbe);
                 }
+                continue;
+            }
+            if (ota_streamEnded())
+            {
+                break;
             }
 
             if (!stream->connected() || (uint32_t)(millis() - probeStartMs) > 2000u)
@@ -2999,11 +3915,37 @@ static void ota_tick(DeviceState *state)
             ota_abort(state, "invalid image header (empty)");
             return;
         }
-        if (headerProbe[0] != 0xE9)
+        OtaDeltaHeader deltaHdr;
+        g_job.deltaActive = headerProbeNeed == sizeof(headerProbe);
+        if (g_job.deltaActive)
+        {
+            if (!ota_delta_parseHeader(headerProbe, headerProbeLen, &deltaHdr))
+            {
+                ota_trace("header_probe_fail", "delta_header bytes=%u", (unsigned int)headerProbeLen);
+                ota_altFallback(state, "delta_bad_header");
+                return;
+            }
+            const uint32_t srcHashStartMs = millis();
+            const bool sourceOk = ota_deltaSourceMatches(deltaHdr);
+            ota_trace("delta_source_check", "ok=%s source=%lu target=%lu elapsed_ms=%lu",
+                      sourceOk ? "true" : "false",
+                      (unsigned long)deltaHdr.sourceSize,
+                      (unsigned long)deltaHdr.targetSize,
+                      (unsigned long)(millis() - srcHashStartMs));
+            if (!sourceOk)
+            {
+                ota_altFallback(state, "delta_source_mismatch");
+                return;
+            }
+            ota_delta_begin(&g_job.delta, deltaHdr);
+            g_job.deltaInLen = 0;
+            g_job.deltaInPos = 0;
+        }
+        else if (headerProbe[0] != 0xE9)
         {
             ota_trace("header_probe_fail", "magic=0x%02X", (unsigned int)headerProbe[0]);
             LOG_ERROR(LogDomain::OTA, "Invalid image header first_byte=0x%02X", (unsigned int)headerProbe[0]);
-            ota_abort(state, "invalid image header (magic != 0xE9)");
+            ota_altFallback(state, "invalid image header (magic != 0xE9)");
             return;
         }
         ota_trace("header_probe_ok", "magic=0x%02X bytes=%u",
@@ -3023,8 +3965,25 @@ static void ota_tick(DeviceState *state)
         }
         ota_logPartitionSnapshot("before_update_begin");
         ota_emitPartitionDiag("before_update_begin");
-        const size_t updateSize =
-            (g_job.bytesTotal > 0) ? (size_t)g_job.bytesTotal : (size_t)OTA_SIZE_UNKNOWN;
+        if (g_job.deltaActive && deltaHdr.targetSize > g_job.targetPartition->size)
+        {
+            ota_abort(state, "not_enough_space");
+            return;
+        }
+        size_t updateSize = (g_job.bytesTotal > 0) ? (size_t)g_job.bytesTotal : (size_t)OTA_SIZE_UNKNOWN;
+        if (g_job.deltaActive)
+        {
+            updateSize = (size_t)deltaHdr.targetSize;
+        }
+        else if (g_job.streamMode == OtaStreamMode::INFLATE)
+        {
+            // Image size is unknown until inflate ends; erase as we go where supported.
+#ifdef OTA_WITH_SEQUENTIAL_WRITES
+            updateSize = (size_t)OTA_WITH_SEQUENTIAL_WRITES;
+#else
+            updateSize = (size_t)OTA_SIZE_UNKNOWN;
+#endif
+        }
 
 #if CFG_OTA_DEV_LOGS
         LOG_INFO(LogDomain::OTA, "esp_ota_begin partition=%s@0x%08lx size=%s (%lu)",
@@ -3038,6 +3997,12 @@ static void ota_tick(DeviceState *state)
                   (unsigned long)g_job.targetPartition->address,
                   (unsigned long)updateSize);
 
+        if (!ota_pipeBegin())
+        {
+            ota_abort(state, "pipeline_init_failed");
+            return;
+        }
+
         const bool wdtDetachedBegin = ota_detachCurrentTaskWdt("update_begin");
         const esp_err_t otaBeginErr = esp_ota_begin(g_job.targetPartition, updateSize, &g_job.otaHandle);
         ota_reattachCurrentTaskWdt(wdtDetachedBegin, "update_begin");
@@ -3060,15 +4025,19 @@ static void ota_tick(DeviceState *state)
         g_job.shaInit = true;
         g_job.updateBegun = true;
 
-        if (g_job.shaInit)
-        {
-            mbedtls_sha256_update(&g_job.shaCtx, headerProbe, headerProbeLen);
-        }
-        if (!ota_requireEspOk(state, "esp_ota_write", esp_ota_write(g_job.otaHandle, headerProbe, headerProbeLen)))
+        // Network bytes were already counted by ota_streamRead; a patch header is
+        // consumed here and image bytes come from the decoder instead.
+        if (!g_job.deltaActive)
         {
-            return;
+            if (g_job.shaInit)
+            {
+                mbedtls_sha256_update(&g_job.shaCtx, headerProbe, headerProbeLen);
+            }
+            if (!ota_requireEspOk(state, "esp_ota_write", esp_ota_write(g_job.otaHandle, headerProbe, headerProbeLen)))
+            {
+                return;
+            }
         }
-        g_job.bytesWritten = (uint32_t)headerProbeLen;
         g_job.bytesAtLastWriteLog = g_job.bytesWritten;
         ota_trace("ota_write_header_ok", "bytes=%u", (unsigned int)headerProbeLen);
         ota_progressPrint(g_job.bytesWritten, g_job.bytesTotal, false, false);
@@ -3086,10 +4055,18 @@ static void ota_tick(DeviceState *state)
         g_job.lastWriteLogMs = g_job.lastProgressMs;
         g_job.zeroReadStreak = 0;
         g_job.noDataSinceMs = 0;
+        g_job.downloadStartMs = g_job.lastProgressMs;
+        g_job.downloadEndMs = 0;
+        g_job.rateWindowStartMs = g_job.lastProgressMs;
+        g_job.rateWindowBytes = g_job.bytesWritten;
+        g_job.minKbps = UINT32_MAX;
+        g_job.netStallMs = 0;
+        g_job.netStallCount = 0;
+        g_job.flashStallMs = 0;
         return;
     }
 
-    // Step B: stream a bounded chunk per tick
+    // Step B: fill pipeline buffers from the stream; otaWriter hashes + flashes them
     WiFiClient *stream = g_job.http.getStreamPtr();
     if (!stream)
     {
@@ -3097,53 +4074,74 @@ static void ota_tick(DeviceState *state)
         ota_abort(state, "no_stream");
         return;
     }
+    if (s_pipeErr != ESP_OK)
+    {
+        (void)ota_requireEspOk(state, "esp_ota_write", s_pipeErr);
+        return;
+    }
 
-    const size_t kMaxChunk = 4096;
-    uint8_t buf[512];
+    const size_t kTickBudget = (size_t)CFG_OTA_STREAM_BUF_BYTES * (size_t)CFG_OTA_STREAM_BUF_COUNT;
     size_t processed = 0;
 
-    while (processed < kMaxChunk)
+    if (g_job.deltaActive)
     {
-        int avail = stream->available();
-        if (avail <= 0)
+        const char *deltaErr = ota_deltaPump(stream, kTickBudget);
+        if (deltaErr)
         {
-            if (g_job.zeroReadStreak == 0)
-                g_job.noDataSinceMs = millis();
-            g_job.zeroReadStreak++;
-            break;
+            ota_trace("delta_fail", "reason=%s produced=%lu/%lu",
+                      deltaErr,
+                      (unsigned long)g_job.delta.produced,
+                      (unsigned long)g_job.delta.targetSize);
+            ota_altFallback(state, deltaErr);
+            return;
         }
+    }
 
-        size_t toRead = (size_t)avail;
-        if (toRead > sizeof(buf))
-            toRead = sizeof(buf);
-
-        int n = stream->read(buf, toRead);
-        if (n <= 0)
+    while (!g_job.deltaActive && processed < kTickBudget)
+    {
+        if (ota_streamEnded())
         {
-            if (g_job.zeroReadStreak == 0)
-                g_job.noDataSinceMs = millis();
-            g_job.zeroReadStreak++;
             break;
         }
-
-        if (g_job.shaInit)
+        if (g_job.pipeFillIdx < 0)
         {
-            mbedtls_sha256_update(&g_job.shaCtx, buf, (size_t)n);
+            uint8_t idx = 0;
+            const uint32_t waitStartMs = millis();
+            const bool gotBuf = xQueueReceive(s_pipeFreeQ, &idx, pdMS_TO_TICKS(20)) == pdTRUE;
+            const uint32_t waitedMs = millis() - waitStartMs;
+            g_job.flashStallMs += waitedMs;
+            if (!gotBuf)
+            {
+                // Writer still busy in flash; TLS/lwIP buffers absorb the backlog meanwhile.
+                break;
+            }
+            g_job.pipeFillIdx = (int8_t)idx;
+            g_job.pipeFillLen = 0;
         }
 
-        const esp_err_t otaWriteErr = esp_ota_write(g_job.otaHandle, buf, (size_t)n);
-        if (!ota_requireEspOk(state, "esp_ota_write", otaWriteErr))
+        uint8_t *dst = s_pipeBuf[g_job.pipeFillIdx] + g_job.pipeFillLen;
+        const size_t room = (size_t)CFG_OTA_STREAM_BUF_BYTES - (size_t)g_job.pipeFillLen;
+        const int n = ota_streamRead(stream, dst, room);
+        if (n < 0)
         {
+            ota_trace("stream_fail", "reason=%s", g_job.streamErr ? g_job.streamErr : "");
+            ota_altFallback(state, g_job.streamErr);
             return;
         }
+        if (n == 0)
+        {
+            break;
+        }
 
-        g_job.zeroReadStreak = 0;
-        g_job.noDataSinceMs = 0;
-        g_job.bytesWritten += (uint32_t)n;
+        g_job.pipeFillLen += (uint32_t)n;
         processed += (size_t)n;
-        g_job.lastProgressMs = millis();
         ota_progressPrint(g_job.bytesWritten, g_job.bytesTotal, false, false);
 
+        if (g_job.pipeFillLen >= (uint32_t)CFG_OTA_STREAM_BUF_BYTES || ota_streamEnded())
+        {
+            ota_pipeSubmitFill();
+        }
+
 #if CFG_OTA_DEV_LOGS
         const uint32_t nowWriteMs = millis();
         const uint32_t bytesSinceLog = g_job.bytesWritten - g_job.bytesAtLastWriteLog;
@@ -3159,9 +4157,10 @@ static void ota_tick(DeviceState *state)
                 }
             }
             LOG_INFO(LogDomain::OTA,
-                     "[TRACE] step=write_chunk read=%d total_written=%lu total_size=%lu pct=%lu",
+                     "[TRACE] step=write_chunk read=%d total_read=%lu flashed=%lu total_size=%lu pct=%lu",
                      n,
                      (unsigned long)g_job.bytesWritten,
+                     (unsigned long)s_pipeBytesFlashed,
                      (unsigned long)g_job.bytesTotal,
                      (unsigned long)pct);
             ota_logRuntimeHealth("write_chunk");
@@ -3172,6 +4171,7 @@ static void ota_tick(DeviceState *state)
     }
 
     uint32_t now = millis();
+    ota_sampleThroughput(now);
 
 #if CFG_OTA_DEV_LOGS
     if (s_otaHeartbeatEnabled && (uint32_t)(now - g_job.lastDiagMs) >= (uint32_t)CFG_OTA_DOWNLOAD_HEARTBEAT_MS)
@@ -3219,9 +4219,25 @@ static void ota_tick(DeviceState *state)
     }
 
     bool finished = false;
-    if (g_job.bytesTotal > 0)
+    if (g_job.deltaActive)
+    {
+        finished = ota_delta_done(g_job.delta);
+        if (finished && !ota_streamEnded())
+        {
+            // END op seen; the rest of the body must be empty (zlib trailer aside).
+            uint8_t extra = 0;
+            const int n = (g_job.deltaInPos < g_job.deltaInLen) ? 1 : ota_streamRead(stream, &extra, 1u);
+            if (n != 0)
+            {
+                ota_altFallback(state, (n < 0) ? g_job.streamErr : "delta_trailing_data");
+                return;
+            }
+            finished = ota_streamEnded();
+        }
+    }
+    else if (g_job.bytesTotal > 0)
     {
-        finished = g_job.bytesWritten >= g_job.bytesTotal;
+        finished = ota_streamEnded();
     }
     else
     {
@@ -3242,7 +4258,24 @@ static void ota_tick(DeviceState *state)
         }
         return;
     }
+
+    // Flush the tail buffer and wait for the writer before touching SHA/OTA handle.
+    ota_pipeSubmitFill();
+    if (!ota_pipeDrain((uint32_t)CFG_OTA_HTTP_READ_TIMEOUT_MS))
+    {
+        ota_trace("pipeline_drain_timeout", "flashed=%lu/%lu",
+                  (unsigned long)s_pipeBytesFlashed, (unsigned long)g_job.bytesWritten);
+        ota_abort(state, "flash_write_timeout");
+        return;
+    }
+    if (s_pipeErr != ESP_OK)
+    {
+        (void)ota_requireEspOk(state, "esp_ota_write", s_pipeErr);
+        return;
+    }
+    g_job.downloadEndMs = millis();
     ota_progressPrint(g_job.bytesWritten, g_job.bytesTotal, true, true);
+    ota_logStreamStats("complete");
     ota_trace("download_complete", "bytes=%lu/%lu", (unsigned long)g_job.bytesWritten, (unsigned long)g_job.bytesTotal);
     ota_logRuntimeHealth("download_complete");
 
@@ -3256,6 +4289,7 @@ static void ota_tick(DeviceState *state)
 #endif
 
     // Step C: finalize update
+    g_job.verifyStartMs = millis();
     if (state)
     {
         ota_setStatus(state, OtaStatus::VERIFYING);
@@ -3263,9 +4297,10 @@ static void ota_tick(DeviceState *state)
         ota_requestPublish();
     }
 
-    if (g_job.bytesWritten < OTA_MIN_BYTES)
+    const uint32_t imageBytes = g_job.deltaActive ? g_job.delta.produced : g_job.decodedBytes;
+    if (imageBytes < OTA_MIN_BYTES)
     {
-        ota_trace("finalize_fail", "download_too_small bytes=%lu", (unsigned long)g_job.bytesWritten);
+        ota_trace("finalize_fail", "download_too_small bytes=%lu", (unsigned long)imageBytes);
         ota_abort(state, "download_too_small");
         return;
     }
@@ -3317,6 +4352,11 @@ static void ota_tick(DeviceState *state)
                 LOG_ERROR(LogDomain::OTA, "Verifying update integrity... FAILED");
 #endif
                 ota_trace("sha_fail", "sha_mismatch");
+                if (g_job.deltaActive)
+                {
+                    ota_altFallback(state, "delta_sha_mismatch");
+                    return;
+                }
                 ota_abort(state, "sha_mismatch");
                 return;
             }
@@ -3367,6 +4407,7 @@ static void ota_tick(DeviceState *state)
     {
         return;
     }
+    g_job.stats.verify_ms = millis() - g_job.verifyStartMs;
     ota_trace("ota_end_ok", "err=%d", (int)otaEndErr);
     ota_logRuntimeHealth("ota_end_ok");
 
@@ -3375,7 +4416,9 @@ static void ota_tick(DeviceState *state)
         (void)ota_requireEspOk(state, "esp_ota_set_boot_partition_target", ESP_ERR_INVALID_ARG);
         return;
     }
+    const uint32_t switchStartMs = millis();
     const esp_err_t setBootErr = esp_ota_set_boot_partition(g_job.targetPartition);
+    g_job.stats.switch_ms = millis() - switchStartMs;
 #if CFG_OTA_DEV_LOGS
     LOG_INFO(LogDomain::OTA, "esp_ota_set_boot_partition target=%s@0x%08lx err=%d",
              g_job.targetPartition->label,
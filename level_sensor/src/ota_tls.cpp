@@ -0,0 +1,423 @@
+#include "ota_tls.h"
+#include <WiFi.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <lwip/sockets.h>
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include <string.h>
+#include <strings.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "logger.h"
+
+static_assert(CFG_OTA_TLS_SESSION_SLOTS >= 1, "CFG_OTA_TLS_SESSION_SLOTS must be at least 1");
+
+#if OTA_TLS_RESUMABLE
+
+struct OtaTlsSessionSlot
+{
+    bool valid = false;
+    char host[96] = {0};
+    uint16_t port = 0;
+    uint32_t savedAtMs = 0;
+    mbedtls_ssl_session session;
+};
+
+// Shared by the loop task (manifest check/pull) and otaTask (download).
+static OtaTlsSessionSlot s_slots[CFG_OTA_TLS_SESSION_SLOTS];
+static SemaphoreHandle_t s_slotsMutex = nullptr; // created by ota_tls_begin()
+
+// Without the lock (ota_tls_begin() not run, or out of heap) the cache is
+// skipped and every handshake is a full one.
+static bool tls_lock()
+{
+    if (s_slotsMutex == nullptr)
+    {
+        return false;
+    }
+    (void)xSemaphoreTake(s_slotsMutex, portMAX_DELAY);
+    return true;
+}
+
+static void tls_unlock()
+{
+    (void)xSemaphoreGive(s_slotsMutex);
+}
+
+static void tls_dropSlot(OtaTlsSessionSlot &slot)
+{
+    mbedtls_ssl_session_free(&slot.session);
+    mbedtls_ssl_session_init(&slot.session);
+    slot.valid = false;
+    slot.host[0] = '\0';
+    slot.port = 0;
+}
+
+static OtaTlsSessionSlot *tls_findSlot(const char *host, uint16_t port)
+{
+    for (size_t i = 0; i < CFG_OTA_TLS_SESSION_SLOTS; ++i)
+    {
+        OtaTlsSessionSlot &slot = s_slots[i];
+        if (slot.valid && slot.port == port && strcasecmp(slot.host, host) == 0)
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// Hand the cached session for host:port to the handshake. True if one was offered.
+static bool tls_offerSession(mbedtls_ssl_context *ssl, const char *host, uint16_t port)
+{
+    if (!tls_lock())
+    {
+        return false;
+    }
+    bool offered = false;
+    OtaTlsSessionSlot *slot = tls_findSlot(host, port);
+    if (slot && (uint32_t)(millis() - slot->savedAtMs) > (uint32_t)CFG_OTA_TLS_SESSION_TTL_MS)
+    {
+        tls_dropSlot(*slot);
+        slot = nullptr;
+    }
+    if (slot)
+    {
+        offered = mbedtls_ssl_set_session(ssl, &slot->session) == 0;
+    }
+    tls_unlock();
+    return offered;
+}
+
+static void tls_storeSession(const mbedtls_ssl_context *ssl, const char *host, uint16_t port)
+{
+    if (!tls_lock())
+    {
+        return;
+    }
+    OtaTlsSessionSlot *slot = tls_findSlot(host, port);
+    for (size_t i = 0; !slot && i < CFG_OTA_TLS_SESSION_SLOTS; ++i)
+    {
+        if (!s_slots[i].valid)
+        {
+            slot = &s_slots[i];
+        }
+    }
+    if (!slot)
+    {
+        // Evict the oldest entry.
+        slot = &s_slots[0];
+        for (size_t i = 1; i < CFG_OTA_TLS_SESSION_SLOTS; ++i)
+        {
+            if ((int32_t)(s_slots[i].savedAtMs - slot->savedAtMs) < 0)
+            {
+                slot = &s_slots[i];
+            }
+        }
+    }
+    tls_dropSlot(*slot);
+    if (mbedtls_ssl_get_session(ssl, &slot->session) == 0)
+    {
+        strncpy(slot->host, host, sizeof(slot->host));
+        slot->host[sizeof(slot->host) - 1] = '\0';
+        slot->port = port;
+        slot->savedAtMs = millis();
+        slot->valid = true;
+    }
+    else
+    {
+        tls_dropSlot(*slot);
+    }
+    tls_unlock();
+}
+
+static void tls_forgetSession(const char *host, uint16_t port)
+{
+    if (!tls_lock())
+    {
+        return;
+    }
+    OtaTlsSessionSlot *slot = tls_findSlot(host, port);
+    if (slot)
+    {
+        tls_dropSlot(*slot);
+    }
+    tls_unlock();
+}
+
+void ota_tls_begin()
+{
+    if (s_slotsMutex != nullptr)
+    {
+        return;
+    }
+    for (size_t i = 0; i < CFG_OTA_TLS_SESSION_SLOTS; ++i)
+    {
+        mbedtls_ssl_session_init(&s_slots[i].session);
+    }
+    s_slotsMutex = xSemaphoreCreateMutex();
+    if (s_slotsMutex == nullptr)
+    {
+        LOG_WARN(LogDomain::OTA, "TLS session cache disabled: mutex alloc failed");
+    }
+}
+
+void ota_tls_clearSessions()
+{
+    if (!tls_lock())
+    {
+        return;
+    }
+    for (size_t i = 0; i < CFG_OTA_TLS_SESSION_SLOTS; ++i)
+    {
+        tls_dropSlot(s_slots[i]);
+    }
+    tls_unlock();
+}
+
+// Only called while the peer's certificate chain is being verified, which a
+// resumed handshake skips; the count doubles as the "was it resumed" signal.
+static int tls_verifyCb(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags)
+{
+    (void)crt;
+    (void)depth;
+    (void)flags;
+    uint16_t *count = static_cast<uint16_t *>(ctx);
+    if (*count < UINT16_MAX)
+    {
+        (*count)++;
+    }
+    return 0;
+}
+
+static bool tls_tcpConnect(int fd, const IPAddress &ip, uint16_t port, int32_t timeout)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    addr.sin_port = htons(port);
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int res = lwip_connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (res < 0 && errno != EINPROGRESS)
+    {
+        return false;
+    }
+    if (res < 0)
+    {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(fd, &wfds);
+        struct timeval tv;
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        res = select(fd + 1, nullptr, &wfds, nullptr, (timeout > 0) ? &tv : nullptr);
+        if (res <= 0)
+        {
+            return false;
+        }
+        int soErr = 0;
+        socklen_t soLen = sizeof(soErr);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &soErr, &soLen) < 0 || soErr != 0)
+        {
+            return false;
+        }
+    }
+
+    if (timeout > 0)
+    {
+        struct timeval io;
+        io.tv_sec = timeout / 1000;
+        io.tv_usec = (timeout % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &io, sizeof(io));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &io, sizeof(io));
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    return true;
+}
+
+#else
+
+void ota_tls_begin() {}
+
+void ota_tls_clearSessions() {}
+
+#endif // OTA_TLS_RESUMABLE
+
+void OtaTlsClient::noteHandshake(uint32_t elapsedMs, bool resumed)
+{
+    if (_hs.handshakes < UINT16_MAX)
+    {
+        _hs.handshakes++;
+    }
+    if (resumed && _hs.resumed < UINT16_MAX)
+    {
+        _hs.resumed++;
+    }
+    _hs.totalMs += elapsedMs;
+    _hs.lastMs = elapsedMs;
+    _hs.lastResumed = resumed;
+}
+
+#if OTA_TLS_RESUMABLE
+// Same socket/bio setup as the core's start_ssl_client(), plus the one step it
+// has no hook for: mbedtls_ssl_set_session() before the handshake.
+int OtaTlsClient::connectResumable(const char *host, uint16_t port, int32_t timeout)
+{
+    stop();
+    _lastError = 0;
+    _certsVerified = 0;
+
+    const uint32_t startMs = millis();
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip))
+    {
+        return 0;
+    }
+
+    sslclient_context *ctx = sslclient;
+    mbedtls_ssl_init(&ctx->ssl_ctx);
+    mbedtls_ssl_config_init(&ctx->ssl_conf);
+    mbedtls_ctr_drbg_init(&ctx->drbg_ctx);
+    mbedtls_entropy_init(&ctx->entropy_ctx);
+    mbedtls_x509_crt_init(&ctx->ca_cert);
+
+    ctx->socket = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (ctx->socket < 0 || !tls_tcpConnect(ctx->socket, ip, port, timeout))
+    {
+        LOG_WARN(LogDomain::OTA, "TLS connect failed host=%s port=%u errno=%d", host, (unsigned)port, errno);
+        stop();
+        return 0;
+    }
+
+    static const char kPers[] = "ota_tls";
+    int ret = mbedtls_ctr_drbg_seed(&ctx->drbg_ctx,
+                                    mbedtls_entropy_func,
+                                    &ctx->entropy_ctx,
+                                    (const unsigned char *)kPers,
+                                    sizeof(kPers) - 1);
+    if (ret == 0)
+    {
+        ret = mbedtls_ssl_config_defaults(&ctx->ssl_conf,
+                                          MBEDTLS_SSL_IS_CLIENT,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    bool caAttached = false;
+    if (ret == 0 && !_use_insecure)
+    {
+        ret = mbedtls_x509_crt_parse(&ctx->ca_cert, (const unsigned char *)_CA_cert, strlen(_CA_cert) + 1);
+        if (ret >= 0)
+        {
+            ret = 0; // >0 means some roots were skipped; the rest are still usable
+            mbedtls_ssl_conf_ca_chain(&ctx->ssl_conf, &ctx->ca_cert, nullptr);
+            caAttached = true;
+            mbedtls_ssl_conf_authmode(&ctx->ssl_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        }
+    }
+    else if (ret == 0)
+    {
+        mbedtls_ssl_conf_authmode(&ctx->ssl_conf, MBEDTLS_SSL_VERIFY_NONE);
+    }
+    if (ret == 0)
+    {
+        mbedtls_ssl_conf_verify(&ctx->ssl_conf, tls_verifyCb, &_certsVerified);
+        mbedtls_ssl_conf_rng(&ctx->ssl_conf, mbedtls_ctr_drbg_random, &ctx->drbg_ctx);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        mbedtls_ssl_conf_session_tickets(&ctx->ssl_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+        ret = mbedtls_ssl_setup(&ctx->ssl_ctx, &ctx->ssl_conf);
+    }
+    if (ret == 0)
+    {
+        ret = mbedtls_ssl_set_hostname(&ctx->ssl_ctx, host);
+    }
+    if (ret != 0)
+    {
+        // stop() only frees the roots once they are attached to the config.
+        if (!caAttached)
+        {
+            mbedtls_x509_crt_free(&ctx->ca_cert);
+        }
+        _lastError = ret;
+        stop();
+        return 0;
+    }
+    mbedtls_ssl_set_bio(&ctx->ssl_ctx, &ctx->socket, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+    const bool offered = tls_offerSession(&ctx->ssl_ctx, host, port);
+    const uint32_t hsTimeoutMs = (ctx->handshake_timeout > 0) ? (uint32_t)ctx->handshake_timeout : 120000u;
+    const uint32_t hsStartMs = millis();
+    while ((ret = mbedtls_ssl_handshake(&ctx->ssl_ctx)) != 0)
+    {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+        {
+            break;
+        }
+        if ((uint32_t)(millis() - hsStartMs) > hsTimeoutMs)
+        {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    if (ret == 0 && !_use_insecure && mbedtls_ssl_get_verify_result(&ctx->ssl_ctx) != 0)
+    {
+        ret = MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+    }
+    if (ret != 0)
+    {
+        // A stale session must not poison the retry; the next attempt goes full.
+        if (offered)
+        {
+            tls_forgetSession(host, port);
+        }
+        _lastError = ret;
+        stop();
+        return 0;
+    }
+
+    const bool resumed = offered && _certsVerified == 0;
+    tls_storeSession(&ctx->ssl_ctx, host, port);
+    _connected = true;
+
+    const uint32_t elapsedMs = millis() - startMs;
+    noteHandshake(elapsedMs, resumed);
+    LOG_DEBUG(LogDomain::OTA,
+              "TLS handshake host=%s mode=%s offered=%s ms=%lu",
+              host,
+              resumed ? "resumed" : "full",
+              offered ? "true" : "false",
+              (unsigned long)elapsedMs);
+    return 1;
+}
+#endif // OTA_TLS_RESUMABLE
+
+int OtaTlsClient::connect(const char *host, uint16_t port, int32_t timeout)
+{
+#if OTA_TLS_RESUMABLE
+    const bool plainTrust = _use_insecure || (_CA_cert != nullptr && _cert == nullptr && _pskIdent == nullptr);
+    if (host && host[0] != '\0' && plainTrust)
+    {
+        return connectResumable(host, port, timeout);
+    }
+#endif
+    const uint32_t startMs = millis();
+    const int ok = WiFiClientSecure::connect(host, port, timeout);
+    if (ok == 1)
+    {
+        noteHandshake(millis() - startMs, false);
+    }
+    return ok;
+}
+
+int OtaTlsClient::connect(const char *host, uint16_t port)
+{
+    return connect(host, port, (int32_t)_timeout);
+}
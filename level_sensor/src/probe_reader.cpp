@@ -2,11 +2,13 @@
 
 #include <Arduino.h>
 #include "simulation.h"
+#include "trace_replay.h"
 
 static struct
 {
     ProbeConfig cfg = {0, 1, 5}; // default pin 0, 1 sample, 5ms delay
     ReadMode mode = READ_PROBE;  // default mode
+    ReadMode configuredMode = READ_PROBE; // restored when a replay stops
 } probe;
 
 static constexpr uint16_t kMinSamples = 1;
@@ -29,7 +31,32 @@ void probe_begin(const ProbeConfig &config)
 // Contract: mode selects between physical probe and simulation backend.
 void probe_updateMode(ReadMode mode)
 {
-    probe.mode = mode;
+    probe.configuredMode = mode;
+    if (probe.mode != READ_REPLAY)
+    {
+        probe.mode = mode;
+    }
+}
+
+bool probe_startReplay(float speed, bool loop)
+{
+    if (!replay_start(millis(), speed, loop))
+    {
+        return false;
+    }
+    probe.mode = READ_REPLAY;
+    return true;
+}
+
+void probe_stopReplay()
+{
+    replay_stop();
+    probe.mode = probe.configuredMode;
+}
+
+ReadMode probe_getMode()
+{
+    return probe.mode;
 }
 
 // Read raw probe value using touchRead averaged over N samples.
@@ -47,6 +74,15 @@ static uint32_t readProbe(uint8_t pin, uint16_t samples)
 // Contract: returns a raw probe value from the active backend.
 uint32_t probe_getRaw()
 {
+    if (probe.mode == READ_REPLAY)
+    {
+        uint32_t raw = 0;
+        if (replay_rawAt(millis(), raw))
+        {
+            return raw;
+        }
+        probe.mode = probe.configuredMode; // replay stopped underneath us
+    }
     if (probe.mode == READ_SIM)
     {
         return readSimulatedRaw(); // Simulation module is a backend provider for raw probe values.
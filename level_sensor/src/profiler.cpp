@@ -0,0 +1,243 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include "logger.h"
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+static portMUX_TYPE s_profMux = portMUX_INITIALIZER_UNLOCKED;
+#define PROFILER_LOCK() portENTER_CRITICAL(&s_profMux)
+#define PROFILER_UNLOCK() portEXIT_CRITICAL(&s_profMux)
+#else
+#define PROFILER_LOCK()
+#define PROFILER_UNLOCK()
+#endif
+
+namespace
+{
+struct ProfilerSlot
+{
+    const char *name;
+    uint32_t count;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t buckets[CFG_PROFILER_BUCKETS];
+};
+} // namespace
+
+static ProfilerSlot s_slots[CFG_PROFILER_SLOTS];
+static size_t s_slotCount = 0;
+static int s_loopSlot = -1;
+static uint32_t s_windowStartMs = 0;
+
+static uint8_t prof_bucketFor(uint32_t us)
+{
+    if (us < 2u)
+    {
+        return 0;
+    }
+    const uint8_t log2 = (uint8_t)(31 - __builtin_clz(us));
+    return (log2 < CFG_PROFILER_BUCKETS) ? log2 : (uint8_t)(CFG_PROFILER_BUCKETS - 1);
+}
+
+static uint32_t prof_bucketUpperUs(uint8_t bucket)
+{
+    return (bucket >= 31u) ? UINT32_MAX : ((1u << (bucket + 1u)) - 1u);
+}
+
+int profiler_register(const char *name)
+{
+    if (!name)
+    {
+        return -1;
+    }
+    int slot = -1;
+    PROFILER_LOCK();
+    for (size_t i = 0; i < s_slotCount; ++i)
+    {
+        if (strcmp(s_slots[i].name, name) == 0)
+        {
+            slot = (int)i;
+            break;
+        }
+    }
+    if (slot < 0 && s_slotCount < CFG_PROFILER_SLOTS)
+    {
+        memset(&s_slots[s_slotCount], 0, sizeof(s_slots[0]));
+        s_slots[s_slotCount].name = name;
+        slot = (int)s_slotCount++;
+    }
+    PROFILER_UNLOCK();
+    return slot;
+}
+
+void profiler_record(int slot, uint32_t us)
+{
+    if (slot < 0 || (size_t)slot >= s_slotCount)
+    {
+        return;
+    }
+    const uint8_t bucket = prof_bucketFor(us);
+    PROFILER_LOCK();
+    ProfilerSlot &s = s_slots[slot];
+    s.count++;
+    s.totalUs += us;
+    if (us > s.maxUs)
+    {
+        s.maxUs = us;
+    }
+    s.buckets[bucket]++;
+    PROFILER_UNLOCK();
+}
+
+void profiler_loopPass(uint32_t passUs)
+{
+    if (s_loopSlot < 0)
+    {
+        s_loopSlot = profiler_register("loop");
+    }
+    profiler_record(s_loopSlot, passUs);
+}
+
+void profiler_reset(uint32_t nowMs)
+{
+    PROFILER_LOCK();
+    for (size_t i = 0; i < s_slotCount; ++i)
+    {
+        const char *name = s_slots[i].name;
+        memset(&s_slots[i], 0, sizeof(s_slots[0]));
+        s_slots[i].name = name;
+    }
+    s_windowStartMs = nowMs;
+    PROFILER_UNLOCK();
+}
+
+size_t profiler_slotCount()
+{
+    return s_slotCount;
+}
+
+static void prof_summarize(const ProfilerSlot &s, ProfilerSlotSummary &out)
+{
+    out.name = s.name;
+    out.count = s.count;
+    out.maxUs = s.maxUs;
+    out.avgUs = s.count ? (uint32_t)(s.totalUs / s.count) : 0u;
+    out.p99Us = 0u;
+    if (s.count == 0u)
+    {
+        return;
+    }
+    // Smallest bucket whose cumulative count reaches 99% (rounded up).
+    const uint32_t target = s.count - s.count / 100u;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < CFG_PROFILER_BUCKETS; ++b)
+    {
+        seen += s.buckets[b];
+        if (seen >= target)
+        {
+            const uint32_t upper = prof_bucketUpperUs(b);
+            out.p99Us = (upper < s.maxUs) ? upper : s.maxUs;
+            return;
+        }
+    }
+    out.p99Us = s.maxUs;
+}
+
+bool profiler_getSummary(size_t slot, ProfilerSlotSummary &out)
+{
+    if (slot >= s_slotCount)
+    {
+        return false;
+    }
+    PROFILER_LOCK();
+    const ProfilerSlot copy = s_slots[slot];
+    PROFILER_UNLOCK();
+    prof_summarize(copy, out);
+    return true;
+}
+
+static uint32_t prof_loopHzX10(uint32_t nowMs)
+{
+    const uint32_t elapsedMs = nowMs - s_windowStartMs;
+    if (s_loopSlot < 0 || elapsedMs == 0u)
+    {
+        return 0u;
+    }
+    return (uint32_t)((uint64_t)s_slots[s_loopSlot].count * 10000u / elapsedMs);
+}
+
+bool profiler_buildJson(char *out, size_t outSize, uint32_t nowMs)
+{
+    if (!out || outSize == 0u)
+    {
+        return false;
+    }
+    const uint32_t hzX10 = prof_loopHzX10(nowMs);
+    int n = snprintf(out, outSize, "{\"window_s\":%lu,\"loop_hz\":%lu.%lu,\"bucket\":\"log2_us\",\"slots\":[",
+                     (unsigned long)((nowMs - s_windowStartMs) / 1000u),
+                     (unsigned long)(hzX10 / 10u), (unsigned long)(hzX10 % 10u));
+    for (size_t i = 0; i < s_slotCount; ++i)
+    {
+        if (n < 0 || (size_t)n >= outSize)
+        {
+            return false;
+        }
+        PROFILER_LOCK();
+        const ProfilerSlot copy = s_slots[i];
+        PROFILER_UNLOCK();
+        ProfilerSlotSummary sum{};
+        prof_summarize(copy, sum);
+        n += snprintf(out + n, outSize - (size_t)n,
+                      "%s{\"name\":\"%s\",\"n\":%lu,\"avg_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu,\"hist\":[",
+                      i ? "," : "", sum.name, (unsigned long)sum.count, (unsigned long)sum.avgUs,
+                      (unsigned long)sum.p99Us, (unsigned long)sum.maxUs);
+        // Trailing empty buckets are omitted; index = log2 of the duration.
+        int last = -1;
+        for (int b = 0; b < CFG_PROFILER_BUCKETS; ++b)
+        {
+            if (copy.buckets[b])
+            {
+                last = b;
+            }
+        }
+        for (int b = 0; b <= last; ++b)
+        {
+            if (n < 0 || (size_t)n >= outSize)
+            {
+                return false;
+            }
+            n += snprintf(out + n, outSize - (size_t)n, "%s%lu", b ? "," : "", (unsigned long)copy.buckets[b]);
+        }
+        if (n < 0 || (size_t)n >= outSize)
+        {
+            return false;
+        }
+        n += snprintf(out + n, outSize - (size_t)n, "]}");
+    }
+    if (n < 0 || (size_t)n >= outSize)
+    {
+        return false;
+    }
+    n += snprintf(out + n, outSize - (size_t)n, "]}");
+    return n > 0 && (size_t)n < outSize;
+}
+
+void profiler_log(uint32_t nowMs)
+{
+    const uint32_t hzX10 = prof_loopHzX10(nowMs);
+    LOG_INFO(LogDomain::SYSTEM, "[PROF] window_s=%lu loop_hz=%lu.%lu",
+             (unsigned long)((nowMs - s_windowStartMs) / 1000u),
+             (unsigned long)(hzX10 / 10u), (unsigned long)(hzX10 % 10u));
+    for (size_t i = 0; i < s_slotCount; ++i)
+    {
+        ProfilerSlotSummary sum{};
+        if (!profiler_getSummary(i, sum))
+        {
+            continue;
+        }
+        LOG_INFO(LogDomain::SYSTEM, "[PROF] %-10s n=%lu avg_us=%lu p99_us=%lu max_us=%lu",
+                 sum.name, (unsigned long)sum.count, (unsigned long)sum.avgUs,
+                 (unsigned long)sum.p99Us, (unsigned long)sum.maxUs);
+    }
+}
@@ -17,6 +17,42 @@ void quality_init(QualityRuntime &rt)
     rt.zeroWindowStart = kWindowInactive;
 }
 
+void quality_configDefaults(QualityConfig &qc)
+{
+    qc = QualityConfig{};
+    qc.disconnectedBelowRaw = CFG_PROBE_DISCONNECTED_BELOW_RAW;
+    qc.rawMin = CFG_PROBE_MIN_RAW;
+    qc.rawMax = CFG_PROBE_MAX_RAW;
+    qc.rapidFluctuationDelta = CFG_RAPID_FLUCTUATION_DELTA;
+    qc.spikeDelta = CFG_SPIKE_DELTA;
+    qc.spikeWindowMs = CFG_SPIKE_WINDOW_MS;
+    qc.stuckDelta = CFG_STUCK_EPS;
+    qc.stuckMs = CFG_STUCK_MS;
+    qc.calRecommendMargin = CFG_CAL_RECOMMEND_MARGIN;
+    qc.calRecommendWindowMs = CFG_CAL_RECOMMEND_WINDOW_MS;
+    qc.zeroWindowMs = CFG_ZERO_WINDOW_MS;
+    qc.spikeCountThreshold = (uint8_t)CFG_SPIKE_COUNT_THRESHOLD;
+    qc.calRecommendCount = (uint8_t)CFG_CAL_RECOMMEND_COUNT;
+    qc.zeroHitCount = (uint8_t)CFG_ZERO_HIT_COUNT;
+}
+
+// The evaluator compares against these as int32 (calibration margin) and uses
+// the counts as "at least one event"; windows are capped at a day.
+bool quality_validateConfig(const QualityConfig &qc)
+{
+    static constexpr uint32_t kMaxWindowMs = 86400000u;
+    if (qc.rawMin > qc.rawMax || qc.rawMax > (uint32_t)INT32_MAX || qc.calRecommendMargin > (uint32_t)INT32_MAX / 2u)
+    {
+        return false;
+    }
+    if (qc.spikeCountThreshold == 0u || qc.calRecommendCount == 0u || qc.zeroHitCount == 0u)
+    {
+        return false;
+    }
+    return qc.spikeWindowMs <= kMaxWindowMs && qc.stuckMs <= kMaxWindowMs &&
+           qc.calRecommendWindowMs <= kMaxWindowMs && qc.zeroWindowMs <= kMaxWindowMs;
+}
+
 static bool windowActive(uint32_t start)
 {
     return start != kWindowInactive;
@@ -199,57 +235,20 @@ finalize:
     return res;
 }
 
-#if defined(QUALITY_SELF_TEST)
-// Minimal self-test harness (compile-time gated).
-// Scenarios:
-// 1) disconnected: raw < disconnectedBelowRaw -> DISCONNECTED_LOW_RAW
-// 2) spike burst: repeated large deltas within spikeWindow -> UNRELIABLE_SPIKES
-// 3) stuck: delta <= stuckDelta for >= stuckMs -> UNRELIABLE_STUCK
-// 4) zero hits: raw==0 count within zeroWindow -> ZERO_HITS
-// 5) cal recommend: repeated below/above bounds -> CALIBRATION_RECOMMENDED
-static void quality_selfTest()
+void quality_evaluateBatch(const uint32_t *raw,
+                           const uint32_t *nowMs,
+                           size_t count,
+                           const AppliedConfig &cfg,
+                           const QualityConfig &qc,
+                           QualityRuntime &rt,
+                           QualityResult *out)
 {
-    QualityConfig qc{};
-    qc.disconnectedBelowRaw = 10;
-    qc.rawMin = 0;
-    qc.rawMax = 1000000;
-    qc.rapidFluctuationDelta = 100;
-    qc.spikeDelta = 500;
-    qc.spikeCountThreshold = 3;
-    qc.spikeWindowMs = 1000;
-    qc.stuckDelta = 2;
-    qc.stuckMs = 1000;
-    qc.calRecommendMargin = 10;
-    qc.calRecommendCount = 2;
-    qc.calRecommendWindowMs = 1000;
-    qc.zeroHitCount = 2;
-    qc.zeroWindowMs = 1000;
-
-    AppliedConfig cfg{};
-    cfg.calDry = 200;
-    cfg.calWet = 800;
-
-    QualityRuntime rt{};
-    quality_init(rt);
-
-    (void)quality_evaluate(5, cfg, qc, rt, 0); // disconnected
-    quality_init(rt);
-
-    (void)quality_evaluate(100, cfg, qc, rt, 0);
-    (void)quality_evaluate(700, cfg, qc, rt, 100); // spike 1
-    (void)quality_evaluate(100, cfg, qc, rt, 200); // spike 2
-    (void)quality_evaluate(700, cfg, qc, rt, 300); // spike 3 -> unreliable_spikes
-
-    quality_init(rt);
-    (void)quality_evaluate(500, cfg, qc, rt, 0);
-    (void)quality_evaluate(501, cfg, qc, rt, 1000); // stuck -> unreliable_stuck
-
-    quality_init(rt);
-    (void)quality_evaluate(0, cfg, qc, rt, 0);
-    (void)quality_evaluate(0, cfg, qc, rt, 100); // zero_hits
-
-    quality_init(rt);
-    (void)quality_evaluate(50, cfg, qc, rt, 0);
-    (void)quality_evaluate(50, cfg, qc, rt, 100); // below -> cal recommend
+    if (!raw || !nowMs || !out)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = quality_evaluate(raw[i], cfg, qc, rt, nowMs[i]);
+    }
 }
-#endif
@@ -0,0 +1,147 @@
+#include "quality_replay.h"
+#include <stdio.h>
+#include <string.h>
+#include "domain_strings.h"
+#include "trace_replay.h"
+
+static bool isAnomaly(ProbeQualityReason reason)
+{
+    return reason == ProbeQualityReason::ANOMALY_OUTLIER || reason == ProbeQualityReason::ANOMALY_NOISE ||
+           reason == ProbeQualityReason::ANOMALY_SHIFT;
+}
+
+bool quality_replayTrace(const AppliedConfig &cfg, const QualityConfig &qc, const DriftConfig *drift,
+                         const AnomalyConfig *anomaly, QualityReplayReport &out, uint32_t (*nowUs)())
+{
+    memset(&out, 0, sizeof(out));
+    ReplayStatus st{};
+    replay_getStatus(st);
+    if (st.active || st.count == 0u || !nowUs)
+    {
+        return false;
+    }
+
+    QualityRuntime rt{};
+    quality_init(rt);
+    DriftState ds{};
+    drift_init(ds, 0.0f);
+    AnomalyState as{};
+    anomaly_init(as);
+    replay_rewind();
+
+    const uint32_t startUs = nowUs();
+    bool havePrev = false;
+    QualityResult prev{};
+    uint32_t prevMs = 0;
+    ReplaySample s{};
+    for (uint32_t i = 0; i < st.count && replay_next(s); ++i)
+    {
+        uint32_t raw = s.raw;
+        if (drift)
+        {
+            // Same gating as the live path: learn only from connected, plausible samples.
+            const bool trusted = !havePrev || (prev.connected && (prev.reason == ProbeQualityReason::OK ||
+                                                                  prev.reason == ProbeQualityReason::CALIBRATION_RECOMMENDED));
+            raw = (uint32_t)drift_update(ds, *drift, (int32_t)s.raw, s.tMs, trusted);
+        }
+        QualityResult qr = quality_evaluate(raw, cfg, qc, rt, s.tMs);
+        if (anomaly)
+        {
+            // The statistical tier reads the threshold result but never feeds back into it.
+            qr = anomaly_evaluate(as, *anomaly, raw, s.tMs, qr).quality;
+        }
+        if (havePrev)
+        {
+            // The previous result holds until this sample.
+            const uint32_t heldMs = s.tMs - prevMs;
+            out.msByReason[(size_t)prev.reason] += heldMs;
+            if (!prev.connected)
+            {
+                out.disconnectedMs += heldMs;
+            }
+        }
+        if (!havePrev || qr.reason != prev.reason || qr.connected != prev.connected)
+        {
+            if (havePrev)
+            {
+                out.transitions++;
+            }
+            if (isAnomaly(qr.reason) && (!havePrev || !isAnomaly(prev.reason)))
+            {
+                out.anomalyEvents++;
+            }
+            if (out.logged < CFG_QUALITY_REPLAY_LOG)
+            {
+                out.log[out.logged++] = QualityReplayTransition{s.tMs, qr.reason, qr.connected};
+            }
+        }
+        prev = qr;
+        prevMs = s.tMs;
+        havePrev = true;
+        out.samples++;
+    }
+    out.cpuUs = nowUs() - startUs;
+    out.driftCompensated = drift != nullptr;
+    out.driftOffset = ds.offset;
+    out.anomalyEvaluated = anomaly != nullptr;
+    out.spanMs = prevMs;
+    replay_rewind();
+    return out.samples > 0u;
+}
+
+bool quality_replayBuildJson(const QualityReplayReport &report, const QualityConfig &qc,
+                             char *out, size_t outSize)
+{
+    if (!out || outSize == 0u)
+    {
+        return false;
+    }
+    int n = snprintf(out, outSize,
+                     "{\"samples\":%lu,\"span_ms\":%lu,\"cpu_us\":%lu,\"transitions\":%lu,\"disconnected_ms\":%lu,"
+                     "\"stuck_ms\":%lu,\"spike_window_ms\":%lu,\"cal_recommend_window_ms\":%lu,"
+                     "\"drift_comp\":%s,\"drift_offset\":%.1f,\"anomaly\":%s,\"anomaly_events\":%lu,"
+                     "\"anomaly_events_per_h\":%.2f,\"ms_by_reason\":{",
+                     (unsigned long)report.samples, (unsigned long)report.spanMs, (unsigned long)report.cpuUs,
+                     (unsigned long)report.transitions, (unsigned long)report.disconnectedMs,
+                     (unsigned long)qc.stuckMs, (unsigned long)qc.spikeWindowMs,
+                     (unsigned long)qc.calRecommendWindowMs,
+                     report.driftCompensated ? "true" : "false", (double)report.driftOffset,
+                     report.anomalyEvaluated ? "true" : "false", (unsigned long)report.anomalyEvents,
+                     report.spanMs ? (double)report.anomalyEvents * 3600000.0 / (double)report.spanMs : 0.0);
+    bool first = true;
+    for (size_t r = 0; r < QUALITY_REASON_COUNT; ++r)
+    {
+        if (report.msByReason[r] == 0u)
+        {
+            continue;
+        }
+        if (n < 0 || (size_t)n >= outSize)
+        {
+            return false;
+        }
+        n += snprintf(out + n, outSize - (size_t)n, "%s\"%s\":%lu", first ? "" : ",",
+                      toString((ProbeQualityReason)r), (unsigned long)report.msByReason[r]);
+        first = false;
+    }
+    if (n < 0 || (size_t)n >= outSize)
+    {
+        return false;
+    }
+    n += snprintf(out + n, outSize - (size_t)n, "},\"log\":[");
+    for (uint8_t i = 0; i < report.logged; ++i)
+    {
+        if (n < 0 || (size_t)n >= outSize)
+        {
+            return false;
+        }
+        const QualityReplayTransition &t = report.log[i];
+        n += snprintf(out + n, outSize - (size_t)n, "%s[%lu,\"%s\",%s]", i ? "," : "",
+                      (unsigned long)t.tMs, toString(t.reason), t.connected ? "true" : "false");
+    }
+    if (n < 0 || (size_t)n >= outSize)
+    {
+        return false;
+    }
+    n += snprintf(out + n, outSize - (size_t)n, "]}");
+    return n > 0 && (size_t)n < outSize;
+}
@@ -0,0 +1,219 @@
+#include "scheduler.h"
+#include <string.h>
+
+static constexpr size_t kMaxTasks = CFG_SCHED_MAX_TASKS;
+
+static SchedTask *s_tasks = nullptr;
+static size_t s_count = 0;
+static SchedHooks s_hooks{};
+static bool s_otaWasBusy = false;
+
+static bool sched_isDue(const SchedTask &t, uint32_t now)
+{
+    return (int32_t)(now - t.nextDueMs) >= 0;
+}
+
+static uint32_t sched_deadline(const SchedTask &t)
+{
+    return t.deadlineMs ? t.deadlineMs : t.periodMs;
+}
+
+bool sched_begin(SchedTask *tasks, size_t count, const SchedHooks &hooks)
+{
+    s_tasks = nullptr;
+    s_count = 0;
+    if (tasks == nullptr || count > kMaxTasks || !hooks.nowMs || !hooks.nowUs)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (tasks[i].periodMs == 0u || tasks[i].fn == nullptr)
+        {
+            return false;
+        }
+    }
+
+    s_tasks = tasks;
+    s_count = count;
+    s_hooks = hooks;
+    s_otaWasBusy = false;
+    const uint32_t now = s_hooks.nowMs();
+    for (size_t i = 0; i < s_count; ++i)
+    {
+        s_tasks[i].nextDueMs = now;
+        s_tasks[i].lastStartMs = now;
+        s_tasks[i].stats = SchedTaskStats{};
+    }
+    return true;
+}
+
+// A release missed by a whole period or more is dropped: the grid restarts at now.
+static void sched_rebaseIfStale(SchedTask &t, uint32_t now)
+{
+    const uint32_t behind = now - t.nextDueMs;
+    if ((int32_t)behind >= (int32_t)t.periodMs)
+    {
+        t.stats.skippedReleases += behind / t.periodMs;
+        t.nextDueMs = now;
+    }
+}
+
+static void sched_runTask(SchedTask &t, uint32_t now)
+{
+    const uint32_t releaseMs = t.nextDueMs;
+    const uint32_t lateMs = now - releaseMs;
+    const uint32_t startUs = s_hooks.nowUs();
+    t.fn();
+    const uint32_t execUs = s_hooks.nowUs() - startUs;
+
+    SchedTaskStats &st = t.stats;
+    st.runs++;
+    st.lastExecUs = execUs;
+    if (execUs > st.maxExecUs)
+    {
+        st.maxExecUs = execUs;
+    }
+    st.totalExecUs += execUs;
+    st.lastLateMs = lateMs;
+    if (lateMs > st.maxLateMs)
+    {
+        st.maxLateMs = lateMs;
+    }
+    st.totalLateMs += lateMs;
+    if (s_hooks.onRun)
+    {
+        s_hooks.onRun(t, execUs);
+    }
+
+    const uint32_t deadline = sched_deadline(t);
+    if (deadline > 0u && (lateMs + execUs / 1000u) > deadline)
+    {
+        st.overruns++;
+        if (s_hooks.onOverrun)
+        {
+            s_hooks.onOverrun(t, lateMs, execUs);
+        }
+    }
+
+    t.lastStartMs = now;
+    // Stay on the release grid; if a whole period was missed, restart from now.
+    t.nextDueMs = releaseMs + t.periodMs;
+    sched_rebaseIfStale(t, s_hooks.nowMs());
+}
+
+uint32_t sched_runOnce()
+{
+    if (!s_tasks)
+    {
+        return 0u;
+    }
+
+    const bool otaBusy = s_hooks.otaBusy && s_hooks.otaBusy();
+    const uint32_t now = s_hooks.nowMs();
+    if (s_otaWasBusy && !otaBusy)
+    {
+        // The releases held back by the job are stale now, not late.
+        for (size_t i = 0; i < s_count; ++i)
+        {
+            if (s_tasks[i].policy == SchedPolicy::SKIP_DURING_OTA)
+            {
+                sched_rebaseIfStale(s_tasks[i], now);
+            }
+        }
+    }
+    s_otaWasBusy = otaBusy;
+
+    // Collect due tasks, then run them most urgent first.
+    size_t order[kMaxTasks];
+    size_t due = 0;
+    for (size_t i = 0; i < s_count; ++i)
+    {
+        const SchedTask &t = s_tasks[i];
+        if (t.policy == SchedPolicy::SKIP_DURING_OTA && otaBusy)
+        {
+            continue;
+        }
+        if (!sched_isDue(t, now))
+        {
+            continue;
+        }
+        size_t j = due++;
+        while (j > 0 && s_tasks[order[j - 1]].priority > t.priority)
+        {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+    }
+    for (size_t k = 0; k < due; ++k)
+    {
+        sched_runTask(s_tasks[order[k]], s_hooks.nowMs());
+    }
+
+    const uint32_t after = s_hooks.nowMs();
+    uint32_t idleMs = UINT32_MAX;
+    for (size_t i = 0; i < s_count; ++i)
+    {
+        const SchedTask &t = s_tasks[i];
+        if (t.policy == SchedPolicy::SKIP_DURING_OTA && otaBusy)
+        {
+            continue;
+        }
+        if (sched_isDue(t, after))
+        {
+            return 0u;
+        }
+        const uint32_t wait = t.nextDueMs - after;
+        if (wait < idleMs)
+        {
+            idleMs = wait;
+        }
+    }
+    return (idleMs == UINT32_MAX) ? 0u : idleMs;
+}
+
+SchedTask *sched_find(const char *name)
+{
+    for (size_t i = 0; i < s_count; ++i)
+    {
+        if (strcmp(s_tasks[i].name, name) == 0)
+        {
+            return &s_tasks[i];
+        }
+    }
+    return nullptr;
+}
+
+bool sched_setPeriod(SchedTask &task, uint32_t periodMs)
+{
+    if (periodMs == 0u)
+    {
+        return false;
+    }
+    task.periodMs = periodMs;
+    task.nextDueMs = task.lastStartMs + periodMs;
+    return true;
+}
+
+void sched_trigger(SchedTask &task)
+{
+    if (s_hooks.nowMs)
+    {
+        task.nextDueMs = s_hooks.nowMs();
+    }
+}
+
+size_t sched_tasks(const SchedTask *&tasks)
+{
+    tasks = s_tasks;
+    return s_count;
+}
+
+void sched_resetStats()
+{
+    for (size_t i = 0; i < s_count; ++i)
+    {
+        s_tasks[i].stats = SchedTaskStats{};
+    }
+}
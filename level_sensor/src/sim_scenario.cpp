@@ -0,0 +1,220 @@
+#include "sim_scenario.h"
+#include <math.h>
+#include <string.h>
+
+static constexpr float kTwoPi = 6.2831853f;
+
+// Mode numbers are persisted (sim_mode) and exposed as HA select options.
+// Spike and rapid amplitudes sit inside the stock quality_config.h bands;
+// test_scenario checks that each scenario trips the verdict it is named for.
+static const SimScenario kBuiltin[] = {
+    {"disconnected", 3, {{SimLayerType::HOLD, 0, 0, 0.0f, 0.0f}, {SimLayerType::NOISE, 0, 0, 20.0f, 0.0f}, {SimLayerType::DISCONNECT, 13000, 3000, 0.0f, 0.0f}}},
+    {"fill", 2, {{SimLayerType::FILL, 120000, 0, 0.0f, 0.0f}, {SimLayerType::NOISE, 0, 0, 20.0f, 0.0f}}},
+    {"drain", 2, {{SimLayerType::DRAIN, 120000, 0, 0.0f, 0.0f}, {SimLayerType::NOISE, 0, 0, 20.0f, 0.0f}}},
+    {"spikes", 3, {{SimLayerType::HOLD, 0, 0, 0.0f, 0.0f}, {SimLayerType::OSCILLATE, 10000, 0, 0.0f, 0.01f}, {SimLayerType::SPIKES, 3000, 500, 0.0f, 0.2f}}},
+    {"rapid_fluctuation", 3, {{SimLayerType::HOLD, 0, 0, 0.0f, 0.0f}, {SimLayerType::NOISE, 0, 0, 20.0f, 0.0f}, {SimLayerType::RAPID, 10000, 4000, 0.0f, 0.06f}}},
+    {"stuck", 3, {{SimLayerType::FILL, 600000, 0, 0.0f, 0.0f}, {SimLayerType::NOISE, 0, 0, 20.0f, 0.0f}, {SimLayerType::STUCK, 20000, 12000, 0.0f, 0.0f}}},
+    {"range_shift", 3, {{SimLayerType::HOLD, 0, 0, 0.0f, 0.0f}, {SimLayerType::NOISE, 0, 0, 20.0f, 0.0f}, {SimLayerType::RANGE_SHIFT, 20000, 20000, 500.0f, 0.0f}}},
+};
+
+static const char *const kLayerNames[(size_t)SimLayerType::COUNT] = {
+    "fill", "drain", "hold", "oscillate", "noise", "drift", "spikes", "rapid", "stuck", "disconnect", "range_shift"};
+
+uint32_t sim_rngNext(uint32_t &state)
+{
+    // xorshift32; zero is a fixed point, so it is never used as state.
+    uint32_t x = state ? state : CFG_SIM_DEFAULT_SEED;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+static float sim_rngUnit(uint32_t &state)
+{
+    return (float)(sim_rngNext(state) >> 8) / 16777216.0f; // [0, 1)
+}
+
+// Irwin-Hall approximation (sum of 4 uniforms), unit variance.
+static float sim_rngGauss(uint32_t &state)
+{
+    const float sum = sim_rngUnit(state) + sim_rngUnit(state) + sim_rngUnit(state) + sim_rngUnit(state);
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+static uint32_t sim_jitter(uint32_t &state, uint32_t periodMs)
+{
+    // 0.5x .. 1.5x of the nominal period
+    return periodMs / 2u + (uint32_t)(sim_rngUnit(state) * (float)periodMs);
+}
+
+static float sim_amplitude(const SimLayer &layer, const SimRange &range)
+{
+    return layer.amplitude + layer.rangeFrac * (float)(range.wet - range.dry);
+}
+
+void sim_engineStart(SimEngine &engine, const SimScenario &scenario, uint32_t seed,
+                     uint32_t nowMs, int32_t startRaw, const SimRange &range)
+{
+    memset(&engine, 0, sizeof(engine));
+    engine.scenario = &scenario;
+    engine.rng = seed ? seed : CFG_SIM_DEFAULT_SEED;
+    engine.startMs = nowMs;
+    if (startRaw < range.dry || startRaw > range.wet)
+    {
+        startRaw = range.dry;
+    }
+    engine.startRaw = startRaw;
+    const int32_t span = range.wet - range.dry;
+    engine.startFraction = (span > 0) ? (float)(startRaw - range.dry) / (float)span : 0.0f;
+    for (uint8_t i = 0; i < scenario.count && i < CFG_SIM_MAX_LAYERS; ++i)
+    {
+        SimLayerState &st = engine.st[i];
+        st.dir = 1;
+        if (scenario.layers[i].type == SimLayerType::SPIKES || scenario.layers[i].type == SimLayerType::RANGE_SHIFT)
+        {
+            st.eventMs = nowMs + sim_jitter(engine.rng, scenario.layers[i].periodMs);
+        }
+    }
+}
+
+static bool sim_due(uint32_t nowMs, uint32_t atMs)
+{
+    return (int32_t)(nowMs - atMs) >= 0;
+}
+
+static float sim_applyLayer(SimEngine &e, const SimLayer &layer, SimLayerState &st,
+                            float v, uint32_t nowMs, const SimRange &range)
+{
+    const uint32_t elapsed = nowMs - e.startMs;
+    const float span = (float)(range.wet - range.dry);
+    const float amp = sim_amplitude(layer, range);
+    const uint32_t period = layer.periodMs ? layer.periodMs : 1u;
+
+    switch (layer.type)
+    {
+    case SimLayerType::FILL:
+    {
+        const float f = fmodf(e.startFraction + (float)elapsed / (float)period, 1.0f);
+        return (float)range.dry + span * f;
+    }
+    case SimLayerType::DRAIN:
+    {
+        const float f = fmodf((1.0f - e.startFraction) + (float)elapsed / (float)period, 1.0f);
+        return (float)range.dry + span * (1.0f - f);
+    }
+    case SimLayerType::HOLD:
+        return ((layer.rangeFrac > 0.0f) ? (float)range.dry + span * layer.rangeFrac : (float)e.startRaw) + layer.amplitude;
+    case SimLayerType::OSCILLATE:
+        return v + amp * sinf(kTwoPi * (float)(elapsed % period) / (float)period);
+    case SimLayerType::NOISE:
+        return v + amp * sim_rngGauss(e.rng);
+    case SimLayerType::DRIFT:
+        return v + amp * ((float)elapsed / 3600000.0f);
+    case SimLayerType::SPIKES:
+        if (!st.active && sim_due(nowMs, st.eventMs))
+        {
+            st.active = true;
+            st.phaseMs = nowMs;
+            st.dir = (sim_rngNext(e.rng) & 1u) ? 1 : -1;
+            st.eventMs = nowMs + layer.durationMs + sim_jitter(e.rng, period);
+        }
+        if (st.active && (uint32_t)(nowMs - st.phaseMs) >= layer.durationMs)
+        {
+            st.active = false;
+        }
+        return st.active ? v + (float)st.dir * amp : v;
+    case SimLayerType::RAPID:
+        if ((elapsed % period) < layer.durationMs)
+        {
+            e.toggle = !e.toggle;
+            return v + (e.toggle ? amp : -amp);
+        }
+        return v;
+    case SimLayerType::STUCK:
+        if ((elapsed % period) < layer.durationMs)
+        {
+            if (!st.active)
+            {
+                st.active = true;
+                st.value = v;
+            }
+            return st.value;
+        }
+        st.active = false;
+        return v;
+    case SimLayerType::DISCONNECT:
+        return ((elapsed % period) + layer.durationMs >= period) ? (float)range.disconnectedRaw : v;
+    case SimLayerType::RANGE_SHIFT:
+        if (sim_due(nowMs, st.eventMs))
+        {
+            st.value = st.target;
+            st.target += (sim_rngNext(e.rng) & 1u) ? amp : -amp;
+            st.phaseMs = nowMs;
+            st.eventMs = nowMs + period;
+        }
+        else
+        {
+            const uint32_t rampMs = layer.durationMs ? layer.durationMs : 1u;
+            const uint32_t since = nowMs - st.phaseMs;
+            const float from = st.value;
+            const float k = (since >= rampMs) ? 1.0f : (float)since / (float)rampMs;
+            return v + from + (st.target - from) * k;
+        }
+        return v + st.value;
+    default:
+        return v;
+    }
+}
+
+int32_t sim_engineSample(SimEngine &engine, uint32_t nowMs, const SimRange &range)
+{
+    if (!engine.scenario)
+    {
+        return engine.startRaw;
+    }
+    float v = (float)engine.startRaw;
+    const uint8_t count = engine.scenario->count < CFG_SIM_MAX_LAYERS ? engine.scenario->count : CFG_SIM_MAX_LAYERS;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        v = sim_applyLayer(engine, engine.scenario->layers[i], engine.st[i], v, nowMs, range);
+    }
+    if (v < 0.0f)
+    {
+        v = 0.0f;
+    }
+    return (int32_t)lroundf(v);
+}
+
+const SimScenario *sim_builtinScenario(uint8_t mode)
+{
+    return (mode < sim_builtinCount()) ? &kBuiltin[mode] : nullptr;
+}
+
+uint8_t sim_builtinCount()
+{
+    return (uint8_t)(sizeof(kBuiltin) / sizeof(kBuiltin[0]));
+}
+
+bool sim_layerTypeFromString(const char *name, SimLayerType &out)
+{
+    if (!name)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < (uint8_t)SimLayerType::COUNT; ++i)
+    {
+        if (strcmp(name, kLayerNames[i]) == 0)
+        {
+            out = (SimLayerType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *sim_layerTypeName(SimLayerType type)
+{
+    return ((uint8_t)type < (uint8_t)SimLayerType::COUNT) ? kLayerNames[(uint8_t)type] : "unknown";
+}
@@ -15,21 +15,23 @@ static uint16_t clampToU16(size_t value)
 StateJsonError buildStateJson(const DeviceState &s, char *outBuf, size_t outSize, StateJsonDiag *diag)
 {
     // Capacity rationale (ArduinoJson v6):
-    // - Objects created by dotted paths: root + device + wifi + time + mqtt + probe + calibration + level + config + ota + ota.active + ota.result + last_cmd = 13
-    // - Leaf keys (worst case): 74 (schema/ts/uptime_seconds/boot_count/reboot_intent*/safe_mode*/crash_*/reset_reason/device/.../last_cmd.* + time.* + ota.force + ota.reboot + ota_last_success_ts)
+    // - Objects created by dotted paths: root + device + wifi + time + mqtt + probe + calibration + level + config + config.quality + ota + ota.active + ota.result + ota.stats + last_cmd = 15
+    // - Leaf keys (worst case): 87 (schema/ts/uptime_seconds/boot_count/reboot_intent*/safe_mode*/crash_*/reset_reason/device/.../last_cmd.* + time.* + ota.force + ota.reboot + ota_last_success_ts)
     // - String pool: conservative sum of max field sizes + enum labels + key bytes headroom.
     static constexpr size_t kRootMembers = 39;
     static constexpr size_t kDeviceMembers = 3;
     static constexpr size_t kWifiMembers = 2;
     static constexpr size_t kTimeMembers = 5;
     static constexpr size_t kMqttMembers = 1;
-    static constexpr size_t kProbeMembers = 4;
-    static constexpr size_t kCalibrationMembers = 5;
+    static constexpr size_t kProbeMembers = 6;
+    static constexpr size_t kCalibrationMembers = 6;
     static constexpr size_t kLevelMembers = 6;
-    static constexpr size_t kConfigMembers = 4;
-    static constexpr size_t kOtaMembers = 6;
+    static constexpr size_t kConfigMembers = 6;
+    static constexpr size_t kConfigQualityMembers = 14;
+    static constexpr size_t kOtaMembers = 7;
     static constexpr size_t kOtaActiveMembers = 5;
     static constexpr size_t kOtaResultMembers = 3;
+    static constexpr size_t kOtaStatsMembers = 15;
     static constexpr size_t kLastCmdMembers = 5;
 
     static constexpr size_t kJsonObjectCapacity =
@@ -42,9 +44,11 @@ StateJsonError buildStateJson(const DeviceState &s, char *outBuf, size_t outSize
         JSON_OBJECT_SIZE(kCalibrationMembers) +
         JSON_OBJECT_SIZE(kLevelMembers) +
         JSON_OBJECT_SIZE(kConfigMembers) +
+        JSON_OBJECT_SIZE(kConfigQualityMembers) +
         JSON_OBJECT_SIZE(kOtaMembers) +
         JSON_OBJECT_SIZE(kOtaActiveMembers) +
         JSON_OBJECT_SIZE(kOtaResultMembers) +
+        JSON_OBJECT_SIZE(kOtaStatsMembers) +
         JSON_OBJECT_SIZE(kLastCmdMembers);
 
     // Conservative maxima for string fields (buffers include NUL in DeviceState; over-allocating is ok).
@@ -74,6 +78,7 @@ StateJsonError buildStateJson(const DeviceState &s, char *outBuf, size_t outSize
         JSON_STRING_SIZE(kMaxEnumStr) +             // probe.quality
         JSON_STRING_SIZE(kMaxEnumStr) +             // calibration.state
         JSON_STRING_SIZE(kMaxEnumStr) +             // config.sense_mode
+        JSON_STRING_SIZE(kMaxEnumStr) +             // config.tank_shape
         JSON_STRING_SIZE(OTA_STATE_MAX) +
         JSON_STRING_SIZE(OTA_ERROR_MAX) +
         JSON_STRING_SIZE(OTA_TARGET_VERSION_MAX) +
@@ -91,7 +96,7 @@ StateJsonError buildStateJson(const DeviceState &s, char *outBuf, size_t outSize
         JSON_STRING_SIZE(kMaxEnumStr) +             // last_cmd.status
         JSON_STRING_SIZE(kMaxLastCmdMsg);
 
-    static constexpr size_t kJsonKeyBytes = 840; // ~80 keys * avg 10 bytes + headroom
+    static constexpr size_t kJsonKeyBytes = 1260; // ~94 keys * avg 10 bytes + 15 config.quality keys * avg 16 + headroom
     static constexpr size_t kStateJsonCapacity = kJsonObjectCapacity + kJsonStringCapacity + kJsonKeyBytes;
     static constexpr size_t kMinJsonSize = 2; // "{}"
 
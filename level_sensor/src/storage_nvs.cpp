@@ -1,12 +1,20 @@
 #include <Arduino.h>
-#include <Preferences.h>
+#include "nvs_wear.h"
 #include <limits>
+#include <string.h>
 #include "storage_nvs.h"
 #include "logger.h"
 #include "domain_strings.h"
 #include "config.h"
 
-static Preferences prefs;
+#ifndef CFG_STORAGE_FLUSH_DEBOUNCE_MS
+#define CFG_STORAGE_FLUSH_DEBOUNCE_MS 1500u // quiet time after the last change before the record is written
+#endif
+#ifndef CFG_STORAGE_FLUSH_MAX_DELAY_MS
+#define CFG_STORAGE_FLUSH_MAX_DELAY_MS 10000u // upper bound while changes keep arriving
+#endif
+
+static WearPreferences prefs;
 
 namespace storage
 {
@@ -14,22 +22,28 @@ namespace nvs
 {
 static constexpr const char kNamespace[] = "level_sensor";
 static constexpr const char kSchemaKey[] = "schema";
-static constexpr uint32_t kSchemaVersion = 2;
-
-// ---------------- Calibration ----------------
+static constexpr uint32_t kSchemaVersion = 3;
+static constexpr uint32_t kLegacySchemaVersion = 2;
+
+// Scalars live in one RAM-shadowed record; the config structs below it are
+// side blobs with the same header and write coalescing (see SideBlob).
+static constexpr const char kKeyRecord[] = "rec";
+static constexpr uint16_t kRecordVersion = 1;
+static constexpr const char kKeyOtaStats[] = "ota_stats";
+static constexpr const char kKeyTankGeometry[] = "tank_geom";
+static constexpr const char kKeyCalCurve[] = "cal_curve";
+static constexpr const char kKeyDrift[] = "drift";
+static constexpr const char kKeyAnomaly[] = "anomaly";
+static constexpr const char kKeyQuality[] = "quality";
+
+// ---------------- Legacy (schema 2) per-field keys, migrated once ----------------
 static constexpr const char kKeyDry[] = "dry";
 static constexpr const char kKeyWet[] = "wet";
 static constexpr const char kKeyInv[] = "inv";
-
-// ---------------- Tank Configuration ----------------
 static constexpr const char kKeyTankVol[] = "tank_vol";
 static constexpr const char kKeyTankHeight[] = "tank_height";
-
-// ---------------- Simulation Configuration ----------------
 static constexpr const char kKeySenseMode[] = "sense_mode";
 static constexpr const char kKeySimMode[] = "sim_mode";
-
-// ---------------- OTA Options ----------------
 static constexpr const char kKeyOtaForce[] = "ota_force";
 static constexpr const char kKeyOtaReboot[] = "ota_reboot";
 static constexpr const char kKeyOtaLastSuccess[] = "ota_last_ok";
@@ -46,11 +60,420 @@ static constexpr const char kKeySafeMode[] = "safe_mode";
 static constexpr const char kKeyRebootIntent[] = "reboot_intent";
 static constexpr const char kKeyRebootIntentTs[] = "reboot_intent_ts";
 
+// Presence bits (StorageRecord::has); a cleared bit reads back as "key missing".
+static constexpr uint32_t kHasDry = 1u << 0;
+static constexpr uint32_t kHasWet = 1u << 1;
+static constexpr uint32_t kHasInv = 1u << 2;
+static constexpr uint32_t kHasTankVol = 1u << 3;
+static constexpr uint32_t kHasTankHeight = 1u << 4;
+static constexpr uint32_t kHasSenseMode = 1u << 5;
+static constexpr uint32_t kHasSimMode = 1u << 6;
+static constexpr uint32_t kHasOtaForce = 1u << 7;
+static constexpr uint32_t kHasOtaReboot = 1u << 8;
+static constexpr uint32_t kHasOtaLastSuccess = 1u << 9;
+static constexpr uint32_t kHasBootCount = 1u << 10;
+static constexpr uint32_t kHasCrashWindowBoots = 1u << 11;
+static constexpr uint32_t kHasCrashWindowBad = 1u << 12;
+static constexpr uint32_t kHasCrashLastBoot = 1u << 13;
+static constexpr uint32_t kHasCrashLatched = 1u << 14;
+static constexpr uint32_t kHasCrashLastStable = 1u << 15;
+static constexpr uint32_t kHasCrashLastReason = 1u << 16;
+static constexpr uint32_t kHasGoodBootTs = 1u << 17;
+static constexpr uint32_t kHasBadBootStreak = 1u << 18;
+static constexpr uint32_t kHasSafeMode = 1u << 19;
+static constexpr uint32_t kHasRebootIntent = 1u << 20;
+static constexpr uint32_t kHasRebootIntentTs = 1u << 21;
+
 static constexpr uint32_t kWarnThrottleMs = 5000;
 } // namespace nvs
 } // namespace storage
 
-// Policy: on schema mismatch, clear all keys in this namespace and write the new version.
+// Field order is the on-flash layout; bump kRecordVersion when it changes.
+struct StorageRecord
+{
+    uint32_t has;
+    int32_t calDry;
+    int32_t calWet;
+    float tankVolume;
+    float tankHeight;
+    uint32_t otaLastSuccess;
+    uint32_t bootCount;
+    uint32_t crashWindowBoots;
+    uint32_t crashWindowBad;
+    uint32_t crashLastBoot;
+    uint32_t crashLastStable;
+    uint32_t crashLastReason;
+    uint32_t goodBootTs;
+    uint32_t badBootStreak;
+    uint32_t rebootIntentTs;
+    uint8_t calInverted;
+    uint8_t senseMode;
+    uint8_t simMode;
+    uint8_t otaForce;
+    uint8_t otaReboot;
+    uint8_t crashLatched;
+    uint8_t safeMode;
+    uint8_t rebootIntent;
+};
+
+struct StorageRecordBlob
+{
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc;
+    StorageRecord rec;
+};
+
+static_assert(sizeof(StorageRecord) == 68u, "StorageRecord layout changed; bump kRecordVersion");
+
+// Structs too large to widen the record with (configs, drift state, the last
+// OTA attempt's stats). Each is shadowed in RAM and written by storage_flush()
+// as header + struct, so a setter costs no flash write until changes settle.
+// Anything else under the key reads as defaults.
+struct SideBlobHeader
+{
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc;
+};
+
+enum SidePart : uint8_t
+{
+    SIDE_TANK_GEOMETRY = 0,
+    SIDE_CAL_CURVE,
+    SIDE_DRIFT,
+    SIDE_ANOMALY,
+    SIDE_QUALITY,
+    SIDE_OTA_STATS,
+    SIDE_COUNT
+};
+
+struct SideBlob
+{
+    const char *key;
+    uint16_t version; // bump when the struct layout changes
+    uint16_t length;
+    void *shadow;
+    bool present;
+};
+
+static constexpr size_t sideMax(size_t a, size_t b)
+{
+    return a > b ? a : b;
+}
+static constexpr size_t kSideMaxLength =
+    sideMax(sideMax(sideMax(sizeof(TankGeometry), sizeof(CalCurve)), sideMax(sizeof(DriftPersist), sizeof(AnomalyConfig))),
+            sideMax(sizeof(QualityConfig), sizeof(OtaStats)));
+
+static TankGeometry s_tankGeometry{};
+static CalCurve s_calCurve{};
+static DriftPersist s_driftPersist{};
+static AnomalyConfig s_anomalyConfig{};
+static QualityConfig s_qualityConfig{};
+static OtaStats s_otaStats{};
+static SideBlob s_side[SIDE_COUNT] = {
+    {storage::nvs::kKeyTankGeometry, 1u, (uint16_t)sizeof(TankGeometry), &s_tankGeometry, false},
+    {storage::nvs::kKeyCalCurve, 1u, (uint16_t)sizeof(CalCurve), &s_calCurve, false},
+    {storage::nvs::kKeyDrift, 1u, (uint16_t)sizeof(DriftPersist), &s_driftPersist, false},
+    {storage::nvs::kKeyAnomaly, 1u, (uint16_t)sizeof(AnomalyConfig), &s_anomalyConfig, false},
+    {storage::nvs::kKeyQuality, 1u, (uint16_t)sizeof(QualityConfig), &s_qualityConfig, false},
+    {storage::nvs::kKeyOtaStats, 1u, (uint16_t)sizeof(OtaStats), &s_otaStats, false},
+};
+
+// Dirty bits: the record, then one per side blob.
+static constexpr uint32_t kPartRecord = 1u << 0;
+static constexpr uint32_t sidePartBit(SidePart part)
+{
+    return 1u << (1u + (uint32_t)part);
+}
+
+static StorageRecord s_rec{};
+static bool s_begun = false;
+static uint32_t s_dirtyParts = 0;
+static uint32_t s_firstDirtyMs = 0;
+static uint32_t s_lastDirtyMs = 0;
+static uint32_t s_pendingChanges = 0;
+static uint32_t s_flushCount = 0;
+static uint32_t s_coalescedChanges = 0;
+// Setters run on the loop task and otaTask; the shadow is only touched under this lock.
+static portMUX_TYPE s_recMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t storage_crc32(const void *data, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= p[i];
+        for (uint8_t bit = 0; bit < 8u; ++bit)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static void rec_markDirtyLocked(uint32_t parts = kPartRecord)
+{
+    const uint32_t now = millis();
+    if (s_dirtyParts == 0u)
+    {
+        s_firstDirtyMs = now;
+    }
+    s_dirtyParts |= parts;
+    s_lastDirtyMs = now;
+    s_pendingChanges++;
+}
+
+// Update one shadow field; unchanged values (and presence) cost nothing.
+template <typename T>
+static void rec_set(T &field, T value, uint32_t hasBit)
+{
+    portENTER_CRITICAL(&s_recMux);
+    if ((s_rec.has & hasBit) == 0u || memcmp(&field, &value, sizeof(T)) != 0)
+    {
+        field = value;
+        s_rec.has |= hasBit;
+        rec_markDirtyLocked();
+    }
+    portEXIT_CRITICAL(&s_recMux);
+}
+
+static void rec_clear(uint32_t hasBits)
+{
+    portENTER_CRITICAL(&s_recMux);
+    if ((s_rec.has & hasBits) != 0u)
+    {
+        s_rec.has &= ~hasBits;
+        rec_markDirtyLocked();
+    }
+    portEXIT_CRITICAL(&s_recMux);
+}
+
+static StorageRecord rec_snapshot()
+{
+    portENTER_CRITICAL(&s_recMux);
+    const StorageRecord copy = s_rec;
+    portEXIT_CRITICAL(&s_recMux);
+    return copy;
+}
+
+// Replace a side blob's shadow; an unchanged value costs nothing.
+static void side_set(SidePart part, const void *value)
+{
+    SideBlob &b = s_side[part];
+    portENTER_CRITICAL(&s_recMux);
+    if (!b.present || memcmp(b.shadow, value, b.length) != 0)
+    {
+        memcpy(b.shadow, value, b.length);
+        b.present = true;
+        rec_markDirtyLocked(sidePartBit(part));
+    }
+    portEXIT_CRITICAL(&s_recMux);
+}
+
+// Copy out the shadow; false when nothing is stored (out untouched).
+static bool side_get(SidePart part, void *out)
+{
+    const SideBlob &b = s_side[part];
+    portENTER_CRITICAL(&s_recMux);
+    const bool present = b.present;
+    if (present)
+    {
+        memcpy(out, b.shadow, b.length);
+    }
+    portEXIT_CRITICAL(&s_recMux);
+    return present;
+}
+
+static void side_loadAll()
+{
+    uint8_t buf[sizeof(SideBlobHeader) + kSideMaxLength];
+    for (uint8_t i = 0; i < SIDE_COUNT; ++i)
+    {
+        SideBlob &b = s_side[i];
+        b.present = false;
+        memset(b.shadow, 0, b.length);
+        if (!prefs.isKey(b.key))
+        {
+            continue;
+        }
+        const size_t len = prefs.getBytesLength(b.key);
+        SideBlobHeader hdr{};
+        if (len == sizeof(hdr) + b.length && prefs.getBytes(b.key, buf, len) == len)
+        {
+            memcpy(&hdr, buf, sizeof(hdr));
+            if (hdr.version == b.version && hdr.length == b.length &&
+                hdr.crc == storage_crc32(buf + sizeof(hdr), b.length))
+            {
+                memcpy(b.shadow, buf + sizeof(hdr), b.length);
+                b.present = true;
+                continue;
+            }
+        }
+        LOG_WARN_EVERY("nvs_side_invalid", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: %s blob invalid (version/length/crc); using defaults", b.key);
+    }
+}
+
+// Write one side blob if it is dirty; on failure it stays dirty for the next tick.
+static bool side_flush(SidePart part)
+{
+    SideBlob &b = s_side[part];
+    const uint32_t bit = sidePartBit(part);
+    uint8_t buf[sizeof(SideBlobHeader) + kSideMaxLength];
+    portENTER_CRITICAL(&s_recMux);
+    const bool dirty = (s_dirtyParts & bit) != 0u;
+    if (dirty)
+    {
+        memcpy(buf + sizeof(SideBlobHeader), b.shadow, b.length);
+        s_dirtyParts &= ~bit;
+    }
+    portEXIT_CRITICAL(&s_recMux);
+    if (!dirty)
+    {
+        return true;
+    }
+    const SideBlobHeader hdr{b.version, b.length, storage_crc32(buf + sizeof(SideBlobHeader), b.length)};
+    memcpy(buf, &hdr, sizeof(hdr));
+    const size_t len = sizeof(hdr) + b.length;
+    if (prefs.putBytes(b.key, buf, len) != len)
+    {
+        portENTER_CRITICAL(&s_recMux);
+        rec_markDirtyLocked(bit);
+        portEXIT_CRITICAL(&s_recMux);
+        LOG_WARN_EVERY("nvs_side_write_failed", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: %s write failed; will retry", b.key);
+        return false;
+    }
+    return true;
+}
+
+static bool rec_load()
+{
+    using namespace storage::nvs;
+    StorageRecordBlob blob{};
+    if (!prefs.isKey(kKeyRecord))
+    {
+        return false;
+    }
+    if (prefs.getBytesLength(kKeyRecord) != sizeof(blob) ||
+        prefs.getBytes(kKeyRecord, &blob, sizeof(blob)) != sizeof(blob) ||
+        blob.version != kRecordVersion ||
+        blob.length != sizeof(StorageRecord) ||
+        blob.crc != storage_crc32(&blob.rec, sizeof(blob.rec)))
+    {
+        LOG_WARN_EVERY("nvs_record_invalid", kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: record blob invalid (version/length/crc); using defaults");
+        return false;
+    }
+    s_rec = blob.rec;
+    return true;
+}
+
+// Schema 2 kept one key per field; fold them into the (dirty) record.
+static void rec_migrateLegacy()
+{
+    using namespace storage::nvs;
+    StorageRecord r{};
+    struct U32Key
+    {
+        const char *key;
+        uint32_t *dst;
+        uint32_t bit;
+    };
+    const U32Key u32Keys[] = {
+        {kKeyOtaLastSuccess, &r.otaLastSuccess, kHasOtaLastSuccess},
+        {kKeyBootCount, &r.bootCount, kHasBootCount},
+        {kKeyCrashWindowBoots, &r.crashWindowBoots, kHasCrashWindowBoots},
+        {kKeyCrashWindowBad, &r.crashWindowBad, kHasCrashWindowBad},
+        {kKeyCrashLastBoot, &r.crashLastBoot, kHasCrashLastBoot},
+        {kKeyCrashLastStable, &r.crashLastStable, kHasCrashLastStable},
+        {kKeyCrashLastReason, &r.crashLastReason, kHasCrashLastReason},
+        {kKeyGoodBootTs, &r.goodBootTs, kHasGoodBootTs},
+        {kKeyBadBootStreak, &r.badBootStreak, kHasBadBootStreak},
+        {kKeyRebootIntentTs, &r.rebootIntentTs, kHasRebootIntentTs},
+    };
+    for (const U32Key &k : u32Keys)
+    {
+        if (prefs.isKey(k.key))
+        {
+            *k.dst = prefs.getUInt(k.key, 0u);
+            r.has |= k.bit;
+        }
+    }
+    struct U8Key
+    {
+        const char *key;
+        uint8_t *dst;
+        uint32_t bit;
+        bool isBool;
+    };
+    const U8Key u8Keys[] = {
+        {kKeyInv, &r.calInverted, kHasInv, true},
+        {kKeySenseMode, &r.senseMode, kHasSenseMode, false},
+        {kKeySimMode, &r.simMode, kHasSimMode, false},
+        {kKeyOtaForce, &r.otaForce, kHasOtaForce, true},
+        {kKeyOtaReboot, &r.otaReboot, kHasOtaReboot, true},
+        {kKeyCrashLatched, &r.crashLatched, kHasCrashLatched, true},
+        {kKeySafeMode, &r.safeMode, kHasSafeMode, true},
+        {kKeyRebootIntent, &r.rebootIntent, kHasRebootIntent, false},
+    };
+    for (const U8Key &k : u8Keys)
+    {
+        if (prefs.isKey(k.key))
+        {
+            *k.dst = k.isBool ? (uint8_t)(prefs.getBool(k.key, false) ? 1u : 0u) : prefs.getUChar(k.key, 0u);
+            r.has |= k.bit;
+        }
+    }
+    if (prefs.isKey(kKeyDry))
+    {
+        r.calDry = prefs.getInt(kKeyDry, 0);
+        r.has |= kHasDry;
+    }
+    if (prefs.isKey(kKeyWet))
+    {
+        r.calWet = prefs.getInt(kKeyWet, 0);
+        r.has |= kHasWet;
+    }
+    if (prefs.isKey(kKeyTankVol))
+    {
+        r.tankVolume = prefs.getFloat(kKeyTankVol, 0.0f);
+        r.has |= kHasTankVol;
+    }
+    if (prefs.isKey(kKeyTankHeight))
+    {
+        r.tankHeight = prefs.getFloat(kKeyTankHeight, 0.0f);
+        r.has |= kHasTankHeight;
+    }
+
+    s_rec = r;
+    s_dirtyParts |= kPartRecord;
+    s_firstDirtyMs = s_lastDirtyMs = millis();
+    LOG_INFO(LogDomain::CONFIG, "NVS: migrated schema %lu keys into record has=0x%06lX",
+             (unsigned long)kLegacySchemaVersion, (unsigned long)r.has);
+}
+
+static void rec_dropLegacyKeys()
+{
+    using namespace storage::nvs;
+    static const char *const kLegacyKeys[] = {
+        kKeyDry, kKeyWet, kKeyInv, kKeyTankVol, kKeyTankHeight, kKeySenseMode, kKeySimMode,
+        kKeyOtaForce, kKeyOtaReboot, kKeyOtaLastSuccess, kKeyBootCount, kKeyCrashWindowBoots,
+        kKeyCrashWindowBad, kKeyCrashLastBoot, kKeyCrashLatched, kKeyCrashLastStable,
+        kKeyCrashLastReason, kKeyGoodBootTs, kKeyBadBootStreak, kKeySafeMode, kKeyRebootIntent,
+        kKeyRebootIntentTs};
+    for (const char *key : kLegacyKeys)
+    {
+        if (prefs.isKey(key))
+        {
+            prefs.remove(key);
+        }
+    }
+}
+
+// Policy: schema 2 is migrated in place; any other mismatch clears the namespace.
 bool storage_begin()
 {
     const bool ok = prefs.begin(storage::nvs::kNamespace, false);
@@ -59,9 +482,28 @@ bool storage_begin()
         LOG_ERROR(LogDomain::CONFIG, "NVS: begin failed namespace=%s", storage::nvs::kNamespace);
         return false;
     }
+    s_begun = true;
+    s_rec = StorageRecord{};
+    s_dirtyParts = 0;
 
     const uint32_t ver = prefs.getUInt(storage::nvs::kSchemaKey, 0);
-    if (ver != storage::nvs::kSchemaVersion)
+    if (ver == storage::nvs::kSchemaVersion)
+    {
+        (void)rec_load();
+        side_loadAll();
+        return true;
+    }
+
+    if (ver == storage::nvs::kLegacySchemaVersion)
+    {
+        side_loadAll();
+        // A record already present means an earlier migration was cut short after it landed.
+        if (!rec_load())
+        {
+            rec_migrateLegacy();
+        }
+    }
+    else
     {
         LOG_WARN_EVERY("nvs_schema_mismatch", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
                        "NVS: schema mismatch stored=%lu expected=%lu; clearing",
@@ -72,12 +514,22 @@ bool storage_begin()
             LOG_WARN_EVERY("nvs_clear_failed", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
                            "NVS: clear failed namespace=%s", storage::nvs::kNamespace);
         }
-        const size_t written = prefs.putUInt(storage::nvs::kSchemaKey, storage::nvs::kSchemaVersion);
-        if (written == 0)
+    }
+    // Record, then legacy cleanup, then schema: a reset in between re-runs the migration.
+    const bool flushed = storage_flush();
+    if (ver == storage::nvs::kLegacySchemaVersion)
+    {
+        if (!flushed)
         {
-            LOG_WARN_EVERY("nvs_schema_write_failed", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
-                           "NVS: failed to store schema version");
+            return true; // legacy keys stay authoritative until the record lands
         }
+        rec_dropLegacyKeys();
+    }
+    const size_t written = prefs.putUInt(storage::nvs::kSchemaKey, storage::nvs::kSchemaVersion);
+    if (written == 0)
+    {
+        LOG_WARN_EVERY("nvs_schema_write_failed", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: failed to store schema version");
     }
 
     return true;
@@ -85,15 +537,99 @@ bool storage_begin()
 
 void storage_end()
 {
+    (void)storage_flush();
     prefs.end();
+    s_begun = false;
 }
 
-bool storage_loadActiveCalibration(int32_t &dry, int32_t &wet, bool &inverted)
+bool storage_flush()
 {
-    dry = prefs.getInt(storage::nvs::kKeyDry, 0);
-    wet = prefs.getInt(storage::nvs::kKeyWet, 0);
-    inverted = prefs.getBool(storage::nvs::kKeyInv, false);
+    if (!s_begun)
+    {
+        return false;
+    }
+    StorageRecordBlob blob{};
+    uint32_t changes = 0;
+    portENTER_CRITICAL(&s_recMux);
+    const uint32_t parts = s_dirtyParts;
+    if (parts != 0u)
+    {
+        blob.rec = s_rec;
+        changes = s_pendingChanges;
+        s_dirtyParts &= ~kPartRecord;
+        s_pendingChanges = 0;
+    }
+    portEXIT_CRITICAL(&s_recMux);
+    if (parts == 0u)
+    {
+        return true;
+    }
+
+    bool ok = true;
+    for (uint8_t i = 0; i < SIDE_COUNT; ++i)
+    {
+        ok = side_flush((SidePart)i) && ok;
+    }
+    if ((parts & kPartRecord) == 0u)
+    {
+        s_flushCount++;
+        s_coalescedChanges += changes;
+        return ok;
+    }
+
+    blob.version = storage::nvs::kRecordVersion;
+    blob.length = (uint16_t)sizeof(StorageRecord);
+    blob.crc = storage_crc32(&blob.rec, sizeof(blob.rec));
+    if (prefs.putBytes(storage::nvs::kKeyRecord, &blob, sizeof(blob)) != sizeof(blob))
+    {
+        portENTER_CRITICAL(&s_recMux);
+        if (s_dirtyParts == 0u)
+        {
+            s_firstDirtyMs = millis();
+        }
+        s_dirtyParts |= kPartRecord;
+        s_lastDirtyMs = millis();
+        s_pendingChanges += changes;
+        portEXIT_CRITICAL(&s_recMux);
+        LOG_WARN_EVERY("nvs_record_write_failed", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: record write failed; will retry");
+        return false;
+    }
+    s_flushCount++;
+    s_coalescedChanges += changes;
+    LOG_DEBUG(LogDomain::CONFIG, "NVS: record flushed changes=%lu flushes=%lu",
+              (unsigned long)changes, (unsigned long)s_flushCount);
+    return ok;
+}
+
+void storage_tick()
+{
+    if (s_dirtyParts == 0u)
+    {
+        return;
+    }
+    const uint32_t now = millis();
+    portENTER_CRITICAL(&s_recMux);
+    const bool settled = (uint32_t)(now - s_lastDirtyMs) >= (uint32_t)CFG_STORAGE_FLUSH_DEBOUNCE_MS;
+    const bool overdue = (uint32_t)(now - s_firstDirtyMs) >= (uint32_t)CFG_STORAGE_FLUSH_MAX_DELAY_MS;
+    portEXIT_CRITICAL(&s_recMux);
+    if (settled || overdue)
+    {
+        (void)storage_flush();
+    }
+}
+
+bool storage_loadCalibrationRaw(int32_t &dry, int32_t &wet, bool &inverted)
+{
+    const StorageRecord r = rec_snapshot();
+    dry = (r.has & storage::nvs::kHasDry) ? r.calDry : 0;
+    wet = (r.has & storage::nvs::kHasWet) ? r.calWet : 0;
+    inverted = (r.has & storage::nvs::kHasInv) ? (r.calInverted != 0u) : false;
+    return (r.has & (storage::nvs::kHasDry | storage::nvs::kHasWet)) == (storage::nvs::kHasDry | storage::nvs::kHasWet);
+}
 
+bool storage_validateCalibration(int32_t &dry, int32_t &wet, bool &inverted)
+{
     const int32_t origDry = dry;
     const int32_t origWet = wet;
     bool ok = (dry != 0) && (wet != 0) && (dry != wet);
@@ -114,14 +650,25 @@ bool storage_loadActiveCalibration(int32_t &dry, int32_t &wet, bool &inverted)
     return ok;
 }
 
-bool storage_loadTank(float &volumeLiters, float &tankHeightCm)
+bool storage_loadActiveCalibration(int32_t &dry, int32_t &wet, bool &inverted)
+{
+    storage_loadCalibrationRaw(dry, wet, inverted);
+    return storage_validateCalibration(dry, wet, inverted);
+}
+
+bool storage_loadTankRaw(float &volumeLiters, float &tankHeightCm)
 {
-    const bool hasVol = prefs.isKey(storage::nvs::kKeyTankVol);
-    const bool hasHeight = prefs.isKey(storage::nvs::kKeyTankHeight);
+    const StorageRecord r = rec_snapshot();
+    const bool hasVol = (r.has & storage::nvs::kHasTankVol) != 0u;
+    const bool hasHeight = (r.has & storage::nvs::kHasTankHeight) != 0u;
 
-    volumeLiters = hasVol ? prefs.getFloat(storage::nvs::kKeyTankVol, 0.0f) : std::numeric_limits<float>::quiet_NaN();
-    tankHeightCm = hasHeight ? prefs.getFloat(storage::nvs::kKeyTankHeight, 0.0f) : std::numeric_limits<float>::quiet_NaN();
+    volumeLiters = hasVol ? r.tankVolume : std::numeric_limits<float>::quiet_NaN();
+    tankHeightCm = hasHeight ? r.tankHeight : std::numeric_limits<float>::quiet_NaN();
+    return hasVol && hasHeight;
+}
 
+bool storage_validateTank(float &volumeLiters, float &tankHeightCm)
+{
     bool ok = true;
     if (!(volumeLiters > 0.0f) || !(tankHeightCm > 0.0f))
     {
@@ -142,13 +689,18 @@ bool storage_loadTank(float &volumeLiters, float &tankHeightCm)
 
     if (!ok)
     {
-        volumeLiters = std::numeric_limits<float>::quiet_NaN();
-        tankHeightCm = std::numeric_limits<float>::quiet_NaN();
         LOG_WARN_EVERY("nvs_tank_invalid", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
                        "NVS: invalid tank config vol=%.2f height=%.2f", (double)volumeLiters, (double)tankHeightCm);
+        volumeLiters = std::numeric_limits<float>::quiet_NaN();
+        tankHeightCm = std::numeric_limits<float>::quiet_NaN();
     }
+    return ok;
+}
 
-    return ok && hasVol && hasHeight;
+bool storage_loadTank(float &volumeLiters, float &tankHeightCm)
+{
+    storage_loadTankRaw(volumeLiters, tankHeightCm);
+    return storage_validateTank(volumeLiters, tankHeightCm);
 }
 
 bool storage_loadSimulation(SenseMode &senseMode, uint8_t &mode)
@@ -157,8 +709,9 @@ bool storage_loadSimulation(SenseMode &senseMode, uint8_t &mode)
     static constexpr uint8_t kSenseMax = (uint8_t)SenseMode::SIM;
     static constexpr uint8_t kSimModeMax = 6;
 
-    const uint8_t senseRaw = prefs.getUChar(storage::nvs::kKeySenseMode, kSenseMin);
-    const uint8_t modeRaw = prefs.getUChar(storage::nvs::kKeySimMode, 0);
+    const StorageRecord r = rec_snapshot();
+    const uint8_t senseRaw = (r.has & storage::nvs::kHasSenseMode) ? r.senseMode : kSenseMin;
+    const uint8_t modeRaw = (r.has & storage::nvs::kHasSimMode) ? r.simMode : 0u;
 
     bool ok = true;
     if (senseRaw < kSenseMin || senseRaw > kSenseMax)
@@ -191,201 +744,300 @@ bool storage_loadSimulation(SenseMode &senseMode, uint8_t &mode)
 
 bool storage_loadOtaOptions(bool &force, bool &reboot)
 {
-    const bool hasForce = prefs.isKey(storage::nvs::kKeyOtaForce);
-    const bool hasReboot = prefs.isKey(storage::nvs::kKeyOtaReboot);
+    const StorageRecord r = rec_snapshot();
+    const bool hasForce = (r.has & storage::nvs::kHasOtaForce) != 0u;
+    const bool hasReboot = (r.has & storage::nvs::kHasOtaReboot) != 0u;
 
-    force = prefs.getBool(storage::nvs::kKeyOtaForce, false);
-    reboot = prefs.getBool(storage::nvs::kKeyOtaReboot, true);
+    force = hasForce ? (r.otaForce != 0u) : false;
+    reboot = hasReboot ? (r.otaReboot != 0u) : true;
 
     return hasForce || hasReboot;
 }
 
 bool storage_loadOtaLastSuccess(uint32_t &ts)
 {
-    const bool hasTs = prefs.isKey(storage::nvs::kKeyOtaLastSuccess);
-    ts = prefs.getUInt(storage::nvs::kKeyOtaLastSuccess, 0);
+    const StorageRecord r = rec_snapshot();
+    const bool hasTs = (r.has & storage::nvs::kHasOtaLastSuccess) != 0u;
+    ts = hasTs ? r.otaLastSuccess : 0u;
     return hasTs;
 }
 
+bool storage_loadOtaStats(OtaStats &stats)
+{
+    stats = OtaStats{};
+    return side_get(SIDE_OTA_STATS, &stats);
+}
+
 bool storage_loadBootCount(uint32_t &count)
 {
-    const bool hasCount = prefs.isKey(storage::nvs::kKeyBootCount);
-    count = prefs.getUInt(storage::nvs::kKeyBootCount, 0u);
+    const StorageRecord r = rec_snapshot();
+    const bool hasCount = (r.has & storage::nvs::kHasBootCount) != 0u;
+    count = hasCount ? r.bootCount : 0u;
     return hasCount;
 }
 
 bool storage_loadCrashLoop(uint32_t &winBoots, uint32_t &winBad, uint32_t &lastBoot, bool &latched, uint32_t &lastStable, uint32_t &lastReason)
 {
-    const bool hasAny =
-        prefs.isKey(storage::nvs::kKeyCrashWindowBoots) ||
-        prefs.isKey(storage::nvs::kKeyCrashWindowBad) ||
-        prefs.isKey(storage::nvs::kKeyCrashLastBoot) ||
-        prefs.isKey(storage::nvs::kKeyCrashLatched) ||
-        prefs.isKey(storage::nvs::kKeyCrashLastStable) ||
-        prefs.isKey(storage::nvs::kKeyCrashLastReason);
-
-    winBoots = prefs.getUInt(storage::nvs::kKeyCrashWindowBoots, 0u);
-    winBad = prefs.getUInt(storage::nvs::kKeyCrashWindowBad, 0u);
-    lastBoot = prefs.getUInt(storage::nvs::kKeyCrashLastBoot, 0u);
-    latched = prefs.getBool(storage::nvs::kKeyCrashLatched, false);
-    lastStable = prefs.getUInt(storage::nvs::kKeyCrashLastStable, 0u);
-    lastReason = prefs.getUInt(storage::nvs::kKeyCrashLastReason, 0u);
+    using namespace storage::nvs;
+    const StorageRecord r = rec_snapshot();
+    const bool hasAny = (r.has & (kHasCrashWindowBoots | kHasCrashWindowBad | kHasCrashLastBoot |
+                                  kHasCrashLatched | kHasCrashLastStable | kHasCrashLastReason)) != 0u;
+
+    winBoots = (r.has & kHasCrashWindowBoots) ? r.crashWindowBoots : 0u;
+    winBad = (r.has & kHasCrashWindowBad) ? r.crashWindowBad : 0u;
+    lastBoot = (r.has & kHasCrashLastBoot) ? r.crashLastBoot : 0u;
+    latched = (r.has & kHasCrashLatched) ? (r.crashLatched != 0u) : false;
+    lastStable = (r.has & kHasCrashLastStable) ? r.crashLastStable : 0u;
+    lastReason = (r.has & kHasCrashLastReason) ? r.crashLastReason : 0u;
     return hasAny;
 }
 
 bool storage_loadGoodBootTs(uint32_t &ts)
 {
-    const bool hasTs = prefs.isKey(storage::nvs::kKeyGoodBootTs);
-    ts = prefs.getUInt(storage::nvs::kKeyGoodBootTs, 0u);
+    const StorageRecord r = rec_snapshot();
+    const bool hasTs = (r.has & storage::nvs::kHasGoodBootTs) != 0u;
+    ts = hasTs ? r.goodBootTs : 0u;
     return hasTs;
 }
 
 bool storage_loadBadBootStreak(uint32_t &count)
 {
-    const bool hasCount = prefs.isKey(storage::nvs::kKeyBadBootStreak);
-    count = prefs.getUInt(storage::nvs::kKeyBadBootStreak, 0u);
+    const StorageRecord r = rec_snapshot();
+    const bool hasCount = (r.has & storage::nvs::kHasBadBootStreak) != 0u;
+    count = hasCount ? r.badBootStreak : 0u;
     return hasCount;
 }
 
 bool storage_loadSafeMode(bool &enabled)
 {
-    const bool hasMode = prefs.isKey(storage::nvs::kKeySafeMode);
-    enabled = prefs.getBool(storage::nvs::kKeySafeMode, false);
+    const StorageRecord r = rec_snapshot();
+    const bool hasMode = (r.has & storage::nvs::kHasSafeMode) != 0u;
+    enabled = hasMode ? (r.safeMode != 0u) : false;
     return hasMode;
 }
 
 bool storage_loadRebootIntent(uint8_t &intent)
 {
-    const bool hasIntent = prefs.isKey(storage::nvs::kKeyRebootIntent);
-    intent = prefs.getUChar(storage::nvs::kKeyRebootIntent, (uint8_t)RebootIntent::NONE);
+    const StorageRecord r = rec_snapshot();
+    const bool hasIntent = (r.has & storage::nvs::kHasRebootIntent) != 0u;
+    intent = hasIntent ? r.rebootIntent : (uint8_t)RebootIntent::NONE;
     return hasIntent;
 }
 
 void storage_saveCalibrationDry(int32_t dry)
 {
-    prefs.putInt(storage::nvs::kKeyDry, dry);
+    rec_set(s_rec.calDry, dry, storage::nvs::kHasDry);
 }
 
 void storage_saveCalibrationWet(int32_t wet)
 {
-    prefs.putInt(storage::nvs::kKeyWet, wet);
+    rec_set(s_rec.calWet, wet, storage::nvs::kHasWet);
 }
 
 void storage_saveCalibrationInverted(bool inverted)
 {
-    prefs.putBool(storage::nvs::kKeyInv, inverted);
+    rec_set(s_rec.calInverted, (uint8_t)(inverted ? 1u : 0u), storage::nvs::kHasInv);
 }
 
 void storage_clearCalibration()
 {
-    prefs.remove(storage::nvs::kKeyDry);
-    prefs.remove(storage::nvs::kKeyWet);
-    prefs.remove(storage::nvs::kKeyInv);
+    rec_clear(storage::nvs::kHasDry | storage::nvs::kHasWet | storage::nvs::kHasInv);
 }
 
-void storage_saveTankVolume(float volumeLiters)
+bool storage_loadCalibrationCurve(CalCurve &curve)
 {
-    prefs.putFloat(storage::nvs::kKeyTankVol, volumeLiters);
+    cal_curveClear(curve);
+    CalCurve stored;
+    if (!side_get(SIDE_CAL_CURVE, &stored))
+    {
+        return false;
+    }
+    if (!cal_curveValidate(stored))
+    {
+        LOG_WARN_EVERY("nvs_cal_curve_invalid", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: invalid calibration curve; using dry/wet only");
+        return false;
+    }
+    curve = stored;
+    return true;
 }
 
-void storage_saveTankHeight(float tankHeightCm)
+void storage_saveCalibrationCurve(const CalCurve &curve)
 {
-    prefs.putFloat(storage::nvs::kKeyTankHeight, tankHeightCm);
+    side_set(SIDE_CAL_CURVE, &curve);
 }
 
-void storage_saveSimulationMode(uint8_t mode)
+void storage_saveTankVolume(float volumeLiters)
 {
-    prefs.putUChar(storage::nvs::kKeySimMode, mode);
+    rec_set(s_rec.tankVolume, volumeLiters, storage::nvs::kHasTankVol);
 }
 
-void storage_saveSenseMode(SenseMode senseMode)
+void storage_saveTankHeight(float tankHeightCm)
 {
-    prefs.putUChar(storage::nvs::kKeySenseMode, (uint8_t)senseMode);
+    rec_set(s_rec.tankHeight, tankHeightCm, storage::nvs::kHasTankHeight);
 }
 
-void storage_saveOtaForce(bool force)
+bool storage_loadTankGeometry(TankGeometry &geometry)
 {
-    prefs.putBool(storage::nvs::kKeyOtaForce, force);
+    tank_geometryDefaults(geometry);
+    TankGeometry stored;
+    if (!side_get(SIDE_TANK_GEOMETRY, &stored))
+    {
+        return false;
+    }
+    if (!tank_validateGeometry(stored))
+    {
+        LOG_WARN_EVERY("nvs_geom_invalid", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: invalid tank geometry; using vertical cylinder");
+        return false;
+    }
+    geometry = stored;
+    return true;
 }
 
-void storage_saveOtaReboot(bool reboot)
+void storage_saveTankGeometry(const TankGeometry &geometry)
 {
-    prefs.putBool(storage::nvs::kKeyOtaReboot, reboot);
+    side_set(SIDE_TANK_GEOMETRY, &geometry);
 }
 
-void storage_saveOtaLastSuccess(uint32_t ts)
+bool storage_loadDrift(DriftPersist &drift)
 {
-    prefs.putUInt(storage::nvs::kKeyOtaLastSuccess, ts);
+    drift = DriftPersist{0.0f, CFG_DRIFT_TAU_S};
+    DriftPersist stored;
+    if (!side_get(SIDE_DRIFT, &stored) || !isfinite(stored.offset))
+    {
+        return false;
+    }
+    drift = stored;
+    return true;
 }
 
-void storage_saveBootCount(uint32_t count)
+void storage_saveDrift(const DriftPersist &drift)
 {
-    prefs.putUInt(storage::nvs::kKeyBootCount, count);
+    side_set(SIDE_DRIFT, &drift);
 }
 
-static void putUIntIfChanged(const char *key, uint32_t value)
+bool storage_loadQuality(QualityConfig &cfg)
 {
-    if (!prefs.isKey(key) || prefs.getUInt(key, 0u) != value)
+    quality_configDefaults(cfg);
+    QualityConfig stored;
+    if (!side_get(SIDE_QUALITY, &stored))
+    {
+        return false;
+    }
+    if (!quality_validateConfig(stored))
     {
-        prefs.putUInt(key, value);
+        LOG_WARN_EVERY("nvs_quality_invalid", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: invalid quality thresholds; using defaults");
+        return false;
     }
+    cfg = stored;
+    return true;
 }
 
-static void putBoolIfChanged(const char *key, bool value)
+void storage_saveQuality(const QualityConfig &cfg)
 {
-    if (!prefs.isKey(key) || prefs.getBool(key, false) != value)
+    side_set(SIDE_QUALITY, &cfg);
+}
+
+bool storage_loadAnomaly(AnomalyConfig &cfg)
+{
+    anomaly_configDefaults(cfg);
+    AnomalyConfig stored;
+    if (!side_get(SIDE_ANOMALY, &stored))
+    {
+        return false;
+    }
+    if (!anomaly_validateConfig(stored))
     {
-        prefs.putBool(key, value);
+        LOG_WARN_EVERY("nvs_anomaly_invalid", storage::nvs::kWarnThrottleMs, LogDomain::CONFIG,
+                       "NVS: invalid anomaly config; using defaults");
+        return false;
     }
+    cfg = stored;
+    return true;
+}
+
+void storage_saveAnomaly(const AnomalyConfig &cfg)
+{
+    side_set(SIDE_ANOMALY, &cfg);
+}
+
+void storage_saveSimulationMode(uint8_t mode)
+{
+    rec_set(s_rec.simMode, mode, storage::nvs::kHasSimMode);
+}
+
+void storage_saveSenseMode(SenseMode senseMode)
+{
+    rec_set(s_rec.senseMode, (uint8_t)senseMode, storage::nvs::kHasSenseMode);
+}
+
+void storage_saveOtaForce(bool force)
+{
+    rec_set(s_rec.otaForce, (uint8_t)(force ? 1u : 0u), storage::nvs::kHasOtaForce);
+}
+
+void storage_saveOtaReboot(bool reboot)
+{
+    rec_set(s_rec.otaReboot, (uint8_t)(reboot ? 1u : 0u), storage::nvs::kHasOtaReboot);
+}
+
+void storage_saveOtaLastSuccess(uint32_t ts)
+{
+    rec_set(s_rec.otaLastSuccess, ts, storage::nvs::kHasOtaLastSuccess);
+}
+
+void storage_saveOtaStats(const OtaStats &stats)
+{
+    side_set(SIDE_OTA_STATS, &stats);
+}
+
+void storage_saveBootCount(uint32_t count)
+{
+    rec_set(s_rec.bootCount, count, storage::nvs::kHasBootCount);
 }
 
 void storage_saveCrashLoop(uint32_t winBoots, uint32_t winBad, uint32_t lastBoot, bool latched, uint32_t lastStable, uint32_t lastReason)
 {
-    putUIntIfChanged(storage::nvs::kKeyCrashWindowBoots, winBoots);
-    putUIntIfChanged(storage::nvs::kKeyCrashWindowBad, winBad);
-    putUIntIfChanged(storage::nvs::kKeyCrashLastBoot, lastBoot);
-    putBoolIfChanged(storage::nvs::kKeyCrashLatched, latched);
-    putUIntIfChanged(storage::nvs::kKeyCrashLastStable, lastStable);
-    putUIntIfChanged(storage::nvs::kKeyCrashLastReason, lastReason);
+    rec_set(s_rec.crashWindowBoots, winBoots, storage::nvs::kHasCrashWindowBoots);
+    rec_set(s_rec.crashWindowBad, winBad, storage::nvs::kHasCrashWindowBad);
+    rec_set(s_rec.crashLastBoot, lastBoot, storage::nvs::kHasCrashLastBoot);
+    rec_set(s_rec.crashLatched, (uint8_t)(latched ? 1u : 0u), storage::nvs::kHasCrashLatched);
+    rec_set(s_rec.crashLastStable, lastStable, storage::nvs::kHasCrashLastStable);
+    rec_set(s_rec.crashLastReason, lastReason, storage::nvs::kHasCrashLastReason);
 }
 
 void storage_saveGoodBootTs(uint32_t ts)
 {
-    putUIntIfChanged(storage::nvs::kKeyGoodBootTs, ts);
+    rec_set(s_rec.goodBootTs, ts, storage::nvs::kHasGoodBootTs);
 }
 
 void storage_saveBadBootStreak(uint32_t count)
 {
-    putUIntIfChanged(storage::nvs::kKeyBadBootStreak, count);
+    rec_set(s_rec.badBootStreak, count, storage::nvs::kHasBadBootStreak);
 }
 
 void storage_saveSafeMode(bool enabled)
 {
-    putBoolIfChanged(storage::nvs::kKeySafeMode, enabled);
+    rec_set(s_rec.safeMode, (uint8_t)(enabled ? 1u : 0u), storage::nvs::kHasSafeMode);
 }
 
 void storage_saveRebootIntent(uint8_t intent)
 {
-    const uint8_t current = prefs.getUChar(storage::nvs::kKeyRebootIntent, (uint8_t)RebootIntent::NONE);
-    const bool changed = !prefs.isKey(storage::nvs::kKeyRebootIntent) || current != intent;
+    const StorageRecord r = rec_snapshot();
+    const bool changed = (r.has & storage::nvs::kHasRebootIntent) == 0u || r.rebootIntent != intent;
     if (changed)
     {
-        prefs.putUChar(storage::nvs::kKeyRebootIntent, intent);
+        rec_set(s_rec.rebootIntent, intent, storage::nvs::kHasRebootIntent);
         // Debug breadcrumb for post-boot diagnostics.
-        prefs.putUInt(storage::nvs::kKeyRebootIntentTs, millis());
+        rec_set(s_rec.rebootIntentTs, (uint32_t)millis(), storage::nvs::kHasRebootIntentTs);
     }
 }
 
 void storage_clearRebootIntent()
 {
-    if (prefs.isKey(storage::nvs::kKeyRebootIntent))
-    {
-        prefs.remove(storage::nvs::kKeyRebootIntent);
-    }
-    if (prefs.isKey(storage::nvs::kKeyRebootIntentTs))
-    {
-        prefs.remove(storage::nvs::kKeyRebootIntentTs);
-    }
+    rec_clear(storage::nvs::kHasRebootIntent | storage::nvs::kHasRebootIntentTs);
 }
 
 static inline void fnv1aMixByte(uint32_t &h, uint8_t b)
@@ -425,25 +1077,28 @@ static inline void fnv1aMixFloat(uint32_t &h, float v)
 
 void storage_dump()
 {
-    const bool hasSchema = prefs.isKey(storage::nvs::kSchemaKey);
-    const uint32_t schema = prefs.getUInt(storage::nvs::kSchemaKey, 0u);
-
-    const bool hasDry = prefs.isKey(storage::nvs::kKeyDry);
-    const bool hasWet = prefs.isKey(storage::nvs::kKeyWet);
-    const bool hasInv = prefs.isKey(storage::nvs::kKeyInv);
-    int32_t dry = prefs.getInt(storage::nvs::kKeyDry, 0);
-    int32_t wet = prefs.getInt(storage::nvs::kKeyWet, 0);
-    bool inv = prefs.getBool(storage::nvs::kKeyInv, false);
-
-    const bool hasVol = prefs.isKey(storage::nvs::kKeyTankVol);
-    const bool hasHeight = prefs.isKey(storage::nvs::kKeyTankHeight);
-    float vol = prefs.getFloat(storage::nvs::kKeyTankVol, 0.0f);
-    float height = prefs.getFloat(storage::nvs::kKeyTankHeight, 0.0f);
-
-    const bool hasSense = prefs.isKey(storage::nvs::kKeySenseMode);
-    const bool hasSimMode = prefs.isKey(storage::nvs::kKeySimMode);
-    uint8_t senseRaw = (uint8_t)prefs.getUChar(storage::nvs::kKeySenseMode, (uint8_t)SenseMode::TOUCH);
-    uint8_t simMode = (uint8_t)prefs.getUChar(storage::nvs::kKeySimMode, 0);
+    using namespace storage::nvs;
+    const bool hasSchema = prefs.isKey(kSchemaKey);
+    const uint32_t schema = prefs.getUInt(kSchemaKey, 0u);
+    const StorageRecord r = rec_snapshot();
+    const auto has = [&r](uint32_t bit) { return (r.has & bit) != 0u; };
+
+    const bool hasDry = has(kHasDry);
+    const bool hasWet = has(kHasWet);
+    const bool hasInv = has(kHasInv);
+    int32_t dry = hasDry ? r.calDry : 0;
+    int32_t wet = hasWet ? r.calWet : 0;
+    bool inv = hasInv && r.calInverted != 0u;
+
+    const bool hasVol = has(kHasTankVol);
+    const bool hasHeight = has(kHasTankHeight);
+    float vol = hasVol ? r.tankVolume : 0.0f;
+    float height = hasHeight ? r.tankHeight : 0.0f;
+
+    const bool hasSense = has(kHasSenseMode);
+    const bool hasSimMode = has(kHasSimMode);
+    uint8_t senseRaw = hasSense ? r.senseMode : (uint8_t)SenseMode::TOUCH;
+    uint8_t simMode = hasSimMode ? r.simMode : 0u;
 
     const bool senseValid =
         (senseRaw >= (uint8_t)SenseMode::TOUCH) &&
@@ -451,36 +1106,36 @@ void storage_dump()
     const SenseMode sense = senseValid ? static_cast<SenseMode>(senseRaw) : SenseMode::TOUCH;
     const char *senseText = senseValid ? domain_strings::c_str(domain_strings::to_string(sense)) : "unknown";
 
-    const bool hasOtaForce = prefs.isKey(storage::nvs::kKeyOtaForce);
-    const bool hasOtaReboot = prefs.isKey(storage::nvs::kKeyOtaReboot);
-    const bool hasOtaLastOk = prefs.isKey(storage::nvs::kKeyOtaLastSuccess);
-    const bool hasBootCount = prefs.isKey(storage::nvs::kKeyBootCount);
-    const bool hasCrashWindowBoots = prefs.isKey(storage::nvs::kKeyCrashWindowBoots);
-    const bool hasCrashWindowBad = prefs.isKey(storage::nvs::kKeyCrashWindowBad);
-    const bool hasCrashLastBoot = prefs.isKey(storage::nvs::kKeyCrashLastBoot);
-    const bool hasCrashLatched = prefs.isKey(storage::nvs::kKeyCrashLatched);
-    const bool hasCrashLastStable = prefs.isKey(storage::nvs::kKeyCrashLastStable);
-    const bool hasCrashLastReason = prefs.isKey(storage::nvs::kKeyCrashLastReason);
-    const bool hasGoodBootTs = prefs.isKey(storage::nvs::kKeyGoodBootTs);
-    const bool hasBadBootStreak = prefs.isKey(storage::nvs::kKeyBadBootStreak);
-    const bool hasSafeMode = prefs.isKey(storage::nvs::kKeySafeMode);
-    const bool hasRebootIntent = prefs.isKey(storage::nvs::kKeyRebootIntent);
-    const bool hasRebootIntentTs = prefs.isKey(storage::nvs::kKeyRebootIntentTs);
-    bool otaForce = prefs.getBool(storage::nvs::kKeyOtaForce, false);
-    bool otaReboot = prefs.getBool(storage::nvs::kKeyOtaReboot, true);
-    uint32_t otaLastOk = prefs.getUInt(storage::nvs::kKeyOtaLastSuccess, 0);
-    uint32_t bootCount = prefs.getUInt(storage::nvs::kKeyBootCount, 0u);
-    uint32_t crashWindowBoots = prefs.getUInt(storage::nvs::kKeyCrashWindowBoots, 0u);
-    uint32_t crashWindowBad = prefs.getUInt(storage::nvs::kKeyCrashWindowBad, 0u);
-    uint32_t crashLastBoot = prefs.getUInt(storage::nvs::kKeyCrashLastBoot, 0u);
-    bool crashLatched = prefs.getBool(storage::nvs::kKeyCrashLatched, false);
-    uint32_t crashLastStable = prefs.getUInt(storage::nvs::kKeyCrashLastStable, 0u);
-    uint32_t crashLastReason = prefs.getUInt(storage::nvs::kKeyCrashLastReason, 0u);
-    uint32_t goodBootTs = prefs.getUInt(storage::nvs::kKeyGoodBootTs, 0u);
-    uint32_t badBootStreak = prefs.getUInt(storage::nvs::kKeyBadBootStreak, 0u);
-    bool safeMode = prefs.getBool(storage::nvs::kKeySafeMode, false);
-    uint8_t rebootIntent = prefs.getUChar(storage::nvs::kKeyRebootIntent, (uint8_t)RebootIntent::NONE);
-    uint32_t rebootIntentTs = prefs.getUInt(storage::nvs::kKeyRebootIntentTs, 0u);
+    const bool hasOtaForce = has(kHasOtaForce);
+    const bool hasOtaReboot = has(kHasOtaReboot);
+    const bool hasOtaLastOk = has(kHasOtaLastSuccess);
+    const bool hasBootCount = has(kHasBootCount);
+    const bool hasCrashWindowBoots = has(kHasCrashWindowBoots);
+    const bool hasCrashWindowBad = has(kHasCrashWindowBad);
+    const bool hasCrashLastBoot = has(kHasCrashLastBoot);
+    const bool hasCrashLatched = has(kHasCrashLatched);
+    const bool hasCrashLastStable = has(kHasCrashLastStable);
+    const bool hasCrashLastReason = has(kHasCrashLastReason);
+    const bool hasGoodBootTs = has(kHasGoodBootTs);
+    const bool hasBadBootStreak = has(kHasBadBootStreak);
+    const bool hasSafeMode = has(kHasSafeMode);
+    const bool hasRebootIntent = has(kHasRebootIntent);
+    const bool hasRebootIntentTs = has(kHasRebootIntentTs);
+    bool otaForce = hasOtaForce && r.otaForce != 0u;
+    bool otaReboot = hasOtaReboot ? (r.otaReboot != 0u) : true;
+    uint32_t otaLastOk = hasOtaLastOk ? r.otaLastSuccess : 0u;
+    uint32_t bootCount = hasBootCount ? r.bootCount : 0u;
+    uint32_t crashWindowBoots = hasCrashWindowBoots ? r.crashWindowBoots : 0u;
+    uint32_t crashWindowBad = hasCrashWindowBad ? r.crashWindowBad : 0u;
+    uint32_t crashLastBoot = hasCrashLastBoot ? r.crashLastBoot : 0u;
+    bool crashLatched = hasCrashLatched && r.crashLatched != 0u;
+    uint32_t crashLastStable = hasCrashLastStable ? r.crashLastStable : 0u;
+    uint32_t crashLastReason = hasCrashLastReason ? r.crashLastReason : 0u;
+    uint32_t goodBootTs = hasGoodBootTs ? r.goodBootTs : 0u;
+    uint32_t badBootStreak = hasBadBootStreak ? r.badBootStreak : 0u;
+    bool safeMode = hasSafeMode && r.safeMode != 0u;
+    uint8_t rebootIntent = hasRebootIntent ? r.rebootIntent : (uint8_t)RebootIntent::NONE;
+    uint32_t rebootIntentTs = hasRebootIntentTs ? r.rebootIntentTs : 0u;
 
     // Deterministic marker over presence + values to detect unexpected NVS drift.
     uint32_t marker = 2166136261u; // FNV-1a 32-bit offset basis
@@ -532,10 +1187,17 @@ void storage_dump()
     fnv1aMixU32(marker, rebootIntentTs);
 
     LOG_INFO(LogDomain::CONFIG,
-             "NVS dump v2 schema=%lu expected=%lu marker=0x%08lX",
+             "NVS dump v3 schema=%lu expected=%lu marker=0x%08lX",
              (unsigned long)schema,
-             (unsigned long)storage::nvs::kSchemaVersion,
+             (unsigned long)kSchemaVersion,
              (unsigned long)marker);
+    LOG_INFO(LogDomain::CONFIG,
+             "NVS record dirty=0x%02lX pending=%lu flushes=%lu coalesced=%lu",
+             (unsigned long)s_dirtyParts,
+             (unsigned long)s_pendingChanges,
+             (unsigned long)s_flushCount,
+             (unsigned long)s_coalescedChanges);
+    nvs_wear_log();
     LOG_INFO(LogDomain::CONFIG,
              "NVS cal has[dry=%s wet=%s inv=%s] dry=%ld wet=%ld inv=%s",
              hasDry ? "y" : "n",
@@ -550,6 +1212,29 @@ void storage_dump()
              hasHeight ? "y" : "n",
              (double)vol,
              (double)height);
+    TankGeometry geometry;
+    const bool hasGeometry = storage_loadTankGeometry(geometry);
+    LOG_INFO(LogDomain::CONFIG,
+             "NVS tank_geom has=%s shape=%s cone_cm=%.2f strap_points=%u",
+             hasGeometry ? "y" : "n",
+             domain_strings::c_str(domain_strings::to_string(geometry.shape)),
+             (double)geometry.coneHeightCm,
+             (unsigned)geometry.strapCount);
+    CalCurve curve;
+    const bool hasCurve = storage_loadCalibrationCurve(curve);
+    LOG_INFO(LogDomain::CONFIG, "NVS cal_curve has=%s points=%u", hasCurve ? "y" : "n", (unsigned)curve.count);
+    QualityConfig quality;
+    const bool hasQuality = storage_loadQuality(quality);
+    LOG_INFO(LogDomain::CONFIG,
+             "NVS quality has=%s disconnected_below=%lu raw=[%lu..%lu] spike_delta=%lu rapid_delta=%lu stuck_delta=%lu stuck_ms=%lu cal_margin=%lu",
+             hasQuality ? "y" : "n", (unsigned long)quality.disconnectedBelowRaw, (unsigned long)quality.rawMin,
+             (unsigned long)quality.rawMax, (unsigned long)quality.spikeDelta, (unsigned long)quality.rapidFluctuationDelta,
+             (unsigned long)quality.stuckDelta, (unsigned long)quality.stuckMs, (unsigned long)quality.calRecommendMargin);
+    AnomalyConfig anomaly;
+    const bool hasAnomaly = storage_loadAnomaly(anomaly);
+    LOG_INFO(LogDomain::CONFIG, "NVS anomaly has=%s enabled=%s window=%u outlier_k=%.1f noise_std=%.0f cusum_h=%.1f",
+             hasAnomaly ? "y" : "n", anomaly.enabled ? "true" : "false", (unsigned)anomaly.window,
+             (double)anomaly.outlierK, (double)anomaly.noiseStd, (double)anomaly.cusumH);
     LOG_INFO(LogDomain::CONFIG,
              "NVS sim has[sense=%s mode=%s] sense_mode=%s(raw=%u) sim_mode=%u",
              hasSense ? "y" : "n",
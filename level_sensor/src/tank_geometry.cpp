@@ -0,0 +1,167 @@
+#include "tank_geometry.h"
+#include <math.h>
+#include <string.h>
+#include "domain_strings.h"
+
+static constexpr uint8_t kTankShapeCount = (uint8_t)TankShape::STRAPPING + 1u;
+
+void tank_geometryDefaults(TankGeometry &geom)
+{
+    memset(&geom, 0, sizeof(geom));
+    geom.shape = TankShape::VERTICAL_CYLINDER;
+}
+
+bool tank_validateGeometry(const TankGeometry &geom)
+{
+    if ((uint8_t)geom.shape >= kTankShapeCount)
+    {
+        return false;
+    }
+    if (geom.shape == TankShape::CONE_BOTTOM)
+    {
+        return isfinite(geom.coneHeightCm) && geom.coneHeightCm > 0.0f;
+    }
+    if (geom.shape != TankShape::STRAPPING)
+    {
+        return true;
+    }
+    if (geom.strapCount < 2u || geom.strapCount > CFG_TANK_STRAP_MAX_POINTS)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < geom.strapCount; ++i)
+    {
+        const TankStrapPoint &p = geom.strap[i];
+        if (!isfinite(p.heightCm) || !isfinite(p.liters) || p.heightCm < 0.0f || p.liters < 0.0f)
+        {
+            return false;
+        }
+        if (i > 0u && (p.heightCm <= geom.strap[i - 1].heightCm || p.liters < geom.strap[i - 1].liters))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool tank_isLinear(const TankGeometry &geom)
+{
+    return geom.shape == TankShape::VERTICAL_CYLINDER || geom.shape == TankShape::RECTANGULAR;
+}
+
+// Filled fraction of a horizontal cylinder at fill height h (fraction of the diameter).
+static double tank_horizontalFraction(double h)
+{
+    const double theta = 2.0 * acos(1.0 - 2.0 * h);
+    return (theta - sin(theta)) / (2.0 * M_PI);
+}
+
+// Filled fraction of a cylinder on a cone whose tip is at the rod bottom;
+// k is the cone height as a fraction of the rod. Same radius for both parts.
+static double tank_coneBottomFraction(double h, double k)
+{
+    const double coneVol = k / 3.0;
+    const double total = coneVol + (1.0 - k);
+    if (h <= k)
+    {
+        const double r = h / k;
+        return coneVol * r * r * r / total;
+    }
+    return (coneVol + (h - k)) / total;
+}
+
+static double tank_strapLiters(const TankGeometry &geom, double heightCm)
+{
+    const TankStrapPoint *pts = geom.strap;
+    const uint8_t n = geom.strapCount;
+    if (heightCm <= pts[0].heightCm)
+    {
+        // Below the first point: straight line from an empty tank at the rod bottom.
+        return (pts[0].heightCm > 0.0f) ? pts[0].liters * (heightCm / pts[0].heightCm) : pts[0].liters;
+    }
+    for (uint8_t i = 1; i < n; ++i)
+    {
+        if (heightCm <= pts[i].heightCm)
+        {
+            const double t = (heightCm - pts[i - 1].heightCm) / (double)(pts[i].heightCm - pts[i - 1].heightCm);
+            return pts[i - 1].liters + t * (double)(pts[i].liters - pts[i - 1].liters);
+        }
+    }
+    return pts[n - 1].liters;
+}
+
+static uint32_t tank_litersToCenti(double liters)
+{
+    if (!(liters > 0.0))
+    {
+        return 0u;
+    }
+    const double centi = liters * 100.0 + 0.5;
+    return (centi >= 4294967295.0) ? UINT32_MAX : (uint32_t)centi;
+}
+
+bool tank_buildVolumeLut(const TankGeometry &geom, float volumeLiters, float rodCm,
+                         uint32_t *lutCenti, size_t points)
+{
+    if (!lutCenti || points < 2u || !tank_validateGeometry(geom) || !(rodCm > 0.0f))
+    {
+        return false;
+    }
+    const bool strapping = geom.shape == TankShape::STRAPPING;
+    if (!strapping && !(volumeLiters > 0.0f))
+    {
+        return false;
+    }
+    const double coneK = (double)geom.coneHeightCm / (double)rodCm;
+    if (geom.shape == TankShape::CONE_BOTTOM && !(coneK < 1.0))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < points; ++i)
+    {
+        const double h = (double)i / (double)(points - 1u);
+        double liters = 0.0;
+        switch (geom.shape)
+        {
+        case TankShape::HORIZONTAL_CYLINDER:
+            liters = volumeLiters * tank_horizontalFraction(h);
+            break;
+        case TankShape::CONE_BOTTOM:
+            liters = volumeLiters * tank_coneBottomFraction(h, coneK);
+            break;
+        case TankShape::STRAPPING:
+            liters = tank_strapLiters(geom, h * (double)rodCm);
+            break;
+        case TankShape::VERTICAL_CYLINDER:
+        case TankShape::RECTANGULAR:
+            liters = volumeLiters * h;
+            break;
+        }
+        lutCenti[i] = tank_litersToCenti(liters);
+        // acos() rounding can dip by a hair near the ends; keep the table monotonic.
+        if (i > 0u && lutCenti[i] < lutCenti[i - 1])
+        {
+            lutCenti[i] = lutCenti[i - 1];
+        }
+    }
+    return true;
+}
+
+bool tank_shapeFromString(const char *name, TankShape &shape)
+{
+    if (!name)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < kTankShapeCount; ++i)
+    {
+        const TankShape candidate = (TankShape)i;
+        if (strcmp(name, domain_strings::c_str(domain_strings::to_string(candidate))) == 0)
+        {
+            shape = candidate;
+            return true;
+        }
+    }
+    return false;
+}
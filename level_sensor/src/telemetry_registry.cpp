@@ -436,6 +436,16 @@ static bool write_probe_raw(const DeviceState &s, JsonObject &root)
     return writeAtPath(root, "probe.raw", s.probe.raw);
 }
 
+static bool write_probe_drift_offset(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "probe.drift_offset", s.probe.driftOffset);
+}
+
+static bool write_probe_quality_confidence(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "probe.quality_confidence", (uint32_t)s.probe.qualityConfidence);
+}
+
 static bool write_probe_raw_valid(const DeviceState &s, JsonObject &root)
 {
     return writeAtPath(root, "probe.raw_valid", s.probe.rawValid);
@@ -466,6 +476,11 @@ static bool write_cal_min_diff(const DeviceState &s, JsonObject &root)
     return writeAtPath(root, "calibration.min_diff", s.calibration.minDiff);
 }
 
+static bool write_cal_curve_points(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "calibration.curve_points", (uint32_t)s.calibration.curvePoints);
+}
+
 static bool write_level_percent(const DeviceState &s, JsonObject &root)
 {
     return writeAtPath(root, "level.percent", s.level.percent);
@@ -506,6 +521,11 @@ static bool write_config_rod(const DeviceState &s, JsonObject &root)
     return writeAtPath(root, "config.rod_length_cm", s.config.rodLengthCm);
 }
 
+static bool write_config_tank_shape(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.tank_shape", c_str(to_string(s.config.tankShape)), true);
+}
+
 static bool write_config_sense_mode(const DeviceState &s, JsonObject &root)
 {
     return writeAtPath(root, "config.sense_mode", c_str(to_string(s.config.senseMode)), true);
@@ -516,6 +536,76 @@ static bool write_config_sim_mode(const DeviceState &s, JsonObject &root)
     return writeAtPath(root, "config.simulation_mode", (uint32_t)s.config.simulationMode);
 }
 
+static bool write_config_quality_disconnected_below_raw(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.disconnected_below_raw", (uint32_t)s.config.quality.disconnectedBelowRaw);
+}
+
+static bool write_config_quality_raw_min(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.raw_min", (uint32_t)s.config.quality.rawMin);
+}
+
+static bool write_config_quality_raw_max(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.raw_max", (uint32_t)s.config.quality.rawMax);
+}
+
+static bool write_config_quality_rapid_delta(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.rapid_delta", (uint32_t)s.config.quality.rapidFluctuationDelta);
+}
+
+static bool write_config_quality_spike_delta(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.spike_delta", (uint32_t)s.config.quality.spikeDelta);
+}
+
+static bool write_config_quality_spike_count(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.spike_count", (uint32_t)s.config.quality.spikeCountThreshold);
+}
+
+static bool write_config_quality_spike_window_ms(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.spike_window_ms", (uint32_t)s.config.quality.spikeWindowMs);
+}
+
+static bool write_config_quality_stuck_delta(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.stuck_delta", (uint32_t)s.config.quality.stuckDelta);
+}
+
+static bool write_config_quality_stuck_ms(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.stuck_ms", (uint32_t)s.config.quality.stuckMs);
+}
+
+static bool write_config_quality_cal_recommend_margin(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.cal_recommend_margin", (uint32_t)s.config.quality.calRecommendMargin);
+}
+
+static bool write_config_quality_cal_recommend_count(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.cal_recommend_count", (uint32_t)s.config.quality.calRecommendCount);
+}
+
+static bool write_config_quality_cal_recommend_window_ms(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.cal_recommend_window_ms", (uint32_t)s.config.quality.calRecommendWindowMs);
+}
+
+static bool write_config_quality_zero_hit_count(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.zero_hit_count", (uint32_t)s.config.quality.zeroHitCount);
+}
+
+static bool write_config_quality_zero_window_ms(const DeviceState &s, JsonObject &root)
+{
+    return writeAtPath(root, "config.quality.zero_window_ms", (uint32_t)s.config.quality.zeroWindowMs);
+}
+
 static const char *installed_fw(const DeviceState &s)
 {
     if (s.fw_version[0])
@@ -640,6 +730,28 @@ static bool write_ota_result(const DeviceState &s, JsonObject &root)
     return wrote;
 }
 
+static bool write_ota_stats(const DeviceState &s, JsonObject &root)
+{
+    const OtaStats &st = s.ota.stats;
+    bool wrote = false;
+    wrote |= writeAtPath(root, "ota.stats.dns_ms", st.dns_ms);
+    wrote |= writeAtPath(root, "ota.stats.tls_ms", st.tls_ms);
+    wrote |= writeAtPath(root, "ota.stats.first_byte_ms", st.first_byte_ms);
+    wrote |= writeAtPath(root, "ota.stats.download_ms", st.download_ms);
+    wrote |= writeAtPath(root, "ota.stats.verify_ms", st.verify_ms);
+    wrote |= writeAtPath(root, "ota.stats.switch_ms", st.switch_ms);
+    wrote |= writeAtPath(root, "ota.stats.bytes", st.bytes);
+    wrote |= writeAtPath(root, "ota.stats.avg_kbps", st.avg_kbps);
+    wrote |= writeAtPath(root, "ota.stats.min_kbps", st.min_kbps);
+    wrote |= writeAtPath(root, "ota.stats.stall_ms", st.stall_ms);
+    wrote |= writeAtPath(root, "ota.stats.stalls", (uint32_t)st.stall_count);
+    wrote |= writeAtPath(root, "ota.stats.net_retries", (uint32_t)st.net_retries);
+    wrote |= writeAtPath(root, "ota.stats.retries", (uint32_t)st.retries);
+    wrote |= writeAtPath(root, "ota.stats.tls_handshakes", (uint32_t)st.tls_handshakes);
+    wrote |= writeAtPath(root, "ota.stats.tls_resumed", (uint32_t)st.tls_resumed);
+    return wrote;
+}
+
 static bool write_last_cmd(const DeviceState &s, JsonObject &root)
 {
     bool wrote = false;
@@ -684,6 +796,8 @@ static const TelemetryFieldDef TELEMETRY_FIELDS[] = {
     {HaComponent::Sensor, "quality", "Probe Quality", "probe.quality", nullptr, nullptr, ICON_QUALITY, nullptr, nullptr, write_probe_quality},
     {HaComponent::Sensor, "raw", "Probe Raw", "probe.raw", nullptr, "ticks", ICON_WATER, nullptr, nullptr, write_probe_raw},
     {HaComponent::BinarySensor, "raw_valid", "Probe Raw Valid", "probe.raw_valid", nullptr, nullptr, nullptr, nullptr, nullptr, write_probe_raw_valid},
+    {HaComponent::Sensor, "drift_offset", "Probe Drift Offset", "probe.drift_offset", nullptr, "ticks", nullptr, nullptr, nullptr, write_probe_drift_offset},
+    {HaComponent::Sensor, "quality_confidence", "Probe Quality Confidence", "probe.quality_confidence", nullptr, "%", ICON_QUALITY, nullptr, nullptr, write_probe_quality_confidence},
 
     // Calibration
     {HaComponent::Sensor, "calibration_state", "Calibration State", "calibration.state", nullptr, nullptr, "mdi:tune", nullptr, nullptr, write_cal_state},
@@ -691,6 +805,7 @@ static const TelemetryFieldDef TELEMETRY_FIELDS[] = {
     {HaComponent::Sensor, "cal_wet", "Calibration Wet", "calibration.wet", nullptr, nullptr, nullptr, nullptr, nullptr, write_cal_wet},
     {HaComponent::Sensor, "cal_inverted", "Calibration Inverted", "calibration.inverted", nullptr, nullptr, nullptr, nullptr, nullptr, write_cal_inverted},
     {HaComponent::Sensor, "cal_min_diff", "Calibration Min Diff", "calibration.min_diff", nullptr, nullptr, nullptr, nullptr, nullptr, write_cal_min_diff},
+    {HaComponent::Sensor, "cal_curve_points", "Calibration Curve Points", "calibration.curve_points", nullptr, nullptr, nullptr, nullptr, nullptr, write_cal_curve_points},
 
     // Level
     {HaComponent::Sensor, "percent", "Level Percent", "level.percent", "humidity", "%", nullptr, nullptr, nullptr, write_level_percent},
@@ -712,8 +827,23 @@ static const TelemetryFieldDef TELEMETRY_FIELDS[] = {
     // Config (internal only)
     {HaComponent::Internal, "tank_volume_l", "Tank Volume", "config.tank_volume_l", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_volume},
     {HaComponent::Internal, "rod_length_cm", "Rod Length", "config.rod_length_cm", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_rod},
+    {HaComponent::Internal, "tank_shape", "Tank Shape", "config.tank_shape", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_tank_shape},
     {HaComponent::Internal, "sense_mode", "Sense Mode", "config.sense_mode", nullptr, nullptr, ICON_TOGGLE, nullptr, nullptr, write_config_sense_mode},
     {HaComponent::Internal, "simulation_mode", "Simulation Mode", "config.simulation_mode", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_sim_mode},
+    {HaComponent::Internal, "quality_disconnected_below_raw", "Quality Disconnected Below Raw", "config.quality.disconnected_below_raw", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_disconnected_below_raw},
+    {HaComponent::Internal, "quality_raw_min", "Quality Raw Min", "config.quality.raw_min", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_raw_min},
+    {HaComponent::Internal, "quality_raw_max", "Quality Raw Max", "config.quality.raw_max", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_raw_max},
+    {HaComponent::Internal, "quality_rapid_delta", "Quality Rapid Fluctuation Delta", "config.quality.rapid_delta", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_rapid_delta},
+    {HaComponent::Internal, "quality_spike_delta", "Quality Spike Delta", "config.quality.spike_delta", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_spike_delta},
+    {HaComponent::Internal, "quality_spike_count", "Quality Spike Count", "config.quality.spike_count", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_spike_count},
+    {HaComponent::Internal, "quality_spike_window_ms", "Quality Spike Window", "config.quality.spike_window_ms", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_spike_window_ms},
+    {HaComponent::Internal, "quality_stuck_delta", "Quality Stuck Delta", "config.quality.stuck_delta", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_stuck_delta},
+    {HaComponent::Internal, "quality_stuck_ms", "Quality Stuck Time", "config.quality.stuck_ms", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_stuck_ms},
+    {HaComponent::Internal, "quality_cal_recommend_margin", "Quality Cal Recommend Margin", "config.quality.cal_recommend_margin", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_cal_recommend_margin},
+    {HaComponent::Internal, "quality_cal_recommend_count", "Quality Cal Recommend Count", "config.quality.cal_recommend_count", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_cal_recommend_count},
+    {HaComponent::Internal, "quality_cal_recommend_window_ms", "Quality Cal Recommend Window", "config.quality.cal_recommend_window_ms", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_cal_recommend_window_ms},
+    {HaComponent::Internal, "quality_zero_hit_count", "Quality Zero Hit Count", "config.quality.zero_hit_count", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_zero_hit_count},
+    {HaComponent::Internal, "quality_zero_window_ms", "Quality Zero Window", "config.quality.zero_window_ms", nullptr, nullptr, nullptr, nullptr, nullptr, write_config_quality_zero_window_ms},
 
     // OTA (flat telemetry for HA)
     {HaComponent::Sensor, "ota_state", "OTA State", "ota_state", nullptr, nullptr, ICON_UPDATE, nullptr, nullptr, write_ota_state_flat},
@@ -730,6 +860,7 @@ static const TelemetryFieldDef TELEMETRY_FIELDS[] = {
     {HaComponent::Internal, "ota_progress", "OTA Progress", "ota.progress", nullptr, nullptr, nullptr, nullptr, nullptr, write_ota_progress},
     {HaComponent::Internal, "ota_active", "OTA Active", "ota.active", nullptr, nullptr, nullptr, nullptr, nullptr, write_ota_active},
     {HaComponent::Internal, "ota_result", "OTA Result", "ota.result", nullptr, nullptr, nullptr, nullptr, nullptr, write_ota_result},
+    {HaComponent::Internal, "ota_stats", "OTA Stats", "ota.stats", nullptr, nullptr, nullptr, nullptr, nullptr, write_ota_stats},
 
     // Last command
     {HaComponent::Sensor, "last_cmd", "Last Command", "last_cmd.type", nullptr, nullptr, ICON_PLAYLIST, "{{ value_json.last_cmd | tojson }}", "last_cmd", write_last_cmd},
@@ -738,6 +869,8 @@ static const TelemetryFieldDef TELEMETRY_FIELDS[] = {
 // Controls (buttons, numbers, switch, select)
 static const char *const SIM_OPTIONS[] = {"0", "1", "2", "3", "4", "5", "6"};
 static const char *const SENSE_OPTIONS[] = {"touch", "sim"};
+// Strapping needs a table, so it is only reachable through set_config.
+static const char *const TANK_SHAPE_OPTIONS[] = {"vertical_cylinder", "horizontal_cylinder", "rectangular", "cone_bottom"};
 static const ControlDef CONTROL_DEFS[] = {
     // Buttons
     {HaComponent::Button, "calibrate_dry", "Calibrate Dry", nullptr, nullptr, nullptr, nullptr, "calibrate", nullptr, 0, 0, 0, nullptr, 0, nullptr, nullptr, nullptr, "{\"schema\":1,\"type\":\"calibrate\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"point\":\"dry\"}}", nullptr},
@@ -762,11 +895,20 @@ static const ControlDef CONTROL_DEFS[] = {
     {HaComponent::Number, "rod_length_cm", "Rod Length (cm)", "config.rod_length_cm", nullptr, nullptr, nullptr, "set_config", "rod_length_cm", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_config\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"rod_length_cm\":{{ value }}}}", nullptr, nullptr},
     {HaComponent::Number, "cal_dry_set", "Set Calibration Dry", "calibration.dry", nullptr, nullptr, nullptr, "set_calibration", "cal_dry_set", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_calibration\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"cal_dry_set\":{{ value }}}}", nullptr, nullptr},
     {HaComponent::Number, "cal_wet_set", "Set Calibration Wet", "calibration.wet", nullptr, nullptr, nullptr, "set_calibration", "cal_wet_set", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_calibration\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"cal_wet_set\":{{ value }}}}", nullptr, nullptr},
+    {HaComponent::Number, "quality_disconnected_below_raw", "Quality Disconnected Below Raw", "config.quality.disconnected_below_raw", nullptr, nullptr, ICON_QUALITY, "set_quality", "disconnected_below_raw", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_quality\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"disconnected_below_raw\":{{ value | int }}}}", nullptr, nullptr},
+    {HaComponent::Number, "quality_spike_delta", "Quality Spike Delta", "config.quality.spike_delta", nullptr, nullptr, ICON_QUALITY, "set_quality", "spike_delta", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_quality\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"spike_delta\":{{ value | int }}}}", nullptr, nullptr},
+    {HaComponent::Number, "quality_rapid_delta", "Quality Rapid Delta", "config.quality.rapid_delta", nullptr, nullptr, ICON_QUALITY, "set_quality", "rapid_delta", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_quality\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"rapid_delta\":{{ value | int }}}}", nullptr, nullptr},
+    {HaComponent::Number, "quality_stuck_delta", "Quality Stuck Delta", "config.quality.stuck_delta", nullptr, nullptr, ICON_QUALITY, "set_quality", "stuck_delta", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_quality\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"stuck_delta\":{{ value | int }}}}", nullptr, nullptr},
+    {HaComponent::Number, "quality_stuck_ms", "Quality Stuck Time", "config.quality.stuck_ms", nullptr, "ms", ICON_QUALITY, "set_quality", "stuck_ms", 0.0f, 86400000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_quality\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"stuck_ms\":{{ value | int }}}}", nullptr, nullptr},
+    {HaComponent::Number, "quality_cal_recommend_margin", "Quality Cal Recommend Margin", "config.quality.cal_recommend_margin", nullptr, nullptr, ICON_QUALITY, "set_quality", "cal_recommend_margin", 0.0f, 10000000.0f, 1.0f, nullptr, 0, nullptr, nullptr, "{\"schema\":1,\"type\":\"set_quality\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"cal_recommend_margin\":{{ value | int }}}}", nullptr, nullptr},
 
     // Selects
     {HaComponent::Select, "sense_mode", "Sense Mode", "config.sense_mode", nullptr, nullptr, nullptr, "set_simulation", "sense_mode", 0, 0, 0,
      SENSE_OPTIONS, sizeof(SENSE_OPTIONS) / sizeof(SENSE_OPTIONS[0]), nullptr, nullptr,
      "{\"schema\":1,\"type\":\"set_simulation\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"sense_mode\":\"{{ value }}\"}}", nullptr, nullptr},
+    {HaComponent::Select, "tank_shape", "Tank Shape", "config.tank_shape", nullptr, nullptr, nullptr, "set_config", "tank_shape", 0, 0, 0,
+     TANK_SHAPE_OPTIONS, sizeof(TANK_SHAPE_OPTIONS) / sizeof(TANK_SHAPE_OPTIONS[0]), nullptr, nullptr,
+     "{\"schema\":1,\"type\":\"set_config\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"tank_shape\":\"{{ value }}\"}}", nullptr, nullptr},
     {HaComponent::Select, "simulation_mode", "Simulation Mode", "config.simulation_mode", nullptr, nullptr, nullptr, "set_simulation", "mode", 0, 0, 0,
      SIM_OPTIONS, sizeof(SIM_OPTIONS) / sizeof(SIM_OPTIONS[0]), nullptr, nullptr,
      "{\"schema\":1,\"type\":\"set_simulation\",\"request_id\":\"{{ timestamp }}\",\"data\":{\"mode\":{{ value | int }}}}", nullptr, nullptr},
@@ -0,0 +1,263 @@
+#include "trace_replay.h"
+#include <string.h>
+
+#ifdef __has_include
+#if __has_include("replay_trace_data.h")
+#include "replay_trace_data.h"
+#define REPLAY_HAS_EMBEDDED 1
+#endif
+#endif
+
+#if !defined(ESP_PLATFORM)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static ReplaySample s_buffer[CFG_REPLAY_MAX_SAMPLES];
+static size_t s_bufferCount = 0;
+
+static const ReplaySample *s_trace = nullptr;
+static size_t s_count = 0;
+static const char *s_source = "none";
+
+static bool s_active = false;
+static bool s_finished = false;
+static bool s_loop = false;
+static float s_speed = 1.0f;
+static uint32_t s_startMs = 0;
+static size_t s_index = 0;
+
+#if !defined(ESP_PLATFORM)
+static void *s_mapAddr = nullptr;
+static size_t s_mapLen = 0;
+
+static void replay_unmap()
+{
+    if (s_mapAddr)
+    {
+        munmap(s_mapAddr, s_mapLen);
+        s_mapAddr = nullptr;
+        s_mapLen = 0;
+    }
+}
+#endif
+
+static bool replay_isOrdered(const ReplaySample *samples, size_t count, uint32_t prevMs)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (samples[i].tMs < prevMs)
+        {
+            return false;
+        }
+        prevMs = samples[i].tMs;
+    }
+    return true;
+}
+
+static void replay_select(const ReplaySample *samples, size_t count, const char *source)
+{
+    s_active = false;
+    s_finished = false;
+    s_trace = samples;
+    s_count = count;
+    s_source = source;
+    s_index = 0;
+}
+
+static uint32_t replay_duration()
+{
+    return (s_count > 1u) ? (s_trace[s_count - 1].tMs - s_trace[0].tMs) : 0u;
+}
+
+void replay_clearBuffer()
+{
+    if (s_trace == s_buffer)
+    {
+        replay_select(nullptr, 0, "none");
+    }
+    s_bufferCount = 0;
+}
+
+bool replay_append(const ReplaySample *samples, size_t count)
+{
+    if (!samples || count == 0u || s_bufferCount + count > CFG_REPLAY_MAX_SAMPLES)
+    {
+        return false;
+    }
+    const uint32_t prevMs = s_bufferCount ? s_buffer[s_bufferCount - 1].tMs : 0u;
+    if (!replay_isOrdered(samples, count, prevMs))
+    {
+        return false;
+    }
+    memcpy(&s_buffer[s_bufferCount], samples, count * sizeof(ReplaySample));
+    s_bufferCount += count;
+    if (s_trace == s_buffer)
+    {
+        s_count = s_bufferCount; // a running buffer replay picks up new chunks
+    }
+    return true;
+}
+
+bool replay_useBuffer()
+{
+    if (s_bufferCount == 0u)
+    {
+        return false;
+    }
+    replay_select(s_buffer, s_bufferCount, "buffer");
+    return true;
+}
+
+bool replay_hasEmbedded()
+{
+#ifdef REPLAY_HAS_EMBEDDED
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool replay_useEmbedded()
+{
+#ifdef REPLAY_HAS_EMBEDDED
+    replay_select(kReplayEmbeddedTrace, sizeof(kReplayEmbeddedTrace) / sizeof(kReplayEmbeddedTrace[0]), "embedded");
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if !defined(ESP_PLATFORM)
+bool replay_mapFile(const char *path)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (st.st_size % (off_t)sizeof(ReplaySample)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        return false;
+    }
+    const ReplaySample *samples = static_cast<const ReplaySample *>(addr);
+    const size_t count = (size_t)st.st_size / sizeof(ReplaySample);
+    if (!replay_isOrdered(samples, count, samples[0].tMs))
+    {
+        munmap(addr, (size_t)st.st_size);
+        return false;
+    }
+    replay_unmap();
+    s_mapAddr = addr;
+    s_mapLen = (size_t)st.st_size;
+    replay_select(samples, count, "file");
+    return true;
+}
+#endif
+
+bool replay_start(uint32_t nowMs, float speed, bool loop)
+{
+    if (!s_trace || s_count == 0u || !(speed > 0.0f))
+    {
+        return false;
+    }
+    s_active = true;
+    s_finished = false;
+    s_loop = loop;
+    s_speed = speed;
+    s_startMs = nowMs;
+    s_index = 0;
+    return true;
+}
+
+void replay_stop()
+{
+    s_active = false;
+}
+
+bool replay_isActive()
+{
+    return s_active;
+}
+
+bool replay_rawAt(uint32_t nowMs, uint32_t &raw)
+{
+    if (!s_active || s_count == 0u)
+    {
+        return false;
+    }
+    const uint32_t t0 = s_trace[0].tMs;
+    const uint32_t duration = replay_duration();
+    uint32_t traceMs = (uint32_t)((float)(nowMs - s_startMs) * s_speed);
+
+    if (traceMs > duration)
+    {
+        if (s_loop && duration > 0u)
+        {
+            // Restart the pass; keep the phase so long gaps between reads stay aligned.
+            const uint32_t passes = traceMs / duration;
+            s_startMs += (uint32_t)((float)(passes * duration) / s_speed);
+            traceMs -= passes * duration;
+            s_index = 0;
+        }
+        else
+        {
+            s_finished = true;
+            s_index = s_count - 1;
+        }
+    }
+    while (s_index + 1 < s_count && (s_trace[s_index + 1].tMs - t0) <= traceMs)
+    {
+        ++s_index;
+    }
+    raw = s_trace[s_index].raw;
+    return true;
+}
+
+bool replay_next(ReplaySample &out)
+{
+    if (!s_trace || s_count == 0u)
+    {
+        return false;
+    }
+    if (s_index >= s_count)
+    {
+        if (!s_loop)
+        {
+            s_finished = true;
+            return false;
+        }
+        s_index = 0;
+    }
+    out = s_trace[s_index++];
+    out.tMs -= s_trace[0].tMs;
+    return true;
+}
+
+void replay_rewind()
+{
+    s_index = 0;
+    s_finished = false;
+}
+
+void replay_getStatus(ReplayStatus &out)
+{
+    out.active = s_active;
+    out.finished = s_finished;
+    out.loop = s_loop;
+    out.speed = s_speed;
+    out.count = (uint32_t)s_count;
+    out.index = (uint32_t)s_index;
+    out.durationMs = replay_duration();
+    out.source = s_source;
+}
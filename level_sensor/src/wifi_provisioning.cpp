@@ -4,7 +4,8 @@
 #include <esp_wifi.h>
 
 #include "wifi_provisioning.h"
-#include <Preferences.h>
+#include "nvs_wear.h"
+#include "boot_trace.h"
 #include <time.h>
 #include "logger.h"
 
@@ -39,7 +40,7 @@ static const time_t VALID_TIME_EPOCH = 1600000000;
 #define CFG_WIFI_PORTAL_DEBUG 0
 #endif
 
-static Preferences wifiPrefs; // WiFi-related preferences
+static WearPreferences wifiPrefs; // WiFi-related preferences
 
 static const char *TIME_STATUS_VALID = "valid";
 static const char *TIME_STATUS_SYNCING = "syncing";
@@ -277,6 +278,7 @@ void wifi_ensureConnected(uint32_t wifiTimeoutMs)
             LOG_INFO(LogDomain::WIFI, "Connected ip=%s connect_ms=%lu",
                      WiFi.localIP().toString().c_str(),
                      (unsigned long)elapsed);
+            boot_trace_mark("wifi_connected");
         }
 
         s_wifiConnectInFlight = false;
@@ -298,6 +300,7 @@ void wifi_ensureConnected(uint32_t wifiTimeoutMs)
         LOG_WARN(LogDomain::WIFI, "WiFi connect timed out after %lums; retry_in_ms=%lu",
                  (unsigned long)(now - s_wifiConnectStartMs),
                  (unsigned long)s_wifiConnectBackoffMs);
+        boot_trace_mark("wifi_connect_timeout");
         WiFi.disconnect(false, false);
         s_wifiConnectInFlight = false;
         s_wifiConnectStartMs = 0;
@@ -350,6 +353,7 @@ void wifi_ensureConnected(uint32_t wifiTimeoutMs)
     LOG_INFO(LogDomain::WIFI, "Connecting to saved WiFi");
 
     WiFi.begin(); // use stored credentials
+    boot_trace_mark("wifi_connect_begin");
     s_wifiConnectInFlight = true;
     s_wifiConnectStartMs = now;
     s_wifiConnectRetryAtMs = 0;
@@ -0,0 +1,79 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+// Host stand-in for the ESP32 ROM tinfl API used by ota_inflate.cpp, backed by
+// the system zlib (native env links -lz). Only the streaming subset the
+// inflater relies on: zlib header parsing, Adler-32 check and HAS_MORE_INPUT.
+// zlib keeps its own history, so the caller's circular window is only an
+// output buffer here; the window-size limit itself is checked by
+// ota_inflate_begin() before any data reaches this.
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+
+typedef enum
+{
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+enum
+{
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef struct
+{
+    z_stream zs;
+    bool open;
+} tinfl_decompressor;
+
+static inline void tinfl_init(tinfl_decompressor *r)
+{
+    if (r->open)
+    {
+        inflateReset(&r->zs);
+        return;
+    }
+    r->zs = z_stream{};
+    r->open = inflateInit2(&r->zs, MAX_WBITS) == Z_OK;
+}
+
+static inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next,
+                                            size_t *pIn_buf_size, mz_uint8 *, mz_uint8 *pOut_buf_next,
+                                            size_t *pOut_buf_size, const mz_uint32 decomp_flags)
+{
+    if (!r->open || (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) == 0u)
+    {
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    r->zs.next_in = const_cast<Bytef *>(pIn_buf_next);
+    r->zs.avail_in = (uInt)*pIn_buf_size;
+    r->zs.next_out = pOut_buf_next;
+    r->zs.avail_out = (uInt)*pOut_buf_size;
+    const int rc = inflate(&r->zs, Z_NO_FLUSH);
+    *pIn_buf_size -= r->zs.avail_in;
+    *pOut_buf_size -= r->zs.avail_out;
+    if (rc == Z_STREAM_END)
+    {
+        return TINFL_STATUS_DONE;
+    }
+    if (rc == Z_DATA_ERROR)
+    {
+        return TINFL_STATUS_FAILED;
+    }
+    if (rc != Z_OK && rc != Z_BUF_ERROR)
+    {
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    return (r->zs.avail_out == 0u) ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
@@ -0,0 +1,293 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "adaptive_sampler.h"
+#include "level_fixed.h"
+#include "quality.h"
+
+// Fixed-rate vs adaptive sampling over a simulated tank: 20 min static, a
+// 5 min fill, then static again, with the probe noise the simulator uses.
+// Faults last one minute and are injected while the level is static, which is
+// when the adaptive sampler is at its slowest. The sampler is fed the way the
+// firmware feeds it: the latest raw sample through the level path.
+
+static constexpr uint32_t kNormalRawMs = 1000u;
+static constexpr uint32_t kNormalComputeMs = 3000u;
+static constexpr uint32_t kFillStartMs = 20u * 60000u;
+static constexpr uint32_t kFillEndMs = 25u * 60000u;
+static constexpr uint32_t kTraceEndMs = 45u * 60000u;
+static constexpr uint32_t kFaultMs = 60000u;
+static constexpr uint32_t kNoFault = UINT32_MAX;
+static constexpr float kNoiseCounts = 40.0f;
+
+enum class Fault : uint8_t
+{
+    NONE,
+    SPIKES, // every other sample jumps by more than spikeDelta
+    ZEROS   // the probe reads 0
+};
+
+struct RunReport
+{
+    uint32_t rawSamples;
+    uint32_t computeSamples;
+    uint32_t detectMs;      // fault start to first matching quality reason
+    uint32_t activeAfterMs; // fill start to first ACTIVE mode
+    uint32_t modeChanges;
+    uint32_t staticMs;      // time spent in STATIC
+};
+
+static uint32_t s_lcg = 1u;
+
+static float gaussian(float sigma)
+{
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    const float u1 = ((float)(s_lcg >> 8) + 0.5f) / 16777216.0f;
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    const float u2 = ((float)(s_lcg >> 8) + 0.5f) / 16777216.0f;
+    return sigma * sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+static SamplerConfig samplerConfig(uint32_t slowRawMs)
+{
+    SamplerConfig cfg{};
+    cfg.normalRawMs = kNormalRawMs;
+    cfg.normalComputeMs = kNormalComputeMs;
+    cfg.fastRawMs = CFG_ADAPT_FAST_RAW_MS;
+    cfg.fastComputeMs = CFG_ADAPT_FAST_COMPUTE_MS;
+    cfg.slowRawMs = slowRawMs;
+    cfg.slowComputeMs = CFG_ADAPT_SLOW_COMPUTE_MS;
+    cfg.activeRatePctPerMin = CFG_ADAPT_ACTIVE_RATE_PCT_PER_MIN;
+    cfg.staticRatePctPerMin = CFG_ADAPT_STATIC_RATE_PCT_PER_MIN;
+    cfg.staticHoldMs = CFG_ADAPT_STATIC_HOLD_MS;
+    cfg.trendWindowMs = CFG_ADAPT_TREND_WINDOW_MS;
+    cfg.minDwellMs = CFG_ADAPT_MIN_DWELL_MS;
+    cfg.publishBurst = (uint8_t)CFG_ADAPT_PUBLISH_BURST;
+    cfg.publishPerMin = (uint8_t)CFG_ADAPT_PUBLISH_PER_MIN;
+    return cfg;
+}
+
+// Same rule the firmware applies in refreshSamplerConfig().
+static uint32_t cappedSlowRawMs(const QualityConfig &qc)
+{
+    uint32_t cap = sampler_rawCapMs(qc.spikeWindowMs, qc.spikeCountThreshold);
+    const uint32_t zeroCap = sampler_rawCapMs(qc.zeroWindowMs, qc.zeroHitCount);
+    if (zeroCap < cap)
+    {
+        cap = zeroCap;
+    }
+    return (CFG_ADAPT_SLOW_RAW_MS < cap) ? CFG_ADAPT_SLOW_RAW_MS : cap;
+}
+
+static float levelPct(uint32_t nowMs)
+{
+    if (nowMs < kFillStartMs)
+    {
+        return 50.0f;
+    }
+    if (nowMs < kFillEndMs)
+    {
+        return 50.0f + 30.0f * (float)(nowMs - kFillStartMs) / (float)(kFillEndMs - kFillStartMs);
+    }
+    return 80.0f;
+}
+
+static uint32_t probeRaw(uint32_t nowMs, uint32_t sampleIdx, Fault fault, uint32_t faultStartMs)
+{
+    if (fault != Fault::NONE && nowMs >= faultStartMs && nowMs - faultStartMs < kFaultMs)
+    {
+        if (fault == Fault::ZEROS)
+        {
+            return 0u;
+        }
+        if ((sampleIdx & 1u) != 0u)
+        {
+            return 40000u + (uint32_t)(levelPct(nowMs) * 200.0f) + 11000u;
+        }
+    }
+    return (uint32_t)lroundf(40000.0f + levelPct(nowMs) * 200.0f + gaussian(kNoiseCounts));
+}
+
+static RunReport runTrace(bool adaptive, uint32_t slowRawMs, const QualityConfig &qc,
+                          Fault fault, uint32_t faultStartMs)
+{
+    AppliedConfig cfg{};
+    cfg.calDry = 40000;
+    cfg.calWet = 60000;
+    cal_curveClear(cfg.calCurve);
+    tank_geometryDefaults(cfg.tankGeometry);
+    LevelCalib calib;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    LevelFilter filter;
+    level_filterInit(filter, CFG_PERCENT_EMA_ALPHA);
+    QualityRuntime rt;
+    quality_init(rt);
+    const SamplerConfig scfg = samplerConfig(slowRawMs);
+    SamplerState st;
+    sampler_init(st, scfg, 0u);
+    s_lcg = 1u;
+    uint32_t lastRaw = 0u;
+    bool connected = false;
+    uint32_t staticSinceMs = kNoFault;
+
+    const ProbeQualityReason want = (fault == Fault::ZEROS) ? ProbeQualityReason::ZERO_HITS
+                                                            : ProbeQualityReason::UNRELIABLE_SPIKES;
+    RunReport rep{0u, 0u, kNoFault, kNoFault, 0u, 0u};
+    uint32_t nextRawMs = 0u;
+    uint32_t nextComputeMs = 0u;
+    while (nextRawMs < kTraceEndMs || nextComputeMs < kTraceEndMs)
+    {
+        if (nextRawMs <= nextComputeMs)
+        {
+            const uint32_t now = nextRawMs;
+            lastRaw = probeRaw(now, rep.rawSamples, fault, faultStartMs);
+            const QualityResult r = quality_evaluate(lastRaw, cfg, qc, rt, now);
+            connected = r.connected;
+            rep.rawSamples++;
+            if (rep.detectMs == kNoFault && fault != Fault::NONE && now >= faultStartMs && r.reason == want)
+            {
+                rep.detectMs = now - faultStartMs;
+            }
+            nextRawMs = now + (adaptive ? st.rawMs : kNormalRawMs);
+        }
+        else
+        {
+            const uint32_t now = nextComputeMs;
+            rep.computeSamples++;
+            if (adaptive)
+            {
+                int32_t percentQ16 = 0;
+                const bool valid = connected && level_percentFromRaw(calib, (int32_t)lastRaw, percentQ16);
+                level_filterUpdate(filter, valid, percentQ16);
+                const LevelFixed lv = level_derive(calib, filter);
+                const bool percentValid = valid && (lv.valid & LEVEL_VALID_PERCENT) != 0u;
+                if (sampler_update(st, scfg, level_q16ToFloat(lv.percentQ16), percentValid, now))
+                {
+                    rep.modeChanges++;
+                }
+                if (rep.activeAfterMs == kNoFault && st.mode == SamplerMode::ACTIVE && now >= kFillStartMs)
+                {
+                    rep.activeAfterMs = now - kFillStartMs;
+                }
+                if (st.mode == SamplerMode::STATIC && staticSinceMs == kNoFault)
+                {
+                    staticSinceMs = now;
+                }
+                else if (st.mode != SamplerMode::STATIC && staticSinceMs != kNoFault)
+                {
+                    rep.staticMs += now - staticSinceMs;
+                    staticSinceMs = kNoFault;
+                }
+            }
+            nextComputeMs = now + (adaptive ? st.computeMs : kNormalComputeMs);
+        }
+    }
+    if (staticSinceMs != kNoFault)
+    {
+        rep.staticMs += kTraceEndMs - staticSinceMs;
+    }
+    return rep;
+}
+
+static void printReport(const char *label, const RunReport &rep)
+{
+    printf("%-18s raw=%lu compute=%lu detect_ms=%ld active_after_ms=%ld mode_changes=%lu static_s=%lu\n", label,
+           (unsigned long)rep.rawSamples, (unsigned long)rep.computeSamples,
+           (rep.detectMs == kNoFault) ? -1L : (long)rep.detectMs,
+           (rep.activeAfterMs == kNoFault) ? -1L : (long)rep.activeAfterMs,
+           (unsigned long)rep.modeChanges, (unsigned long)(rep.staticMs / 1000u));
+}
+
+static QualityConfig s_qc;
+
+// Windows and counts are the shipped defaults; the raw thresholds are pinned so
+// a board config.h tuned for another probe does not change the trace.
+void setUp()
+{
+    quality_configDefaults(s_qc);
+    s_qc.disconnectedBelowRaw = 30000u;
+    s_qc.rawMin = 0u;
+    s_qc.rawMax = 65535u;
+    s_qc.spikeDelta = 10000u;
+    s_qc.rapidFluctuationDelta = 5000u;
+}
+
+void tearDown() {}
+
+static void test_raw_cap_follows_quality_windows()
+{
+    TEST_ASSERT_EQUAL_UINT32(1666u, sampler_rawCapMs(5000u, 3u));
+    TEST_ASSERT_EQUAL_UINT32(2500u, sampler_rawCapMs(5000u, 2u));
+    TEST_ASSERT_EQUAL_UINT32(1u, sampler_rawCapMs(1u, 3u));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, sampler_rawCapMs(5000u, 0u));
+    TEST_ASSERT_EQUAL_UINT32(1666u, cappedSlowRawMs(s_qc));
+}
+
+static void test_reconfigure_moves_current_mode_only()
+{
+    SamplerConfig cfg = samplerConfig(4000u);
+    SamplerState st;
+    sampler_init(st, cfg, 0u);
+    cfg.slowRawMs = 1500u;
+    TEST_ASSERT_FALSE(sampler_reconfigure(st, cfg)); // NORMAL does not use slowRawMs
+    st.mode = SamplerMode::STATIC;
+    TEST_ASSERT_TRUE(sampler_reconfigure(st, cfg));
+    TEST_ASSERT_EQUAL_UINT32(1500u, st.rawMs);
+}
+
+static void test_adaptive_takes_fewer_samples()
+{
+    const RunReport fixed = runTrace(false, 0u, s_qc, Fault::NONE, kNoFault);
+    const RunReport adapt = runTrace(true, cappedSlowRawMs(s_qc), s_qc, Fault::NONE, kNoFault);
+    printReport("fixed", fixed);
+    printReport("adaptive", adapt);
+    TEST_ASSERT_LESS_THAN_UINT32(fixed.rawSamples, adapt.rawSamples);
+    TEST_ASSERT_LESS_THAN_UINT32(fixed.computeSamples, adapt.computeSamples);
+    // The fill is picked up once the windowed trend clears its deadband.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(CFG_ADAPT_TREND_WINDOW_MS + 2u * CFG_ADAPT_SLOW_COMPUTE_MS,
+                                     adapt.activeAfterMs);
+    // Probe noise alone never moves the mode: static -> (normal) -> active for
+    // the fill, back down to static after it, and most of the trace is static.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(5u, adapt.modeChanges);
+    TEST_ASSERT_GREATER_THAN_UINT32(kTraceEndMs / 2000u, adapt.staticMs / 1000u);
+}
+
+static void test_spikes_detected_at_slow_cadence()
+{
+    const uint32_t faultMs = 10u * 60000u; // long after the static hold
+    const RunReport fixed = runTrace(false, 0u, s_qc, Fault::SPIKES, faultMs);
+    const RunReport adapt = runTrace(true, cappedSlowRawMs(s_qc), s_qc, Fault::SPIKES, faultMs);
+    const RunReport uncapped = runTrace(true, 4000u, s_qc, Fault::SPIKES, faultMs);
+    printReport("fixed spikes", fixed);
+    printReport("adaptive spikes", adapt);
+    printReport("4 s slow spikes", uncapped);
+    // Up to one interval passes before the first faulty sample is taken.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(s_qc.spikeWindowMs + kNormalRawMs, fixed.detectMs);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(s_qc.spikeWindowMs + cappedSlowRawMs(s_qc), adapt.detectMs);
+    // Three spikes 4 s apart never fit the 5 s window.
+    TEST_ASSERT_EQUAL_UINT32(kNoFault, uncapped.detectMs);
+}
+
+static void test_zero_hits_detected_at_slow_cadence()
+{
+    s_qc.disconnectedBelowRaw = 0u; // otherwise 0 reads as a disconnect
+    s_qc.zeroHitCount = 3u;
+    const uint32_t faultMs = 10u * 60000u;
+    const RunReport adapt = runTrace(true, cappedSlowRawMs(s_qc), s_qc, Fault::ZEROS, faultMs);
+    const RunReport uncapped = runTrace(true, 4000u, s_qc, Fault::ZEROS, faultMs);
+    printReport("adaptive zeros", adapt);
+    printReport("4 s slow zeros", uncapped);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(s_qc.zeroWindowMs + cappedSlowRawMs(s_qc), adapt.detectMs);
+    TEST_ASSERT_EQUAL_UINT32(kNoFault, uncapped.detectMs);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_raw_cap_follows_quality_windows);
+    RUN_TEST(test_reconfigure_moves_current_mode_only);
+    RUN_TEST(test_adaptive_takes_fewer_samples);
+    RUN_TEST(test_spikes_detected_at_slow_cadence);
+    RUN_TEST(test_zero_hits_detected_at_slow_cadence);
+    return UNITY_END();
+}
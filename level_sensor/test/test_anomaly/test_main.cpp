@@ -0,0 +1,257 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "anomaly.h"
+
+// The statistical quality tier on synthetic 1 Hz traces: quiet holds and
+// steady fills must stay OK, and a spike, a level jump and a noise burst must
+// each raise their own verdict within a few samples.
+
+static constexpr uint32_t kSampleMs = 1000u;
+static constexpr float kLevel = 100000.0f;
+static constexpr float kNoise = 40.0f;
+
+static uint32_t s_lcg = 1u;
+
+static float uniform()
+{
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    return ((float)(s_lcg >> 8) + 0.5f) / 16777216.0f;
+}
+
+static float gaussian(float sigma)
+{
+    return sigma * sqrtf(-2.0f * logf(uniform())) * cosf(2.0f * (float)M_PI * uniform());
+}
+
+static AnomalyConfig enabledConfig()
+{
+    AnomalyConfig cfg;
+    anomaly_configDefaults(cfg);
+    cfg.enabled = true;
+    return cfg;
+}
+
+static constexpr QualityResult kOk{true, ProbeQualityReason::OK};
+
+static AnomalyResult feed(AnomalyState &st, const AnomalyConfig &cfg, float raw, uint32_t &nowMs)
+{
+    nowMs += kSampleMs;
+    return anomaly_evaluate(st, cfg, (uint32_t)lroundf(raw), nowMs, kOk);
+}
+
+// Fraction of samples flagged over n samples of level(t) + noise, after warm-up.
+static float falsePositiveRate(AnomalyState &st, const AnomalyConfig &cfg, uint32_t n, float slopePerS)
+{
+    uint32_t nowMs = 0u;
+    uint32_t flagged = 0u;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const float raw = kLevel + slopePerS * (float)i + gaussian(kNoise);
+        const AnomalyResult r = feed(st, cfg, raw, nowMs);
+        if (i > cfg.warmup && r.quality.reason != ProbeQualityReason::OK)
+        {
+            flagged++;
+        }
+    }
+    return (float)flagged / (float)n;
+}
+
+static void warmUp(AnomalyState &st, const AnomalyConfig &cfg, uint32_t &nowMs, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; ++i)
+    {
+        TEST_ASSERT_TRUE(feed(st, cfg, kLevel + gaussian(kNoise), nowMs).quality.reason == ProbeQualityReason::OK);
+    }
+}
+
+void setUp()
+{
+    s_lcg = 1u;
+}
+
+void tearDown() {}
+
+static void test_disabled_passes_through()
+{
+    AnomalyConfig cfg;
+    anomaly_configDefaults(cfg);
+    TEST_ASSERT_FALSE(cfg.enabled);
+    AnomalyState st;
+    anomaly_init(st);
+    const AnomalyResult r = anomaly_evaluate(st, cfg, 250000u, 1000u, kOk);
+    TEST_ASSERT_TRUE(r.quality.reason == ProbeQualityReason::OK);
+    TEST_ASSERT_EQUAL_UINT8(0u, r.confidence);
+    TEST_ASSERT_EQUAL_UINT32(0u, st.n);
+}
+
+static void test_quiet_hold_and_fill_stay_ok()
+{
+    const AnomalyConfig cfg = enabledConfig();
+    AnomalyState st;
+    anomaly_init(st);
+    const float hold = falsePositiveRate(st, cfg, 86400u, 0.0f);
+    anomaly_init(st);
+    const float fill = falsePositiveRate(st, cfg, 3600u, 20.0f);
+    printf("false positives: hold %.4f %%, 20 counts/s fill %.4f %%\n", (double)(100.0f * hold),
+           (double)(100.0f * fill));
+    TEST_ASSERT_TRUE(hold < 0.0005f);
+    TEST_ASSERT_TRUE(fill < 0.0005f);
+}
+
+static void test_scale_tracks_noise()
+{
+    AnomalyConfig cfg = enabledConfig();
+    cfg.minSigma = 1.0f;
+    AnomalyState st;
+    anomaly_init(st);
+    uint32_t nowMs = 0u;
+    const float sigma = 300.0f;
+    for (uint32_t i = 0; i < 5000u; ++i)
+    {
+        feed(st, cfg, kLevel + gaussian(sigma), nowMs);
+    }
+    // The error is reading minus a trend prediction that carries noise of its own,
+    // so its spread is somewhat above the reading noise.
+    const float scale = anomaly_sigma(st, cfg);
+    printf("robust scale %.0f for reading noise %.0f\n", (double)scale, (double)sigma);
+    TEST_ASSERT_TRUE(scale > sigma && scale < 2.0f * sigma);
+}
+
+static void test_spike_is_an_outlier_and_does_not_move_the_model()
+{
+    const AnomalyConfig cfg = enabledConfig();
+    AnomalyState st;
+    anomaly_init(st);
+    uint32_t nowMs = 0u;
+    warmUp(st, cfg, nowMs, 200u);
+    const float levelBefore = st.level;
+    const AnomalyResult r = feed(st, cfg, kLevel + 5000.0f, nowMs);
+    TEST_ASSERT_TRUE(r.quality.reason == ProbeQualityReason::ANOMALY_OUTLIER);
+    TEST_ASSERT_TRUE(r.confidence > 50u);
+    TEST_ASSERT_FLOAT_WITHIN(50.0f, levelBefore, st.level);
+    TEST_ASSERT_TRUE(feed(st, cfg, kLevel, nowMs).quality.reason == ProbeQualityReason::OK);
+}
+
+static void test_level_jump_is_a_shift_and_is_held()
+{
+    const AnomalyConfig cfg = enabledConfig();
+    AnomalyState st;
+    anomaly_init(st);
+    uint32_t nowMs = 0u;
+    warmUp(st, cfg, nowMs, 200u);
+    // Past the outlier test the model holds still, so the clamped z feeds the
+    // CUSUM at full rate until it trips. Smaller steps are followed by the trend.
+    const float jump = 1500.0f;
+    TEST_ASSERT_TRUE(feed(st, cfg, kLevel + jump, nowMs).quality.reason == ProbeQualityReason::ANOMALY_OUTLIER);
+    uint32_t detectedAfter = 1u;
+    while (detectedAfter < 10u &&
+           feed(st, cfg, kLevel + jump + gaussian(kNoise), nowMs).quality.reason != ProbeQualityReason::ANOMALY_SHIFT)
+    {
+        detectedAfter++;
+    }
+    printf("%.0f-count jump reported as a shift on sample %lu\n", (double)jump, (unsigned long)(detectedAfter + 1u));
+    TEST_ASSERT_TRUE(detectedAfter < 10u);
+
+    // Held for holdMs on the rebased model, then back to OK.
+    const uint32_t heldUntil = nowMs + cfg.holdMs;
+    while (nowMs + kSampleMs < heldUntil)
+    {
+        TEST_ASSERT_TRUE(feed(st, cfg, kLevel + jump + gaussian(kNoise), nowMs).quality.reason ==
+                         ProbeQualityReason::ANOMALY_SHIFT);
+    }
+    feed(st, cfg, kLevel + jump, nowMs);
+    TEST_ASSERT_TRUE(feed(st, cfg, kLevel + jump, nowMs).quality.reason == ProbeQualityReason::OK);
+}
+
+static void test_noise_is_flagged()
+{
+    const AnomalyConfig cfg = enabledConfig();
+    AnomalyState st;
+    anomaly_init(st);
+    uint32_t nowMs = 0u;
+    warmUp(st, cfg, nowMs, 200u);
+
+    // Noise that creeps up (a connector going bad) is tracked by the scale and
+    // ends up as ANOMALY_NOISE once its std passes noiseStd.
+    const uint32_t ramp = 1200u;
+    uint32_t noisy = 0u;
+    for (uint32_t i = 0; i < ramp + 4u * cfg.window; ++i)
+    {
+        const float sigma = kNoise + (2.0f * cfg.noiseStd - kNoise) * (float)(i < ramp ? i : ramp) / (float)ramp;
+        if (feed(st, cfg, kLevel + gaussian(sigma), nowMs).quality.reason == ProbeQualityReason::ANOMALY_NOISE)
+        {
+            noisy++;
+        }
+    }
+    TEST_ASSERT_TRUE(st.noisy);
+    TEST_ASSERT_TRUE(noisy > cfg.window);
+
+    // Noise that starts at full strength is judged sample by sample against the
+    // quiet scale (outliers, then shifts); either way it is not OK.
+    anomaly_init(st);
+    warmUp(st, cfg, nowMs, 200u);
+    uint32_t flagged = 0u;
+    for (uint32_t i = 0; i < 4u * cfg.window; ++i)
+    {
+        if (feed(st, cfg, kLevel + gaussian(2.0f * cfg.noiseStd), nowMs).quality.reason != ProbeQualityReason::OK)
+        {
+            flagged++;
+        }
+    }
+    printf("sudden noise burst: %lu of %lu samples flagged\n", (unsigned long)flagged,
+           (unsigned long)(4u * cfg.window));
+    TEST_ASSERT_TRUE(flagged > 2u * cfg.window);
+}
+
+static void test_threshold_verdicts_stand()
+{
+    const AnomalyConfig cfg = enabledConfig();
+    AnomalyState st;
+    anomaly_init(st);
+    uint32_t nowMs = 0u;
+    warmUp(st, cfg, nowMs, 100u);
+    const uint32_t seen = st.n;
+
+    const QualityResult spike{true, ProbeQualityReason::UNRELIABLE_SPIKES};
+    AnomalyResult r = anomaly_evaluate(st, cfg, 900000u, nowMs + kSampleMs, spike);
+    TEST_ASSERT_TRUE(r.quality.reason == ProbeQualityReason::UNRELIABLE_SPIKES);
+    TEST_ASSERT_EQUAL_UINT8(100u, r.confidence);
+    TEST_ASSERT_EQUAL_UINT32(seen, st.n);
+
+    const QualityResult unplugged{false, ProbeQualityReason::DISCONNECTED_LOW_RAW};
+    r = anomaly_evaluate(st, cfg, 0u, nowMs + 2u * kSampleMs, unplugged);
+    TEST_ASSERT_FALSE(r.quality.connected);
+    TEST_ASSERT_EQUAL_UINT32(0u, st.n);
+}
+
+static void test_config_validation()
+{
+    AnomalyConfig cfg = enabledConfig();
+    TEST_ASSERT_TRUE(anomaly_validateConfig(cfg));
+    cfg.window = 2u;
+    TEST_ASSERT_FALSE(anomaly_validateConfig(cfg));
+    cfg = enabledConfig();
+    cfg.outlierK = 1.0f;
+    TEST_ASSERT_FALSE(anomaly_validateConfig(cfg));
+    cfg = enabledConfig();
+    cfg.noiseStd = NAN;
+    TEST_ASSERT_FALSE(anomaly_validateConfig(cfg));
+    cfg = enabledConfig();
+    cfg.holdMs = 86400001u;
+    TEST_ASSERT_FALSE(anomaly_validateConfig(cfg));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_disabled_passes_through);
+    RUN_TEST(test_quiet_hold_and_fill_stay_ok);
+    RUN_TEST(test_scale_tracks_noise);
+    RUN_TEST(test_spike_is_an_outlier_and_does_not_move_the_model);
+    RUN_TEST(test_level_jump_is_a_shift_and_is_held);
+    RUN_TEST(test_noise_is_flagged);
+    RUN_TEST(test_threshold_verdicts_stand);
+    RUN_TEST(test_config_validation);
+    return UNITY_END();
+}
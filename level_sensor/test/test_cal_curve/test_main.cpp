@@ -0,0 +1,185 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include "cal_curve.h"
+#include "level_fixed.h"
+
+// Multi-point calibration against synthetic non-linear probes: the rod is
+// calibrated at evenly spaced levels, then swept from empty to full and the
+// percent from level_percentFromRaw() is compared with the true level.
+
+static constexpr int32_t kDry = 80000;
+static constexpr int32_t kWet = 140000;
+
+typedef float (*ProbeResponse)(float level01);
+
+// Fringe field saturates towards the top of the rod.
+static float saturating(float x)
+{
+    return (1.0f - expf(-2.5f * x)) / (1.0f - expf(-2.5f));
+}
+
+// Weak response near the bottom (mounting bracket), steep above it.
+static float delayed(float x)
+{
+    return x * x * (3.0f - 2.0f * x);
+}
+
+static int32_t probeRaw(ProbeResponse f, float percent)
+{
+    return kDry + (int32_t)lroundf((float)(kWet - kDry) * f(percent / 100.0f));
+}
+
+static LevelCalib calibrate(ProbeResponse f, uint8_t points)
+{
+    AppliedConfig cfg{};
+    cfg.tankVolumeLiters = 1000.0f;
+    cfg.rodLengthCm = 100.0f;
+    tank_geometryDefaults(cfg.tankGeometry);
+    cfg.calDry = (uint32_t)kDry;
+    cfg.calWet = (uint32_t)kWet;
+    cal_curveClear(cfg.calCurve);
+    for (uint8_t i = 1; i <= points; ++i)
+    {
+        const float pct = 100.0f * (float)i / (float)(points + 1u);
+        TEST_ASSERT_TRUE(cal_curveInsert(cfg.calCurve, probeRaw(f, pct), pct));
+    }
+    LevelCalib calib;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    TEST_ASSERT_EQUAL_UINT8(points, calib.curvePointsUsed);
+    return calib;
+}
+
+static float maxError(const LevelCalib &calib, ProbeResponse f)
+{
+    float worst = 0.0f;
+    for (float pct = 0.0f; pct <= 100.0f; pct += 0.05f)
+    {
+        int32_t q16 = 0;
+        TEST_ASSERT_TRUE(level_percentFromRaw(calib, probeRaw(f, pct), q16));
+        worst = fmaxf(worst, fabsf(level_q16ToFloat(q16) - pct));
+    }
+    return worst;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_accuracy_improves_with_points()
+{
+    struct Probe
+    {
+        const char *name;
+        ProbeResponse f;
+        float maxErrFull; // with CFG_CAL_CURVE_MAX_POINTS points
+    };
+    // "delayed" is flat at both ends, where a few raw counts span whole
+    // percents; evenly spaced points leave the most error there.
+    const Probe probes[] = {{"saturating", saturating, 0.5f}, {"delayed", delayed, 3.0f}};
+    for (const Probe &p : probes)
+    {
+        float previous = 1000.0f;
+        printf("%-10s", p.name);
+        for (uint8_t n = 0; n <= CFG_CAL_CURVE_MAX_POINTS; n += 2)
+        {
+            const float err = maxError(calibrate(p.f, n), p.f);
+            printf("  %u pts: %5.2f %%", (unsigned)n, (double)err);
+            TEST_ASSERT_TRUE(err < previous);
+            previous = err;
+        }
+        printf("\n");
+        TEST_ASSERT_TRUE(previous < p.maxErrFull);
+    }
+}
+
+static void test_linear_probe_is_exact_either_way()
+{
+    const auto linear = [](float x) { return x; };
+    TEST_ASSERT_TRUE(maxError(calibrate(linear, 0), linear) < 0.01f);
+    TEST_ASSERT_TRUE(maxError(calibrate(linear, CFG_CAL_CURVE_MAX_POINTS), linear) < 0.01f);
+}
+
+static void test_insert_keeps_table_sorted_and_bounded()
+{
+    CalCurve c;
+    cal_curveClear(c);
+    TEST_ASSERT_FALSE(cal_curveInsert(c, 90000, 0.0f));
+    TEST_ASSERT_FALSE(cal_curveInsert(c, 90000, 100.0f));
+    TEST_ASSERT_FALSE(cal_curveInsert(c, 0, 50.0f));
+    TEST_ASSERT_TRUE(cal_curveInsert(c, 120000, 60.0f));
+    TEST_ASSERT_TRUE(cal_curveInsert(c, 100000, 30.0f));
+    TEST_ASSERT_TRUE(cal_curveInsert(c, 101000, 30.0f)); // same level: replace
+    TEST_ASSERT_EQUAL_UINT8(2u, c.count);
+    TEST_ASSERT_EQUAL_UINT16(3000u, c.points[0].percentX100);
+    TEST_ASSERT_EQUAL_INT32(101000, c.points[0].raw);
+    for (uint8_t i = c.count; i < CFG_CAL_CURVE_MAX_POINTS; ++i)
+    {
+        TEST_ASSERT_TRUE(cal_curveInsert(c, 90000 + i, 1.0f + i));
+    }
+    TEST_ASSERT_FALSE(cal_curveInsert(c, 95000, 95.0f));
+    TEST_ASSERT_TRUE(cal_curveValidate(c));
+}
+
+static void test_folding_point_is_skipped()
+{
+    AppliedConfig cfg{};
+    cfg.tankVolumeLiters = NAN;
+    cfg.rodLengthCm = NAN;
+    tank_geometryDefaults(cfg.tankGeometry);
+    cfg.calDry = (uint32_t)kDry;
+    cfg.calWet = (uint32_t)kWet;
+    cal_curveClear(cfg.calCurve);
+    cal_curveInsert(cfg.calCurve, 100000, 25.0f);
+    cal_curveInsert(cfg.calCurve, 95000, 50.0f); // below the 25 % point: would fold the curve
+    cal_curveInsert(cfg.calCurve, 130000, 75.0f);
+    LevelCalib calib;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    TEST_ASSERT_EQUAL_UINT8(2u, calib.curvePointsUsed);
+    int32_t prev = -1;
+    for (int32_t raw = kDry; raw <= kWet; raw += 100)
+    {
+        int32_t q16 = 0;
+        level_percentFromRaw(calib, raw, q16);
+        TEST_ASSERT_TRUE(q16 >= prev);
+        prev = q16;
+    }
+}
+
+static volatile int32_t s_sink;
+
+// Host timing of the hot-path lookup for growing tables. The search is a
+// fixed number of halving steps, so the cost should barely move with N.
+static void test_lookup_benchmark()
+{
+    constexpr uint32_t kLookups = 500000u;
+    for (uint8_t n = 0; n <= CFG_CAL_CURVE_MAX_POINTS; n += 4)
+    {
+        const LevelCalib calib = calibrate(saturating, n);
+        uint32_t lcg = 1u;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < kLookups; ++i)
+        {
+            lcg = lcg * 1664525u + 1013904223u;
+            int32_t q16 = 0;
+            level_percentFromRaw(calib, kDry + (int32_t)(lcg >> 16), q16);
+            s_sink = q16;
+        }
+        const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - t0)
+                              .count();
+        printf("lookup with %u curve points: %.1f ns\n", (unsigned)n, ns / kLookups);
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_accuracy_improves_with_points);
+    RUN_TEST(test_linear_probe_is_exact_either_way);
+    RUN_TEST(test_insert_keeps_table_sorted_and_bounded);
+    RUN_TEST(test_folding_point_is_skipped);
+    RUN_TEST(test_lookup_benchmark);
+    return UNITY_END();
+}
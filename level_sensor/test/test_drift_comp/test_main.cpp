@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "drift_comp.h"
+
+// Replays a day of 1 Hz touch readings: a constant water level under a
+// diurnal baseline swing plus reading noise. The corrected reading should
+// stay near the level while the uncorrected one follows the baseline.
+
+static constexpr uint32_t kSampleMs = 1000u;
+static constexpr uint32_t kDayMs = 86400000u;
+static constexpr int32_t kLevelRaw = 20000;
+static constexpr float kSwing = 500.0f; // diurnal baseline amplitude, raw counts
+static constexpr int32_t kNoise = 15;
+
+static uint32_t s_lcg = 1u;
+
+static int32_t noise()
+{
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    return (int32_t)(s_lcg >> 16) % (2 * kNoise + 1) - kNoise;
+}
+
+static float baseline(uint32_t nowMs)
+{
+    return kSwing * sinf(2.0f * (float)M_PI * (float)nowMs / (float)kDayMs);
+}
+
+static DriftConfig defaultConfig()
+{
+    return DriftConfig{CFG_DRIFT_TAU_S, CFG_DRIFT_STABLE_MS, CFG_DRIFT_STABLE_BAND, CFG_DRIFT_MAX_OFFSET,
+                       CFG_DRIFT_FAST_ALPHA};
+}
+
+struct ReplayError
+{
+    float maxAbs;
+    float rms;
+};
+
+// Error of corrected (or raw) against the true level over [fromMs, toMs).
+static ReplayError replay(DriftState &st, const DriftConfig &cfg, uint32_t fromMs, uint32_t toMs, bool corrected,
+                          int32_t (*level)(uint32_t))
+{
+    ReplayError e{0.0f, 0.0f};
+    double sq = 0.0;
+    uint32_t n = 0;
+    for (uint32_t t = fromMs; t < toMs; t += kSampleMs)
+    {
+        const int32_t truth = level(t);
+        const int32_t raw = truth + (int32_t)lroundf(baseline(t)) + noise();
+        const int32_t out = drift_update(st, cfg, raw, t, true);
+        const float err = (float)((corrected ? out : raw) - truth);
+        e.maxAbs = fmaxf(e.maxAbs, fabsf(err));
+        sq += (double)err * err;
+        n++;
+    }
+    e.rms = n ? (float)sqrt(sq / n) : 0.0f;
+    return e;
+}
+
+static int32_t constantLevel(uint32_t)
+{
+    return kLevelRaw;
+}
+
+// Half the day still, then the tank is filled by 3000 counts over ten minutes.
+static int32_t fillAtNoon(uint32_t nowMs)
+{
+    const uint32_t start = kDayMs / 2u;
+    if (nowMs < start)
+    {
+        return kLevelRaw;
+    }
+    const uint32_t into = nowMs - start;
+    return kLevelRaw + (int32_t)((into >= 600000u) ? 3000u : (uint64_t)into * 3000u / 600000u);
+}
+
+void setUp()
+{
+    s_lcg = 1u;
+}
+
+void tearDown() {}
+
+static void test_diurnal_swing_is_tracked()
+{
+    const DriftConfig cfg = defaultConfig();
+    DriftState st;
+    drift_init(st, 0.0f);
+    // Warm-up: the quiet period has to pass before the offset adapts.
+    replay(st, cfg, 0u, 3600000u, true, constantLevel);
+    const ReplayError comp = replay(st, cfg, 3600000u, kDayMs, true, constantLevel);
+
+    DriftState off;
+    drift_init(off, 0.0f);
+    s_lcg = 1u;
+    const ReplayError raw = replay(off, cfg, 3600000u, kDayMs, false, constantLevel);
+
+    printf("drift replay: raw max=%.1f rms=%.1f  compensated max=%.1f rms=%.1f\n", (double)raw.maxAbs,
+           (double)raw.rms, (double)comp.maxAbs, (double)comp.rms);
+    TEST_ASSERT_TRUE(raw.maxAbs > 400.0f);
+    // Tracking lag at the steepest slope is swing * 2pi * tau / day (about 11 counts) plus noise.
+    TEST_ASSERT_TRUE(comp.maxAbs < 60.0f);
+    TEST_ASSERT_TRUE(comp.rms < 20.0f);
+}
+
+static void test_fill_is_not_absorbed()
+{
+    const DriftConfig cfg = defaultConfig();
+    DriftState st;
+    drift_init(st, 0.0f);
+    replay(st, cfg, 0u, kDayMs / 2u, true, fillAtNoon);
+    const float offsetBefore = st.offset;
+    replay(st, cfg, kDayMs / 2u, kDayMs / 2u + 600000u, true, fillAtNoon);
+    // The fill outpaces band / tau by far: the offset is held while it runs.
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, offsetBefore, st.offset);
+    const ReplayError after = replay(st, cfg, kDayMs / 2u + 600000u, kDayMs, true, fillAtNoon);
+    printf("after fill: compensated max=%.1f rms=%.1f\n", (double)after.maxAbs, (double)after.rms);
+    // Drift during the fill and the following quiet period (~15 min at the
+    // steepest slope, about 33 counts) is anchored into the new reference.
+    TEST_ASSERT_TRUE(after.maxAbs < 90.0f);
+    TEST_ASSERT_TRUE(after.rms < 60.0f);
+}
+
+static void test_untrusted_samples_do_not_adapt()
+{
+    const DriftConfig cfg = defaultConfig();
+    DriftState st;
+    drift_init(st, 100.0f);
+    for (uint32_t t = 0; t < 2u * CFG_DRIFT_STABLE_MS; t += kSampleMs)
+    {
+        TEST_ASSERT_EQUAL_INT32(kLevelRaw + 200, drift_update(st, cfg, kLevelRaw + 300, t, false));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, st.offset);
+}
+
+static void test_offset_is_clamped()
+{
+    DriftConfig cfg = defaultConfig();
+    cfg.maxOffset = 200.0f;
+    DriftState st;
+    drift_init(st, 0.0f);
+    // Baseline creeps 2000 counts over 20 h, slowly enough to count as drift.
+    for (uint32_t t = 0; t < 72000000u; t += kSampleMs)
+    {
+        drift_update(st, cfg, kLevelRaw + (int32_t)(t / 36000u), t, true);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(200.0f, st.offset);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_diurnal_swing_is_tracked);
+    RUN_TEST(test_fill_is_not_absorbed);
+    RUN_TEST(test_untrusted_samples_do_not_adapt);
+    RUN_TEST(test_offset_is_clamped);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include <unity.h>
+#include <stdio.h>
+#include "duty_cycle.h"
+
+// duty_plan driven over simulated days: each iteration is one wake, and the
+// clock jumps by the sleep it asked for plus a fixed awake time.
+
+static constexpr uint64_t kHourMs = 3600000ull;
+static constexpr uint32_t kAwakeMs = 1500u;
+
+static DutyConfig testConfig()
+{
+    DutyConfig cfg{};
+    cfg.minIntervalS = 300u;
+    cfg.maxIntervalS = 3600u;
+    cfg.fastRatePctPerHour = 10.0f;
+    cfg.publishDeltaPct = 2.0f;
+    cfg.heartbeatS = 21600u;
+    cfg.listenMs = 2000u;
+    cfg.awakeWindowMs = 60000u;
+    cfg.maxAwakeMs = 600000u;
+    return cfg;
+}
+
+// 50 % until hour 10, filled to 80 % over two hours, then a slow drain.
+static float levelAt(uint64_t ms)
+{
+    const float h = (float)ms / (float)kHourMs;
+    if (h < 10.0f)
+    {
+        return 50.0f;
+    }
+    if (h < 12.0f)
+    {
+        return 50.0f + 15.0f * (h - 10.0f);
+    }
+    return 80.0f - 0.2f * (h - 12.0f);
+}
+
+struct SimReport
+{
+    uint32_t wakes;
+    uint32_t publishes;
+    uint32_t heartbeats;
+    uint32_t minSleepS;
+    uint32_t maxSleepS;
+    uint32_t sleepDuringFillS; // longest sleep chosen while filling
+    uint64_t maxPublishGapMs;
+    uint64_t awakeTotalMs;
+};
+
+static SimReport simulate(const DutyConfig &cfg, uint64_t durationMs, bool brokerUp)
+{
+    DutyRtcState st;
+    duty_reset(st);
+    SimReport rep{0u, 0u, 0u, UINT32_MAX, 0u, 0u, 0u, 0u};
+    uint64_t now = 0;
+    uint64_t lastPublish = 0;
+    while (now < durationMs)
+    {
+        const DutyObservation obs{now, levelAt(now), true, ProbeQualityReason::OK};
+        const DutyDecision d = duty_plan(st, cfg, obs);
+        rep.wakes++;
+        uint64_t awake = kAwakeMs;
+        if (d.publish && brokerUp)
+        {
+            duty_notePublished(st, obs);
+            duty_noteSamplesFlushed(st);
+            rep.publishes++;
+            rep.heartbeats += d.heartbeat ? 1u : 0u;
+            awake += d.awakeMs;
+            if (now - lastPublish > rep.maxPublishGapMs)
+            {
+                rep.maxPublishGapMs = now - lastPublish;
+            }
+            lastPublish = now;
+        }
+        else
+        {
+            duty_bufferObservation(st, obs);
+        }
+        rep.minSleepS = (d.sleepS < rep.minSleepS) ? d.sleepS : rep.minSleepS;
+        rep.maxSleepS = (d.sleepS > rep.maxSleepS) ? d.sleepS : rep.maxSleepS;
+        if (now >= 11u * kHourMs && now < 12u * kHourMs && d.sleepS > rep.sleepDuringFillS)
+        {
+            rep.sleepDuringFillS = d.sleepS;
+        }
+        rep.awakeTotalMs += awake;
+        duty_beforeSleep(st, now + awake, d.sleepS);
+        now = st.clockMs;
+    }
+    printf("wakes=%lu publishes=%lu heartbeats=%lu sleep_s=%lu..%lu fill_sleep_s=%lu max_gap_s=%lu awake_pct=%.3f\n",
+           (unsigned long)rep.wakes, (unsigned long)rep.publishes, (unsigned long)rep.heartbeats,
+           (unsigned long)rep.minSleepS, (unsigned long)rep.maxSleepS, (unsigned long)rep.sleepDuringFillS,
+           (unsigned long)(rep.maxPublishGapMs / 1000u), 100.0 * (double)rep.awakeTotalMs / (double)now);
+    return rep;
+}
+
+static DutyConfig s_cfg;
+static DutyRtcState s_st;
+
+void setUp()
+{
+    s_cfg = testConfig();
+    duty_reset(s_st);
+}
+
+void tearDown() {}
+
+static DutyObservation obsAt(uint64_t ms, float pct)
+{
+    return DutyObservation{ms, pct, true, ProbeQualityReason::OK};
+}
+
+static void test_interval_follows_level_rate()
+{
+    const SimReport rep = simulate(s_cfg, 48u * kHourMs, true);
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.minIntervalS, rep.minSleepS);
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.maxIntervalS, rep.maxSleepS);
+    // 15 %/h is above the fast rate: once seen, the fill is tracked at the minimum interval.
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.minIntervalS, rep.sleepDuringFillS);
+    // Heartbeats bound the silence between publishes.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32((uint64_t)(s_cfg.heartbeatS + s_cfg.maxIntervalS) * 1000u,
+                                     rep.maxPublishGapMs);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(48u * 3600u / (s_cfg.heartbeatS + s_cfg.maxIntervalS), rep.heartbeats);
+    TEST_ASSERT_GREATER_THAN_UINT32(rep.heartbeats + 5u, rep.publishes); // fill steps of publishDeltaPct
+}
+
+static void test_offline_buffer_forces_publish_attempts()
+{
+    const SimReport rep = simulate(s_cfg, 24u * kHourMs, false);
+    TEST_ASSERT_EQUAL_UINT32(0u, rep.publishes);
+
+    DutyRtcState st;
+    duty_reset(st);
+    for (uint32_t i = 0; i < CFG_DUTY_BUFFER_SAMPLES; ++i)
+    {
+        duty_bufferObservation(st, obsAt(i * 1000u, 50.0f));
+    }
+    // State published but duty/samples failed: nothing is lost.
+    duty_notePublished(st, obsAt(0u, 50.0f));
+    TEST_ASSERT_EQUAL_UINT8(CFG_DUTY_BUFFER_SAMPLES, st.bufCount);
+    TEST_ASSERT_TRUE(duty_plan(st, s_cfg, obsAt(1000u, 50.0f)).publish);
+    duty_noteSamplesFlushed(st);
+    TEST_ASSERT_EQUAL_UINT8(0u, st.bufCount);
+    for (uint32_t i = 0; i < CFG_DUTY_BUFFER_SAMPLES + 3u; ++i)
+    {
+        duty_bufferObservation(st, obsAt(1000u * (i + 1u), 50.0f));
+    }
+    TEST_ASSERT_EQUAL_UINT8(CFG_DUTY_BUFFER_SAMPLES, st.bufCount);
+    TEST_ASSERT_EQUAL_UINT32(4u, st.buf[0].tS); // oldest dropped first
+    TEST_ASSERT_TRUE(duty_plan(st, s_cfg, obsAt(60000u, 50.0f)).publish);
+}
+
+static void test_heartbeat_wakes_get_awake_window()
+{
+    DutyDecision d = duty_plan(s_st, s_cfg, obsAt(0u, 50.0f));
+    TEST_ASSERT_TRUE(d.publish);
+    TEST_ASSERT_TRUE(d.heartbeat); // first wake after a cold boot
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.awakeWindowMs, d.awakeMs);
+    duty_notePublished(s_st, obsAt(0u, 50.0f));
+
+    d = duty_plan(s_st, s_cfg, obsAt(300000u, 50.0f));
+    TEST_ASSERT_FALSE(d.publish);
+    TEST_ASSERT_EQUAL_UINT32(0u, d.awakeMs);
+
+    d = duty_plan(s_st, s_cfg, obsAt(600000u, 55.0f)); // level change: short listen only
+    TEST_ASSERT_TRUE(d.publish);
+    TEST_ASSERT_FALSE(d.heartbeat);
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.listenMs, d.awakeMs);
+    duty_notePublished(s_st, obsAt(600000u, 55.0f));
+
+    d = duty_plan(s_st, s_cfg, obsAt(600000u + s_cfg.heartbeatS * 1000ull, 55.0f));
+    TEST_ASSERT_TRUE(d.heartbeat);
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.awakeWindowMs, d.awakeMs);
+}
+
+static void test_command_keeps_next_wake_reachable()
+{
+    duty_notePublished(s_st, obsAt(0u, 50.0f));
+    s_st.commandSeen = true;
+    const DutyDecision d = duty_plan(s_st, s_cfg, obsAt(300000u, 50.0f));
+    TEST_ASSERT_TRUE(d.publish); // nothing changed, but the operator may be waiting
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.awakeWindowMs, d.awakeMs);
+}
+
+static void test_awake_window_extends_and_caps()
+{
+    DutyAwakeWindow w{};
+    duty_awakeBegin(w, 1000u, s_cfg.listenMs);
+    TEST_ASSERT_TRUE(duty_awakeTick(w, s_cfg, 2000u, false, false));
+    TEST_ASSERT_FALSE(duty_awakeTick(w, s_cfg, 3000u, false, false));
+
+    duty_awakeBegin(w, 1000u, s_cfg.listenMs);
+    TEST_ASSERT_TRUE(duty_awakeTick(w, s_cfg, 2500u, true, false)); // retained command arrived
+    TEST_ASSERT_TRUE(duty_awakeTick(w, s_cfg, 60000u, false, false));
+    TEST_ASSERT_FALSE(duty_awakeTick(w, s_cfg, 62500u, false, false));
+
+    // An OTA job holds the window open, but not past maxAwakeMs.
+    duty_awakeBegin(w, 1000u, s_cfg.listenMs);
+    TEST_ASSERT_TRUE(duty_awakeTick(w, s_cfg, 300000u, false, true));
+    TEST_ASSERT_FALSE(duty_awakeTick(w, s_cfg, 1000u + s_cfg.maxAwakeMs, false, true));
+}
+
+static void test_awake_window_survives_millis_wrap()
+{
+    DutyAwakeWindow w{};
+    const uint32_t start = UINT32_MAX - 500u;
+    duty_awakeBegin(w, start, s_cfg.listenMs);
+    TEST_ASSERT_TRUE(duty_awakeTick(w, s_cfg, start + 1000u, false, false));
+    TEST_ASSERT_FALSE(duty_awakeTick(w, s_cfg, start + 2500u, false, false));
+}
+
+static void test_invalid_level_keeps_interval()
+{
+    DutyObservation bad{0u, 0.0f, false, ProbeQualityReason::DISCONNECTED_LOW_RAW};
+    DutyDecision d = duty_plan(s_st, s_cfg, bad);
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.minIntervalS, d.sleepS);
+    duty_notePublished(s_st, bad);
+    bad.nowMs = 300000u;
+    d = duty_plan(s_st, s_cfg, bad);
+    TEST_ASSERT_FALSE(d.publish);
+    TEST_ASSERT_EQUAL_UINT32(s_cfg.minIntervalS, d.sleepS);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_interval_follows_level_rate);
+    RUN_TEST(test_offline_buffer_forces_publish_attempts);
+    RUN_TEST(test_heartbeat_wakes_get_awake_window);
+    RUN_TEST(test_command_keeps_next_wake_reachable);
+    RUN_TEST(test_awake_window_extends_and_caps);
+    RUN_TEST(test_awake_window_survives_millis_wrap);
+    RUN_TEST(test_invalid_level_keeps_interval);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include "level_fixed.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LEVEL_TEST_TSC 1
+#endif
+
+// The fixed-point pipeline against the float one it replaced in main.cpp
+// (computePercent / percent EMA / refreshLevelFromPercent): same inputs, the
+// outputs must agree within the Q16 / 0.01-unit rounding of the fixed path.
+
+static constexpr float kVolumeL = 1234.5f;
+static constexpr float kRodCm = 187.3f;
+
+static AppliedConfig makeConfig(int32_t dry, int32_t wet, bool inverted)
+{
+    AppliedConfig cfg{};
+    cfg.tankVolumeLiters = kVolumeL;
+    cfg.rodLengthCm = kRodCm;
+    tank_geometryDefaults(cfg.tankGeometry);
+    cfg.calDry = (uint32_t)dry;
+    cfg.calWet = (uint32_t)wet;
+    cfg.calInverted = inverted;
+    cal_curveClear(cfg.calCurve);
+    quality_configDefaults(cfg.quality);
+    return cfg;
+}
+
+// Reference: the float path as it was in main.cpp.
+static float floatPercent(const AppliedConfig &cfg, int32_t raw)
+{
+    const float start = cfg.calInverted ? (float)cfg.calWet : (float)cfg.calDry;
+    const float end = cfg.calInverted ? (float)cfg.calDry : (float)cfg.calWet;
+    const float p = ((float)raw - start) * 100.0f / (end - start);
+    return p < 0.0f ? 0.0f : (p > 100.0f ? 100.0f : p);
+}
+
+struct FloatLevel
+{
+    float percent;
+    float liters;
+    float centimeters;
+};
+
+static FloatLevel floatLevel(const AppliedConfig &cfg, float percent)
+{
+    return FloatLevel{percent, cfg.tankVolumeLiters * percent / 100.0f, cfg.rodLengthCm * percent / 100.0f};
+}
+
+static LevelFixed fixedLevel(const LevelCalib &calib, LevelFilter &filter, int32_t raw)
+{
+    int32_t q16 = 0;
+    const bool ok = level_percentFromRaw(calib, raw, q16);
+    level_filterUpdate(filter, ok, q16);
+    return level_derive(calib, filter);
+}
+
+static void assertMatches(const FloatLevel &ref, const LevelFixed &fx)
+{
+    TEST_ASSERT_EQUAL_UINT8(LEVEL_VALID_PERCENT | LEVEL_VALID_LITERS | LEVEL_VALID_CENTIMETERS, fx.valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, ref.percent, level_q16ToFloat(fx.percentQ16));
+    // 0.01 rounding of the fixed path plus float error of the reference.
+    TEST_ASSERT_FLOAT_WITHIN(0.0051f + ref.liters * 2e-6f, ref.liters, level_centiToFloat(fx.litersCenti));
+    TEST_ASSERT_FLOAT_WITHIN(0.0051f + ref.centimeters * 2e-6f, ref.centimeters, level_centiToFloat(fx.centimetersCenti));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_two_point_sweep_matches_float()
+{
+    const bool inverted[] = {false, true};
+    for (bool inv : inverted)
+    {
+        const AppliedConfig cfg = makeConfig(inv ? 140000 : 80000, inv ? 80000 : 140000, inv);
+        LevelCalib calib;
+        level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+        for (int32_t raw = 70000; raw <= 150000; raw += 7)
+        {
+            LevelFilter filter;
+            level_filterInit(filter, 1.0f);
+            assertMatches(floatLevel(cfg, floatPercent(cfg, raw)), fixedLevel(calib, filter, raw));
+        }
+    }
+}
+
+static void test_ema_tracks_float_ema()
+{
+    const AppliedConfig cfg = makeConfig(80000, 140000, false);
+    LevelCalib calib;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    const float alpha = 0.2f;
+    LevelFilter filter;
+    level_filterInit(filter, alpha);
+    float ema = NAN;
+    float worst = 0.0f;
+    uint32_t lcg = 7u;
+    for (uint32_t i = 0; i < 20000u; ++i)
+    {
+        lcg = lcg * 1664525u + 1013904223u;
+        // A slow fill with noise, then a drain.
+        const int32_t trend = (i < 10000u) ? (int32_t)(i * 6u) : (int32_t)((20000u - i) * 6u);
+        const int32_t raw = 80000 + trend + (int32_t)(lcg >> 22) - 512;
+        const float p = floatPercent(cfg, raw);
+        ema = isnan(ema) ? p : alpha * p + (1.0f - alpha) * ema;
+        const LevelFixed fx = fixedLevel(calib, filter, raw);
+        worst = fmaxf(worst, fabsf(ema - level_q16ToFloat(fx.percentQ16)));
+    }
+    printf("ema: worst |float - fixed| = %.5f %%\n", (double)worst);
+    // Each step rounds to 1/65536 %; the error does not accumulate past a few LSB.
+    TEST_ASSERT_TRUE(worst < 0.002f);
+}
+
+static void test_invalid_inputs_clear_bits()
+{
+    AppliedConfig cfg = makeConfig(0, 140000, false);
+    LevelCalib calib;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    int32_t q16 = 0;
+    TEST_ASSERT_FALSE(level_percentFromRaw(calib, 100000, q16));
+
+    cfg = makeConfig(80000, 80010, false); // closer than CFG_CAL_MIN_DIFF
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    TEST_ASSERT_EQUAL_UINT8(0u, calib.valid);
+
+    cfg = makeConfig(80000, 140000, false);
+    cfg.tankVolumeLiters = NAN;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    LevelFilter filter;
+    level_filterInit(filter, 1.0f);
+    const LevelFixed fx = fixedLevel(calib, filter, 110000);
+    TEST_ASSERT_EQUAL_UINT8(LEVEL_VALID_PERCENT | LEVEL_VALID_CENTIMETERS, fx.valid);
+
+    // An invalid sample resets the filter instead of carrying a NaN.
+    level_filterUpdate(filter, false, 0);
+    TEST_ASSERT_EQUAL_UINT8(0u, level_derive(calib, filter).valid);
+}
+
+static volatile float s_sinkF;
+static volatile uint32_t s_sinkU;
+
+static uint64_t ticks()
+{
+#ifdef LEVEL_TEST_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// Host numbers only show the relative cost; on the device the same loop
+// runs under the profiler (ESP.getCycleCount).
+static void test_cycle_count_comparison()
+{
+    const AppliedConfig cfg = makeConfig(80000, 140000, false);
+    LevelCalib calib;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    constexpr uint32_t kSamples = 200000u;
+    const float alpha = 0.2f;
+
+    uint64_t t0 = ticks();
+    float ema = NAN;
+    for (uint32_t i = 0; i < kSamples; ++i)
+    {
+        const float p = floatPercent(cfg, 80000 + (int32_t)(i & 0xFFFFu));
+        ema = isnan(ema) ? p : alpha * p + (1.0f - alpha) * ema;
+        const FloatLevel lv = floatLevel(cfg, ema);
+        s_sinkF = lv.liters + lv.centimeters;
+    }
+    const uint64_t floatTicks = ticks() - t0;
+
+    LevelFilter filter;
+    level_filterInit(filter, alpha);
+    t0 = ticks();
+    for (uint32_t i = 0; i < kSamples; ++i)
+    {
+        const LevelFixed lv = fixedLevel(calib, filter, 80000 + (int32_t)(i & 0xFFFFu));
+        s_sinkU = lv.litersCenti + lv.centimetersCenti;
+    }
+    const uint64_t fixedTicks = ticks() - t0;
+
+#ifdef LEVEL_TEST_TSC
+    const char *unit = "TSC cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("level pipeline per sample: float %.1f %s, fixed %.1f %s\n", (double)floatTicks / kSamples, unit,
+           (double)fixedTicks / kSamples, unit);
+    TEST_ASSERT_TRUE(fixedTicks > 0u && floatTicks > 0u);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_two_point_sweep_matches_float);
+    RUN_TEST(test_ema_tracks_float_ema);
+    RUN_TEST(test_invalid_inputs_clear_bits);
+    RUN_TEST(test_cycle_count_comparison);
+    return UNITY_END();
+}
@@ -0,0 +1,260 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <zlib.h>
+#include "ota_delta.h"
+#include "ota_inflate.h"
+
+// WTD1 patches applied the way otaTask does: the patch arrives in uneven
+// network chunks, output is drained into a small flash-write buffer, and the
+// source is read back from the "running partition" (a byte vector here). The
+// source image is this test binary (padded to at least 64 KB), the target an
+// edited copy of it with the kinds of change a rebuild makes: inserted code,
+// relocated pointers, a changed tail.
+
+static uint32_t s_lcg = 1u;
+static std::vector<uint8_t> s_source;
+
+static uint32_t nextRandom()
+{
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    return s_lcg >> 8;
+}
+
+static void putU32(std::vector<uint8_t> &v, uint32_t x)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        v.push_back((uint8_t)(x >> (8 * i)));
+    }
+}
+
+static bool readSource(uint32_t offset, uint8_t *dst, size_t len, void *ctx)
+{
+    const std::vector<uint8_t> &src = *static_cast<const std::vector<uint8_t> *>(ctx);
+    if (offset > src.size() || len > src.size() - offset)
+    {
+        return false;
+    }
+    memcpy(dst, src.data() + offset, len);
+    return true;
+}
+
+// Patch and expected target built side by side from a list of edits.
+struct PatchBuilder
+{
+    const std::vector<uint8_t> &src;
+    std::vector<uint8_t> ops;
+    std::vector<uint8_t> target;
+
+    void copy(uint32_t off, uint32_t len)
+    {
+        ops.push_back(0x01);
+        putU32(ops, off);
+        putU32(ops, len);
+        target.insert(target.end(), src.begin() + off, src.begin() + off + len);
+    }
+    // Relocated block: every 4th byte (low byte of a pointer) moves by delta.
+    void add(uint32_t off, uint32_t len, uint8_t delta)
+    {
+        ops.push_back(0x02);
+        putU32(ops, off);
+        putU32(ops, len);
+        for (uint32_t i = 0; i < len; ++i)
+        {
+            const uint8_t d = (i % 4u == 0u) ? delta : 0u;
+            ops.push_back(d);
+            target.push_back((uint8_t)(src[off + i] + d));
+        }
+    }
+    void data(uint32_t len)
+    {
+        ops.push_back(0x03);
+        putU32(ops, len);
+        for (uint32_t i = 0; i < len; ++i)
+        {
+            const uint8_t b = (uint8_t)nextRandom();
+            ops.push_back(b);
+            target.push_back(b);
+        }
+    }
+    std::vector<uint8_t> finish()
+    {
+        std::vector<uint8_t> patch = {'W', 'T', 'D', '1'};
+        putU32(patch, (uint32_t)target.size());
+        putU32(patch, (uint32_t)src.size());
+        patch.resize(OTA_DELTA_HEADER_BYTES, 0u); // sha256 is checked by the caller, not the decoder
+        patch.insert(patch.end(), ops.begin(), ops.end());
+        patch.push_back(0x00);
+        return patch;
+    }
+};
+
+// A rebuild with a function added at 30 % and everything after it relocated.
+static std::vector<uint8_t> rebuildPatch(PatchBuilder &b)
+{
+    const uint32_t n = (uint32_t)b.src.size();
+    const uint32_t cut = n * 3u / 10u;
+    const uint32_t moved = n / 5u;
+    b.copy(0u, cut);
+    b.data(1500u);
+    b.add(cut, moved, 0x10u);
+    b.copy(cut + moved, n - cut - moved - 4096u);
+    b.data(8192u); // new rodata at the end
+    return b.finish();
+}
+
+static OtaDeltaResult apply(const std::vector<uint8_t> &patch, std::vector<uint8_t> &out, size_t maxIn, size_t maxOut)
+{
+    OtaDeltaHeader hdr;
+    TEST_ASSERT_TRUE(ota_delta_parseHeader(patch.data(), patch.size(), &hdr));
+    OtaDeltaDecoder dec;
+    ota_delta_begin(&dec, hdr);
+    out.clear();
+    std::vector<uint8_t> buf(maxOut);
+    size_t pos = OTA_DELTA_HEADER_BYTES;
+    size_t chunkEnd = pos;
+    for (;;)
+    {
+        if (pos == chunkEnd && chunkEnd < patch.size())
+        {
+            chunkEnd = pos + 1u + nextRandom() % maxIn;
+            chunkEnd = chunkEnd > patch.size() ? patch.size() : chunkEnd;
+        }
+        size_t used = 0;
+        size_t produced = 0;
+        const size_t cap = 1u + nextRandom() % maxOut;
+        const OtaDeltaResult r = ota_delta_step(&dec, patch.data() + pos, chunkEnd - pos, &used, buf.data(), cap,
+                                                &produced, readSource, &s_source);
+        pos += used;
+        out.insert(out.end(), buf.begin(), buf.begin() + produced);
+        if (r == OtaDeltaResult::DONE || r == OtaDeltaResult::ERROR)
+        {
+            return r;
+        }
+        if (r == OtaDeltaResult::NEED_INPUT && pos >= patch.size())
+        {
+            return r;
+        }
+    }
+}
+
+void setUp()
+{
+    s_lcg = 1u;
+}
+
+void tearDown() {}
+
+static void test_rebuild_patch_reproduces_target()
+{
+    PatchBuilder b{s_source, {}, {}};
+    const std::vector<uint8_t> patch = rebuildPatch(b);
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE(OtaDeltaResult::DONE == apply(patch, out, 1460u, 4096u));
+    TEST_ASSERT_TRUE(out == b.target);
+    printf("source %zu, target %zu, patch %zu bytes\n", s_source.size(), b.target.size(), patch.size());
+}
+
+static void test_byte_sized_chunks()
+{
+    PatchBuilder b{s_source, {}, {}};
+    b.copy(100u, 700u);
+    b.add(5000u, 300u, 0x04u);
+    b.data(50u);
+    const std::vector<uint8_t> patch = b.finish();
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE(OtaDeltaResult::DONE == apply(patch, out, 1u, 1u));
+    TEST_ASSERT_TRUE(out == b.target);
+}
+
+// Patches travel zlib-compressed; the ADD bodies are mostly zeros.
+static void test_compressed_patch_through_inflate()
+{
+    PatchBuilder b{s_source, {}, {}};
+    const std::vector<uint8_t> patch = rebuildPatch(b);
+
+    z_stream zs{};
+    TEST_ASSERT_EQUAL_INT(Z_OK, deflateInit2(&zs, 9, Z_DEFLATED, 13, 9, Z_DEFAULT_STRATEGY));
+    std::vector<uint8_t> blob(deflateBound(&zs, patch.size()));
+    zs.next_in = const_cast<Bytef *>(patch.data());
+    zs.avail_in = (uInt)patch.size();
+    zs.next_out = blob.data();
+    zs.avail_out = (uInt)blob.size();
+    TEST_ASSERT_EQUAL_INT(Z_STREAM_END, deflate(&zs, Z_FINISH));
+    blob.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    uint32_t window = 0;
+    TEST_ASSERT_TRUE(ota_inflate_isZlibHeader(blob.data(), blob.size(), &window));
+    TEST_ASSERT_TRUE(ota_inflate_begin(window));
+    std::vector<uint8_t> inflated(patch.size() + 16u);
+    size_t used = 0;
+    size_t produced = 0;
+    TEST_ASSERT_TRUE(OtaInflateResult::DONE == ota_inflate_step(blob.data(), blob.size(), &used, inflated.data(),
+                                                                inflated.size(), &produced));
+    inflated.resize(produced);
+    TEST_ASSERT_TRUE(inflated == patch);
+    printf("patch compressed %zu -> %zu bytes\n", patch.size(), blob.size());
+
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE(OtaDeltaResult::DONE == apply(inflated, out, 1460u, 4096u));
+    TEST_ASSERT_TRUE(out == b.target);
+}
+
+static void test_malformed_patches_fail()
+{
+    std::vector<uint8_t> out;
+
+    PatchBuilder range{s_source, {}, {}};
+    range.ops.push_back(0x01);
+    putU32(range.ops, (uint32_t)s_source.size() - 10u);
+    putU32(range.ops, 20u);
+    range.target.resize(20u);
+    TEST_ASSERT_TRUE(OtaDeltaResult::ERROR == apply(range.finish(), out, 64u, 64u));
+
+    PatchBuilder shortTarget{s_source, {}, {}};
+    shortTarget.copy(0u, 100u);
+    std::vector<uint8_t> patch = shortTarget.finish();
+    patch[4] = 200u; // header claims more than the ops produce
+    TEST_ASSERT_TRUE(OtaDeltaResult::ERROR == apply(patch, out, 64u, 64u));
+
+    PatchBuilder badOp{s_source, {}, {}};
+    badOp.copy(0u, 10u);
+    patch = badOp.finish();
+    patch.back() = 0x07u;
+    TEST_ASSERT_TRUE(OtaDeltaResult::ERROR == apply(patch, out, 64u, 64u));
+
+    patch[0] = 'X';
+    OtaDeltaHeader hdr;
+    TEST_ASSERT_FALSE(ota_delta_parseHeader(patch.data(), patch.size(), &hdr));
+    TEST_ASSERT_FALSE(ota_delta_parseHeader(patch.data(), OTA_DELTA_HEADER_BYTES - 1u, &hdr));
+}
+
+int main(int, char **argv)
+{
+    FILE *f = fopen(argv[0], "rb");
+    uint8_t buf[65536];
+    size_t n;
+    while (f && (n = fread(buf, 1, sizeof(buf), f)) > 0u)
+    {
+        s_source.insert(s_source.end(), buf, buf + n);
+    }
+    if (f)
+    {
+        fclose(f);
+    }
+
+    if (s_source.size() < 65536u)
+    {
+        s_source.resize(65536u, 0xA5u);
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_rebuild_patch_reproduces_target);
+    RUN_TEST(test_byte_sized_chunks);
+    RUN_TEST(test_compressed_patch_through_inflate);
+    RUN_TEST(test_malformed_patches_fail);
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <zlib.h>
+#include "ota_inflate.h"
+
+// Real builds compressed the way ota_compress.py does (level 9, memLevel 9,
+// window 2^13) and streamed back through ota_inflate in the uneven chunks an
+// HTTP body arrives in. The decoder underneath is test/host/rom/miniz.h, so
+// this covers the window bookkeeping and the step protocol, not the ROM tinfl.
+
+static constexpr int kWindowBits = 13;
+
+static const char *s_selfPath = nullptr;
+static uint32_t s_lcg = 1u;
+
+static uint32_t nextRandom()
+{
+    s_lcg = s_lcg * 1664525u + 1013904223u;
+    return s_lcg >> 8;
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0u)
+    {
+        out.insert(out.end(), buf, buf + n);
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+static std::vector<uint8_t> compress(const std::vector<uint8_t> &data, int windowBits)
+{
+    z_stream zs{};
+    TEST_ASSERT_EQUAL_INT(Z_OK, deflateInit2(&zs, 9, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY));
+    std::vector<uint8_t> out(deflateBound(&zs, data.size()));
+    zs.next_in = const_cast<Bytef *>(data.data());
+    zs.avail_in = (uInt)data.size();
+    zs.next_out = out.data();
+    zs.avail_out = (uInt)out.size();
+    TEST_ASSERT_EQUAL_INT(Z_STREAM_END, deflate(&zs, Z_FINISH));
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+// Feed blob in random input chunks up to maxIn and drain into random output
+// caps up to maxOut, the way otaTask interleaves HTTP reads and flash writes.
+static OtaInflateResult inflateChunked(const std::vector<uint8_t> &blob, std::vector<uint8_t> &out, size_t maxIn,
+                                       size_t maxOut)
+{
+    uint32_t window = 0;
+    TEST_ASSERT_TRUE(ota_inflate_isZlibHeader(blob.data(), blob.size(), &window));
+    TEST_ASSERT_TRUE(ota_inflate_begin(window));
+    out.clear();
+    std::vector<uint8_t> buf(maxOut);
+    size_t pos = 0;
+    size_t chunkEnd = 0;
+    for (;;)
+    {
+        if (pos == chunkEnd && chunkEnd < blob.size())
+        {
+            chunkEnd = pos + 1u + nextRandom() % maxIn;
+            if (chunkEnd > blob.size())
+            {
+                chunkEnd = blob.size();
+            }
+        }
+        size_t used = 0;
+        size_t produced = 0;
+        const size_t cap = 1u + nextRandom() % maxOut;
+        const OtaInflateResult r =
+            ota_inflate_step(blob.data() + pos, chunkEnd - pos, &used, buf.data(), cap, &produced);
+        pos += used;
+        out.insert(out.end(), buf.begin(), buf.begin() + produced);
+        if (r == OtaInflateResult::DONE || r == OtaInflateResult::ERROR)
+        {
+            return r;
+        }
+        if (r == OtaInflateResult::NEED_INPUT && pos >= blob.size())
+        {
+            return r; // truncated stream
+        }
+    }
+}
+
+static void roundTrip(const char *label, const std::vector<uint8_t> &image)
+{
+    const std::vector<uint8_t> blob = compress(image, kWindowBits);
+    std::vector<uint8_t> out;
+    const auto t0 = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(OtaInflateResult::DONE == inflateChunked(blob, out, 1460u, 4096u));
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)image.size(), (uint32_t)out.size());
+    TEST_ASSERT_TRUE(memcmp(image.data(), out.data(), image.size()) == 0);
+    printf("%s: %zu -> %zu bytes (%.1f %%), inflated at %.0f MB/s\n", label, image.size(), blob.size(),
+           100.0 * (double)blob.size() / (double)image.size(), (double)image.size() / s / 1e6);
+}
+
+void setUp()
+{
+    s_lcg = 1u;
+}
+
+void tearDown() {}
+
+static void test_round_trip_real_builds()
+{
+    std::vector<uint8_t> image;
+    TEST_ASSERT_TRUE_MESSAGE(readFile(s_selfPath, image), "cannot read the test binary");
+    roundTrip("native test build", image);
+
+    // Device image and whole-firmware host build, when built in this checkout.
+    static const char *const kImages[] = {".pio/build/arduino_nano_esp32/firmware.bin", ".pio/build/sim/program"};
+    for (const char *path : kImages)
+    {
+        if (readFile(path, image))
+        {
+            roundTrip(path, image);
+        }
+    }
+}
+
+static void test_tiny_chunks()
+{
+    std::vector<uint8_t> image;
+    TEST_ASSERT_TRUE(readFile(s_selfPath, image));
+    image.resize(image.size() < 200000u ? image.size() : 200000u);
+    const std::vector<uint8_t> blob = compress(image, kWindowBits);
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE(OtaInflateResult::DONE == inflateChunked(blob, out, 3u, 7u));
+    TEST_ASSERT_TRUE(out == image);
+}
+
+static void test_rejects_wider_window()
+{
+    std::vector<uint8_t> image(4096u, 0x5Au);
+    const std::vector<uint8_t> blob = compress(image, 15);
+    uint32_t window = 0;
+    TEST_ASSERT_TRUE(ota_inflate_isZlibHeader(blob.data(), blob.size(), &window));
+    TEST_ASSERT_EQUAL_UINT32(32768u, window);
+    TEST_ASSERT_FALSE(ota_inflate_begin(window));
+}
+
+static void test_corruption_is_reported()
+{
+    std::vector<uint8_t> image;
+    TEST_ASSERT_TRUE(readFile(s_selfPath, image));
+    image.resize(65536u);
+    std::vector<uint8_t> blob = compress(image, kWindowBits);
+    std::vector<uint8_t> out;
+
+    std::vector<uint8_t> badAdler = blob;
+    badAdler.back() ^= 0x01u;
+    TEST_ASSERT_TRUE(OtaInflateResult::ERROR == inflateChunked(badAdler, out, 1460u, 4096u));
+
+    std::vector<uint8_t> truncated(blob.begin(), blob.end() - 16);
+    TEST_ASSERT_TRUE(OtaInflateResult::NEED_INPUT == inflateChunked(truncated, out, 1460u, 4096u));
+}
+
+int main(int, char **argv)
+{
+    s_selfPath = argv[0];
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_real_builds);
+    RUN_TEST(test_tiny_chunks);
+    RUN_TEST(test_rejects_wider_window);
+    RUN_TEST(test_corruption_is_reported);
+    return UNITY_END();
+}
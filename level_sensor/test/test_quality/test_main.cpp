@@ -0,0 +1,303 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "quality.h"
+
+// Thresholds small enough to drive every reason with a handful of samples.
+static QualityConfig testConfig()
+{
+    QualityConfig qc{};
+    qc.disconnectedBelowRaw = 10;
+    qc.rawMin = 0;
+    qc.rawMax = 5000;
+    qc.rapidFluctuationDelta = 100;
+    qc.spikeDelta = 500;
+    qc.spikeCountThreshold = 3;
+    qc.spikeWindowMs = 1000;
+    qc.stuckDelta = 2;
+    qc.stuckMs = 1000;
+    qc.calRecommendMargin = 10;
+    qc.calRecommendCount = 2;
+    qc.calRecommendWindowMs = 1000;
+    qc.zeroHitCount = 2;
+    qc.zeroWindowMs = 1000;
+    return qc;
+}
+
+static AppliedConfig s_cfg;
+static QualityConfig s_qc;
+static QualityRuntime s_rt;
+
+void setUp()
+{
+    s_cfg = AppliedConfig{};
+    s_cfg.calDry = 200;
+    s_cfg.calWet = 800;
+    s_qc = testConfig();
+    quality_init(s_rt);
+}
+
+void tearDown() {}
+
+static ProbeQualityReason eval(uint32_t raw, uint32_t nowMs)
+{
+    return quality_evaluate(raw, s_cfg, s_qc, s_rt, nowMs).reason;
+}
+
+static void test_disconnected_resets_history()
+{
+    eval(500, 0);
+    const QualityResult r = quality_evaluate(5, s_cfg, s_qc, s_rt, 100);
+    TEST_ASSERT_FALSE(r.connected);
+    TEST_ASSERT_EQUAL(ProbeQualityReason::DISCONNECTED_LOW_RAW, r.reason);
+    TEST_ASSERT_FALSE(s_rt.hasLast);
+}
+
+static void test_out_of_bounds_keeps_last_raw()
+{
+    eval(500, 0);
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OUT_OF_BOUNDS, eval(6000, 100));
+    TEST_ASSERT_EQUAL_UINT32(500, s_rt.lastRaw);
+}
+
+static void test_spike_burst_within_window()
+{
+    s_cfg.calDry = 0; // the low side of the swing would also count as out of calibration
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(100, 0));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(700, 100));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(100, 200));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::UNRELIABLE_SPIKES, eval(700, 300));
+}
+
+static void test_spikes_spread_beyond_window_are_tolerated()
+{
+    s_cfg.calDry = 0;
+    eval(100, 0);
+    eval(700, 100);
+    eval(100, 1300); // window expired: count restarts
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(700, 1400));
+}
+
+static void test_rapid_fluctuation()
+{
+    eval(400, 0);
+    TEST_ASSERT_EQUAL(ProbeQualityReason::UNRELIABLE_RAPID, eval(550, 100));
+}
+
+static void test_stuck_after_stuck_ms()
+{
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(500, 0));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(501, 1000)); // starts the stuck run
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(500, 1500));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::UNRELIABLE_STUCK, eval(501, 2000));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(520, 2100)); // movement clears it
+}
+
+static void test_zero_hits()
+{
+    s_qc.disconnectedBelowRaw = 0; // otherwise 0 reads as disconnected
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(0, 0));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::ZERO_HITS, eval(0, 100));
+}
+
+static void test_calibration_recommended()
+{
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(150, 0));
+    TEST_ASSERT_EQUAL(ProbeQualityReason::CALIBRATION_RECOMMENDED, eval(160, 100));
+}
+
+static void test_no_calibration_never_recommends()
+{
+    s_cfg.calDry = 0;
+    s_cfg.calWet = 0;
+    eval(150, 0);
+    TEST_ASSERT_EQUAL(ProbeQualityReason::OK, eval(160, 100));
+}
+
+static void test_defaults_validate()
+{
+    QualityConfig qc;
+    quality_configDefaults(qc);
+    TEST_ASSERT_TRUE(quality_validateConfig(qc));
+    TEST_ASSERT_TRUE(quality_validateConfig(testConfig()));
+}
+
+static void test_validate_rejects_bad_sets()
+{
+    QualityConfig qc = testConfig();
+    qc.rawMin = qc.rawMax + 1u;
+    TEST_ASSERT_FALSE(quality_validateConfig(qc));
+
+    qc = testConfig();
+    qc.spikeCountThreshold = 0;
+    TEST_ASSERT_FALSE(quality_validateConfig(qc));
+
+    qc = testConfig();
+    qc.stuckMs = 86400001u;
+    TEST_ASSERT_FALSE(quality_validateConfig(qc));
+
+    qc = testConfig();
+    qc.calRecommendMargin = 0x80000000u;
+    TEST_ASSERT_FALSE(quality_validateConfig(qc));
+}
+
+// Random trace that hits every reason: disconnects, out-of-bounds, zeros,
+// spikes, rapid swings, stuck runs and calibration excursions. cleanOnly keeps
+// it to a slowly moving level with a few counts of noise.
+static void makeTrace(size_t count, bool cleanOnly, std::vector<uint32_t> &raw, std::vector<uint32_t> &t)
+{
+    raw.resize(count);
+    t.resize(count);
+    uint32_t rng = 0x2545F491u;
+    uint32_t now = 0;
+    uint32_t level = 500;
+    for (size_t i = 0; i < count; ++i)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        now += 50u + (rng % 400u);
+        t[i] = now;
+        if (cleanOnly)
+        {
+            raw[i] = 300u + (uint32_t)((i / 64u) % 400u) + (rng % 8u);
+            continue;
+        }
+        const uint32_t pick = (rng >> 8) % 100u;
+        if (pick < 3u)
+            raw[i] = rng % 3u; // disconnected, or zero hits without a floor
+        else if (pick < 5u)
+            raw[i] = 6000u; // out of bounds
+        else if (pick < 10u)
+            raw[i] = level + 600u; // spike
+        else if (pick < 15u)
+            raw[i] = level + 150u; // rapid
+        else if (pick < 20u)
+            raw[i] = 50u + (rng % 100u); // below calibration
+        else if (pick < 60u)
+            raw[i] = level; // stuck run
+        else
+            raw[i] = level = 150u + (rng % 800u);
+    }
+}
+
+static void assertSameRuntime(const QualityRuntime &a, const QualityRuntime &b)
+{
+    TEST_ASSERT_EQUAL(a.hasLast, b.hasLast);
+    TEST_ASSERT_EQUAL_UINT32(a.lastRaw, b.lastRaw);
+    TEST_ASSERT_EQUAL_UINT8(a.spikeCount, b.spikeCount);
+    TEST_ASSERT_EQUAL_UINT32(a.spikeWindowStart, b.spikeWindowStart);
+    TEST_ASSERT_EQUAL_UINT32(a.stuckStartMs, b.stuckStartMs);
+    TEST_ASSERT_EQUAL_UINT8(a.calBelowCount, b.calBelowCount);
+    TEST_ASSERT_EQUAL_UINT8(a.calAboveCount, b.calAboveCount);
+    TEST_ASSERT_EQUAL_UINT32(a.calWindowStart, b.calWindowStart);
+    TEST_ASSERT_EQUAL_UINT8(a.zeroCount, b.zeroCount);
+    TEST_ASSERT_EQUAL_UINT32(a.zeroWindowStart, b.zeroWindowStart);
+}
+
+// The batch path against the scalar one, sample for sample, with the trace cut
+// into uneven batches so the runtime has to carry over between calls. Returns
+// the reasons the trace produced.
+static uint32_t checkBatchAgainstScalar()
+{
+    std::vector<uint32_t> raw;
+    std::vector<uint32_t> t;
+    makeTrace(4099u, false, raw, t);
+    std::vector<QualityResult> batch(raw.size());
+    QualityRuntime scalarRt;
+    QualityRuntime batchRt;
+    quality_init(scalarRt);
+    quality_init(batchRt);
+    static const size_t kCuts[] = {1u, 63u, 64u, 65u, 1000u, 7u};
+    size_t done = 0;
+    for (size_t c = 0; done < raw.size(); ++c)
+    {
+        const size_t want = kCuts[c % (sizeof(kCuts) / sizeof(kCuts[0]))];
+        const size_t n = (raw.size() - done < want) ? (raw.size() - done) : want;
+        quality_evaluateBatch(&raw[done], &t[done], n, s_cfg, s_qc, batchRt, &batch[done]);
+        done += n;
+    }
+
+    uint32_t seen = 0;
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+        const QualityResult ref = quality_evaluate(raw[i], s_cfg, s_qc, scalarRt, t[i]);
+        TEST_ASSERT_EQUAL_MESSAGE(ref.connected, batch[i].connected, "connected");
+        TEST_ASSERT_EQUAL_MESSAGE(ref.reason, batch[i].reason, "reason");
+        seen |= 1u << (uint32_t)ref.reason;
+    }
+    assertSameRuntime(scalarRt, batchRt);
+    return seen;
+}
+
+static void test_batch_matches_scalar()
+{
+    uint32_t seen = checkBatchAgainstScalar();
+    s_qc.disconnectedBelowRaw = 0; // lets the low samples through as zero hits
+    seen |= checkBatchAgainstScalar();
+    // The trace is only a useful reference if it exercises the reasons.
+    TEST_ASSERT_TRUE((seen & (1u << (uint32_t)ProbeQualityReason::DISCONNECTED_LOW_RAW)) != 0u);
+    TEST_ASSERT_TRUE((seen & (1u << (uint32_t)ProbeQualityReason::ZERO_HITS)) != 0u);
+    TEST_ASSERT_TRUE((seen & (1u << (uint32_t)ProbeQualityReason::UNRELIABLE_SPIKES)) != 0u);
+    TEST_ASSERT_TRUE((seen & (1u << (uint32_t)ProbeQualityReason::UNRELIABLE_RAPID)) != 0u);
+    TEST_ASSERT_TRUE((seen & (1u << (uint32_t)ProbeQualityReason::UNRELIABLE_STUCK)) != 0u);
+    TEST_ASSERT_TRUE((seen & (1u << (uint32_t)ProbeQualityReason::CALIBRATION_RECOMMENDED)) != 0u);
+    TEST_ASSERT_TRUE((seen & (1u << (uint32_t)ProbeQualityReason::OUT_OF_BOUNDS)) != 0u);
+}
+
+static volatile uint32_t s_sink;
+
+// Host timing over a large trace, scalar calls vs one batch call, per sample.
+static void test_batch_benchmark()
+{
+    constexpr size_t kSamples = 1u << 21;
+    std::vector<uint32_t> raw;
+    std::vector<uint32_t> t;
+    std::vector<QualityResult> out(kSamples);
+    for (int clean = 1; clean >= 0; --clean)
+    {
+        makeTrace(kSamples, clean != 0, raw, t);
+        QualityRuntime rt;
+        quality_init(rt);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kSamples; ++i)
+        {
+            out[i] = quality_evaluate(raw[i], s_cfg, s_qc, rt, t[i]);
+        }
+        const double scalarNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - t0)
+                                    .count();
+        s_sink = (uint32_t)out[kSamples - 1u].reason;
+
+        quality_init(rt);
+        t0 = std::chrono::steady_clock::now();
+        quality_evaluateBatch(raw.data(), t.data(), kSamples, s_cfg, s_qc, rt, out.data());
+        const double batchNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - t0)
+                                   .count();
+        s_sink = (uint32_t)out[kSamples - 1u].reason;
+        printf("%-12s %u samples: scalar %.1f ns, batch %.1f ns per sample\n",
+               clean ? "clean trace" : "faulty trace", (unsigned)kSamples,
+               scalarNs / kSamples, batchNs / kSamples);
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_disconnected_resets_history);
+    RUN_TEST(test_out_of_bounds_keeps_last_raw);
+    RUN_TEST(test_spike_burst_within_window);
+    RUN_TEST(test_spikes_spread_beyond_window_are_tolerated);
+    RUN_TEST(test_rapid_fluctuation);
+    RUN_TEST(test_stuck_after_stuck_ms);
+    RUN_TEST(test_zero_hits);
+    RUN_TEST(test_calibration_recommended);
+    RUN_TEST(test_no_calibration_never_recommends);
+    RUN_TEST(test_defaults_validate);
+    RUN_TEST(test_validate_rejects_bad_sets);
+    RUN_TEST(test_batch_matches_scalar);
+    RUN_TEST(test_batch_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,153 @@
+#include <unity.h>
+#include <stdio.h>
+#include "quality.h"
+#include "sim_scenario.h"
+
+// The simulation scenarios exist to exercise the quality tier without a
+// faulty probe at hand, so each built-in one is played through
+// quality_evaluate() with the stock thresholds and must raise the verdict it is
+// named for. Also: a seed reproduces its trace exactly.
+
+static constexpr uint32_t kSampleMs = 500u; // SENSOR period of the sim build
+static constexpr uint32_t kRunMs = 600000u;
+static constexpr SimRange kRange = {80000, 140000, 20000};
+static constexpr uint8_t kReasonCount = (uint8_t)ProbeQualityReason::UNKNOWN + 1u;
+
+struct Tally
+{
+    uint32_t samples;
+    uint32_t byReason[kReasonCount];
+};
+
+// The quality_config.h defaults, pinned: include/config.h switches the spike
+// and rapid checks off for the deployed probe.
+static QualityConfig stockThresholds()
+{
+    QualityConfig qc;
+    quality_configDefaults(qc);
+    qc.disconnectedBelowRaw = 30000u;
+    qc.spikeDelta = 10000u;
+    qc.rapidFluctuationDelta = 5000u;
+    qc.rawMax = 1000000u;
+    return qc;
+}
+
+static Tally play(const SimScenario &scenario, uint32_t seed)
+{
+    AppliedConfig cfg{};
+    cfg.calDry = (uint32_t)kRange.dry;
+    cfg.calWet = (uint32_t)kRange.wet;
+    cfg.quality = stockThresholds();
+    QualityRuntime rt;
+    quality_init(rt);
+    SimEngine engine;
+    sim_engineStart(engine, scenario, seed, 0u, (kRange.dry + kRange.wet) / 2, kRange);
+    Tally t{};
+    for (uint32_t now = 0; now < kRunMs; now += kSampleMs)
+    {
+        const int32_t raw = sim_engineSample(engine, now, kRange);
+        const QualityResult r = quality_evaluate((uint32_t)raw, cfg, cfg.quality, rt, now);
+        t.byReason[(uint8_t)r.reason]++;
+        t.samples++;
+    }
+    return t;
+}
+
+static float share(const Tally &t, ProbeQualityReason reason)
+{
+    return (float)t.byReason[(uint8_t)reason] / (float)t.samples;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_builtin_scenarios_raise_their_verdict()
+{
+    struct Expect
+    {
+        const char *name;
+        ProbeQualityReason reason;
+        float minShare;
+    };
+    // Share of samples that must carry the scenario's verdict over ten minutes.
+    // range_shift moves the baseline slowly for the drift compensator; the
+    // threshold tier has to leave it alone.
+    const Expect expect[] = {{"disconnected", ProbeQualityReason::DISCONNECTED_LOW_RAW, 0.15f},
+                             {"fill", ProbeQualityReason::OK, 0.95f},
+                             {"drain", ProbeQualityReason::OK, 0.95f},
+                             {"spikes", ProbeQualityReason::UNRELIABLE_SPIKES, 0.08f},
+                             {"rapid_fluctuation", ProbeQualityReason::UNRELIABLE_RAPID, 0.15f},
+                             {"stuck", ProbeQualityReason::UNRELIABLE_STUCK, 0.05f},
+                             {"range_shift", ProbeQualityReason::OK, 0.95f}};
+    TEST_ASSERT_EQUAL_UINT8(sizeof(expect) / sizeof(expect[0]), sim_builtinCount());
+
+    printf("%-18s %6s %6s %6s %6s %6s %6s %6s %6s\n", "scenario", "ok", "disc", "spikes", "rapid", "stuck", "bounds",
+           "cal", "zero");
+    for (uint8_t mode = 0; mode < sim_builtinCount(); ++mode)
+    {
+        const SimScenario *s = sim_builtinScenario(mode);
+        TEST_ASSERT_NOT_NULL(s);
+        TEST_ASSERT_EQUAL_STRING(expect[mode].name, s->name);
+        const Tally t = play(*s, CFG_SIM_DEFAULT_SEED);
+        printf("%-18s", s->name);
+        for (uint8_t r = 0; r <= (uint8_t)ProbeQualityReason::ZERO_HITS; ++r)
+        {
+            printf(" %5.1f%%", (double)(100.0f * share(t, (ProbeQualityReason)r)));
+        }
+        printf("\n");
+        TEST_ASSERT_TRUE(share(t, expect[mode].reason) >= expect[mode].minShare);
+    }
+    TEST_ASSERT_NULL(sim_builtinScenario(sim_builtinCount()));
+}
+
+static void test_seed_reproduces_trace()
+{
+    const SimScenario *s = sim_builtinScenario(3); // spikes: noise, jitter and direction all use the PRNG
+    SimEngine a;
+    SimEngine b;
+    SimEngine c;
+    sim_engineStart(a, *s, 42u, 1000u, 100000, kRange);
+    sim_engineStart(b, *s, 42u, 1000u, 100000, kRange);
+    sim_engineStart(c, *s, 43u, 1000u, 100000, kRange);
+    uint32_t differ = 0;
+    for (uint32_t now = 1000u; now < 1000u + kRunMs; now += kSampleMs)
+    {
+        const int32_t ra = sim_engineSample(a, now, kRange);
+        TEST_ASSERT_EQUAL_INT32(ra, sim_engineSample(b, now, kRange));
+        differ += (ra != sim_engineSample(c, now, kRange)) ? 1u : 0u;
+    }
+    TEST_ASSERT_TRUE(differ > 0u);
+}
+
+static void test_layer_names_round_trip()
+{
+    for (uint8_t i = 0; i < (uint8_t)SimLayerType::COUNT; ++i)
+    {
+        SimLayerType t = SimLayerType::COUNT;
+        TEST_ASSERT_TRUE(sim_layerTypeFromString(sim_layerTypeName((SimLayerType)i), t));
+        TEST_ASSERT_EQUAL_UINT8(i, (uint8_t)t);
+    }
+    SimLayerType t = SimLayerType::HOLD;
+    TEST_ASSERT_FALSE(sim_layerTypeFromString("sawtooth", t));
+    TEST_ASSERT_FALSE(sim_layerTypeFromString(nullptr, t));
+    TEST_ASSERT_EQUAL_STRING("unknown", sim_layerTypeName(SimLayerType::COUNT));
+}
+
+static void test_out_of_range_start_uses_dry()
+{
+    const SimScenario hold = {"hold", 1, {{SimLayerType::HOLD, 0u, 0u, 0.0f, 0.0f}}};
+    SimEngine e;
+    sim_engineStart(e, hold, 1u, 0u, kRange.wet + 5000, kRange);
+    TEST_ASSERT_EQUAL_INT32(kRange.dry, sim_engineSample(e, 1000u, kRange));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_builtin_scenarios_raise_their_verdict);
+    RUN_TEST(test_seed_reproduces_trace);
+    RUN_TEST(test_layer_names_round_trip);
+    RUN_TEST(test_out_of_range_start_uses_dry);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "scheduler.h"
+
+// The scheduler on a fake clock. Task bodies advance the clock by their
+// execution time; the loop idles for whatever sched_runOnce() returns, capped
+// at CFG_SCHED_MAX_IDLE_MS like appLoop().
+
+static uint64_t s_nowUs = 0;
+static bool s_otaBusy = false;
+
+static uint32_t fakeNowMs()
+{
+    return (uint32_t)(s_nowUs / 1000u);
+}
+
+static uint32_t fakeNowUs()
+{
+    return (uint32_t)s_nowUs;
+}
+
+static bool fakeOtaBusy()
+{
+    return s_otaBusy;
+}
+
+// Execution times of the firmware's loop tasks (g_tasks in main.cpp): SENSOR
+// averages 8 touch reads 5 ms apart, MQTT occasionally serializes and sends
+// the state document.
+static uint32_t s_mqttRuns = 0;
+static void runFast() { s_nowUs += 200u; }
+static void runSensor() { s_nowUs += 40000u; }
+static void runCompute() { s_nowUs += 1500u; }
+static void runMqtt() { s_nowUs += ((++s_mqttRuns % 20u) == 0u) ? 30000u : 2000u; }
+static void runStateMeta() { s_nowUs += 500u; }
+static void runBoot() { s_nowUs += 100u; }
+static void runNothing() {}
+
+static constexpr uint32_t kPollMs = 50u;
+
+// Same periods, deadlines, priorities and policies as g_tasks in main.cpp.
+static SchedTask s_firmware[] = {
+    {"FAST", kPollMs, kPollMs, 0, SchedPolicy::ALWAYS, runFast, 0u, 0u, {}},
+    {"SENSOR", 1000u, 1000u, 1, SchedPolicy::SKIP_DURING_OTA, runSensor, 0u, 0u, {}},
+    {"COMPUTE", 3000u, 3000u, 2, SchedPolicy::SKIP_DURING_OTA, runCompute, 0u, 0u, {}},
+    {"MQTT", kPollMs, 250u, 3, SchedPolicy::SKIP_DURING_OTA, runMqtt, 0u, 0u, {}},
+    {"STATE_META", 1000u, 1000u, 4, SchedPolicy::SKIP_DURING_OTA, runStateMeta, 0u, 0u, {}},
+    {"BOOT", kPollMs, 0u, 5, SchedPolicy::ALWAYS, runBoot, 0u, 0u, {}}};
+static constexpr size_t kFirmwareTasks = sizeof(s_firmware) / sizeof(s_firmware[0]);
+
+static std::vector<uint32_t> s_late[kFirmwareTasks];
+
+static void recordLateness(const SchedTask &task, uint32_t)
+{
+    s_late[&task - s_firmware].push_back(task.stats.lastLateMs);
+}
+
+static const SchedHooks kHooks{fakeNowMs, fakeNowUs, fakeOtaBusy, nullptr, nullptr};
+static const SchedHooks kFirmwareHooks{fakeNowMs, fakeNowUs, fakeOtaBusy, nullptr, recordLateness};
+
+static void runFor(uint32_t ms)
+{
+    const uint64_t endUs = s_nowUs + (uint64_t)ms * 1000u;
+    while (s_nowUs < endUs)
+    {
+        const uint32_t idleMs = sched_runOnce();
+        s_nowUs += (uint64_t)((idleMs < CFG_SCHED_MAX_IDLE_MS) ? idleMs : CFG_SCHED_MAX_IDLE_MS) * 1000u;
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t> v, uint32_t pct)
+{
+    if (v.empty())
+    {
+        return 0u;
+    }
+    std::sort(v.begin(), v.end());
+    return v[(v.size() - 1u) * pct / 100u];
+}
+
+void setUp()
+{
+    s_nowUs = 0u;
+    s_otaBusy = false;
+    s_mqttRuns = 0u;
+    for (auto &v : s_late)
+    {
+        v.clear();
+    }
+}
+
+void tearDown() {}
+
+static void test_begin_rejects_more_tasks_than_slots()
+{
+    static SchedTask many[CFG_SCHED_MAX_TASKS + 1];
+    for (auto &t : many)
+    {
+        t = SchedTask{"t", 10u, 0u, 0, SchedPolicy::ALWAYS, runNothing, 0u, 0u, {}};
+    }
+    TEST_ASSERT_FALSE(sched_begin(many, CFG_SCHED_MAX_TASKS + 1, kHooks));
+    const SchedTask *tasks = nullptr;
+    TEST_ASSERT_EQUAL_UINT32(0u, sched_tasks(tasks));
+    TEST_ASSERT_EQUAL_UINT32(0u, sched_runOnce());
+    TEST_ASSERT_TRUE(sched_begin(many, CFG_SCHED_MAX_TASKS, kHooks));
+}
+
+static void test_begin_rejects_zero_period()
+{
+    SchedTask tasks[] = {{"ok", 10u, 0u, 0, SchedPolicy::ALWAYS, runNothing, 0u, 0u, {}},
+                         {"zero", 0u, 0u, 1, SchedPolicy::ALWAYS, runNothing, 0u, 0u, {}}};
+    TEST_ASSERT_FALSE(sched_begin(tasks, 2, kHooks));
+    TEST_ASSERT_TRUE(sched_begin(tasks, 1, kHooks));
+    TEST_ASSERT_FALSE(sched_setPeriod(tasks[0], 0u));
+    TEST_ASSERT_EQUAL_UINT32(10u, tasks[0].periodMs);
+}
+
+static void test_ota_pause_rebases_instead_of_counting_late()
+{
+    SchedTask tasks[] = {{"fast", 50u, 0u, 0, SchedPolicy::ALWAYS, runNothing, 0u, 0u, {}},
+                         {"sensor", 1000u, 0u, 1, SchedPolicy::SKIP_DURING_OTA, runNothing, 0u, 0u, {}}};
+    TEST_ASSERT_TRUE(sched_begin(tasks, 2, kHooks));
+    runFor(5000u);
+    const uint32_t runsBefore = tasks[1].stats.runs;
+
+    s_otaBusy = true;
+    runFor(30000u);
+    TEST_ASSERT_EQUAL_UINT32(runsBefore, tasks[1].stats.runs);
+
+    s_otaBusy = false;
+    sched_runOnce();
+    TEST_ASSERT_EQUAL_UINT32(runsBefore + 1u, tasks[1].stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(0u, tasks[1].stats.lastLateMs);
+    TEST_ASSERT_EQUAL_UINT32(0u, tasks[1].stats.overruns);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(29u, tasks[1].stats.skippedReleases);
+    // Back on a grid anchored at the end of the job.
+    TEST_ASSERT_EQUAL_UINT32(fakeNowMs() + 1000u, tasks[1].nextDueMs);
+}
+
+static void test_firmware_table_lateness()
+{
+    TEST_ASSERT_TRUE(sched_begin(s_firmware, kFirmwareTasks, kFirmwareHooks));
+    runFor(10u * 60000u);
+
+    printf("%-12s %7s %7s %7s %7s %8s\n", "task", "runs", "p50_ms", "p99_ms", "max_ms", "overruns");
+    for (size_t i = 0; i < kFirmwareTasks; ++i)
+    {
+        const SchedTask &t = s_firmware[i];
+        printf("%-12s %7lu %7lu %7lu %7lu %8lu\n", t.name, (unsigned long)t.stats.runs,
+               (unsigned long)percentile(s_late[i], 50u), (unsigned long)percentile(s_late[i], 99u),
+               (unsigned long)t.stats.maxLateMs, (unsigned long)t.stats.overruns);
+        TEST_ASSERT_EQUAL_UINT32(0u, t.stats.overruns);
+        TEST_ASSERT_EQUAL_UINT32(0u, t.stats.skippedReleases);
+    }
+    // FAST is first in every pass, so it only waits for a pass already running:
+    // at worst a SENSOR read plus a state publish.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(1u, percentile(s_late[0], 50u));
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(40u + 30u, percentile(s_late[0], 99u));
+    // Periodic tasks keep their rate: 10 min of 1 s releases.
+    TEST_ASSERT_UINT32_WITHIN(1u, 600u, s_firmware[1].stats.runs);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_rejects_more_tasks_than_slots);
+    RUN_TEST(test_begin_rejects_zero_period);
+    RUN_TEST(test_ota_pause_rebases_instead_of_counting_late);
+    RUN_TEST(test_firmware_table_lateness);
+    return UNITY_END();
+}
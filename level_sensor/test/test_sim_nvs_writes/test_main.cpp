@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <esp_system.h>
+#include "main.h"
+#include "sim_hal.h"
+#include "sim_scenario.h"
+
+// Flash writes per hour for the whole firmware (pio test -e sim). One boot
+// runs through a sequence of one-hour phases; after each the in-memory NVS
+// is asked how many puts actually changed a stored value, per key. The
+// bounds are what the coalescing layer is meant to guarantee: one record or
+// side-blob write per settled burst, nothing while idle except the periodic
+// drift and wear persists.
+
+namespace
+{
+constexpr char kCmdTopic[] = "water_tank/water_tank_esp32/cmd";
+constexpr uint32_t kHourMs = 3600000u;
+constexpr SimRange kRange = {80000, 140000, 20000};
+const SimScenario kSteady = {"steady", 2, {{SimLayerType::HOLD, 0u, 0u, 0.0f, 0.0f},
+                                           {SimLayerType::NOISE, 0u, 0u, 40.0f, 0.0f}}};
+
+SimEngine s_engine;
+std::map<std::string, uint32_t> s_lastWrites;
+bool s_booted = false;
+
+int32_t probeSample(uint32_t nowMs)
+{
+    return sim_engineSample(s_engine, nowMs, kRange);
+}
+
+void runUntil(uint64_t endMs)
+{
+    while (simhal_nowUs() / 1000u < endMs)
+    {
+        appLoop();
+    }
+}
+
+void inject(uint32_t atMs, const char *type, const char *data)
+{
+    char cmd[384];
+    snprintf(cmd, sizeof(cmd), "{\"schema\":1,\"request_id\":\"t-%s-%lu\",\"type\":\"%s\",\"data\":%s}", type,
+             (unsigned long)atMs, type, data);
+    simhal_inject(atMs, kCmdTopic, cmd);
+}
+
+struct PhaseCtx
+{
+    uint32_t total;
+};
+
+void collect(const char *nsKey, const SimNvsStats &st, void *ctx)
+{
+    uint32_t &last = s_lastWrites[nsKey];
+    const uint32_t delta = st.writes - last;
+    last = st.writes;
+    if (delta != 0u)
+    {
+        printf("    %-28s %4lu\n", nsKey, (unsigned long)delta);
+    }
+    static_cast<PhaseCtx *>(ctx)->total += delta;
+}
+
+// Run one hour from now and return the flash writes it caused.
+uint32_t phase(const char *name)
+{
+    const uint64_t endMs = simhal_nowUs() / 1000u + kHourMs;
+    runUntil(endMs);
+    printf("  phase %-16s writes/hour:\n", name);
+    PhaseCtx ctx{0u};
+    simhal_forEachNvsKey(collect, &ctx);
+    printf("    %-28s %4lu\n", "total", (unsigned long)ctx.total);
+    return ctx.total;
+}
+
+uint32_t nowMs()
+{
+    return (uint32_t)(simhal_nowUs() / 1000u);
+}
+} // namespace
+
+void setUp()
+{
+    if (s_booted)
+    {
+        return;
+    }
+    simhal_begin(SimHalConfig{0.0, false, (uint32_t)ESP_RST_POWERON});
+    sim_engineStart(s_engine, kSteady, CFG_SIM_DEFAULT_SEED, 0u, 110000, kRange);
+    simhal_setProbe(probeSample);
+    appSetup();
+    s_booted = true;
+}
+
+void tearDown() {}
+
+// First boot: schema, record, boot/crash accounting and a calibration.
+static void test_boot_hour()
+{
+    inject(20000u, "set_calibration", "{\"cal_dry_set\":80000,\"cal_wet_set\":140000}");
+    const uint32_t writes = phase("boot+calibrate");
+    // schema + record (defaults, then the calibration) + first drift persist.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(6u, writes);
+}
+
+static void test_idle_hour()
+{
+    const uint32_t writes = phase("idle");
+    // At most a drift persist; nothing else changes while the level holds.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(2u, writes);
+}
+
+// One HA form submit: several fields in three commands within a second.
+static void test_config_burst_hour()
+{
+    const uint32_t t = nowMs();
+    inject(t + 100u, "set_config", "{\"tank_volume_l\":950,\"rod_length_cm\":120,\"tank_shape\":\"rectangular\"}");
+    inject(t + 300u, "set_quality", "{\"stuck_ms\":600000,\"spike_count\":4}");
+    inject(t + 500u, "set_anomaly", "{\"enabled\":true,\"window\":128}");
+    const uint32_t writes = phase("config burst");
+    // One write per blob touched: record, tank_geom, quality, anomaly.
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(4u + 2u, writes);
+}
+
+static void test_broker_outage_hour()
+{
+    simhal_setBrokerUp(false);
+    const uint32_t writes = phase("broker outage");
+    simhal_setBrokerUp(true);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(2u, writes);
+}
+
+// Re-taking dry/wet every five minutes: each pair lands as one record write.
+static void test_recalibration_hour()
+{
+    const uint32_t t = nowMs();
+    for (uint32_t i = 0; i < 12u; ++i)
+    {
+        char data[96];
+        snprintf(data, sizeof(data), "{\"cal_dry_set\":%lu,\"cal_wet_set\":%lu}", (unsigned long)(80000u + i * 10u),
+                 (unsigned long)(140000u - i * 10u));
+        inject(t + 1000u + i * 300000u, "set_calibration", data);
+    }
+    const uint32_t writes = phase("recalibration");
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(12u + 2u, writes);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_hour);
+    RUN_TEST(test_idle_hour);
+    RUN_TEST(test_config_burst_hour);
+    RUN_TEST(test_broker_outage_hour);
+    RUN_TEST(test_recalibration_hour);
+    return UNITY_END();
+}
@@ -0,0 +1,217 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "level_fixed.h"
+#include "tank_geometry.h"
+
+// Volume from height for each tank shape, through the same path the firmware
+// uses: tank_buildVolumeLut() at config time, then level_derive() per sample.
+// Modelled shapes are checked against their closed-form volume; the error left
+// is the linear interpolation between lookup table entries.
+
+static constexpr float kVolumeL = 2000.0f;
+static constexpr float kRodCm = 150.0f;
+
+static AppliedConfig makeConfig(const TankGeometry &geom)
+{
+    AppliedConfig cfg{};
+    cfg.tankVolumeLiters = kVolumeL;
+    cfg.rodLengthCm = kRodCm;
+    cfg.tankGeometry = geom;
+    cfg.calDry = 80000u;
+    cfg.calWet = 140000u;
+    cal_curveClear(cfg.calCurve);
+    return cfg;
+}
+
+static float litersAt(const LevelCalib &calib, float percent)
+{
+    LevelFilter filter;
+    level_filterInit(filter, 1.0f);
+    level_filterUpdate(filter, true, (int32_t)lroundf(percent * (float)LEVEL_Q16_ONE));
+    const LevelFixed lv = level_derive(calib, filter);
+    TEST_ASSERT_TRUE((lv.valid & LEVEL_VALID_LITERS) != 0u);
+    return level_centiToFloat(lv.litersCenti);
+}
+
+static double horizontalLiters(double h)
+{
+    const double theta = 2.0 * acos(1.0 - 2.0 * h);
+    return (double)kVolumeL * (theta - sin(theta)) / (2.0 * M_PI);
+}
+
+// Worst |derived - exact| in liters over a fine height sweep.
+static float worstError(const LevelCalib &calib, double (*exact)(double))
+{
+    float worst = 0.0f;
+    for (int i = 0; i <= 10000; ++i)
+    {
+        const float pct = (float)i / 100.0f;
+        worst = fmaxf(worst, fabsf(litersAt(calib, pct) - (float)exact((double)pct / 100.0)));
+    }
+    return worst;
+}
+
+static constexpr float kConeCm = 30.0f;
+
+static double coneLiters(double h)
+{
+    const double k = (double)kConeCm / (double)kRodCm;
+    const double total = k / 3.0 + (1.0 - k);
+    const double v = (h <= k) ? (k / 3.0) * pow(h / k, 3.0) : k / 3.0 + (h - k);
+    return (double)kVolumeL * v / total;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_linear_shapes_skip_the_table()
+{
+    TankGeometry geom;
+    tank_geometryDefaults(geom);
+    TEST_ASSERT_TRUE(tank_isLinear(geom));
+    LevelCalib calib;
+    level_prepare(calib, makeConfig(geom), CFG_CAL_MIN_DIFF);
+    TEST_ASSERT_FALSE(calib.volumeLutActive);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, kVolumeL * 0.37f, litersAt(calib, 37.0f));
+
+    geom.shape = TankShape::RECTANGULAR;
+    TEST_ASSERT_TRUE(tank_isLinear(geom));
+}
+
+static void test_horizontal_cylinder_matches_closed_form()
+{
+    TankGeometry geom;
+    tank_geometryDefaults(geom);
+    geom.shape = TankShape::HORIZONTAL_CYLINDER;
+    LevelCalib calib;
+    level_prepare(calib, makeConfig(geom), CFG_CAL_MIN_DIFF);
+    TEST_ASSERT_TRUE(calib.volumeLutActive);
+    const float worst = worstError(calib, horizontalLiters);
+    printf("horizontal cylinder: worst %.3f L (%.4f %% of volume) with %u table points\n", (double)worst,
+           (double)(100.0f * worst / kVolumeL), (unsigned)CFG_TANK_LUT_POINTS);
+    // Chord error is largest at the ends, where the curve is steepest.
+    TEST_ASSERT_TRUE(worst < 0.001f * kVolumeL);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, kVolumeL / 2.0f, litersAt(calib, 50.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, kVolumeL, litersAt(calib, 100.0f));
+}
+
+static void test_cone_bottom_matches_closed_form()
+{
+    TankGeometry geom;
+    tank_geometryDefaults(geom);
+    geom.shape = TankShape::CONE_BOTTOM;
+    geom.coneHeightCm = kConeCm;
+    LevelCalib calib;
+    level_prepare(calib, makeConfig(geom), CFG_CAL_MIN_DIFF);
+    TEST_ASSERT_TRUE(calib.volumeLutActive);
+    const float worst = worstError(calib, coneLiters);
+    printf("cone bottom: worst %.3f L (%.4f %% of volume)\n", (double)worst, (double)(100.0f * worst / kVolumeL));
+    TEST_ASSERT_TRUE(worst < 0.001f * kVolumeL);
+
+    // A cone as tall as the rod leaves no cylinder above it.
+    geom.coneHeightCm = kRodCm;
+    uint32_t lut[CFG_TANK_LUT_POINTS];
+    TEST_ASSERT_FALSE(tank_buildVolumeLut(geom, kVolumeL, kRodCm, lut, CFG_TANK_LUT_POINTS));
+}
+
+static void test_strapping_table()
+{
+    TankGeometry geom;
+    tank_geometryDefaults(geom);
+    geom.shape = TankShape::STRAPPING;
+    const TankStrapPoint pts[] = {{15.0f, 60.0f}, {75.0f, 900.0f}, {120.0f, 1500.0f}};
+    geom.strapCount = 3u;
+    for (uint8_t i = 0; i < geom.strapCount; ++i)
+    {
+        geom.strap[i] = pts[i];
+    }
+    TEST_ASSERT_TRUE(tank_validateGeometry(geom));
+    AppliedConfig cfg = makeConfig(geom);
+    cfg.tankVolumeLiters = NAN; // a strapping table carries its own liters
+    LevelCalib calib;
+    level_prepare(calib, cfg, CFG_CAL_MIN_DIFF);
+    TEST_ASSERT_TRUE(calib.volumeLutActive);
+
+    // A strap point between two table entries is cut off by at most one table
+    // spacing times the steepest slope (14 L/cm).
+    const float step = 14.0f * kRodCm / (float)(CFG_TANK_LUT_POINTS - 1u);
+    TEST_ASSERT_FLOAT_WITHIN(step, 60.0f, litersAt(calib, 100.0f * 15.0f / kRodCm));
+    TEST_ASSERT_FLOAT_WITHIN(step, 900.0f, litersAt(calib, 50.0f));
+    TEST_ASSERT_FLOAT_WITHIN(step, 480.0f, litersAt(calib, 100.0f * 45.0f / kRodCm));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1500.0f, litersAt(calib, 100.0f)); // clamped past the last point
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, litersAt(calib, 0.0f));
+}
+
+static void test_invalid_geometry_is_rejected()
+{
+    TankGeometry geom;
+    tank_geometryDefaults(geom);
+    geom.shape = TankShape::STRAPPING;
+    geom.strapCount = 1u;
+    geom.strap[0] = TankStrapPoint{10.0f, 10.0f};
+    TEST_ASSERT_FALSE(tank_validateGeometry(geom)); // too few points
+
+    geom.strapCount = 2u;
+    geom.strap[1] = TankStrapPoint{10.0f, 20.0f};
+    TEST_ASSERT_FALSE(tank_validateGeometry(geom)); // heights not ascending
+
+    geom.strap[1] = TankStrapPoint{20.0f, 5.0f};
+    TEST_ASSERT_FALSE(tank_validateGeometry(geom)); // liters decreasing
+
+    geom.shape = TankShape::CONE_BOTTOM;
+    geom.coneHeightCm = 0.0f;
+    TEST_ASSERT_FALSE(tank_validateGeometry(geom));
+
+    geom.shape = (TankShape)9;
+    TEST_ASSERT_FALSE(tank_validateGeometry(geom));
+
+    // A modelled shape without a tank volume has nothing to scale.
+    tank_geometryDefaults(geom);
+    geom.shape = TankShape::HORIZONTAL_CYLINDER;
+    uint32_t lut[CFG_TANK_LUT_POINTS];
+    TEST_ASSERT_FALSE(tank_buildVolumeLut(geom, NAN, kRodCm, lut, CFG_TANK_LUT_POINTS));
+}
+
+static void test_table_is_monotonic()
+{
+    TankGeometry geom;
+    tank_geometryDefaults(geom);
+    geom.shape = TankShape::HORIZONTAL_CYLINDER;
+    uint32_t lut[CFG_TANK_LUT_POINTS];
+    TEST_ASSERT_TRUE(tank_buildVolumeLut(geom, kVolumeL, kRodCm, lut, CFG_TANK_LUT_POINTS));
+    TEST_ASSERT_EQUAL_UINT32(0u, lut[0]);
+    for (size_t i = 1; i < CFG_TANK_LUT_POINTS; ++i)
+    {
+        TEST_ASSERT_TRUE(lut[i] >= lut[i - 1]);
+    }
+}
+
+static void test_shape_names_round_trip()
+{
+    const char *names[] = {"vertical_cylinder", "horizontal_cylinder", "rectangular", "cone_bottom", "strapping"};
+    for (uint8_t i = 0; i < 5u; ++i)
+    {
+        TankShape shape = TankShape::VERTICAL_CYLINDER;
+        TEST_ASSERT_TRUE(tank_shapeFromString(names[i], shape));
+        TEST_ASSERT_EQUAL_UINT8(i, (uint8_t)shape);
+    }
+    TankShape shape = TankShape::RECTANGULAR;
+    TEST_ASSERT_FALSE(tank_shapeFromString("sphere", shape));
+    TEST_ASSERT_FALSE(tank_shapeFromString(nullptr, shape));
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)TankShape::RECTANGULAR, (uint8_t)shape);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_linear_shapes_skip_the_table);
+    RUN_TEST(test_horizontal_cylinder_matches_closed_form);
+    RUN_TEST(test_cone_bottom_matches_closed_form);
+    RUN_TEST(test_strapping_table);
+    RUN_TEST(test_invalid_geometry_is_rejected);
+    RUN_TEST(test_table_is_monotonic);
+    RUN_TEST(test_shape_names_round_trip);
+    return UNITY_END();
+}